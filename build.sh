@@ -1,3 +1,23 @@
 #!/bin/bash
 mkdir -p build
-g++ -std=c++17 -Wall -g -O3 src/*.cpp -o build/test
+g++ -std=c++17 -Wall -g -O3 -pthread src/test.cpp -o build/test
+g++ -std=c++17 -Wall -O2 -pthread -DBIFSI_INSTRUMENT -DBIFSI_INSTRUMENT_CYCLES src/test.cpp -o build/test_instrument
+# the vector code of bifsi_batch.h is only compiled with these instruction
+# sets, so the tests are built once more for each. GCC 12 warns about the
+# uninitialized variable of _mm512_undefined_epi32 inside its own AVX-512
+# intrinsics, which is a false positive.
+g++ -std=c++17 -Wall -O2 -pthread -mavx2 src/test.cpp -o build/test_avx2
+g++ -std=c++17 -Wall -Wno-maybe-uninitialized -O2 -pthread -mavx512f src/test.cpp -o build/test_avx512
+g++ -std=c++17 -Wall -O3 src/bench.cpp -o build/bench
+if echo '#include <gmp.h>' | g++ -E -x c++ - > /dev/null 2>&1; then
+	g++ -std=c++17 -Wall -O3 -pthread src/fuzz.cpp -o build/fuzz -lgmp
+fi
+if command -v nvcc > /dev/null 2>&1; then
+	# the CUDA mode of the fuzzer, which is also what checks that the device
+	# code of bifsi_cuda.cuh compiles
+	if echo '#include <gmp.h>' | g++ -E -x c++ - > /dev/null 2>&1; then
+		nvcc -std=c++17 -O3 --expt-relaxed-constexpr -Xcompiler -Wall -x cu src/fuzz.cpp -o build/fuzz_cuda -lgmp -lpthread
+	else
+		echo "skipping build/fuzz_cuda, gmp.h not found"
+	fi
+fi
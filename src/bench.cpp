@@ -0,0 +1,419 @@
+/*
+ * bench.cpp
+ * published: 2022-09-04
+ * last change: 2022-09-04
+ *
+ * Copyright 2022 Daniel Strecker
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Stand alone program for measuring the performance of the bifsi library. You
+ * don't need this file for using the library.
+ *
+ * Measures ns/op and ops/s of the operations of bui for sizes from 128 to 8192
+ * bits and the element types uint8_t, uint16_t, uint32_t and uint64_t, and of
+ * the Karatsuba and NTT multiplication kernels up to 262144 bits, and prints
+ * the results as CSV, or as JSON with --json.
+ *
+ * Usage: bench [--json] [--min-time-ms <ms>]
+ */
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "bifsi.h"
+
+using std::cout;
+using std::endl;
+using std::string;
+
+/*
+ * Makes the compiler assume that value is read and the memory is modified, so
+ * the computation of value is neither removed nor hoisted out of the loop.
+ */
+template<typename T>
+inline void do_not_optimize(const T &value) {
+	asm volatile("" : : "r,m"(value) : "memory");
+}
+
+struct bench_result {
+	string el_t_name;
+	size_t size_in_bits;
+	string op;
+	size_t iterations;
+	double ns_per_op;
+	double ops_per_s;
+};
+
+std::vector<bench_result> results;
+
+double min_time_ns = 200e6;
+
+/*
+ * Runs op with doubling numbers of iterations until the runs take at least
+ * min_time_ns and records the last run.
+ */
+template<typename EL_T, typename OP_T>
+void measure(size_t size_in_bits, const string &op_name, OP_T op) {
+	size_t iterations = 1;
+
+	while (true) {
+		const auto start = std::chrono::steady_clock::now();
+
+		for (size_t i = 0; i < iterations; i++) {
+			op();
+		}
+
+		const auto end = std::chrono::steady_clock::now();
+
+		const double ns = std::chrono::duration<double, std::nano>(end - start).count();
+
+		if (ns >= min_time_ns || iterations >= ((size_t) 1 << 40)) {
+			bench_result r;
+			r.el_t_name = "uint" + std::to_string(sizeof(EL_T) * 8) + "_t";
+			r.size_in_bits = size_in_bits;
+			r.op = op_name;
+			r.iterations = iterations;
+			r.ns_per_op = ns / iterations;
+			r.ops_per_s = 1e9 / r.ns_per_op;
+
+			results.push_back(r);
+
+			std::cerr << r.el_t_name << " " << size_in_bits << " " << op_name << ": " << r.ns_per_op << " ns/op" << endl;
+
+			return;
+		}
+
+		iterations *= 2;
+	}
+}
+
+template<size_t SIZE_IN_BITS, typename EL_T>
+bifsi::bui<SIZE_IN_BITS, EL_T> random_bui() {
+	bifsi::bui<SIZE_IN_BITS, EL_T> result;
+
+	for (size_t i = 0; i < bifsi::bui<SIZE_IN_BITS, EL_T>::SIZE_IN_ELS; i++) {
+		result.el[i] = (EL_T) (((uint64_t) std::rand() << 33) ^ ((uint64_t) std::rand() << 16) ^ std::rand());
+	}
+
+	return result;
+}
+
+template<size_t SIZE_IN_BITS, typename EL_T>
+void bench_size() {
+	typedef bifsi::bui<SIZE_IN_BITS, EL_T> bui_t;
+
+	bui_t x = random_bui<SIZE_IN_BITS, EL_T>();
+	bui_t y = random_bui<SIZE_IN_BITS, EL_T>();
+
+	const EL_T m = (EL_T) (std::rand() | 1);
+
+	measure<EL_T>(SIZE_IN_BITS, "add", [&]() {
+		x += m;
+		do_not_optimize(x);
+	});
+
+	measure<EL_T>(SIZE_IN_BITS, "sub", [&]() {
+		x -= m;
+		do_not_optimize(x);
+	});
+
+	measure<EL_T>(SIZE_IN_BITS, "mul_scalar", [&]() {
+		x *= m;
+		do_not_optimize(x);
+	});
+
+	x = random_bui<SIZE_IN_BITS, EL_T>();
+
+	measure<EL_T>(SIZE_IN_BITS, "div_scalar", [&]() {
+		bui_t t = x;
+		do_not_optimize(t /= m);
+	});
+
+	measure<EL_T>(SIZE_IN_BITS, "mod_scalar", [&]() {
+		do_not_optimize(x);
+		do_not_optimize(x % m);
+	});
+
+	const bifsi::divisor<EL_T> dm(m);
+
+	measure<EL_T>(SIZE_IN_BITS, "div_divisor", [&]() {
+		bui_t t = x;
+		do_not_optimize(t /= dm);
+	});
+
+	measure<EL_T>(SIZE_IN_BITS, "mod_divisor", [&]() {
+		do_not_optimize(x);
+		do_not_optimize(x % dm);
+	});
+
+	measure<EL_T>(SIZE_IN_BITS, "compare", [&]() {
+		do_not_optimize(x);
+		do_not_optimize(x < m);
+	});
+
+	measure<EL_T>(SIZE_IN_BITS, "compare_bui", [&]() {
+		do_not_optimize(x);
+		do_not_optimize(x < y);
+	});
+
+	size_t n = 0;
+
+	measure<EL_T>(SIZE_IN_BITS, "shift", [&]() {
+		n = (n + 7) % SIZE_IN_BITS;
+		x <<= n;
+		x >>= n;
+		do_not_optimize(x);
+	});
+
+	measure<EL_T>(SIZE_IN_BITS, "mul", [&]() {
+		x *= y;
+		do_not_optimize(x);
+	});
+
+	x = random_bui<SIZE_IN_BITS, EL_T>();
+
+	measure<EL_T>(SIZE_IN_BITS, "mul_add", [&]() {
+		do_not_optimize(x);
+		do_not_optimize(bifsi::mul_add(x, y, x));
+	});
+
+	measure<EL_T>(SIZE_IN_BITS, "mul_add_scalar", [&]() {
+		do_not_optimize(x.mul_add_scalar(y, m));
+		do_not_optimize(x);
+	});
+
+	bui_t mod = random_bui<SIZE_IN_BITS, EL_T>();
+	mod.el[bui_t::SIZE_IN_ELS - 1] |= (EL_T) 1 << (sizeof(EL_T) * 8 - 1);
+
+	x %= mod;
+	y %= mod;
+
+	measure<EL_T>(SIZE_IN_BITS, "add_mod", [&]() {
+		x = bifsi::add_mod(x, y, mod);
+		do_not_optimize(x);
+	});
+
+	measure<EL_T>(SIZE_IN_BITS, "sub_mod", [&]() {
+		x = bifsi::sub_mod(x, y, mod);
+		do_not_optimize(x);
+	});
+
+	x = random_bui<SIZE_IN_BITS, EL_T>();
+
+	measure<EL_T>(SIZE_IN_BITS, "square", [&]() {
+		x.square();
+		do_not_optimize(x);
+	});
+
+	x = random_bui<SIZE_IN_BITS, EL_T>();
+
+	measure<EL_T>(SIZE_IN_BITS, "str", [&]() {
+		do_not_optimize(x);
+		const string s = x.str();
+		do_not_optimize(s.data());
+	});
+
+	const string dec = x.str();
+
+	measure<EL_T>(SIZE_IN_BITS, "from_chars_dec", [&]() {
+		bui_t t;
+		do_not_optimize(bifsi::from_chars(dec.data(), dec.data() + dec.size(), t));
+		do_not_optimize(t);
+	});
+
+	const string hex(SIZE_IN_BITS / 4, 'f');
+
+	measure<EL_T>(SIZE_IN_BITS, "from_chars_hex", [&]() {
+		bui_t t;
+		do_not_optimize(bifsi::from_chars(hex.data(), hex.data() + hex.size(), t, 16));
+		do_not_optimize(t);
+	});
+
+	// values using a quarter of the size, with the policies ct and vartime
+	bui_t a = random_bui<SIZE_IN_BITS, EL_T>() >>= (SIZE_IN_BITS - SIZE_IN_BITS / 4);
+	bui_t b = random_bui<SIZE_IN_BITS, EL_T>() >>= (SIZE_IN_BITS - SIZE_IN_BITS / 4);
+	bui_t d = random_bui<SIZE_IN_BITS, EL_T>() >>= (SIZE_IN_BITS - SIZE_IN_BITS / 8);
+	d.el[0] |= 1;
+
+	measure<EL_T>(SIZE_IN_BITS, "mul_quarter", [&]() {
+		do_not_optimize(a);
+		do_not_optimize(bifsi::mul(a, b));
+	});
+
+	measure<EL_T>(SIZE_IN_BITS, "mul_quarter_vartime", [&]() {
+		do_not_optimize(a);
+		do_not_optimize(bifsi::mul<bifsi::vartime>(a, b));
+	});
+
+	measure<EL_T>(SIZE_IN_BITS, "divmod_quarter", [&]() {
+		do_not_optimize(a);
+		do_not_optimize(bifsi::divmod(a, d));
+	});
+
+	measure<EL_T>(SIZE_IN_BITS, "divmod_quarter_vartime", [&]() {
+		do_not_optimize(a);
+		do_not_optimize(bifsi::divmod<bifsi::vartime>(a, d));
+	});
+
+	measure<EL_T>(SIZE_IN_BITS, "compare_quarter", [&]() {
+		do_not_optimize(a);
+		do_not_optimize(a.compare(b));
+	});
+
+	measure<EL_T>(SIZE_IN_BITS, "compare_quarter_vartime", [&]() {
+		do_not_optimize(a);
+		do_not_optimize(a.template compare<bifsi::vartime>(b));
+	});
+
+	measure<EL_T>(SIZE_IN_BITS, "str_quarter", [&]() {
+		do_not_optimize(a);
+		const string s = a.str();
+		do_not_optimize(s.data());
+	});
+
+	measure<EL_T>(SIZE_IN_BITS, "str_quarter_vartime", [&]() {
+		do_not_optimize(a);
+		const string s = a.template str<bifsi::vartime>();
+		do_not_optimize(s.data());
+	});
+
+	const string dec_quarter = a.str();
+
+	measure<EL_T>(SIZE_IN_BITS, "from_chars_dec_quarter", [&]() {
+		bui_t t;
+		do_not_optimize(bifsi::from_chars(dec_quarter.data(), dec_quarter.data() + dec_quarter.size(), t));
+		do_not_optimize(t);
+	});
+
+	measure<EL_T>(SIZE_IN_BITS, "from_chars_dec_quarter_vartime", [&]() {
+		bui_t t;
+		do_not_optimize(bifsi::from_chars<bifsi::vartime>(dec_quarter.data(), dec_quarter.data() + dec_quarter.size(), t));
+		do_not_optimize(t);
+	});
+}
+
+/*
+ * Measures the multiplication kernels for sizes around NTT_THRESHOLD_ELS,
+ * where bench_size would take too long for the slower operations.
+ */
+template<size_t SIZE_IN_BITS, typename EL_T>
+void bench_large_mul() {
+	typedef bifsi::bui<SIZE_IN_BITS, EL_T> bui_t;
+
+	constexpr size_t N = bui_t::SIZE_IN_ELS;
+
+	// static, the products don't fit onto the stack next to the temporaries
+	static bui_t x = random_bui<SIZE_IN_BITS, EL_T>();
+	static bui_t y = random_bui<SIZE_IN_BITS, EL_T>();
+	static EL_T r[2 * N];
+
+	measure<EL_T>(SIZE_IN_BITS, "mul_karatsuba", [&]() {
+		bifsi::karatsuba_mul<N>(r, x.el, y.el);
+		do_not_optimize(r[0]);
+	});
+
+	measure<EL_T>(SIZE_IN_BITS, "mul_ntt", [&]() {
+		bifsi::ntt_mul<2 * N, N>(r, x.el, y.el);
+		do_not_optimize(r[0]);
+	});
+
+	measure<EL_T>(SIZE_IN_BITS, "sqr_karatsuba", [&]() {
+		bifsi::karatsuba_sqr<N>(r, x.el);
+		do_not_optimize(r[0]);
+	});
+
+	measure<EL_T>(SIZE_IN_BITS, "sqr_ntt", [&]() {
+		bifsi::ntt_mul<2 * N, N>(r, x.el, (const EL_T*) nullptr);
+		do_not_optimize(r[0]);
+	});
+}
+
+template<typename EL_T>
+void bench_el_type() {
+	bench_size<128, EL_T>();
+	bench_size<256, EL_T>();
+	bench_size<512, EL_T>();
+	bench_size<1024, EL_T>();
+	bench_size<2048, EL_T>();
+	bench_size<4096, EL_T>();
+	bench_size<8192, EL_T>();
+
+	if constexpr (sizeof(EL_T) >= 4) {
+		bench_large_mul<32768, EL_T>();
+		bench_large_mul<65536, EL_T>();
+		bench_large_mul<131072, EL_T>();
+		bench_large_mul<262144, EL_T>();
+	}
+}
+
+void print_csv() {
+	cout << "el_t,size_in_bits,op,iterations,ns_per_op,ops_per_s" << endl;
+
+	for (const bench_result &r : results) {
+		cout << r.el_t_name << "," << r.size_in_bits << "," << r.op << "," << r.iterations << "," << r.ns_per_op << "," << r.ops_per_s << endl;
+	}
+}
+
+void print_json() {
+	cout << "[" << endl;
+
+	for (size_t i = 0; i < results.size(); i++) {
+		const bench_result &r = results[i];
+
+		cout << "  {\"el_t\": \"" << r.el_t_name << "\", \"size_in_bits\": " << r.size_in_bits << ", \"op\": \"" << r.op << "\", \"iterations\": " << r.iterations << ", \"ns_per_op\": " << r.ns_per_op << ", \"ops_per_s\": " << r.ops_per_s << "}" << (i + 1 < results.size() ? "," : "") << endl;
+	}
+
+	cout << "]" << endl;
+}
+
+int main(int argc, char **argv) {
+	bool json = false;
+
+	for (int i = 1; i < argc; i++) {
+		if (std::strcmp(argv[i], "--json") == 0) {
+			json = true;
+
+		} else if (std::strcmp(argv[i], "--min-time-ms") == 0 && i + 1 < argc) {
+			min_time_ns = std::atof(argv[++i]) * 1e6;
+
+		} else {
+			std::cerr << "usage: " << argv[0] << " [--json] [--min-time-ms <ms>]" << endl;
+			return 1;
+		}
+	}
+
+	std::srand(12345);
+
+	bench_el_type<uint8_t>();
+	bench_el_type<uint16_t>();
+	bench_el_type<uint32_t>();
+	bench_el_type<uint64_t>();
+
+	cout.precision(6);
+
+	if (json) {
+		print_json();
+	} else {
+		print_csv();
+	}
+
+	return 0;
+}
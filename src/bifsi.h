@@ -35,6 +35,9 @@
  * you can find at
  * https://www.boost.org/doc/libs/1_80_0/libs/multiprecision/doc/html/boost_multiprecision/tut/ints/cpp_int.html .
  * (TOC: https://www.boost.org/doc/libs/1_80_0/libs/multiprecision/doc/html/index.html )
+ * For public values on CPUs, multiplication, division, comparison and the
+ * conversions from and to decimal strings can be given the execution policy
+ * vartime, with which they skip leading zero elements, see vartime.
  */
 
 #ifndef BIFSI_H_
@@ -46,16 +49,52 @@
 #include <cstring>
 #include <iostream>
 #include <string>
+#include <system_error>
 #include <type_traits>
 #include <typeinfo>
+#include <utility>
 #include <algorithm>
 
+#if __cplusplus >= 202002L
+#include <compare>
+#endif
+
+/*
+ * True while a constexpr function is evaluated at compile time. The carry
+ * chains then use the portable primitives instead of the intrinsics, which
+ * aren't constexpr. Always false for compilers without the builtin.
+ */
+#if defined(__has_builtin)
+#if __has_builtin(__builtin_is_constant_evaluated)
+#define BIFSI_IS_CONSTANT_EVALUATED() __builtin_is_constant_evaluated()
+#endif
+#endif
+
+#ifndef BIFSI_IS_CONSTANT_EVALUATED
+#define BIFSI_IS_CONSTANT_EVALUATED() false
+#endif
+
+#if defined(__x86_64__) && !defined(BIFSI_NO_INTRINSICS)
+#include <immintrin.h>
+#endif
+
 #ifndef __NVCC__
 #define __host__
 #define __device__
 #define __global__
 #endif
 
+/*
+ * Hooks for the counters of bifsi_instrument.h, which are 0 instructions
+ * unless BIFSI_INSTRUMENT is defined before including this file.
+ */
+#ifdef BIFSI_INSTRUMENT
+#include "bifsi_instrument.h"
+#else
+#define BIFSI_INSTRUMENT_BEGIN(OP)
+#define BIFSI_INSTRUMENT_END(OP, LIMB_OPS)
+#endif
+
 namespace {
 
 /*
@@ -92,17 +131,60 @@ twice_size_t<UINT_T> f(UINT_T x) {
 
 namespace bifsi {
 
+/*
+ * The platforms for which default_el_t selects an element type.
+ */
+enum class platform {
+	host, cuda
+};
+
+/*
+ * The platform of the current translation unit. In a translation unit compiled
+ * by nvcc, the host code uses the cuda platform as well, so that host and
+ * device agree on the layout of the values that are copied between them.
+ */
+#ifdef __NVCC__
+constexpr platform current_platform = platform::cuda;
+#else
+constexpr platform current_platform = platform::host;
+#endif
+
+/*
+ * Selects the fastest element type of a platform. On the host, this is
+ * uint64_t if the compiler provides unsigned __int128 as its twice size type,
+ * because then the product of two elements is a single instruction. GPUs have
+ * no native 128 bit multiplication, so they use uint32_t.
+ */
+template<platform PLATFORM> struct default_el;
+template<platform PLATFORM> using default_el_t = typename default_el<PLATFORM>::type;
+
+#ifdef __GNUC__
+template<> struct default_el<platform::host> {
+	typedef uint64_t type;
+};
+#else
+template<> struct default_el<platform::host> {
+	typedef uint32_t type;
+};
+#endif
+template<> struct default_el<platform::cuda> {
+	typedef uint32_t type;
+};
+
 /*
  * Integer type of the elements (limbs) that a big int uses to store its
- * magnitude. Usually, the best choice for this type is the second largest type
- * that is provided by the C++ environment. It's not the largest type, because
- * some operation implementations, e.g. multiplication, need a type that is
- * twice the size of this element type.
+ * magnitude by default, see the EL_T parameter of bui. Usually, the best
+ * choice for this type is the second largest type that is provided by the C++
+ * environment. It's not the largest type, because some operation
+ * implementations, e.g. multiplication, need a type that is twice the size of
+ * this element type. Define BIFSI_EL_T before including this file to select
+ * another default, e.g. -DBIFSI_EL_T=uint32_t.
  */
-//typedef uint8_t el_t;
-//typedef uint16_t el_t;
-typedef uint32_t el_t;
-//typedef uint64_t el_t;
+#ifdef BIFSI_EL_T
+typedef BIFSI_EL_T el_t;
+#else
+typedef default_el_t<current_platform> el_t;
+#endif
 
 /*
  * Integer type twice the size of the element type. Many C++ environments
@@ -143,7 +225,7 @@ inline constexpr int32_t ceil_constexpr(double d) {
  */
 template<typename INT_T>
 __host__ __device__
-inline int wrapped_builtin_clz(const INT_T &x) {
+inline constexpr int wrapped_builtin_clz(const INT_T &x) {
 	if (sizeof(INT_T) == sizeof(unsigned char)) {
 		return __builtin_clz((unsigned int) x) - 24;
 
@@ -167,13 +249,25 @@ inline int wrapped_builtin_clz(const INT_T &x) {
 
 template<typename INT_T>
 __host__ __device__
-inline int number_of_leading_0_bits(const INT_T &x) {
+inline constexpr int number_of_leading_0_bits(const INT_T &x) {
 	return (x == 0) ? (sizeof(INT_T) * 8) : wrapped_builtin_clz(x);
 }
 
+/*
+ * Number of trailing 0 bits of x. Zero extending x to unsigned long long
+ * doesn't change them, so one intrinsic works for all types.
+ */
+template<typename INT_T>
+__host__ __device__
+inline constexpr int number_of_trailing_0_bits(const INT_T &x) {
+	static_assert(sizeof(INT_T) <= sizeof(unsigned long long), "no suitable __builtin_ctz intrinsic for INT_T");
+
+	return (x == 0) ? (sizeof(INT_T) * 8) : __builtin_ctzll((unsigned long long) x);
+}
+
 template<typename INT_T>
 __host__ __device__
-inline int bitlen(const INT_T &x) {
+inline constexpr int bitlen(const INT_T &x) {
 	return (x == 0) ? sizeof(INT_T) * 8 : sizeof(INT_T) * 8 - wrapped_builtin_clz(x);
 }
 
@@ -193,6 +287,107 @@ std::string type_name() {
 	return result;
 }
 
+/*
+ * Like std::is_unsigned_v, std::is_signed_v and std::is_integral_v, but also
+ * true for unsigned __int128 and __int128, which the standard library only
+ * treats as integers in the GNU modes like -std=gnu++17, not with -std=c++17.
+ */
+#ifdef __GNUC__
+template<typename T>
+constexpr bool is_unsigned_int_v = std::is_unsigned_v<T> || std::is_same_v<std::remove_cv_t<T>, unsigned __int128>;
+
+template<typename T>
+constexpr bool is_signed_int_v = (std::is_integral_v<T> && std::is_signed_v<T>) || std::is_same_v<std::remove_cv_t<T>, __int128>;
+#else
+template<typename T>
+constexpr bool is_unsigned_int_v = std::is_unsigned_v<T>;
+
+template<typename T>
+constexpr bool is_signed_int_v = std::is_integral_v<T> && std::is_signed_v<T>;
+#endif
+
+template<typename T>
+constexpr bool is_int_v = std::is_integral_v<T> || is_unsigned_int_v<T> || is_signed_int_v<T>;
+
+/*
+ * Like std::make_unsigned_t, but also for __int128, see is_unsigned_int_v.
+ */
+template<typename T> struct make_unsigned {
+	using type = std::make_unsigned_t<T>;
+};
+#ifdef __GNUC__
+template<> struct make_unsigned<__int128> {
+	using type = unsigned __int128;
+};
+template<> struct make_unsigned<unsigned __int128> {
+	using type = unsigned __int128;
+};
+#endif
+template<typename T> using make_unsigned_t = typename make_unsigned<T>::type;
+
+/*
+ * Array of N objects of type T. Unlike T[N], it can be made of copies of a
+ * value in constant expressions with filled(), without default constructing
+ * the elements first, so it works for bui, whose default constructor leaves
+ * the value uninitialized and therefore isn't constexpr.
+ */
+template<typename T, size_t N>
+struct fixed_array {
+	T v[N];
+
+	__host__ __device__
+	inline constexpr T& operator[](const size_t &i) {
+		return v[i];
+	}
+
+	__host__ __device__
+	inline constexpr const T& operator[](const size_t &i) const {
+		return v[i];
+	}
+
+	__host__ __device__
+	static inline constexpr fixed_array filled(const T &x) {
+		return filled(x, std::make_index_sequence<N>());
+	}
+
+private:
+	template<size_t ... I>
+	__host__ __device__
+	static inline constexpr fixed_array filled(const T &x, std::index_sequence<I...>) {
+		return { { ((void) I, x)... } };
+	}
+};
+
+/*
+ * Execution policies for the operations that take one as their first template
+ * parameter, e.g. divmod<vartime>(a, d) or a.compare<vartime>(b).
+ *
+ * ct is the default and the behavior of all other operations: the number of
+ * iterations depends only on the sizes, so the threads of a warp stay
+ * coherent, see the top of this file.
+ *
+ * With vartime, an operation counts the used elements of its operands, i.e.
+ * those up to the topmost nonzero one, and only processes these, and
+ * comparisons stop at the first element that differs. This is much faster on
+ * CPUs for values far below the size of their type, but the execution time
+ * reveals the values, so use it for public values only, e.g. when parsing or
+ * pre-screening prime candidates on the host, and not for secrets or in
+ * kernels, where it lets the threads of a warp diverge.
+ */
+struct ct {
+};
+
+struct vartime {
+};
+
+template<typename POLICY>
+constexpr bool is_vartime_v = std::is_same_v<POLICY, vartime>;
+
+template<typename POLICY>
+inline static constexpr void static_assert_policy() {
+	static_assert(std::is_same_v<POLICY, ct> || std::is_same_v<POLICY, vartime>, "POLICY is neither ct nor vartime");
+}
+
 /**
  * Fails if INT_T is not an integer or if it is neither signed nor
  * unsigned. If INT_T passes the checks, then this function translates to
@@ -200,19 +395,19 @@ std::string type_name() {
  */
 template<typename INT_T>
 inline static constexpr void static_assert_singed_or_unsigned_int_type() {
-	static_assert(std::is_integral_v<INT_T>, "INT_T is not an integer type");
-	static_assert(std::is_unsigned_v<INT_T> || std::is_signed_v<INT_T>, "INT_T is neither signed nor unsigned");
+	static_assert(is_int_v<INT_T>, "INT_T is not an integer type");
+	static_assert(is_unsigned_int_v<INT_T> || is_signed_int_v<INT_T>, "INT_T is neither signed nor unsigned");
 }
 
 template<typename UINT_T>
 inline static constexpr void assert_unsigned_int_type() {
-	static_assert(std::is_integral_v<UINT_T>, "UINT_T is not an integer type");
+	static_assert(is_int_v<UINT_T>, "UINT_T is not an integer type");
 
 	// making the check for unsignedness at runtime allows for easier code
 	// using this function and it is completely optimized away when not
 	// failing, because it's already known at compile time if the check
 	// fails or succeeds.
-	assert(std::is_unsigned_v<UINT_T>);
+	assert(is_unsigned_int_v<UINT_T>);
 }
 
 template<typename UINT_T>
@@ -242,988 +437,4769 @@ inline std::string uint_to_string(const UINT_T &x) {
 	return std::string(result);
 }
 
-/**
- * This class represents an unsigned big fixed size int with the specified size
- * in number of bits. bui means simply big unsigned int. This is the central
- * class of this library.
- */
-template<size_t SIZE_IN_BITS>
-class bui {
-private:
-	static_assert(sizeof(tw_t) == 2 * sizeof(el_t), "constraint not fulfilled: sizeof(tw_t) == 2 * sizeof(el_t)");
-	// static_assert(sizeof(el_t) == 2 * sizeof(ha_t), "constraint not fulfilled: sizeof(el_t) = 2 * sizeof(ha_t)");
-	static_assert(EL_SIZE_IN_BITS % 8 == 0, "constraint not fulfilled: EL_SIZE_IN_BITS % 8 == 0");
-	static_assert(SIZE_IN_BITS > 0, "constraint not fulfilled: SIZE_IN_BITS > 0");
-	static_assert(SIZE_IN_BITS % EL_SIZE_IN_BITS == 0, "constraint not fulfilled: SIZE_IN_BITS % EL_SIZE_IN_BITS == 0");
-
-public:
-	/*
-	 * Number of elements that this big int uses to store its magnitude.
-	 */
-	static const size_t SIZE_IN_ELS = SIZE_IN_BITS / EL_SIZE_IN_BITS;
+#ifndef BIFSI_KARATSUBA_THRESHOLD_ELS
+#define BIFSI_KARATSUBA_THRESHOLD_ELS 32
+#endif
 
-	/*
-	 * Array of data elements which store the magnitude of this big int.
-	 */
-	el_t el[SIZE_IN_ELS];
+/*
+ * Number of elements starting at which the multiplication of two big ints
+ * switches from the Comba kernel to Karatsuba. Below this threshold, the
+ * quadratic Comba kernel is faster, because it needs neither recursion nor
+ * temporaries. Define BIFSI_KARATSUBA_THRESHOLD_ELS before including this file
+ * to override the default.
+ */
+const size_t KARATSUBA_THRESHOLD_ELS = BIFSI_KARATSUBA_THRESHOLD_ELS;
 
-	/*
-	 * Constructs a new object of this type. The value is not initialized, so
-	 * it's arbitrary. This constructor is empty and if fully optimized by the
-	 * compiler, it translates to zero instructions.
-	 */
-	__host__ __device__
-	inline bui() {
-	}
+#ifndef BIFSI_NTT_THRESHOLD_ELS
+#define BIFSI_NTT_THRESHOLD_ELS 2048
+#endif
 
-	template<typename INT_T>
-	__host__ __device__
-	inline constexpr bui(const INT_T &value) :
-			bui() {
-		static_assert_singed_or_unsigned_int_type<INT_T>();
+/*
+ * Number of elements starting at which the multiplication of two big ints
+ * switches from Karatsuba to the number theoretic transform of ntt_mul, which
+ * is O(n log n), but with a big constant factor. This is on the host only,
+ * see ntt_mul. Define BIFSI_NTT_THRESHOLD_ELS before including this file to
+ * override the default.
+ */
+const size_t NTT_THRESHOLD_ELS = BIFSI_NTT_THRESHOLD_ELS;
 
-		if (std::is_unsigned_v<INT_T>) {
-			this->set_uint(value);
-		} else {
-			this->set_uint(static_cast<std::make_unsigned_t<INT_T>>(value));
-		}
-	}
+#ifndef BIFSI_NTT_MAX_SIZE
+#define BIFSI_NTT_MAX_SIZE 16384
+#endif
 
-	__host__ __device__
-	inline constexpr bui(const char *value) :
-			bui() {
-		this->set(value);
-	}
+/*
+ * Maximum length of the transforms of ntt_mul, a power of 2. The default of
+ * 2^14 covers products of two values of 2^18 bits. mul_els takes the
+ * temporaries of ntt_mul from the stack, which are 256 KiB at this length,
+ * and products that need longer transforms stay with Karatsuba. Define
+ * BIFSI_NTT_MAX_SIZE before including this file to override the default.
+ */
+const size_t NTT_MAX_SIZE = BIFSI_NTT_MAX_SIZE;
 
-	__host__ __device__
-	inline constexpr el_t to_el_t() const {
-		return el[0];
-	}
+#ifndef BIFSI_MONT_SQR_THRESHOLD_ELS
+#define BIFSI_MONT_SQR_THRESHOLD_ELS 12
+#endif
 
-	__host__ __device__
-	inline constexpr tw_t to_tw_t() const {
-		if (SIZE_IN_ELS == 1) {
-			return el[0];
-		} else {
-			return el[0] | (((tw_t) el[1]) << EL_SIZE_IN_BITS);
-		}
-	}
+/*
+ * Number of elements starting at which montgomery::mont_sqr squares with
+ * sqr_els and reduces separately. Below this threshold, the interleaved
+ * product and reduction of mont_mul is faster, although it computes each
+ * cross product twice. Define BIFSI_MONT_SQR_THRESHOLD_ELS before including
+ * this file to override the default.
+ */
+const size_t MONT_SQR_THRESHOLD_ELS = BIFSI_MONT_SQR_THRESHOLD_ELS;
 
-	__host__ __device__
-	inline explicit constexpr operator el_t() const {
-		return to_el_t();
-	}
+/*
+ * Portable implementations of the carry chain primitives addc, subb and
+ * mul_wide. The carry is found by comparison and the product is formed in the
+ * twice size type. These are the fallback for element types and platforms
+ * without intrinsics and the reference for the tests.
+ */
+namespace portable {
 
-	__host__ __device__
-	inline explicit constexpr operator tw_t() const {
-		return to_tw_t();
-	}
+/*
+ * Returns the low element of a + b + carry and stores the carry out in carry.
+ * carry must be 0 or 1.
+ */
+template<typename EL_T>
+__host__ __device__
+inline constexpr EL_T addc(const EL_T &a, const EL_T &b, EL_T &carry) {
+	EL_T s = (EL_T) (a + carry);
+	EL_T c = (s < carry);
 
-private:
-	template<typename UINT_T>
-	__host__ __device__
-	inline constexpr void set_uint(const UINT_T &value) {
-		assert_unsigned_int_type<UINT_T>();
+	s = (EL_T) (s + b);
+	c |= (s < b);
 
-		if (sizeof(el_t) >= sizeof(UINT_T) || SIZE_IN_ELS == 1) {
-			el[0] = value;
-			set_zero_starting_at_el<1>();
+	carry = c;
 
-		} else if (2 * sizeof(el_t) >= sizeof(UINT_T) || SIZE_IN_ELS == 2) {
-			el[0] = value;
-			el[1] = value >> 1 * EL_SIZE_IN_BITS;
-			set_zero_starting_at_el<2>();
+	return s;
+}
 
-		} else if (4 * sizeof(el_t) >= sizeof(UINT_T) || SIZE_IN_ELS <= 4) {
-			el[0] = value;
-			el[1] = value >> 1 * EL_SIZE_IN_BITS;
-			el[2] = value >> 2 * EL_SIZE_IN_BITS;
+/*
+ * Returns the low element of a - b - borrow and stores the borrow out in
+ * borrow. borrow must be 0 or 1.
+ */
+template<typename EL_T>
+__host__ __device__
+inline constexpr EL_T subb(const EL_T &a, const EL_T &b, EL_T &borrow) {
+	EL_T d = (EL_T) (a - borrow);
+	EL_T c = (d > a);
 
-			if (SIZE_IN_ELS == 3) {
-				set_zero_starting_at_el<3>();
-			} else {
-				el[3] = value >> 3 * EL_SIZE_IN_BITS;
-				set_zero_starting_at_el<4>();
-			}
+	const EL_T d_before = d;
+	d = (EL_T) (d - b);
+	c |= (d > d_before);
 
-		} else if (8 * sizeof(el_t) >= sizeof(UINT_T) || SIZE_IN_ELS <= 8) {
-			el[0] = value;
-			el[1] = value >> 1 * EL_SIZE_IN_BITS;
-			el[2] = value >> 2 * EL_SIZE_IN_BITS;
-			el[3] = value >> 3 * EL_SIZE_IN_BITS;
-			el[4] = value >> 4 * EL_SIZE_IN_BITS;
+	borrow = c;
 
-			if (SIZE_IN_ELS == 5) {
-				set_zero_starting_at_el<5>();
+	return d;
+}
 
-			} else if (SIZE_IN_ELS == 6) {
-				el[5] = value >> 5 * EL_SIZE_IN_BITS;
-				set_zero_starting_at_el<6>();
+/*
+ * Returns the low element of the product a * b and stores the high element in
+ * hi.
+ */
+template<typename EL_T>
+__host__ __device__
+inline constexpr EL_T mul_wide(const EL_T &a, const EL_T &b, EL_T &hi) {
+	typedef twice_size_t<EL_T> TW_T;
 
-			} else if (SIZE_IN_ELS == 7) {
-				el[5] = value >> 5 * EL_SIZE_IN_BITS;
-				el[6] = value >> 6 * EL_SIZE_IN_BITS;
-				set_zero_starting_at_el<7>();
+	const TW_T p = ((TW_T) a) * b;
+	hi = (EL_T) (p >> (sizeof(EL_T) * 8));
 
-			} else {
-				el[5] = value >> 5 * EL_SIZE_IN_BITS;
-				el[6] = value >> 6 * EL_SIZE_IN_BITS;
-				el[7] = value >> 7 * EL_SIZE_IN_BITS;
-				set_zero_starting_at_el<8>();
+	return (EL_T) p;
+}
 
-			}
+} /* namespace portable */
 
-		} else {
-			static_assert(8 * sizeof(el_t) >= sizeof(uint64_t), "no suitable way to assign from UINT_T");
+/*
+ * The carry chain primitives with intrinsics or inline PTX. Neither is allowed
+ * in constant expressions, so they are only called by the dispatching addc,
+ * subb and mul_wide in namespace bifsi below, outside of constant evaluation.
+ */
+namespace intrinsic {
 
-		}
+/*
+ * Carry chain primitive, see portable::addc. On x86-64, 32 and 64 bit
+ * elements use _addcarry_u32/_addcarry_u64, which compile to adc, so the
+ * carry stays in the carry flag between the elements of a loop. On CUDA, 32
+ * and 64 bit elements use the PTX instructions add.cc and addc. Define
+ * BIFSI_NO_INTRINSICS to always use the portable implementation.
+ */
+template<typename EL_T>
+__host__ __device__
+inline EL_T addc(const EL_T &a, const EL_T &b, EL_T &carry) {
+#if defined(__CUDA_ARCH__) && !defined(BIFSI_NO_INTRINSICS)
+	if constexpr (sizeof(EL_T) == 4) {
+		EL_T s;
+		EL_T c;
+
+		// carry + 0xffffffff sets the carry flag iff carry is 1
+		asm("add.cc.u32 %0, %2, 0xffffffff;\n\t"
+				"addc.cc.u32 %0, %3, %4;\n\t"
+				"addc.u32 %1, 0, 0;" : "=&r"(s), "=r"(c) : "r"(carry), "r"(a), "r"(b));
+
+		carry = c;
+		return s;
+
+	} else if constexpr (sizeof(EL_T) == 8) {
+		EL_T s;
+		EL_T c;
+
+		asm("add.cc.u64 %0, %2, 0xffffffffffffffff;\n\t"
+				"addc.cc.u64 %0, %3, %4;\n\t"
+				"addc.u64 %1, 0, 0;" : "=&l"(s), "=l"(c) : "l"(carry), "l"(a), "l"(b));
+
+		carry = c;
+		return s;
 	}
+#elif defined(__x86_64__) && !defined(BIFSI_NO_INTRINSICS)
+	if constexpr (sizeof(EL_T) == 4) {
+		unsigned int s;
+		carry = _addcarry_u32((unsigned char) carry, a, b, &s);
+		return s;
+
+	} else if constexpr (sizeof(EL_T) == 8) {
+		unsigned long long s;
+		carry = _addcarry_u64((unsigned char) carry, a, b, &s);
+		return s;
+	}
+#endif
 
-	template<typename UINT_T>
-	__host__ __device__
-	inline constexpr UINT_T as_uint() const {
-		assert_unsigned_int_type<UINT_T>();
-
-		if (1 * sizeof(el_t) >= sizeof(UINT_T) || SIZE_IN_ELS == 1) {
-			return el[0];
+	return portable::addc(a, b, carry);
+}
 
-		} else if (2 * sizeof(el_t) >= sizeof(UINT_T) || SIZE_IN_ELS == 2) {
-			return el[0] | //
-					(((UINT_T) el[1]) << 1 * EL_SIZE_IN_BITS);
+/*
+ * Borrow chain primitive, see portable::subb. Uses _subborrow_u32/
+ * _subborrow_u64 (sbb) on x86-64 and sub.cc and subc on CUDA, like addc.
+ */
+template<typename EL_T>
+__host__ __device__
+inline EL_T subb(const EL_T &a, const EL_T &b, EL_T &borrow) {
+#if defined(__CUDA_ARCH__) && !defined(BIFSI_NO_INTRINSICS)
+	if constexpr (sizeof(EL_T) == 4) {
+		EL_T d;
+		EL_T c;
+
+		// 0 - borrow sets the borrow flag iff borrow is 1, the final subc
+		// yields 0 or 0xffffffff
+		asm("sub.cc.u32 %0, 0, %2;\n\t"
+				"subc.cc.u32 %0, %3, %4;\n\t"
+				"subc.u32 %1, 0, 0;" : "=&r"(d), "=r"(c) : "r"(borrow), "r"(a), "r"(b));
+
+		borrow = c & 1;
+		return d;
+
+	} else if constexpr (sizeof(EL_T) == 8) {
+		EL_T d;
+		EL_T c;
+
+		asm("sub.cc.u64 %0, 0, %2;\n\t"
+				"subc.cc.u64 %0, %3, %4;\n\t"
+				"subc.u64 %1, 0, 0;" : "=&l"(d), "=l"(c) : "l"(borrow), "l"(a), "l"(b));
+
+		borrow = c & 1;
+		return d;
+	}
+#elif defined(__x86_64__) && !defined(BIFSI_NO_INTRINSICS)
+	if constexpr (sizeof(EL_T) == 4) {
+		unsigned int d;
+		borrow = _subborrow_u32((unsigned char) borrow, a, b, &d);
+		return d;
+
+	} else if constexpr (sizeof(EL_T) == 8) {
+		unsigned long long d;
+		borrow = _subborrow_u64((unsigned char) borrow, a, b, &d);
+		return d;
+	}
+#endif
 
-		} else if (4 * sizeof(el_t) >= sizeof(UINT_T) || SIZE_IN_ELS <= 4) {
-			if (SIZE_IN_ELS == 3) {
-				return el[0] | //
-						(((UINT_T) el[1]) << 1 * EL_SIZE_IN_BITS) | //
-						(((UINT_T) el[2]) << 2 * EL_SIZE_IN_BITS);
+	return portable::subb(a, b, borrow);
+}
 
-			} else {
-				return el[0] | //
-						(((UINT_T) el[1]) << 1 * EL_SIZE_IN_BITS) | //
-						(((UINT_T) el[2]) << 2 * EL_SIZE_IN_BITS) | //
-						(((UINT_T) el[3]) << 3 * EL_SIZE_IN_BITS);
+} /* namespace intrinsic */
 
-			}
+/*
+ * Returns the low element of a + b + carry and stores the carry out in carry.
+ * carry must be 0 or 1. Uses intrinsic::addc, or portable::addc in constant
+ * evaluation.
+ */
+template<typename EL_T>
+__host__ __device__
+inline constexpr EL_T addc(const EL_T &a, const EL_T &b, EL_T &carry) {
+	return BIFSI_IS_CONSTANT_EVALUATED() ? portable::addc(a, b, carry) : intrinsic::addc(a, b, carry);
+}
 
-		} else if (8 * sizeof(el_t) >= sizeof(UINT_T) || SIZE_IN_ELS <= 8) {
-			if (SIZE_IN_ELS == 5) {
-				return el[0] | //
-						(((UINT_T) el[1]) << 1 * EL_SIZE_IN_BITS) | //
-						(((UINT_T) el[2]) << 2 * EL_SIZE_IN_BITS) | //
-						(((UINT_T) el[3]) << 3 * EL_SIZE_IN_BITS) | //
-						(((UINT_T) el[4]) << 4 * EL_SIZE_IN_BITS);
-
-			} else if (SIZE_IN_ELS == 6) {
-				return el[0] | //
-						(((UINT_T) el[1]) << 1 * EL_SIZE_IN_BITS) | //
-						(((UINT_T) el[2]) << 2 * EL_SIZE_IN_BITS) | //
-						(((UINT_T) el[3]) << 3 * EL_SIZE_IN_BITS) | //
-						(((UINT_T) el[4]) << 4 * EL_SIZE_IN_BITS) | //
-						(((UINT_T) el[5]) << 5 * EL_SIZE_IN_BITS);
-
-			} else if (SIZE_IN_ELS == 7) {
-				return el[0] | //
-						(((UINT_T) el[1]) << 1 * EL_SIZE_IN_BITS) | //
-						(((UINT_T) el[2]) << 2 * EL_SIZE_IN_BITS) | //
-						(((UINT_T) el[3]) << 3 * EL_SIZE_IN_BITS) | //
-						(((UINT_T) el[4]) << 4 * EL_SIZE_IN_BITS) | //
-						(((UINT_T) el[5]) << 5 * EL_SIZE_IN_BITS) | //
-						(((UINT_T) el[6]) << 6 * EL_SIZE_IN_BITS);
+/*
+ * Returns the low element of a - b - borrow and stores the borrow out in
+ * borrow. borrow must be 0 or 1. Uses intrinsic::subb, or portable::subb in
+ * constant evaluation.
+ */
+template<typename EL_T>
+__host__ __device__
+inline constexpr EL_T subb(const EL_T &a, const EL_T &b, EL_T &borrow) {
+	return BIFSI_IS_CONSTANT_EVALUATED() ? portable::subb(a, b, borrow) : intrinsic::subb(a, b, borrow);
+}
 
-			} else {
-				return el[0] | //
-						(((UINT_T) el[1]) << 1 * EL_SIZE_IN_BITS) | //
-						(((UINT_T) el[2]) << 2 * EL_SIZE_IN_BITS) | //
-						(((UINT_T) el[3]) << 3 * EL_SIZE_IN_BITS) | //
-						(((UINT_T) el[4]) << 4 * EL_SIZE_IN_BITS) | //
-						(((UINT_T) el[5]) << 5 * EL_SIZE_IN_BITS) | //
-						(((UINT_T) el[6]) << 6 * EL_SIZE_IN_BITS) | //
-						(((UINT_T) el[7]) << 7 * EL_SIZE_IN_BITS);
+/*
+ * Returns the low element of a + carry and stores the carry out in carry, for
+ * propagating a carry through the upper elements. On the host, the comparison
+ * chain is faster than adc with a zero operand, because it doesn't need the
+ * carry in the carry flag.
+ */
+template<typename EL_T>
+__host__ __device__
+inline constexpr EL_T addc(const EL_T &a, EL_T &carry) {
+#ifdef __CUDA_ARCH__
+	return addc(a, (EL_T) 0, carry);
+#else
+	const EL_T s = (EL_T) (a + carry);
+	carry = (s < carry);
+
+	return s;
+#endif
+}
 
-			}
+/*
+ * Returns the low element of a - borrow and stores the borrow out in borrow,
+ * like addc(a, carry).
+ */
+template<typename EL_T>
+__host__ __device__
+inline constexpr EL_T subb(const EL_T &a, EL_T &borrow) {
+#ifdef __CUDA_ARCH__
+	return subb(a, (EL_T) 0, borrow);
+#else
+	const EL_T d = (EL_T) (a - borrow);
+	borrow = (d > a);
+
+	return d;
+#endif
+}
 
-		} else {
-			// the condition in the static assert is to make the compiler happy
-			// in all cases when the static assert isn't even reached.
-			static_assert(8 * sizeof(el_t) >= sizeof(UINT_T), "no suitable way to convert to UINT_T");
-			return 0; // will never be reached
+namespace intrinsic {
 
-		}
+/*
+ * Full product primitive, see portable::mul_wide. Uses __umulhi/__umul64hi on
+ * CUDA, which lacks a native twice size type for 64 bit elements, and
+ * _mulx_u64 on x86-64 with BMI2, which doesn't touch the flags and therefore
+ * doesn't break the carry chain of a surrounding addc loop.
+ */
+template<typename EL_T>
+__host__ __device__
+inline EL_T mul_wide(const EL_T &a, const EL_T &b, EL_T &hi) {
+#if defined(__CUDA_ARCH__) && !defined(BIFSI_NO_INTRINSICS)
+	if constexpr (sizeof(EL_T) == 4) {
+		hi = __umulhi(a, b);
+		return a * b;
+
+	} else if constexpr (sizeof(EL_T) == 8) {
+		hi = __umul64hi(a, b);
+		return a * b;
+	}
+#elif defined(__x86_64__) && defined(__BMI2__) && !defined(BIFSI_NO_INTRINSICS)
+	if constexpr (sizeof(EL_T) == 8) {
+		unsigned long long h;
+		const EL_T lo = _mulx_u64(a, b, &h);
+		hi = h;
+		return lo;
 	}
+#endif
 
-	__host__ __device__
-	inline constexpr bui& set_from_str(const char *str) {
-		size_t len = std::strlen(str);
+	return portable::mul_wide(a, b, hi);
+}
 
-		set_zero();
+} /* namespace intrinsic */
 
-#ifdef __NVCC__
-		#pragma unroll
-		#endif
-		for (size_t i = 0; i < len; i++) {
-			char c = str[i];
+/*
+ * Returns the low element of the product a * b and stores the high element in
+ * hi. Uses intrinsic::mul_wide, or portable::mul_wide in constant evaluation.
+ */
+template<typename EL_T>
+__host__ __device__
+inline constexpr EL_T mul_wide(const EL_T &a, const EL_T &b, EL_T &hi) {
+	return BIFSI_IS_CONSTANT_EVALUATED() ? portable::mul_wide(a, b, hi) : intrinsic::mul_wide(a, b, hi);
+}
 
-			assert(c >= '0');
-			assert(c <= '9');
+/*
+ * True if the twice size type of EL_T fits into a register, like uint64_t for
+ * 32 bit elements on 64 bit platforms. Then a * b + c + d is a single
+ * multiplication and addition in the twice size type, which is faster than
+ * splitting it into mul_wide and addc.
+ */
+template<typename EL_T>
+constexpr bool TW_IS_NATIVE = sizeof(EL_T) * 2 <= sizeof(size_t);
 
-			*this *= 10;
+/*
+ * True if mul_add_wide computes in the twice size type. On the host, that's
+ * also the case for 64 bit elements, because unsigned __int128 compiles to
+ * mul or mulx and add/adc as well, without the intrinsics' overhead of
+ * passing carries through registers. On CUDA, 64 bit elements use
+ * __umul64hi and add.cc/addc instead.
+ */
+template<typename EL_T>
+#ifdef __CUDA_ARCH__
+constexpr bool MUL_ADD_IN_TW = TW_IS_NATIVE<EL_T>;
+#else
+constexpr bool MUL_ADD_IN_TW = true;
+#endif
 
-			*this += (el_t) (c - '0');
-		}
+/*
+ * Returns the low element of a * b + c and stores the high element in hi.
+ * hi may be the same object as c.
+ */
+template<typename EL_T>
+__host__ __device__
+inline constexpr EL_T mul_add_wide(const EL_T &a, const EL_T &b, const EL_T &c, EL_T &hi) {
+	if constexpr (MUL_ADD_IN_TW<EL_T>) {
+		typedef twice_size_t<EL_T> TW_T;
+
+		const TW_T p = ((TW_T) a) * b + c;
+		hi = (EL_T) (p >> (sizeof(EL_T) * 8));
+
+		return (EL_T) p;
+
+	} else {
+		EL_T h = 0;
+		EL_T lo = mul_wide(a, b, h);
+
+		EL_T carry = 0;
+		lo = addc(lo, c, carry);
+		hi = (EL_T) (h + carry);
+
+		return lo;
+	}
+}
+
+/*
+ * Returns the low element of a * b + c + d and stores the high element in hi.
+ * This can't overflow, because (2^W - 1)^2 + 2 * (2^W - 1) = 2^(2 * W) - 1.
+ * hi may be the same object as c or d.
+ */
+template<typename EL_T>
+__host__ __device__
+inline constexpr EL_T mul_add_wide(const EL_T &a, const EL_T &b, const EL_T &c, const EL_T &d, EL_T &hi) {
+	if constexpr (MUL_ADD_IN_TW<EL_T>) {
+		typedef twice_size_t<EL_T> TW_T;
+
+		const TW_T p = ((TW_T) a) * b + c + d;
+		hi = (EL_T) (p >> (sizeof(EL_T) * 8));
+
+		return (EL_T) p;
+
+	} else {
+		EL_T h = 0;
+		EL_T lo = mul_wide(a, b, h);
+
+		EL_T carry = 0;
+		lo = addc(lo, c, carry);
+		h = (EL_T) (h + carry);
+
+		carry = 0;
+		lo = addc(lo, d, carry);
+		hi = (EL_T) (h + carry);
+
+		return lo;
+	}
+}
+
+/*
+ * Adds the B_ELS elements of b to the A_ELS elements of a, in place, and
+ * returns the carry out of the topmost element of a. B_ELS must not be
+ * greater than A_ELS.
+ */
+template<size_t A_ELS, size_t B_ELS, typename EL_T>
+__host__ __device__
+inline constexpr EL_T els_add(EL_T *a, const EL_T *b) {
+	static_assert(B_ELS <= A_ELS, "constraint not fulfilled: B_ELS <= A_ELS");
+
+	EL_T carry = 0;
+
+#ifdef __NVCC__
+#pragma unroll
+#endif
+	for (size_t i = 0; i < B_ELS; i++) {
+		a[i] = addc(a[i], b[i], carry);
+	}
+
+#ifdef __NVCC__
+#pragma unroll
+#endif
+	for (size_t i = B_ELS; i < A_ELS; i++) {
+		a[i] = addc(a[i], carry);
+	}
+
+	return carry;
+}
+
+/*
+ * Subtracts the B_ELS elements of b from the A_ELS elements of a, in place,
+ * and returns the borrow out of the topmost element of a. B_ELS must not be
+ * greater than A_ELS.
+ */
+template<size_t A_ELS, size_t B_ELS, typename EL_T>
+__host__ __device__
+inline constexpr EL_T els_sub(EL_T *a, const EL_T *b) {
+	static_assert(B_ELS <= A_ELS, "constraint not fulfilled: B_ELS <= A_ELS");
+
+	EL_T borrow = 0;
+
+#ifdef __NVCC__
+#pragma unroll
+#endif
+	for (size_t i = 0; i < B_ELS; i++) {
+		a[i] = subb(a[i], b[i], borrow);
+	}
+
+#ifdef __NVCC__
+#pragma unroll
+#endif
+	for (size_t i = B_ELS; i < A_ELS; i++) {
+		a[i] = subb(a[i], borrow);
+	}
+
+	return borrow;
+}
+
+/*
+ * Replaces the N elements of x with x * m + a and returns the element that
+ * carries out of the topmost element of x. This is a single pass over x, with
+ * the high element of each product carried into the next one.
+ */
+template<size_t N, typename EL_T>
+__host__ __device__
+inline constexpr EL_T els_mul_add_el(EL_T *x, const EL_T &m, const EL_T &a) {
+	if constexpr (MUL_ADD_IN_TW<EL_T>) {
+		// the carry stays in the twice size type, which saves truncating and
+		// extending it, the critical path of the loop, in each iteration
+		typedef twice_size_t<EL_T> TW_T;
+
+		TW_T tw = a;
+
+#ifdef __NVCC__
+#pragma unroll
+#endif
+		for (size_t i = 0; i < N; i++) {
+			tw += ((TW_T) x[i]) * m;
+			x[i] = (EL_T) tw;
+			tw >>= sizeof(EL_T) * 8;
+		}
+
+		return (EL_T) tw;
+
+	} else {
+		EL_T carry = a;
+
+#ifdef __NVCC__
+#pragma unroll
+#endif
+		for (size_t i = 0; i < N; i++) {
+			x[i] = mul_add_wide(x[i], m, carry, carry);
+		}
+
+		return carry;
+	}
+}
+
+/*
+ * Same as els_mul_add_el, but only for the used elements of x, whose number
+ * is updated, see vartime. The elements of x above these must be 0.
+ */
+template<size_t N, typename EL_T>
+__host__ __device__
+inline constexpr EL_T els_mul_add_el_vartime(EL_T *x, size_t &used, const EL_T &m, const EL_T &a) {
+	EL_T carry = a;
+
+	if constexpr (MUL_ADD_IN_TW<EL_T>) {
+		// see els_mul_add_el
+		typedef twice_size_t<EL_T> TW_T;
+
+		TW_T tw = a;
+
+		for (size_t i = 0; i < used; i++) {
+			tw += ((TW_T) x[i]) * m;
+			x[i] = (EL_T) tw;
+			tw >>= sizeof(EL_T) * 8;
+		}
+
+		carry = (EL_T) tw;
+
+	} else {
+		for (size_t i = 0; i < used; i++) {
+			x[i] = mul_add_wide(x[i], m, carry, carry);
+		}
+	}
+
+	if (carry != 0 && used < N) {
+		x[used++] = carry;
+		carry = 0;
+	}
+
+	return carry;
+}
+
+/*
+ * Adds a * m to the N elements of r, in place, where a has N elements, and
+ * returns the element that carries out of the topmost element of r. This
+ * can't overflow the carry, because a * m + r + carry is less than
+ * 2^(2 * EL_SIZE_IN_BITS) for each element.
+ */
+template<size_t N, typename EL_T>
+__host__ __device__
+inline constexpr EL_T els_mul_add_els(EL_T *r, const EL_T *a, const EL_T &m) {
+	if constexpr (MUL_ADD_IN_TW<EL_T>) {
+		// see els_mul_add_el
+		typedef twice_size_t<EL_T> TW_T;
+
+		TW_T tw = 0;
+
+#ifdef __NVCC__
+#pragma unroll
+#endif
+		for (size_t i = 0; i < N; i++) {
+			tw += ((TW_T) a[i]) * m + r[i];
+			r[i] = (EL_T) tw;
+			tw >>= sizeof(EL_T) * 8;
+		}
+
+		return (EL_T) tw;
+
+	} else {
+		EL_T carry = 0;
+
+#ifdef __NVCC__
+#pragma unroll
+#endif
+		for (size_t i = 0; i < N; i++) {
+			r[i] = mul_add_wide(a[i], m, r[i], carry, carry);
+		}
+
+		return carry;
+	}
+}
+
+/*
+ * Stores (a + b) mod n in r, where a, b and n have N elements, and a and b
+ * are less than n. a + b is written to r directly and a + b - n to a
+ * temporary, then one of them is selected with a mask instead of a branch.
+ * The two carry chains are separate loops, because on x86, both would
+ * compete for the single carry flag in one loop. r may be a or b.
+ */
+template<size_t N, typename EL_T>
+__host__ __device__
+inline constexpr void els_add_mod(EL_T *r, const EL_T *a, const EL_T *b, const EL_T *n) {
+	EL_T carry = 0;
+
+#ifdef __NVCC__
+#pragma unroll
+#endif
+	for (size_t i = 0; i < N; i++) {
+		r[i] = addc(a[i], b[i], carry);
+	}
+
+	EL_T d[N] = { };
+	EL_T borrow = 0;
+
+#ifdef __NVCC__
+#pragma unroll
+#endif
+	for (size_t i = 0; i < N; i++) {
+		d[i] = subb(r[i], n[i], borrow);
+	}
+
+	// a + b >= n, if the sum carries out of the top element or if
+	// subtracting n doesn't borrow
+	const EL_T mask = (EL_T) -(EL_T) ((carry != 0) | (borrow == 0));
+
+#ifdef __NVCC__
+#pragma unroll
+#endif
+	for (size_t i = 0; i < N; i++) {
+		r[i] = (d[i] & mask) | (r[i] & ~mask);
+	}
+}
+
+/*
+ * Stores (a - b) mod n in r, where a, b and n have N elements, and a and b
+ * are less than n. The borrow of a - b is turned into a mask for n, which is
+ * added in the second pass, so there is neither a branch nor a temporary.
+ * r may be a or b.
+ */
+template<size_t N, typename EL_T>
+__host__ __device__
+inline constexpr void els_sub_mod(EL_T *r, const EL_T *a, const EL_T *b, const EL_T *n) {
+	EL_T borrow = 0;
+
+#ifdef __NVCC__
+#pragma unroll
+#endif
+	for (size_t i = 0; i < N; i++) {
+		r[i] = subb(a[i], b[i], borrow);
+	}
+
+	const EL_T mask = (EL_T) -borrow;
+
+	EL_T carry = 0;
+
+#ifdef __NVCC__
+#pragma unroll
+#endif
+	for (size_t i = 0; i < N; i++) {
+		r[i] = addc(r[i], (EL_T) (n[i] & mask), carry);
+	}
+}
+
+/*
+ * Stores |a - b| in r, where a has A_ELS elements and b has B_ELS <= A_ELS
+ * elements. Returns 1 if b > a, else 0. The negation in case of b > a is done
+ * with a mask instead of a branch.
+ */
+template<size_t A_ELS, size_t B_ELS, typename EL_T>
+__host__ __device__
+inline constexpr EL_T els_abs_diff(EL_T *r, const EL_T *a, const EL_T *b) {
+#ifdef __NVCC__
+#pragma unroll
+#endif
+	for (size_t i = 0; i < A_ELS; i++) {
+		r[i] = a[i];
+	}
+
+	const EL_T borrow = els_sub<A_ELS, B_ELS>(r, b);
+	const EL_T mask = (EL_T) -borrow;
+
+	// two's complement negation if borrow, identity otherwise
+	EL_T carry = borrow;
+
+#ifdef __NVCC__
+#pragma unroll
+#endif
+	for (size_t i = 0; i < A_ELS; i++) {
+		r[i] = addc((EL_T) (r[i] ^ mask), carry);
+	}
+
+	return borrow;
+}
+
+/*
+ * Returns -1, 0 or 1 if the A_ELS elements of a are less than, equal to or
+ * greater than the B_ELS elements of b. The elements are visited from the
+ * most significant to the least significant one, with the first difference
+ * kept by a mask, so there is no branch which depends on the values.
+ */
+template<size_t A_ELS, size_t B_ELS, typename EL_T>
+__host__ __device__
+inline constexpr int els_cmp(const EL_T *a, const EL_T *b) {
+	int result = 0;
+
+	// the elements of the longer operand above the shorter one decide first,
+	// at most one of these loops runs
+#ifdef __NVCC__
+#pragma unroll
+#endif
+	for (size_t i = B_ELS; i < A_ELS; i++) {
+		result |= (int) (a[i] != 0);
+	}
+
+#ifdef __NVCC__
+#pragma unroll
+#endif
+	for (size_t i = A_ELS; i < B_ELS; i++) {
+		result |= -(int) (b[i] != 0);
+	}
+
+	constexpr size_t N = (A_ELS < B_ELS) ? A_ELS : B_ELS;
+
+#ifdef __NVCC__
+#pragma unroll
+#endif
+	for (size_t i = N - 1; i != (size_t) -1; i--) {
+		const int undecided = -(int) (result == 0);
+		result |= ((int) (a[i] > b[i]) - (int) (a[i] < b[i])) & undecided;
+	}
+
+	return result;
+}
+
+/*
+ * Returns the number of used elements of the N elements of a, i.e. the index
+ * of the topmost nonzero element plus 1, or 0 if a is 0. This stops at the
+ * topmost nonzero element, so it's not branchless, see vartime.
+ */
+template<size_t N, typename EL_T>
+__host__ __device__
+inline constexpr size_t els_used(const EL_T *a) {
+	size_t n = N;
+
+	while (n > 0 && a[n - 1] == 0) {
+		n--;
+	}
+
+	return n;
+}
+
+/*
+ * Same as els_cmp, but returns at the first element that differs, see
+ * vartime.
+ */
+template<size_t A_ELS, size_t B_ELS, typename EL_T>
+__host__ __device__
+inline constexpr int els_cmp_vartime(const EL_T *a, const EL_T *b) {
+	for (size_t i = B_ELS; i < A_ELS; i++) {
+		if (a[i] != 0) {
+			return 1;
+		}
+	}
+
+	for (size_t i = A_ELS; i < B_ELS; i++) {
+		if (b[i] != 0) {
+			return -1;
+		}
+	}
+
+	constexpr size_t N = (A_ELS < B_ELS) ? A_ELS : B_ELS;
+
+	for (size_t i = N - 1; i != (size_t) -1; i--) {
+		if (a[i] != b[i]) {
+			return (a[i] > b[i]) ? 1 : -1;
+		}
+	}
+
+	return 0;
+}
+
+/*
+ * Returns true if the A_ELS elements of a have the same value as the B_ELS
+ * elements of b, computed without a branch.
+ */
+template<size_t A_ELS, size_t B_ELS, typename EL_T>
+__host__ __device__
+inline constexpr bool els_eq(const EL_T *a, const EL_T *b) {
+	constexpr size_t N = (A_ELS < B_ELS) ? A_ELS : B_ELS;
+
+	EL_T diff = 0;
+
+#ifdef __NVCC__
+#pragma unroll
+#endif
+	for (size_t i = 0; i < N; i++) {
+		diff |= a[i] ^ b[i];
+	}
+
+#ifdef __NVCC__
+#pragma unroll
+#endif
+	for (size_t i = N; i < A_ELS; i++) {
+		diff |= a[i];
+	}
+
+#ifdef __NVCC__
+#pragma unroll
+#endif
+	for (size_t i = N; i < B_ELS; i++) {
+		diff |= b[i];
+	}
+
+	return diff == 0;
+}
+
+/*
+ * Comba multiplication kernel. Multiplies the A_ELS elements of a with the
+ * B_ELS elements of b and stores the lowest R_ELS elements of the product in
+ * r. The product is computed column by column, i.e. all products
+ * a[i] * b[k - i] of column k are summed up in an accumulator before r[k] is
+ * written, so the accumulator stays in registers and r is written only once.
+ * If C_ELS is not 0, the C_ELS elements of c are added to the product, each
+ * c[k] into the accumulator of column k, so a * b + c takes a single pass.
+ * r must not overlap with a or b. r may be c, because c[k] is read before
+ * r[k] is written.
+ */
+template<size_t R_ELS, size_t A_ELS, size_t B_ELS, size_t C_ELS = 0, typename EL_T>
+__host__ __device__
+inline constexpr void comba_mul(EL_T *r, const EL_T *a, const EL_T *b, const EL_T *c = nullptr) {
+	static_assert(R_ELS <= A_ELS + B_ELS, "constraint not fulfilled: R_ELS <= A_ELS + B_ELS");
+	static_assert(C_ELS <= R_ELS, "constraint not fulfilled: C_ELS <= R_ELS");
+
+	typedef twice_size_t<EL_T> TW_T;
+
+	constexpr size_t W = sizeof(EL_T) * 8;
+
+	if constexpr (TW_IS_NATIVE<EL_T>) {
+		// the column sum is acc + acc_hi * 2^(2 * W). acc_hi is of type TW_T,
+		// because for small EL_T, a column can have more than 2^W summands.
+		TW_T acc = 0;
+		TW_T acc_hi = 0;
+
+#ifdef __NVCC__
+#pragma unroll
+#endif
+		for (size_t k = 0; k < R_ELS; k++) {
+			const size_t i_begin = (k < B_ELS) ? 0 : k - B_ELS + 1;
+			const size_t i_end = (k < A_ELS) ? k + 1 : A_ELS;
+
+			if (k < C_ELS) {
+				acc += c[k];
+				acc_hi += (acc < c[k]);
+			}
+
+#ifdef __NVCC__
+#pragma unroll
+#endif
+			for (size_t i = i_begin; i < i_end; i++) {
+				const TW_T p = ((TW_T) a[i]) * b[k - i];
+				acc += p;
+				acc_hi += (acc < p);
+			}
+
+			r[k] = (EL_T) acc;
+
+			acc = (acc >> W) | (((TW_T) (EL_T) acc_hi) << W);
+			acc_hi >>= W;
+		}
+
+	} else {
+		// the column sum is c0 + c1 * 2^W + c2 * 2^(2 * W), accumulated with
+		// mul_wide and addc
+		EL_T c0 = 0;
+		EL_T c1 = 0;
+		EL_T c2 = 0;
+
+#ifdef __NVCC__
+#pragma unroll
+#endif
+		for (size_t k = 0; k < R_ELS; k++) {
+			const size_t i_begin = (k < B_ELS) ? 0 : k - B_ELS + 1;
+			const size_t i_end = (k < A_ELS) ? k + 1 : A_ELS;
+
+			if (k < C_ELS) {
+				EL_T carry = 0;
+				c0 = addc(c0, c[k], carry);
+				c1 = addc(c1, carry);
+				c2 += carry;
+			}
+
+#ifdef __NVCC__
+#pragma unroll
+#endif
+			for (size_t i = i_begin; i < i_end; i++) {
+				EL_T hi = 0;
+				const EL_T lo = mul_wide(a[i], b[k - i], hi);
+
+				EL_T carry = 0;
+				c0 = addc(c0, lo, carry);
+				c1 = addc(c1, hi, carry);
+				c2 += carry;
+			}
+
+			r[k] = c0;
+
+			c0 = c1;
+			c1 = c2;
+			c2 = 0;
+		}
+	}
+}
+
+template<size_t N, typename EL_T>
+__host__ __device__
+inline constexpr void mul_els(EL_T *r, const EL_T *a, const EL_T *b);
+
+template<size_t N, typename EL_T>
+__host__ __device__
+inline constexpr void mul_els_lo(EL_T *r, const EL_T *a, const EL_T *b);
+
+/*
+ * Karatsuba multiplication kernel. Multiplies the N elements of a with the N
+ * elements of b and stores the 2 * N elements of the product in r. This is the
+ * subtractive variant, which computes the middle term as
+ *
+ * a_lo * b_hi + a_hi * b_lo = z0 + z2 + (a_hi - a_lo) * (b_lo - b_hi),
+ *
+ * so the factors of the third multiplication don't grow by a carry element.
+ * The sign of the third product is applied with a mask instead of a branch.
+ * r must not overlap with a or b.
+ */
+template<size_t N, typename EL_T>
+__host__ __device__
+inline constexpr void karatsuba_mul(EL_T *r, const EL_T *a, const EL_T *b) {
+	static_assert(N >= 2, "constraint not fulfilled: N >= 2");
+
+	constexpr size_t LO = N / 2;
+	constexpr size_t HI = N - LO;
+	constexpr size_t M_ELS = 2 * HI + 1;
+
+	// z0 = a_lo * b_lo goes to r[0, 2 * LO), z2 = a_hi * b_hi to r[2 * LO, 2 * N)
+	mul_els<LO>(r, a, b);
+	mul_els<HI>(r + 2 * LO, a + LO, b + LO);
+
+	EL_T da[HI];
+	EL_T db[HI];
+	EL_T a_lo[HI];
+	EL_T b_lo[HI];
+
+#ifdef __NVCC__
+#pragma unroll
+#endif
+	for (size_t i = 0; i < HI; i++) {
+		a_lo[i] = (i < LO) ? a[i] : 0;
+		b_lo[i] = (i < LO) ? b[i] : 0;
+	}
+
+	const EL_T neg_a = els_abs_diff<HI, HI>(da, a + LO, a_lo);
+	const EL_T neg_b = els_abs_diff<HI, HI>(db, b_lo, b + LO);
+
+	EL_T d[2 * HI];
+	mul_els<HI>(d, da, db);
+
+	// m = z0 + z2
+	EL_T m[M_ELS];
+
+#ifdef __NVCC__
+#pragma unroll
+#endif
+	for (size_t i = 0; i < M_ELS; i++) {
+		m[i] = (i < 2 * HI) ? r[2 * LO + i] : 0;
+	}
+
+	els_add<M_ELS, 2 * LO>(m, r);
+
+	// m += d or m -= d, depending on the sign of the product
+	const EL_T mask = (EL_T) -(neg_a ^ neg_b);
+	EL_T carry = mask & 1;
+
+#ifdef __NVCC__
+#pragma unroll
+#endif
+	for (size_t i = 0; i < M_ELS; i++) {
+		const EL_T d_i = ((i < 2 * HI) ? d[i] : 0) ^ mask;
+
+		m[i] = addc(m[i], d_i, carry);
+	}
+
+	els_add<2 * N - LO, M_ELS>(r + LO, m);
+}
+
+/*
+ * Same as karatsuba_mul, but only the lowest N elements of the product are
+ * computed and stored in r. The product of the high halves contributes at most
+ * one element (for odd N) and the cross products are only needed modulo
+ * 2^(HI * EL_SIZE_IN_BITS), so this costs one full and two truncated
+ * multiplications of half size.
+ */
+template<size_t N, typename EL_T>
+__host__ __device__
+inline constexpr void karatsuba_mul_lo(EL_T *r, const EL_T *a, const EL_T *b) {
+	static_assert(N >= 2, "constraint not fulfilled: N >= 2");
+
+	constexpr size_t LO = N / 2;
+	constexpr size_t HI = N - LO;
+
+	EL_T z0[2 * LO];
+	mul_els<LO>(z0, a, b);
+
+#ifdef __NVCC__
+#pragma unroll
+#endif
+	for (size_t i = 0; i < N; i++) {
+		r[i] = (i < 2 * LO) ? z0[i] : 0;
+	}
+
+	EL_T a_lo[HI];
+	EL_T b_lo[HI];
+
+#ifdef __NVCC__
+#pragma unroll
+#endif
+	for (size_t i = 0; i < HI; i++) {
+		a_lo[i] = (i < LO) ? a[i] : 0;
+		b_lo[i] = (i < LO) ? b[i] : 0;
+	}
+
+	EL_T c[HI];
+
+	mul_els_lo<HI>(c, a_lo, b + LO);
+	els_add<HI, HI>(r + LO, c);
+
+	mul_els_lo<HI>(c, a + LO, b_lo);
+	els_add<HI, HI>(r + LO, c);
+
+	if constexpr (HI > LO) {
+		// lowest element of a_hi * b_hi, which lands in r[2 * LO] = r[N - 1]
+		r[N - 1] += (EL_T) (((twice_size_t<EL_T>) a[LO]) * b[LO]);
+	}
+}
+
+/*
+ * One of the three primes of the number theoretic transform of ntt_mul, with
+ * its constants for the Montgomery multiplication of ntt_mont_mul, which
+ * works on 32 bit values, so the loops over the coefficients can use the
+ * vector units. neg_inv is -p^-1 mod 2^32, r2 is 2^64 mod p and g generates
+ * the multiplicative group mod p.
+ */
+struct ntt_prime {
+	uint32_t p;
+	uint32_t g;
+	uint32_t neg_inv;
+	uint32_t r2;
+};
+
+__host__ __device__
+inline constexpr ntt_prime make_ntt_prime(const uint32_t &p, const uint32_t &g) {
+	// Newton iteration, each step doubles the number of correct low bits
+	uint32_t inv = p;
+
+	for (size_t i = 0; i < 4; i++) {
+		inv *= 2 - p * inv;
+	}
+
+	const uint64_t r = (((uint64_t) 1) << 32) % p;
+
+	return ntt_prime { p, g, (uint32_t) -inv, (uint32_t) (r * r % p) };
+}
+
+/*
+ * Primes p < 2^31 with 2^24 dividing p - 1, so they have roots of unity of
+ * all orders up to 2^24, with their generators. The digits of ntt_mul have 32
+ * bits, so each coefficient of the convolution is less than
+ * 2^23 * (2^32 - 1)^2 < p0 * p1 * p2 ~ 2^89.
+ */
+template<size_t I>
+__host__ __device__
+inline constexpr ntt_prime ntt_prime_at() {
+	static_assert(I < 3, "constraint not fulfilled: I < 3");
+
+	if constexpr (I == 0) {
+		return make_ntt_prime(2013265921U, 31U); // 15 * 2^27 + 1
+	} else if constexpr (I == 1) {
+		return make_ntt_prime(469762049U, 3U); // 7 * 2^26 + 1
+	} else {
+		return make_ntt_prime(754974721U, 11U); // 45 * 2^24 + 1
+	}
+}
+
+/*
+ * Returns t * 2^-32 mod p, for t < p * 2^32. The result of the Montgomery
+ * reduction is less than 2 * p, p is subtracted with a mask.
+ */
+__host__ __device__
+inline constexpr uint32_t ntt_reduce(const uint64_t &t, const ntt_prime &q) {
+	const uint32_t m = (uint32_t) t * q.neg_inv;
+	const uint32_t u = (uint32_t) ((t + (uint64_t) m * q.p) >> 32);
+	const uint32_t d = u - q.p;
+
+	return d + (q.p & (uint32_t) -(d >> 31));
+}
+
+/*
+ * Returns a * b * 2^-32 mod p, such that with b being in Montgomery form, the
+ * result is a * b mod p in the same form as a.
+ */
+__host__ __device__
+inline constexpr uint32_t ntt_mont_mul(const uint32_t &a, const uint32_t &b, const ntt_prime &q) {
+	return ntt_reduce((uint64_t) a * b, q);
+}
+
+__host__ __device__
+inline constexpr uint32_t ntt_add(const uint32_t &a, const uint32_t &b, const ntt_prime &q) {
+	const uint32_t d = a + b - q.p;
+
+	return d + (q.p & (uint32_t) -(d >> 31));
+}
+
+__host__ __device__
+inline constexpr uint32_t ntt_sub(const uint32_t &a, const uint32_t &b, const ntt_prime &q) {
+	const uint32_t d = a - b;
+
+	return d + (q.p & (uint32_t) -(d >> 31));
+}
+
+/*
+ * Returns x^e mod p, in the same form as x, which is Montgomery form.
+ */
+__host__ __device__
+inline constexpr uint32_t ntt_mont_pow(uint32_t x, uint64_t e, const ntt_prime &q) {
+	uint32_t result = ntt_reduce(q.r2, q);
+
+	for (; e != 0; e >>= 1) {
+		if (e & 1) {
+			result = ntt_mont_mul(result, x, q);
+		}
+
+		x = ntt_mont_mul(x, x, q);
+	}
+
+	return result;
+}
+
+/*
+ * Number of digits of 32 bits of N elements of EL_T, and the length of the
+ * transforms of their products, which must be a power of 2 not less than the
+ * number of digits of a product.
+ */
+template<size_t N, typename EL_T>
+__host__ __device__
+inline constexpr size_t ntt_digit_count() {
+	return (N * sizeof(EL_T) * 8 + 31) / 32;
+}
+
+template<size_t N, typename EL_T>
+__host__ __device__
+inline constexpr size_t ntt_size() {
+	size_t l = 1;
+
+	while (l < 2 * ntt_digit_count<N, EL_T>()) {
+		l *= 2;
+	}
+
+	return l;
+}
+
+/*
+ * Returns the 32 bits of the N elements of a starting at bit 32 * k, 0 for
+ * the bits above the elements.
+ */
+template<size_t N, typename EL_T>
+__host__ __device__
+inline constexpr uint32_t ntt_digit(const EL_T *a, const size_t &k) {
+	constexpr size_t EL_SIZE_IN_BITS = sizeof(EL_T) * 8;
+
+	if constexpr (EL_SIZE_IN_BITS > 32) {
+		return (uint32_t) (a[(k * 32) / EL_SIZE_IN_BITS] >> ((k * 32) % EL_SIZE_IN_BITS));
+	} else {
+		constexpr size_t ELS_PER_DIGIT = 32 / EL_SIZE_IN_BITS;
+
+		uint32_t result = 0;
+
+		for (size_t s = 0; s < ELS_PER_DIGIT; s++) {
+			const size_t i = k * ELS_PER_DIGIT + s;
+			result |= (i < N) ? ((uint32_t) a[i]) << (s * EL_SIZE_IN_BITS) : 0;
+		}
+
+		return result;
+	}
+}
+
+/*
+ * Stores the digit of 32 bits at bit 32 * k of the R_ELS elements of r. The
+ * digits must be stored in ascending order, starting with k = 0, bits above
+ * the elements are dropped.
+ */
+template<size_t R_ELS, typename EL_T>
+__host__ __device__
+inline constexpr void ntt_set_digit(EL_T *r, const size_t &k, const uint32_t &digit) {
+	constexpr size_t EL_SIZE_IN_BITS = sizeof(EL_T) * 8;
+
+	if constexpr (EL_SIZE_IN_BITS > 32) {
+		const size_t i = (k * 32) / EL_SIZE_IN_BITS;
+		const size_t shift = (k * 32) % EL_SIZE_IN_BITS;
+
+		if (i < R_ELS) {
+			r[i] = ((shift == 0) ? 0 : r[i]) | (((EL_T) digit) << shift);
+		}
+	} else {
+		constexpr size_t ELS_PER_DIGIT = 32 / EL_SIZE_IN_BITS;
+
+		for (size_t s = 0; s < ELS_PER_DIGIT; s++) {
+			const size_t i = k * ELS_PER_DIGIT + s;
+
+			if (i < R_ELS) {
+				r[i] = (EL_T) (((uint64_t) digit) >> (s * EL_SIZE_IN_BITS));
+			}
+		}
+	}
+}
+
+/*
+ * Stores the twiddle factors of the transforms of length L in tw, in
+ * Montgomery form, with w^j for the root w of unity of order 2 * h at
+ * tw[h + j], for each power of 2 h < L and j < h. Each pass of the transforms
+ * reads a contiguous run of the table. With inverse, the roots are inverted.
+ */
+template<size_t L>
+__host__ __device__
+inline constexpr void ntt_twiddles(uint32_t *tw, const ntt_prime &q, const bool &inverse) {
+	const uint32_t g = ntt_mont_mul(q.g, q.r2, q);
+	const uint64_t order = (q.p - 1) / L;
+	const uint32_t w = ntt_mont_pow(g, inverse ? (q.p - 1) - order : order, q);
+
+	tw[L / 2] = ntt_reduce(q.r2, q);
+
+	for (size_t j = 1; j < L / 2; j++) {
+		tw[L / 2 + j] = ntt_mont_mul(tw[L / 2 + j - 1], w, q);
+	}
+
+	for (size_t h = L / 4; h > 0; h /= 2) {
+		for (size_t j = 0; j < h; j++) {
+			tw[h + j] = tw[2 * (h + j)];
+		}
+	}
+}
+
+/*
+ * The twiddle factors of ntt_twiddles for the transforms of length L, with
+ * tw[i][0] for the forward and tw[i][1] for the inverse transform modulo
+ * ntt_prime_at<i>().
+ */
+template<size_t L>
+struct ntt_twiddle_table {
+	uint32_t tw[3][2][L];
+};
+
+template<size_t L>
+inline constexpr ntt_twiddle_table<L> make_ntt_twiddle_table() {
+	ntt_twiddle_table<L> table {};
+
+	ntt_twiddles<L>(table.tw[0][0], ntt_prime_at<0>(), false);
+	ntt_twiddles<L>(table.tw[0][1], ntt_prime_at<0>(), true);
+	ntt_twiddles<L>(table.tw[1][0], ntt_prime_at<1>(), false);
+	ntt_twiddles<L>(table.tw[1][1], ntt_prime_at<1>(), true);
+	ntt_twiddles<L>(table.tw[2][0], ntt_prime_at<2>(), false);
+	ntt_twiddles<L>(table.tw[2][1], ntt_prime_at<2>(), true);
+
+	return table;
+}
+
+/*
+ * The twiddle factors for the transforms of length L, computed at compile
+ * time, once for each length that ntt_mul is used with.
+ */
+template<size_t L>
+inline constexpr ntt_twiddle_table<L> NTT_TWIDDLES = make_ntt_twiddle_table<L>();
+
+/*
+ * Forward transform of the L coefficients of x in place, decimation in
+ * frequency, such that the result is in bit reversed order, which is what
+ * ntt_inverse takes, so the coefficients never need to be permuted.
+ */
+template<size_t L>
+__host__ __device__
+inline constexpr void ntt_forward(uint32_t *x, const uint32_t *tw, const ntt_prime &prime) {
+	// a local copy, which the stores to x can't change, so the butterflies
+	// can be vectorized
+	const ntt_prime q = prime;
+
+	for (size_t h = L / 2; h > 0; h /= 2) {
+		for (size_t i = 0; i < L; i += 2 * h) {
+			for (size_t j = 0; j < h; j++) {
+				const uint32_t u = x[i + j];
+				const uint32_t v = x[i + j + h];
+
+				x[i + j] = ntt_add(u, v, q);
+				x[i + j + h] = ntt_mont_mul(ntt_sub(u, v, q), tw[h + j], q);
+			}
+		}
+	}
+}
+
+/*
+ * Inverse transform of the L coefficients of x in place, decimation in time,
+ * from bit reversed order, with the inverted twiddle factors. The result is L
+ * times the original coefficients.
+ */
+template<size_t L>
+__host__ __device__
+inline constexpr void ntt_inverse(uint32_t *x, const uint32_t *tw, const ntt_prime &prime) {
+	// a local copy, which the stores to x can't change, so the butterflies
+	// can be vectorized
+	const ntt_prime q = prime;
+
+	for (size_t h = 1; h < L; h *= 2) {
+		for (size_t i = 0; i < L; i += 2 * h) {
+			for (size_t j = 0; j < h; j++) {
+				const uint32_t u = x[i + j];
+				const uint32_t v = ntt_mont_mul(x[i + j + h], tw[h + j], q);
+
+				x[i + j] = ntt_add(u, v, q);
+				x[i + j + h] = ntt_sub(u, v, q);
+			}
+		}
+	}
+}
+
+/*
+ * Stores the cyclic convolution of length L of the digits of a and b modulo
+ * the prime q in c, or of a with itself if b is nullptr. tw and tw_inv are
+ * the twiddle factors of the forward and the inverse transform, t is a
+ * temporary of L values. The digits are converted to Montgomery form, which
+ * also reduces them modulo q, and the coefficients end up in Montgomery form
+ * and multiplied by L from ntt_inverse, which ntt_to_els takes out.
+ */
+template<size_t N, size_t L, typename EL_T>
+__host__ __device__
+inline constexpr void ntt_convolve(uint32_t *c, const EL_T *a, const EL_T *b, const uint32_t *tw, const uint32_t *tw_inv, uint32_t *t, const ntt_prime &q) {
+	constexpr size_t DIGITS = ntt_digit_count<N, EL_T>();
+
+	for (size_t k = 0; k < L; k++) {
+		c[k] = ntt_mont_mul((k < DIGITS) ? ntt_digit<N>(a, k) : 0, q.r2, q);
+	}
+
+	ntt_forward<L>(c, tw, q);
+
+	if (b == nullptr) {
+		for (size_t k = 0; k < L; k++) {
+			c[k] = ntt_mont_mul(c[k], c[k], q);
+		}
+	} else {
+		for (size_t k = 0; k < L; k++) {
+			t[k] = ntt_mont_mul((k < DIGITS) ? ntt_digit<N>(b, k) : 0, q.r2, q);
+		}
+
+		ntt_forward<L>(t, tw, q);
+
+		for (size_t k = 0; k < L; k++) {
+			c[k] = ntt_mont_mul(c[k], t[k], q);
+		}
+	}
+
+	ntt_inverse<L>(c, tw_inv, q);
+}
+
+/*
+ * Combines the convolutions c0, c1 and c2 modulo the three primes to the
+ * digits of the product with the Chinese remainder theorem, in the mixed
+ * radix form of Garner, and stores them with their carries in the R_ELS
+ * elements of r. The coefficients are less than p0 * p1 * p2, so the carry
+ * stays below 2^61.
+ */
+template<size_t R_ELS, size_t L, typename EL_T>
+__host__ __device__
+inline constexpr void ntt_to_els(EL_T *r, const uint32_t *c0, const uint32_t *c1, const uint32_t *c2) {
+	constexpr ntt_prime q0 = ntt_prime_at<0>();
+	constexpr ntt_prime q1 = ntt_prime_at<1>();
+	constexpr ntt_prime q2 = ntt_prime_at<2>();
+	constexpr uint64_t P01 = (uint64_t) q0.p * q1.p;
+
+	// p0^-1 mod p1 and (p0 * p1)^-1 mod p2 in Montgomery form, by Fermat,
+	// and the latter times 2^32 again, which takes out the 2^-32 of
+	// ntt_reduce
+	const uint32_t inv_0_1 = ntt_mont_pow(ntt_reduce((uint64_t) q0.p % q1.p * q1.r2, q1), q1.p - 2, q1);
+	const uint32_t inv_01_2 = ntt_mont_pow(ntt_reduce(P01 % q2.p * q2.r2, q2), q2.p - 2, q2);
+	const uint32_t inv_01_2_r = ntt_mont_mul(inv_01_2, q2.r2, q2);
+
+	// L^-1, which takes L and the Montgomery form out of the results of
+	// ntt_convolve
+	const uint32_t scale_0 = ntt_reduce(ntt_mont_pow(ntt_reduce((uint64_t) (L % q0.p) * q0.r2, q0), q0.p - 2, q0), q0);
+	const uint32_t scale_1 = ntt_reduce(ntt_mont_pow(ntt_reduce((uint64_t) (L % q1.p) * q1.r2, q1), q1.p - 2, q1), q1);
+	const uint32_t scale_2 = ntt_reduce(ntt_mont_pow(ntt_reduce((uint64_t) (L % q2.p) * q2.r2, q2), q2.p - 2, q2), q2);
+
+	uint64_t carry = 0;
+
+	for (size_t k = 0; k < L && 32 * k < R_ELS * sizeof(EL_T) * 8; k++) {
+		const uint32_t x0 = ntt_mont_mul(c0[k], scale_0, q0);
+		const uint32_t x1 = ntt_mont_mul(c1[k], scale_1, q1);
+		const uint32_t x2 = ntt_mont_mul(c2[k], scale_2, q2);
+
+		// x = v0 + v1 * p0 + v2 * p0 * p1, where v0 < p0 < 2^31 and
+		// lo < p0 * p1 < 2^60 are small enough for ntt_reduce, so neither
+		// needs a division
+		const uint32_t v0 = x0;
+		const uint32_t v1 = ntt_sub(ntt_mont_mul(x1, inv_0_1, q1), ntt_reduce((uint64_t) v0 * inv_0_1, q1), q1);
+		const uint64_t lo = v0 + (uint64_t) v1 * q0.p;
+		const uint32_t v2 = ntt_sub(ntt_mont_mul(x2, inv_01_2, q2), ntt_mont_mul(ntt_reduce(lo, q2), inv_01_2_r, q2), q2);
+
+		// the high part of v2 * p0 * p1 goes straight into the carry
+		const uint64_t low_part = lo + (uint64_t) v2 * (uint32_t) P01;
+		const uint64_t sum = (low_part & 0xffffffffU) + carry;
+
+		ntt_set_digit<R_ELS>(r, k, (uint32_t) sum);
+
+		carry = (sum >> 32) + (low_part >> 32) + (uint64_t) v2 * (uint32_t) (P01 >> 32);
+	}
+}
+
+/*
+ * Number of values of 32 bits of the temporaries of ntt_mul for products of
+ * N elements of EL_T.
+ */
+template<size_t N, typename EL_T>
+__host__ __device__
+inline constexpr size_t ntt_scratch_size() {
+	return 4 * ntt_size<N, EL_T>();
+}
+
+/*
+ * Number theoretic transform multiplication kernel. Multiplies the N
+ * elements of a with the N elements of b and stores the lowest R_ELS
+ * elements of the product in r, like comba_mul. The digits of 32 bits of a
+ * and b are convolved modulo three primes, in O(n log n), and the product is
+ * combined from the convolutions, see ntt_to_els. scratch must have room for
+ * ntt_scratch_size<N, EL_T>() values. If b is nullptr, a is squared, with one
+ * forward transform less. r must not overlap with a or b.
+ *
+ * This is for the host only. The butterflies of ntt_forward and ntt_inverse
+ * and the pointwise products are branchless loops of 32 bit values, which
+ * the compiler vectorizes, there are no intrinsics. There is no device
+ * version: the temporaries are too big for the stack of a CUDA thread,
+ * device code can't read the twiddle tables, and there is no transform that
+ * is shared by the threads of a block. Device code stays with Karatsuba, see
+ * use_ntt.
+ */
+template<size_t R_ELS, size_t N, typename EL_T>
+inline constexpr void ntt_mul(EL_T *r, const EL_T *a, const EL_T *b, uint32_t *scratch) {
+	constexpr size_t L = ntt_size<N, EL_T>();
+	const ntt_twiddle_table<L> &table = NTT_TWIDDLES<L>;
+
+	static_assert(L <= NTT_MAX_SIZE, "constraint not fulfilled: ntt_size<N, EL_T>() <= NTT_MAX_SIZE");
+
+	uint32_t *c0 = scratch;
+	uint32_t *c1 = scratch + L;
+	uint32_t *c2 = scratch + 2 * L;
+	uint32_t *t = scratch + 3 * L;
+
+	ntt_convolve<N, L>(c0, a, b, table.tw[0][0], table.tw[0][1], t, ntt_prime_at<0>());
+	ntt_convolve<N, L>(c1, a, b, table.tw[1][0], table.tw[1][1], t, ntt_prime_at<1>());
+	ntt_convolve<N, L>(c2, a, b, table.tw[2][0], table.tw[2][1], t, ntt_prime_at<2>());
+
+	ntt_to_els<R_ELS, L>(r, c0, c1, c2);
+}
+
+/*
+ * Like above, with the temporaries on the stack, which are
+ * 4 * ntt_size<N, EL_T>() values of 32 bits, at most 256 KiB with the default
+ * NTT_MAX_SIZE.
+ */
+template<size_t R_ELS, size_t N, typename EL_T>
+inline constexpr void ntt_mul(EL_T *r, const EL_T *a, const EL_T *b) {
+	uint32_t scratch[ntt_scratch_size<N, EL_T>()];
+
+	ntt_mul<R_ELS, N>(r, a, b, scratch);
+}
+
+/*
+ * Whether products of N elements of EL_T are computed with ntt_mul, which is
+ * never the case in device code, see ntt_mul.
+ */
+template<size_t N, typename EL_T>
+__host__ __device__
+inline constexpr bool use_ntt() {
+#ifdef __CUDA_ARCH__
+	return false;
+#else
+	return N >= NTT_THRESHOLD_ELS && ntt_size<N, EL_T>() <= NTT_MAX_SIZE;
+#endif
+}
+
+/*
+ * Multiplies the N elements of a with the N elements of b and stores the
+ * 2 * N elements of the product in r. The kernel is selected at compile time
+ * by N: Comba for small, Karatsuba for medium and ntt_mul for very big N. In
+ * constant expressions, it's always the Comba kernel, because the temporaries
+ * of the other kernels are left uninitialized. r must not
+ * overlap with a or b.
+ */
+template<size_t N, typename EL_T>
+__host__ __device__
+inline constexpr void mul_els(EL_T *r, const EL_T *a, const EL_T *b) {
+	if constexpr (N < KARATSUBA_THRESHOLD_ELS || N < 2) {
+		comba_mul<2 * N, N, N>(r, a, b);
+	} else if (BIFSI_IS_CONSTANT_EVALUATED()) {
+		comba_mul<2 * N, N, N>(r, a, b);
+	} else if constexpr (use_ntt<N, EL_T>()) {
+		ntt_mul<2 * N, N>(r, a, b);
+	} else {
+		karatsuba_mul<N>(r, a, b);
+	}
+}
+
+/*
+ * Multiplies the N elements of a with the N elements of b and stores the
+ * lowest N elements of the product in r. The kernel is selected at compile
+ * time by N. r must not overlap with a or b.
+ */
+template<size_t N, typename EL_T>
+__host__ __device__
+inline constexpr void mul_els_lo(EL_T *r, const EL_T *a, const EL_T *b) {
+	if constexpr (N < KARATSUBA_THRESHOLD_ELS || N < 2) {
+		comba_mul<N, N, N>(r, a, b);
+	} else if (BIFSI_IS_CONSTANT_EVALUATED()) {
+		comba_mul<N, N, N>(r, a, b);
+	} else if constexpr (use_ntt<N, EL_T>()) {
+		ntt_mul<N, N>(r, a, b);
+	} else {
+		karatsuba_mul_lo<N>(r, a, b);
+	}
+}
+
+/*
+ * Stores the 2 * N elements of a * b + c in r, where a, b and c have N
+ * elements. This can't overflow, because (2^k - 1)^2 + 2^k - 1 < 2^(2 * k).
+ * With the Comba kernel, c is added in the same pass as the products, with
+ * the Karatsuba and NTT kernels, it's added to the product afterwards. r must
+ * not overlap with a, b or c.
+ */
+template<size_t N, typename EL_T>
+__host__ __device__
+inline constexpr void mul_add_els(EL_T *r, const EL_T *a, const EL_T *b, const EL_T *c) {
+	if constexpr (N < KARATSUBA_THRESHOLD_ELS || N < 2) {
+		comba_mul<2 * N, N, N, N>(r, a, b, c);
+	} else if (BIFSI_IS_CONSTANT_EVALUATED()) {
+		comba_mul<2 * N, N, N, N>(r, a, b, c);
+	} else if constexpr (use_ntt<N, EL_T>()) {
+		ntt_mul<2 * N, N>(r, a, b);
+		els_add<2 * N, N>(r, c);
+	} else {
+		karatsuba_mul<N>(r, a, b);
+		els_add<2 * N, N>(r, c);
+	}
+}
+
+/*
+ * Comba squaring kernel. Squares the N elements of a and stores the lowest
+ * R_ELS elements of the square in r. Like comba_mul, the square is computed
+ * column by column, but each cross product a[i] * a[k - i] with i < k - i is
+ * computed once and the sum of the cross products of a column is doubled
+ * before the diagonal a[k / 2]^2 of even columns is added, so this needs
+ * about half the element multiplications of comba_mul. r must not overlap
+ * with a.
+ */
+template<size_t R_ELS, size_t N, typename EL_T>
+__host__ __device__
+inline constexpr void comba_sqr(EL_T *r, const EL_T *a) {
+	static_assert(R_ELS <= 2 * N, "constraint not fulfilled: R_ELS <= 2 * N");
+
+	typedef twice_size_t<EL_T> TW_T;
+
+	constexpr size_t W = sizeof(EL_T) * 8;
+
+	if constexpr (TW_IS_NATIVE<EL_T>) {
+		// the column sum is acc + acc_hi * 2^(2 * W), see comba_mul, and the
+		// sum of the cross products of a column is x + x_hi * 2^(2 * W)
+		TW_T acc = 0;
+		TW_T acc_hi = 0;
+
+#ifdef __NVCC__
+#pragma unroll
+#endif
+		for (size_t k = 0; k < R_ELS; k++) {
+			const size_t i_begin = (k < N) ? 0 : k - N + 1;
+			const size_t i_end = (k + 1) / 2;
+
+			TW_T x = 0;
+			TW_T x_hi = 0;
+
+#ifdef __NVCC__
+#pragma unroll
+#endif
+			for (size_t i = i_begin; i < i_end; i++) {
+				const TW_T p = ((TW_T) a[i]) * a[k - i];
+				x += p;
+				x_hi += (x < p);
+			}
+
+			x_hi = (x_hi << 1) | (x >> (2 * W - 1));
+			x <<= 1;
+
+			if (k % 2 == 0) {
+				const TW_T p = ((TW_T) a[k / 2]) * a[k / 2];
+				x += p;
+				x_hi += (x < p);
+			}
+
+			acc += x;
+			acc_hi += x_hi + (acc < x);
+
+			r[k] = (EL_T) acc;
+
+			acc = (acc >> W) | (((TW_T) (EL_T) acc_hi) << W);
+			acc_hi >>= W;
+		}
+
+	} else {
+		// the column sum is c0 + c1 * 2^W + c2 * 2^(2 * W), see comba_mul, and
+		// the sum of the cross products of a column is x0 + x1 * 2^W + x2 *
+		// 2^(2 * W)
+		EL_T c0 = 0;
+		EL_T c1 = 0;
+		EL_T c2 = 0;
+
+#ifdef __NVCC__
+#pragma unroll
+#endif
+		for (size_t k = 0; k < R_ELS; k++) {
+			const size_t i_begin = (k < N) ? 0 : k - N + 1;
+			const size_t i_end = (k + 1) / 2;
+
+			EL_T x0 = 0;
+			EL_T x1 = 0;
+			EL_T x2 = 0;
+
+#ifdef __NVCC__
+#pragma unroll
+#endif
+			for (size_t i = i_begin; i < i_end; i++) {
+				EL_T hi = 0;
+				const EL_T lo = mul_wide(a[i], a[k - i], hi);
+
+				EL_T carry = 0;
+				x0 = addc(x0, lo, carry);
+				x1 = addc(x1, hi, carry);
+				x2 += carry;
+			}
+
+			x2 = (x2 << 1) | (x1 >> (W - 1));
+			x1 = (x1 << 1) | (x0 >> (W - 1));
+			x0 <<= 1;
+
+			if (k % 2 == 0) {
+				EL_T hi = 0;
+				const EL_T lo = mul_wide(a[k / 2], a[k / 2], hi);
+
+				EL_T carry = 0;
+				x0 = addc(x0, lo, carry);
+				x1 = addc(x1, hi, carry);
+				x2 += carry;
+			}
+
+			EL_T carry = 0;
+			c0 = addc(c0, x0, carry);
+			c1 = addc(c1, x1, carry);
+			c2 = c2 + x2 + carry;
+
+			r[k] = c0;
+
+			c0 = c1;
+			c1 = c2;
+			c2 = 0;
+		}
+	}
+}
+
+template<size_t N, typename EL_T>
+__host__ __device__
+inline constexpr void sqr_els(EL_T *r, const EL_T *a);
+
+/*
+ * Karatsuba squaring kernel. Squares the N elements of a and stores the
+ * 2 * N elements of the square in r. Like karatsuba_mul, but all three
+ * multiplications are squarings and the middle term is
+ *
+ * 2 * a_lo * a_hi = z0 + z2 - (a_hi - a_lo)^2,
+ *
+ * which needs no sign handling, because the third square is never negative.
+ * r must not overlap with a.
+ */
+template<size_t N, typename EL_T>
+__host__ __device__
+inline constexpr void karatsuba_sqr(EL_T *r, const EL_T *a) {
+	static_assert(N >= 2, "constraint not fulfilled: N >= 2");
+
+	constexpr size_t LO = N / 2;
+	constexpr size_t HI = N - LO;
+	constexpr size_t M_ELS = 2 * HI + 1;
+
+	// z0 = a_lo^2 goes to r[0, 2 * LO), z2 = a_hi^2 to r[2 * LO, 2 * N)
+	sqr_els<LO>(r, a);
+	sqr_els<HI>(r + 2 * LO, a + LO);
+
+	EL_T da[HI];
+	EL_T a_lo[HI];
+
+#ifdef __NVCC__
+#pragma unroll
+#endif
+	for (size_t i = 0; i < HI; i++) {
+		a_lo[i] = (i < LO) ? a[i] : 0;
+	}
+
+	els_abs_diff<HI, HI>(da, a + LO, a_lo);
+
+	EL_T d[2 * HI];
+	sqr_els<HI>(d, da);
+
+	// m = z0 + z2 - d
+	EL_T m[M_ELS];
+
+#ifdef __NVCC__
+#pragma unroll
+#endif
+	for (size_t i = 0; i < M_ELS; i++) {
+		m[i] = (i < 2 * HI) ? r[2 * LO + i] : 0;
+	}
+
+	els_add<M_ELS, 2 * LO>(m, r);
+	els_sub<M_ELS, 2 * HI>(m, d);
+
+	els_add<2 * N - LO, M_ELS>(r + LO, m);
+}
+
+/*
+ * Same as karatsuba_sqr, but only the lowest N elements of the square are
+ * computed and stored in r. Like karatsuba_mul_lo, this costs one full
+ * squaring and one truncated multiplication of half size, because the cross
+ * product 2 * a_lo * a_hi is only needed modulo 2^(HI * EL_SIZE_IN_BITS).
+ */
+template<size_t N, typename EL_T>
+__host__ __device__
+inline constexpr void karatsuba_sqr_lo(EL_T *r, const EL_T *a) {
+	static_assert(N >= 2, "constraint not fulfilled: N >= 2");
+
+	constexpr size_t LO = N / 2;
+	constexpr size_t HI = N - LO;
+
+	EL_T z0[2 * LO];
+	sqr_els<LO>(z0, a);
+
+#ifdef __NVCC__
+#pragma unroll
+#endif
+	for (size_t i = 0; i < N; i++) {
+		r[i] = (i < 2 * LO) ? z0[i] : 0;
+	}
+
+	EL_T a_lo[HI];
+
+#ifdef __NVCC__
+#pragma unroll
+#endif
+	for (size_t i = 0; i < HI; i++) {
+		a_lo[i] = (i < LO) ? a[i] : 0;
+	}
+
+	EL_T c[HI];
+
+	mul_els_lo<HI>(c, a_lo, a + LO);
+	els_add<HI, HI>(r + LO, c);
+	els_add<HI, HI>(r + LO, c);
+
+	if constexpr (HI > LO) {
+		// lowest element of a_hi^2, which lands in r[2 * LO] = r[N - 1]
+		r[N - 1] += (EL_T) (((twice_size_t<EL_T>) a[LO]) * a[LO]);
+	}
+}
+
+/*
+ * Squares the N elements of a and stores the 2 * N elements of the square in
+ * r. The kernel is selected at compile time by N, like for mul_els. r must
+ * not overlap with a.
+ */
+template<size_t N, typename EL_T>
+__host__ __device__
+inline constexpr void sqr_els(EL_T *r, const EL_T *a) {
+	if constexpr (N < 2) {
+		// no cross products
+		comba_mul<2 * N, N, N>(r, a, a);
+	} else if constexpr (N < KARATSUBA_THRESHOLD_ELS) {
+		comba_sqr<2 * N, N>(r, a);
+	} else if (BIFSI_IS_CONSTANT_EVALUATED()) {
+		comba_sqr<2 * N, N>(r, a);
+	} else if constexpr (use_ntt<N, EL_T>()) {
+		ntt_mul<2 * N, N>(r, a, (const EL_T*) nullptr);
+	} else {
+		karatsuba_sqr<N>(r, a);
+	}
+}
+
+/*
+ * Squares the N elements of a and stores the lowest N elements of the square
+ * in r. The kernel is selected at compile time by N, like for mul_els_lo. r
+ * must not overlap with a.
+ */
+template<size_t N, typename EL_T>
+__host__ __device__
+inline constexpr void sqr_els_lo(EL_T *r, const EL_T *a) {
+	if constexpr (N < 2) {
+		// no cross products
+		comba_mul<N, N, N>(r, a, a);
+	} else if constexpr (N < KARATSUBA_THRESHOLD_ELS) {
+		comba_sqr<N, N>(r, a);
+	} else if (BIFSI_IS_CONSTANT_EVALUATED()) {
+		comba_sqr<N, N>(r, a);
+	} else if constexpr (use_ntt<N, EL_T>()) {
+		ntt_mul<N, N>(r, a, (const EL_T*) nullptr);
+	} else {
+		karatsuba_sqr_lo<N>(r, a);
+	}
+}
+
+/*
+ * Multiplies the an used elements of a with the bn used elements of b and
+ * stores the lowest R_ELS elements of the product in r, one row per element
+ * of a, with loop bounds known only at runtime. This is for operands with far
+ * fewer used elements than their size, see mul_els_vartime. r must not
+ * overlap with a or b.
+ */
+template<size_t R_ELS, typename EL_T>
+__host__ __device__
+inline constexpr void schoolbook_mul_vartime(EL_T *r, const EL_T *a, const size_t &an, const EL_T *b, const size_t &bn) {
+	for (size_t i = 0; i < R_ELS; i++) {
+		r[i] = 0;
+	}
+
+	for (size_t i = 0; i < an && i < R_ELS; i++) {
+		const size_t end = (bn < R_ELS - i) ? bn : R_ELS - i;
+
+		EL_T carry = 0;
+
+		for (size_t j = 0; j < end; j++) {
+			r[i + j] = mul_add_wide(a[i], b[j], r[i + j], carry, carry);
+		}
+
+		// the rows above haven't reached this element yet
+		if (i + end < R_ELS) {
+			r[i + end] = carry;
+		}
+	}
+}
+
+/*
+ * Same as mul_els, but for the an and bn used elements of a and b, see
+ * vartime. If both have at most half of the N elements used, the product is
+ * that of the lower halves, recursively. If one of them has at most a quarter
+ * of the used elements of the other, it's computed row by row, see
+ * schoolbook_mul_vartime. Otherwise, it's mul_els for the full size.
+ */
+template<size_t N, typename EL_T>
+__host__ __device__
+inline constexpr void mul_els_vartime(EL_T *r, const EL_T *a, const EL_T *b, const size_t &an, const size_t &bn) {
+	constexpr size_t HALF = N / 2;
+
+	const size_t min_n = (an < bn) ? an : bn;
+	const size_t max_n = (an < bn) ? bn : an;
+
+	if constexpr (HALF > 0) {
+		if (max_n <= HALF) {
+			mul_els_vartime<HALF>(r, a, b, an, bn);
+
+			for (size_t i = 2 * HALF; i < 2 * N; i++) {
+				r[i] = 0;
+			}
+
+			return;
+		}
+	}
+
+	if (4 * min_n <= max_n) {
+		if (an <= bn) {
+			schoolbook_mul_vartime<2 * N>(r, a, an, b, bn);
+		} else {
+			schoolbook_mul_vartime<2 * N>(r, b, bn, a, an);
+		}
+	} else {
+		mul_els<N>(r, a, b);
+	}
+}
+
+/*
+ * Same as mul_els_lo, but for the an and bn used elements of a and b, see
+ * mul_els_vartime.
+ */
+template<size_t N, typename EL_T>
+__host__ __device__
+inline constexpr void mul_els_lo_vartime(EL_T *r, const EL_T *a, const EL_T *b, const size_t &an, const size_t &bn) {
+	constexpr size_t HALF = N / 2;
+
+	const size_t min_n = (an < bn) ? an : bn;
+	const size_t max_n = (an < bn) ? bn : an;
+
+	if constexpr (HALF > 0) {
+		if (max_n <= HALF) {
+			// the whole product fits into the 2 * HALF <= N elements
+			mul_els_vartime<HALF>(r, a, b, an, bn);
+
+			for (size_t i = 2 * HALF; i < N; i++) {
+				r[i] = 0;
+			}
+
+			return;
+		}
+	}
+
+	if (4 * min_n <= max_n) {
+		if (an <= bn) {
+			schoolbook_mul_vartime<N>(r, a, an, b, bn);
+		} else {
+			schoolbook_mul_vartime<N>(r, b, bn, a, an);
+		}
+	} else {
+		mul_els_lo<N>(r, a, b);
+	}
+}
+
+/*
+ * Same as sqr_els, but for the an used elements of a, which are squared with
+ * the kernel for half the size, recursively, if an is at most N / 2, see
+ * mul_els_vartime.
+ */
+template<size_t N, typename EL_T>
+__host__ __device__
+inline constexpr void sqr_els_vartime(EL_T *r, const EL_T *a, const size_t &an) {
+	constexpr size_t HALF = N / 2;
+
+	if constexpr (HALF > 0) {
+		if (an <= HALF) {
+			sqr_els_vartime<HALF>(r, a, an);
+
+			for (size_t i = 2 * HALF; i < 2 * N; i++) {
+				r[i] = 0;
+			}
+
+			return;
+		}
+	}
+
+	sqr_els<N>(r, a);
+}
+
+/*
+ * Same as sqr_els_lo, but for the an used elements of a, see sqr_els_vartime.
+ */
+template<size_t N, typename EL_T>
+__host__ __device__
+inline constexpr void sqr_els_lo_vartime(EL_T *r, const EL_T *a, const size_t &an) {
+	constexpr size_t HALF = N / 2;
+
+	if constexpr (HALF > 0) {
+		if (an <= HALF) {
+			sqr_els_vartime<HALF>(r, a, an);
+
+			for (size_t i = 2 * HALF; i < N; i++) {
+				r[i] = 0;
+			}
+
+			return;
+		}
+	}
+
+	sqr_els_lo<N>(r, a);
+}
+
+/*
+ * Divides the N elements of a by the M elements of d with Knuth's algorithm D
+ * (TAOCP Vol. 2, 4.3.1) and stores the N elements of the quotient in q and
+ * the M elements of the remainder in r. d must not be 0.
+ *
+ * d is normalized by shifting it left until its topmost nonzero element has
+ * its highest bit set, which makes the trial quotients computed in TW_T from
+ * the two topmost elements of the remainder at most 2 too large.
+ *
+ * Unlike most functions of this library, this function is not branchless: the
+ * number of iterations depends on the number of nonzero elements of d and the
+ * trial quotient corrections depend on the values. Use ct_div_els for a fixed
+ * number of iterations.
+ *
+ * Only the lowest na elements of a are divided, the ones above must be 0.
+ * The default is all N, with which the number of iterations doesn't depend
+ * on a. divmod<vartime> passes the used elements of a, see vartime.
+ */
+template<size_t N, size_t M, typename EL_T>
+__host__ __device__
+inline constexpr void knuth_div_els(EL_T *q, EL_T *r, const EL_T *a, const EL_T *d, const size_t &na = N) {
+	typedef twice_size_t<EL_T> TW_T;
+
+	constexpr size_t W = sizeof(EL_T) * 8;
+	constexpr TW_T B = ((TW_T) 1) << W;
+
+	size_t n = M;
+
+	while (n > 0 && d[n - 1] == 0) {
+		n--;
+	}
+
+	assert(n > 0); // division by zero
+
+	for (size_t i = 0; i < N; i++) {
+		q[i] = 0;
+	}
+
+	for (size_t i = 0; i < M; i++) {
+		r[i] = (i < N) ? a[i] : 0;
+	}
+
+	if (n > na) {
+		// d has more nonzero elements than a, so d > a
+		return;
+	}
+
+	if (n == 1) {
+		TW_T tw = 0;
+
+		for (size_t i = na - 1; i != (size_t) -1; i--) {
+			tw <<= W;
+			tw |= a[i];
+			q[i] = (EL_T) (tw / d[0]);
+			tw %= d[0];
+		}
+
+		for (size_t i = 0; i < M; i++) {
+			r[i] = 0;
+		}
+
+		r[0] = (EL_T) tw;
+
+		return;
+	}
+
+	const size_t s = number_of_leading_0_bits(d[n - 1]);
+
+	// normalized divisor and dividend
+	EL_T vn[M] = { };
+	EL_T un[N + 1] = { };
+
+	for (size_t i = n - 1; i > 0; i--) {
+		vn[i] = (EL_T) (((((TW_T) d[i]) << W) | d[i - 1]) >> (W - s));
+	}
+
+	vn[0] = (EL_T) (((TW_T) d[0]) << s);
+
+	un[na] = (EL_T) ((((TW_T) a[na - 1]) << s) >> W);
+
+	for (size_t i = na - 1; i > 0; i--) {
+		un[i] = (EL_T) (((((TW_T) a[i]) << W) | a[i - 1]) >> (W - s));
+	}
+
+	un[0] = (EL_T) (((TW_T) a[0]) << s);
+
+	for (size_t j = na - n; j != (size_t) -1; j--) {
+		const TW_T num = (((TW_T) un[j + n]) << W) | un[j + n - 1];
+
+		TW_T qhat = num / vn[n - 1];
+		TW_T rhat = num % vn[n - 1];
+
+		while (qhat >= B || qhat * vn[n - 2] > ((rhat << W) | un[j + n - 2])) {
+			qhat--;
+			rhat += vn[n - 1];
+
+			if (rhat >= B) {
+				break;
+			}
+		}
+
+		// un[j, j + n] -= qhat * vn, qhat fits into EL_T at this point
+		EL_T carry = 0;
+		EL_T borrow = 0;
+
+		for (size_t i = 0; i < n; i++) {
+			const EL_T p = mul_add_wide((EL_T) qhat, vn[i], carry, carry);
+			un[i + j] = subb(un[i + j], p, borrow);
+		}
+
+		un[j + n] = subb(un[j + n], carry, borrow);
+
+		q[j] = (EL_T) qhat;
+
+		if (borrow) {
+			// qhat was 1 too large, add back one vn
+			q[j]--;
+
+			EL_T c = 0;
+
+			for (size_t i = 0; i < n; i++) {
+				un[i + j] = addc(un[i + j], vn[i], c);
+			}
+
+			un[j + n] += c;
+		}
+	}
+
+	// unnormalize the remainder
+	for (size_t i = 0; i < n - 1; i++) {
+		r[i] = (EL_T) (((((TW_T) un[i + 1]) << W) | un[i]) >> s);
+	}
+
+	r[n - 1] = un[n - 1] >> s;
+
+	for (size_t i = n; i < M; i++) {
+		r[i] = 0;
+	}
+}
+
+/*
+ * Divides the N elements of a by the M elements of d and stores the N
+ * elements of the quotient in q and the M elements of the remainder in r. d
+ * must not be 0.
+ *
+ * This is a bitwise restoring division with a fixed number of
+ * N * EL_SIZE_IN_BITS iterations, each of which shifts one bit of a into the
+ * remainder and subtracts d if possible. The subtraction is selected with a
+ * mask, so there is no branch which depends on the values, which keeps the
+ * threads of a warp coherent and makes the execution time independent of the
+ * values. It's slower than knuth_div_els by a factor in the order of
+ * EL_SIZE_IN_BITS.
+ */
+template<size_t N, size_t M, typename EL_T>
+__host__ __device__
+inline constexpr void ct_div_els(EL_T *q, EL_T *r, const EL_T *a, const EL_T *d) {
+	constexpr size_t W = sizeof(EL_T) * 8;
+
+#ifdef __NVCC__
+#pragma unroll
+#endif
+	for (size_t i = 0; i < N; i++) {
+		q[i] = 0;
+	}
+
+#ifdef __NVCC__
+#pragma unroll
+#endif
+	for (size_t i = 0; i < M; i++) {
+		r[i] = 0;
+	}
+
+	for (size_t bit_idx = N * W - 1; bit_idx != (size_t) -1; bit_idx--) {
+		// r = 2 * r + bit, with r_hi being the bit shifted out of r
+		const EL_T r_hi = r[M - 1] >> (W - 1);
+
+#ifdef __NVCC__
+#pragma unroll
+#endif
+		for (size_t i = M - 1; i > 0; i--) {
+			r[i] = (EL_T) (r[i] << 1) | (r[i - 1] >> (W - 1));
+		}
+
+		r[0] = (EL_T) (r[0] << 1) | ((a[bit_idx / W] >> (bit_idx % W)) & 1);
+
+		// r -= d, if r >= d
+		EL_T t[M] = { };
+
+#ifdef __NVCC__
+#pragma unroll
+#endif
+		for (size_t i = 0; i < M; i++) {
+			t[i] = r[i];
+		}
+
+		const EL_T borrow = els_sub<M, M>(t, d);
+		const EL_T q_bit = r_hi | (borrow ^ 1);
+		const EL_T mask = (EL_T) -q_bit;
+
+#ifdef __NVCC__
+#pragma unroll
+#endif
+		for (size_t i = 0; i < M; i++) {
+			r[i] = (t[i] & mask) | (r[i] & ~mask);
+		}
+
+		q[bit_idx / W] |= (EL_T) (q_bit << (bit_idx % W));
+	}
+}
+
+/**
+ * A divisor d of one element together with a precomputed reciprocal, for
+ * dividing many values by the same d. Each element of the quotient then costs
+ * a multiplication and a few additions and comparisons instead of a hardware
+ * division of a twice size value, which is slow for unsigned __int128 on the
+ * host and emulated on CUDA. See div_2by1 and els_div_divisor.
+ *
+ * d is normalized to d_norm = d * 2^shift with the highest bit set, and the
+ * reciprocal v = floor((2^(2 * W) - 1) / d_norm) - 2^W is computed with one
+ * division in the constructor, with W being EL_SIZE_IN_BITS. The constructor
+ * is constexpr, so divisors known at compile time cost nothing at run time,
+ * see CONST_DIVISOR.
+ *
+ * Reference: N. Moeller, T. Granlund, Improved division by invariant integers,
+ * IEEE Transactions on Computers 60 (2011), algorithm 4.
+ */
+template<typename EL_T = el_t>
+struct divisor {
+	typedef twice_size_t<EL_T> tw_t;
+
+	static const size_t EL_SIZE_IN_BITS = sizeof(EL_T) * 8;
+
+	EL_T d = 0;
+	EL_T d_norm = 0;
+	EL_T v = 0;
+	unsigned int shift;
+
+	/*
+	 * d must not be 0.
+	 */
+	__host__ __device__
+	inline constexpr divisor(const EL_T &d) :
+			d(d), d_norm(0), v(0), shift(0) {
+		assert(d != 0);
+
+		while ((EL_T) (d << shift) >> (EL_SIZE_IN_BITS - 1) == 0) {
+			shift++;
+		}
+
+		d_norm = (EL_T) (d << shift);
+		v = (EL_T) ((((tw_t) (EL_T) ~d_norm) << EL_SIZE_IN_BITS | (EL_T) ~(EL_T) 0) / d_norm);
+	}
+
+	/*
+	 * Returns the quotient of u1 * 2^W + u0 divided by d_norm and stores the
+	 * remainder in r. u1 must be less than d_norm, so the quotient fits into
+	 * one element. The two corrections of the estimated quotient are plain
+	 * selects, which compilers translate to conditional moves, because a mask
+	 * would lengthen the dependency chain from one element to the next.
+	 */
+	__host__ __device__
+	inline constexpr EL_T div_2by1(const EL_T &u1, const EL_T &u0, EL_T &r) const {
+		// (q1, q0) = v * u1 + (u1, u0), which doesn't overflow
+		EL_T q1 = 0;
+		const EL_T q0 = mul_add_wide(v, u1, u0, q1);
+		q1 = (EL_T) (q1 + u1 + 1);
+
+		// at least unsigned int, so uint16_t doesn't overflow a signed int
+		typedef std::common_type_t<EL_T, unsigned int> uw_t;
+
+		EL_T rem = (EL_T) (u0 - (EL_T) ((uw_t) q1 * d_norm));
+
+		// rem > q0 means that q1 is one too big, rem then wrapped around
+		const bool too_big = rem > q0;
+		q1 = (EL_T) (q1 - too_big);
+		rem = too_big ? (EL_T) (rem + d_norm) : rem;
+
+		// rarely, q1 is one too small
+		const bool too_small = rem >= d_norm;
+		q1 = (EL_T) (q1 + too_small);
+		rem = too_small ? (EL_T) (rem - d_norm) : rem;
+
+		r = rem;
+
+		return q1;
+	}
+
+	/*
+	 * Returns the element hi * 2^shift + lo / 2^(W - shift) mod 2^W, i.e. the
+	 * element of the normalized dividend at the position of hi. The right
+	 * shift is done in two steps, because shift may be 0.
+	 */
+	__host__ __device__
+	inline constexpr EL_T normalize(const EL_T &hi, const EL_T &lo) const {
+		return (EL_T) ((EL_T) (hi << shift) | ((EL_T) (lo >> 1) >> (EL_SIZE_IN_BITS - 1 - shift)));
+	}
+};
+
+/*
+ * The divisor D, constructed at compile time, e.g. CONST_DIVISOR<EL_T, 10>.
+ */
+template<typename EL_T, EL_T D>
+inline constexpr divisor<EL_T> CONST_DIVISOR = divisor<EL_T>(D);
+
+/*
+ * Divides the N elements of a by d, stores the N elements of the quotient in
+ * q and returns the remainder. q may be a. The elements of a are shifted by
+ * d.shift on the fly, so the normalized dividend is never stored.
+ *
+ * Only the lowest na elements of a are divided, the ones above must be 0 and
+ * na must not be 0. The default is all N, see knuth_div_els.
+ */
+template<size_t N, typename EL_T>
+__host__ __device__
+inline constexpr EL_T els_div_divisor(EL_T *q, const EL_T *a, const divisor<EL_T> &d, const size_t &na = N) {
+	for (size_t i = na; i < N; i++) {
+		q[i] = 0;
+	}
+
+	// the bits shifted out of the top element, less than d_norm
+	EL_T r = d.normalize(0, a[na - 1]);
+
+#ifdef __NVCC__
+#pragma unroll
+#endif
+	for (size_t i = na - 1; i > 0; i--) {
+		q[i] = d.div_2by1(r, d.normalize(a[i], a[i - 1]), r);
+	}
+
+	q[0] = d.div_2by1(r, (EL_T) (a[0] << d.shift), r);
+
+	return (EL_T) (r >> d.shift);
+}
+
+/*
+ * Returns the remainder of the N elements of a divided by d, like
+ * els_div_divisor, but without storing the quotient.
+ */
+template<size_t N, typename EL_T>
+__host__ __device__
+inline constexpr EL_T els_mod_divisor(const EL_T *a, const divisor<EL_T> &d) {
+	EL_T r = d.normalize(0, a[N - 1]);
+
+#ifdef __NVCC__
+#pragma unroll
+#endif
+	for (size_t i = N - 1; i > 0; i--) {
+		d.div_2by1(r, d.normalize(a[i], a[i - 1]), r);
+	}
+
+	d.div_2by1(r, (EL_T) (a[0] << d.shift), r);
+
+	return (EL_T) (r >> d.shift);
+}
+
+/*
+ * Number of decimal digits of the biggest power of 10 that fits into EL_T,
+ * e.g. 9 for uint32_t, because 10^9 < 2^32 < 10^10.
+ */
+template<typename EL_T>
+__host__ __device__
+inline constexpr size_t dec_chunk_digits() {
+	size_t digits = 0;
+
+	for (EL_T p = 1; p <= (EL_T) (((EL_T) ~(EL_T) 0) / 10); p = (EL_T) (p * 10)) {
+		digits++;
+	}
+
+	return digits;
+}
+
+/*
+ * The biggest power of 10 that fits into EL_T, e.g. 10^9 for uint32_t.
+ */
+template<typename EL_T>
+__host__ __device__
+inline constexpr EL_T dec_chunk() {
+	EL_T result = 1;
+
+	for (size_t i = 0; i < dec_chunk_digits<EL_T>(); i++) {
+		result = (EL_T) (result * 10);
+	}
+
+	return result;
+}
+
+/*
+ * Maximum number of decimal digits of a value with SIZE_IN_BITS bits.
+ */
+template<size_t SIZE_IN_BITS>
+__host__ __device__
+inline constexpr size_t max_dec_digits() {
+	constexpr double LOG_BASE10_2 = 0.301029995663981195; // constexpr std::log10(2.0);
+
+	return ceil_constexpr(SIZE_IN_BITS * LOG_BASE10_2);
+}
+
+/*
+ * Order of the bytes of bui::to_bytes and bui::from_bytes.
+ */
+enum class byte_order {
+	little, big
+};
+
+/*
+ * Result of from_chars, analogous to std::from_chars_result. ptr points to the
+ * first character which is not part of the parsed number. ec is
+ * std::errc::invalid_argument if there are no digits at all and
+ * std::errc::result_out_of_range if the number doesn't fit into the bui.
+ */
+struct from_chars_result {
+	const char *ptr;
+	std::errc ec;
+};
+
+/*
+ * Returns the value of the digit c in the given base, or base if c is no
+ * digit of that base. Supports bases up to 36, with letters of either case.
+ */
+__host__ __device__
+inline constexpr unsigned int digit_value(const char &c, const unsigned int &base) {
+	unsigned int value = base;
+
+	if (c >= '0' && c <= '9') {
+		value = c - '0';
+	} else if (c >= 'a' && c <= 'z') {
+		value = c - 'a' + 10;
+	} else if (c >= 'A' && c <= 'Z') {
+		value = c - 'A' + 10;
+	}
+
+	return (value < base) ? value : base;
+}
+
+/*
+ * Stores the value of the FROM_ELS elements of a in the TO_ELS elements of r,
+ * where the elements of r and a have different types, but both sequences have
+ * the same number of bits. Each element of the bigger type is composed of or
+ * split into sizeof(bigger) / sizeof(smaller) elements of the smaller type, so
+ * this works on values and doesn't depend on the byte order of the platform.
+ */
+template<size_t TO_ELS, size_t FROM_ELS, typename TO_EL_T, typename FROM_EL_T>
+__host__ __device__
+inline constexpr void els_convert(TO_EL_T *r, const FROM_EL_T *a) {
+	static_assert(TO_ELS * sizeof(TO_EL_T) == FROM_ELS * sizeof(FROM_EL_T), "constraint not fulfilled: TO_ELS * sizeof(TO_EL_T) == FROM_ELS * sizeof(FROM_EL_T)");
+
+	if constexpr (sizeof(TO_EL_T) >= sizeof(FROM_EL_T)) {
+		constexpr size_t K = sizeof(TO_EL_T) / sizeof(FROM_EL_T);
+
+#ifdef __NVCC__
+#pragma unroll
+#endif
+		for (size_t i = 0; i < TO_ELS; i++) {
+			TO_EL_T x = 0;
+
+#ifdef __NVCC__
+#pragma unroll
+#endif
+			for (size_t j = 0; j < K; j++) {
+				x |= (TO_EL_T) (((TO_EL_T) a[i * K + j]) << (j * sizeof(FROM_EL_T) * 8));
+			}
+
+			r[i] = x;
+		}
+
+	} else {
+		constexpr size_t K = sizeof(FROM_EL_T) / sizeof(TO_EL_T);
+
+#ifdef __NVCC__
+#pragma unroll
+#endif
+		for (size_t i = 0; i < TO_ELS; i++) {
+			r[i] = (TO_EL_T) (a[i / K] >> ((i % K) * sizeof(TO_EL_T) * 8));
+		}
+	}
+}
+
+/*
+ * Stores x in the N elements of r, the lowest element first, and zero in the
+ * elements above the size of UINT_T. If UINT_T has more than N elements, the
+ * upper ones are cut off.
+ */
+template<size_t N, typename EL_T, typename UINT_T>
+__host__ __device__
+inline constexpr void uint_to_els(EL_T *r, const UINT_T &x) {
+	constexpr size_t X_ELS = std::min((sizeof(UINT_T) + sizeof(EL_T) - 1) / sizeof(EL_T), N);
+
+#ifdef __NVCC__
+#pragma unroll
+#endif
+	for (size_t i = 0; i < X_ELS; i++) {
+		r[i] = (EL_T) (x >> (i * sizeof(EL_T) * 8));
+	}
+
+#ifdef __NVCC__
+#pragma unroll
+#endif
+	for (size_t i = X_ELS; i < N; i++) {
+		r[i] = 0;
+	}
+}
+
+/*
+ * Returns the lowest bits of the N elements of a as UINT_T, the inverse of
+ * uint_to_els.
+ */
+template<typename UINT_T, size_t N, typename EL_T>
+__host__ __device__
+inline constexpr UINT_T els_to_uint(const EL_T *a) {
+	constexpr size_t X_ELS = std::min((sizeof(UINT_T) + sizeof(EL_T) - 1) / sizeof(EL_T), N);
+
+	UINT_T result = 0;
+
+#ifdef __NVCC__
+#pragma unroll
+#endif
+	for (size_t i = 0; i < X_ELS; i++) {
+		result |= (UINT_T) (((UINT_T) a[i]) << (i * sizeof(EL_T) * 8));
+	}
+
+	return result;
+}
+
+/**
+ * This class represents an unsigned big fixed size int with the specified size
+ * in number of bits. bui means simply big unsigned int. This is the central
+ * class of this library.
+ *
+ * EL_T is the type of the elements which store the magnitude. It defaults to
+ * el_t, but it can be chosen per type, e.g. uint64_t on the host and uint32_t
+ * in CUDA kernels. Values with different element types are converted with the
+ * explicit converting constructor or with el_cast.
+ */
+template<size_t SIZE_IN_BITS, typename EL_T = el_t>
+class bui {
+public:
+	/*
+	 * Integer type of the elements of this big int.
+	 */
+	typedef EL_T el_t;
+
+	/*
+	 * Integer type twice the size of the element type.
+	 */
+	typedef twice_size_t<EL_T> tw_t;
+
+	static const size_t EL_SIZE_IN_BITS = sizeof(EL_T) * 8;
+
+private:
+	static_assert(sizeof(tw_t) == 2 * sizeof(el_t), "constraint not fulfilled: sizeof(tw_t) == 2 * sizeof(el_t)");
+	// static_assert(sizeof(el_t) == 2 * sizeof(ha_t), "constraint not fulfilled: sizeof(el_t) = 2 * sizeof(ha_t)");
+	static_assert(EL_SIZE_IN_BITS % 8 == 0, "constraint not fulfilled: EL_SIZE_IN_BITS % 8 == 0");
+	static_assert(SIZE_IN_BITS > 0, "constraint not fulfilled: SIZE_IN_BITS > 0");
+	static_assert(SIZE_IN_BITS % EL_SIZE_IN_BITS == 0, "constraint not fulfilled: SIZE_IN_BITS % EL_SIZE_IN_BITS == 0");
+
+public:
+	/*
+	 * Number of elements that this big int uses to store its magnitude.
+	 */
+	static const size_t SIZE_IN_ELS = SIZE_IN_BITS / EL_SIZE_IN_BITS;
+
+	/*
+	 * Number of bytes written by to_bytes and read by from_bytes.
+	 */
+	static const size_t SIZE_IN_BYTES = SIZE_IN_BITS / 8;
+
+	/*
+	 * Array of data elements which store the magnitude of this big int.
+	 */
+	el_t el[SIZE_IN_ELS];
+
+	/*
+	 * Constructs a new object of this type. The value is not initialized, so
+	 * it's arbitrary. This constructor is empty and if fully optimized by the
+	 * compiler, it translates to zero instructions.
+	 */
+	__host__ __device__
+	inline bui() {
+	}
+
+	/*
+	 * Constructs a new object with the given value. This and the following
+	 * constructors initialize el with el() instead of delegating to bui(),
+	 * because a constexpr constructor must initialize all members in C++17.
+	 * The compiler removes these stores, because they are overwritten.
+	 */
+	template<typename INT_T>
+	__host__ __device__
+	inline constexpr bui(const INT_T &value) :
+			el() {
+		static_assert_singed_or_unsigned_int_type<INT_T>();
+
+		if (is_unsigned_int_v<INT_T>) {
+			this->set_uint(value);
+		} else {
+			this->set_uint(static_cast<make_unsigned_t<INT_T>>(value));
+		}
+	}
+
+	__host__ __device__
+	inline constexpr bui(const char *value) :
+			el() {
+		this->set_from_str(value);
+	}
+
+	/*
+	 * Constructs a new object with the value of b, which has the same size,
+	 * but a different element type, see els_convert.
+	 */
+	template<typename B_EL_T>
+	__host__ __device__
+	inline explicit constexpr bui(const bui<SIZE_IN_BITS, B_EL_T> &b) :
+			bui() {
+		els_convert<SIZE_IN_ELS, bui<SIZE_IN_BITS, B_EL_T>::SIZE_IN_ELS>(el, b.el);
+	}
+
+	/*
+	 * Constructs a new object with the value of b, which has the same element
+	 * type, but a different size. A narrower b is extended with zeros, a wider
+	 * one is cut off to its lowest SIZE_IN_BITS bits, see width_cast.
+	 */
+	template<size_t B_SIZE_IN_BITS, std::enable_if_t<B_SIZE_IN_BITS != SIZE_IN_BITS, int> = 0>
+	__host__ __device__
+	inline explicit constexpr bui(const bui<B_SIZE_IN_BITS, EL_T> &b) :
+			el() {
+		constexpr size_t B_ELS = bui<B_SIZE_IN_BITS, EL_T>::SIZE_IN_ELS;
+		constexpr size_t COPY_ELS = std::min(SIZE_IN_ELS, B_ELS);
+
+#ifdef __NVCC__
+#pragma unroll
+#endif
+		for (size_t i = 0; i < COPY_ELS; i++) {
+			el[i] = b.el[i];
+		}
+
+		set_zero_starting_at_el<COPY_ELS>();
+	}
+
+	__host__ __device__
+	inline constexpr el_t to_el_t() const {
+		return el[0];
+	}
+
+	__host__ __device__
+	inline constexpr tw_t to_tw_t() const {
+		if (SIZE_IN_ELS == 1) {
+			return el[0];
+		} else {
+			return el[0] | (((tw_t) el[1]) << EL_SIZE_IN_BITS);
+		}
+	}
+
+	__host__ __device__
+	inline explicit constexpr operator el_t() const {
+		return to_el_t();
+	}
+
+	__host__ __device__
+	inline explicit constexpr operator tw_t() const {
+		return to_tw_t();
+	}
+
+private:
+	template<typename UINT_T>
+	__host__ __device__
+	inline constexpr void set_uint(const UINT_T &value) {
+		assert_unsigned_int_type<UINT_T>();
+
+		uint_to_els<SIZE_IN_ELS>(el, value);
+	}
+
+	template<typename UINT_T>
+	__host__ __device__
+	inline constexpr UINT_T as_uint() const {
+		assert_unsigned_int_type<UINT_T>();
+
+		return els_to_uint<UINT_T, SIZE_IN_ELS>(el);
+	}
+
+	__host__ __device__
+	inline constexpr bui& set_from_str(const char *str) {
+		size_t len = std::char_traits<char>::length(str);
+
+		set_zero();
+
+		const from_chars_result result = from_chars(str, str + len, *this);
+
+		assert(result.ptr == str + len);
+		assert(result.ec == std::errc());
+
+		return *this;
+	}
+
+	/*
+	 * Returns true if, and only if, b represents a different value than this
+	 * object.
+	 *
+	 * This function calls
+	 *
+	 * assert(
+	 *   sizeof(el_t) % sizeof(UINT_T) == 0 ||
+	 *   sizeof(UINT_T) % sizeof(el_t) == 0
+	 * ),
+	 *
+	 * which fails if the condition is not met, because the implementation is
+	 * not ready for such cases.
+	 */
+	template<typename UINT_T>
+	__host__ __device__
+	inline constexpr bool operator_neq_uint(const UINT_T &b) const {
+		assert_unsigned_int_type<UINT_T>();
+
+		bool result = false;
+
+		if constexpr (sizeof(el_t) >= sizeof(UINT_T)) {
+			assert(sizeof(el_t) % sizeof(UINT_T) == 0);
+
+			result = (to_el_t() != b);
+			result |= is_nonzero_starting_at_el<1>();
+
+		} else {
+			assert(sizeof(UINT_T) % sizeof(el_t) == 0);
+
+			result = (as_uint<UINT_T>() != b);
+			result |= is_nonzero_starting_at_el<sizeof(UINT_T) / sizeof(el_t)>();
+		}
+
+		return result;
+	}
+
+	/*
+	 * Returns true if, and only if, b represents a the same value as this
+	 * object.
+	 *
+	 * This function calls
+	 *
+	 * assert(
+	 *   sizeof(el_t) % sizeof(UINT_T) == 0 ||
+	 *   sizeof(UINT_T) % sizeof(el_t) == 0
+	 * ),
+	 *
+	 * which fails if the condition is not met, because the implementation is
+	 * not ready for such cases.
+	 */
+	template<typename UINT_T>
+	__host__ __device__
+	inline constexpr bool operator_eq_uint(const UINT_T &b) const {
+		assert_unsigned_int_type<UINT_T>();
+
+		bool result = false;
+
+		if constexpr (sizeof(el_t) >= sizeof(UINT_T)) {
+			assert(sizeof(el_t) % sizeof(UINT_T) == 0);
+
+			result = (to_el_t() == b);
+			result &= is_zero_starting_at_el<1>();
+
+		} else {
+			assert(sizeof(UINT_T) % sizeof(el_t) == 0);
+
+			result = (as_uint<UINT_T>() == b);
+			result &= is_zero_starting_at_el<sizeof(UINT_T) / sizeof(el_t)>();
+		}
+
+		return result;
+	}
+
+	/*
+	 * Returns true if, and only if, b represents a value less than this
+	 * object.
+	 *
+	 * This function calls
+	 *
+	 * assert(
+	 *   sizeof(el_t) % sizeof(UINT_T) == 0 ||
+	 *   sizeof(UINT_T) % sizeof(el_t) == 0
+	 * ),
+	 *
+	 * which fails if the condition is not met, because the implementation is
+	 * not ready for such cases.
+	 */
+	template<typename UINT_T>
+	__host__ __device__
+	inline constexpr bool operator_lt_uint(const UINT_T &b) const {
+		assert_unsigned_int_type<UINT_T>();
+
+		bool result = false;
+
+		if constexpr (sizeof(el_t) >= sizeof(UINT_T)) {
+			assert(sizeof(el_t) % sizeof(UINT_T) == 0);
+
+			result = (to_el_t() < b);
+			result &= is_zero_starting_at_el<1>();
+
+		} else {
+			assert(sizeof(UINT_T) % sizeof(el_t) == 0);
+
+			result = (as_uint<UINT_T>() < b);
+			result &= is_zero_starting_at_el<sizeof(UINT_T) / sizeof(el_t)>();
+		}
+
+		return result;
+	}
+
+	/*
+	 * Returns true if, and only if, b represents a value greater than this
+	 * object.
+	 *
+	 * This function calls
+	 *
+	 * assert(
+	 *   sizeof(el_t) % sizeof(UINT_T) == 0 ||
+	 *   sizeof(UINT_T) % sizeof(el_t) == 0
+	 * ),
+	 *
+	 * which fails if the condition is not met, because the implementation is
+	 * not ready for such cases.
+	 */
+	template<typename UINT_T>
+	__host__ __device__
+	inline constexpr bool operator_gt_uint(const UINT_T &b) const {
+		assert_unsigned_int_type<UINT_T>();
+
+		bool result = false;
+
+		if constexpr (sizeof(el_t) >= sizeof(UINT_T)) {
+			assert(sizeof(el_t) % sizeof(UINT_T) == 0);
+
+			result = (to_el_t() > b);
+			result |= is_nonzero_starting_at_el<1>();
+
+		} else {
+			assert(sizeof(UINT_T) % sizeof(el_t) == 0);
+
+			result = (as_uint<UINT_T>() > b);
+			result |= is_nonzero_starting_at_el<sizeof(UINT_T) / sizeof(el_t)>();
+		}
+
+		return result;
+	}
+
+	/*
+	 * Returns true if, and only if, b represents a value less than or equal to
+	 * this object.
+	 *
+	 * This function calls
+	 *
+	 * assert(
+	 *   sizeof(el_t) % sizeof(UINT_T) == 0 ||
+	 *   sizeof(UINT_T) % sizeof(el_t) == 0
+	 * ),
+	 *
+	 * which fails if the condition is not met, because the implementation is
+	 * not ready for such cases.
+	 */
+	template<typename UINT_T>
+	__host__ __device__
+	inline constexpr bool operator_leq_uint(const UINT_T &b) const {
+		assert_unsigned_int_type<UINT_T>();
+
+		bool result = false;
+
+		if constexpr (sizeof(el_t) >= sizeof(UINT_T)) {
+			assert(sizeof(el_t) % sizeof(UINT_T) == 0);
+
+			result = (to_el_t() <= b);
+			result &= is_zero_starting_at_el<1>();
+
+		} else {
+			assert(sizeof(UINT_T) % sizeof(el_t) == 0);
+
+			result = (as_uint<UINT_T>() <= b);
+			result &= is_zero_starting_at_el<sizeof(UINT_T) / sizeof(el_t)>();
+		}
+
+		return result;
+	}
+
+	/*
+	 * Returns true if, and only if, b represents a value greater than or equal
+	 * to this object.
+	 *
+	 * This function calls
+	 *
+	 * assert(
+	 *   sizeof(el_t) % sizeof(UINT_T) == 0 ||
+	 *   sizeof(UINT_T) % sizeof(el_t) == 0
+	 * ),
+	 *
+	 * which fails if the condition is not met, because the implementation is
+	 * not ready for such cases.
+	 */
+	template<typename UINT_T>
+	__host__ __device__
+	inline constexpr bool operator_geq_uint(const UINT_T &b) const {
+		assert_unsigned_int_type<UINT_T>();
+
+		bool result = false;
+
+		if constexpr (sizeof(el_t) >= sizeof(UINT_T)) {
+			assert(sizeof(el_t) % sizeof(UINT_T) == 0);
+
+			result = (to_el_t() >= b);
+			result |= is_nonzero_starting_at_el<1>();
+
+		} else {
+			assert(sizeof(UINT_T) % sizeof(el_t) == 0);
+
+			result = (as_uint<UINT_T>() >= b);
+			result |= is_nonzero_starting_at_el<sizeof(UINT_T) / sizeof(el_t)>();
+		}
+
+		return result;
+	}
+
+	/*
+	 * Number of elements of this big int type needed for the value of an
+	 * UINT_T, limited to SIZE_IN_ELS, because bits above are cut off anyway.
+	 */
+	template<typename UINT_T>
+	static constexpr size_t UINT_ELS = std::min((sizeof(UINT_T) + sizeof(el_t) - 1) / sizeof(el_t), SIZE_IN_ELS);
+
+	template<typename UINT_T>
+	__host__ __device__
+	inline constexpr bui& operator_pluseq_uint(const UINT_T &b) {
+		assert_unsigned_int_type<UINT_T>();
+
+		el_t b_els[UINT_ELS<UINT_T>] = { };
+		uint_to_els<UINT_ELS<UINT_T>>(b_els, b);
+
+		els_add<SIZE_IN_ELS, UINT_ELS<UINT_T>>(el, b_els);
+
+		return *this;
+	}
+
+	template<typename UINT_T>
+	__host__ __device__
+	inline constexpr bui& operator_minuseq_uint(const UINT_T &b) {
+		assert_unsigned_int_type<UINT_T>();
+
+		el_t b_els[UINT_ELS<UINT_T>] = { };
+		uint_to_els<UINT_ELS<UINT_T>>(b_els, b);
+
+		els_sub<SIZE_IN_ELS, UINT_ELS<UINT_T>>(el, b_els);
+
+		return *this;
+	}
+
+	template<typename UINT_T>
+	__host__ __device__
+	inline constexpr bui& operator_muleq_uint(const UINT_T &b) {
+		assert_unsigned_int_type<UINT_T>();
+
+		BIFSI_INSTRUMENT_BEGIN(mul);
+
+		if constexpr (UINT_ELS<UINT_T> == 1) {
+			els_mul_add_el<SIZE_IN_ELS>(el, (el_t) b, (el_t) 0);
+
+		} else {
+			el_t b_els[UINT_ELS<UINT_T>] = { };
+			uint_to_els<UINT_ELS<UINT_T>>(b_els, b);
+
+			el_t r[SIZE_IN_ELS] = { };
+
+			comba_mul<SIZE_IN_ELS, SIZE_IN_ELS, UINT_ELS<UINT_T>>(r, el, b_els);
+
+#ifdef __NVCC__
+#pragma unroll
+#endif
+			for (size_t i = 0; i < SIZE_IN_ELS; i++) {
+				el[i] = r[i];
+			}
+		}
+
+		BIFSI_INSTRUMENT_END(mul, SIZE_IN_ELS * UINT_ELS<UINT_T>);
+
+		return *this;
+	}
+
+	template<typename UINT_T>
+	__host__ __device__
+	inline constexpr bui& operator_diveq_uint(const UINT_T &b) {
+		assert_unsigned_int_type<UINT_T>();
+
+		if constexpr (sizeof(UINT_T) <= sizeof(el_t)) {
+			tw_t tw = 0;
+
+#ifdef __NVCC__
+#pragma unroll
+#endif
+			for (size_t i = SIZE_IN_ELS - 1; i != (size_t) -1; i--) {
+				tw <<= EL_SIZE_IN_BITS;
+				tw |= el[i];
+				el[i] = (el_t) (tw / (el_t) b);
+				tw %= (el_t) b;
+			}
+
+		} else {
+			// not limited to SIZE_IN_ELS like UINT_ELS, the divisor must not be
+			// cut off
+			constexpr size_t B_EL_COUNT = sizeof(UINT_T) / sizeof(el_t);
+
+			el_t b_els[B_EL_COUNT] = { };
+			uint_to_els<B_EL_COUNT>(b_els, b);
+
+			el_t q[SIZE_IN_ELS] = { };
+			el_t r[B_EL_COUNT] = { };
+
+			knuth_div_els<SIZE_IN_ELS, B_EL_COUNT>(q, r, el, b_els);
+
+#ifdef __NVCC__
+#pragma unroll
+#endif
+			for (size_t i = 0; i < SIZE_IN_ELS; i++) {
+				el[i] = q[i];
+			}
+		}
+
+		return *this;
+	}
+
+public:
+	template<size_t START_EL_IDX>
+	__host__ __device__
+	inline constexpr void set_zero_starting_at_el() {
+#ifdef __NVCC__
+#pragma unroll
+#endif
+		for (size_t i = START_EL_IDX; i < SIZE_IN_ELS; i++) {
+			el[i] = 0;
+		}
+	}
+
+	__host__ __device__
+	inline constexpr void set_zero() {
+		set_zero_starting_at_el<0>();
+	}
+
+	template<typename INT_T>
+	__host__ __device__
+	inline constexpr INT_T as() const {
+		static_assert_singed_or_unsigned_int_type<INT_T>();
+
+		if (is_unsigned_int_v<INT_T>) {
+			return as_uint<INT_T>();
+		} else {
+			return as_uint<make_unsigned_t<INT_T>>();
+		}
+	}
+
+	template<typename INT_T>
+	__host__ __device__
+	inline constexpr bui& set(const INT_T &value) {
+		if (is_unsigned_int_v<INT_T>) {
+			set_uint(value);
+		} else {
+			set_uint(static_cast<make_unsigned_t<INT_T>>(value));
+		}
+
+		return *this;
+	}
+
+	template<typename INT_T>
+	__host__ __device__
+	inline constexpr bui& operator=(const INT_T &value) {
+		return set(value);
+	}
+
+	__host__ __device__
+	inline constexpr bui& operator=(const char *str) {
+		return set_from_str(str);
+	}
+
+	__host__ __device__
+	inline constexpr size_t bitlen() const {
+#ifdef __NVCC__
+#pragma unroll
+#endif
+		for (size_t i = SIZE_IN_ELS - 1; i < SIZE_IN_ELS; i--) {
+			if (el[i] != 0) {
+				size_t sub_el_bitlen = bitlen(el[i]);
+				return i * EL_SIZE_IN_BITS + sub_el_bitlen;
+			}
+		}
+
+		return 0;
+	}
+
+	template<size_t START_EL_IDX>
+	__host__ __device__
+	inline constexpr bool is_zero_starting_at_el() const {
+		bool result = true;
+
+#ifdef __NVCC__
+#pragma unroll
+#endif
+		for (size_t i = START_EL_IDX; i < SIZE_IN_ELS; i++) {
+			result &= (el[i] == 0);
+		}
+
+		return result;
+	}
+
+	template<size_t START_EL_IDX>
+	__host__ __device__
+	inline constexpr bool is_nonzero_starting_at_el() const {
+		bool result = false;
+
+#ifdef __NVCC__
+#pragma unroll
+#endif
+		for (size_t i = START_EL_IDX; i < SIZE_IN_ELS; i++) {
+			result |= (el[i] != 0);
+		}
+
+		return result;
+	}
+
+	__host__ __device__
+	inline constexpr bool is_zero() const {
+		return is_zero_starting_at_el<0>();
+	}
+
+	__host__ __device__
+	inline constexpr bool is_nonzero() const {
+		return is_nonzero_starting_at_el<0>();
+	}
+
+	template<typename INT_T>
+	__host__ __device__
+	inline constexpr bool operator!=(const INT_T &b) const {
+		static_assert_singed_or_unsigned_int_type<INT_T>();
+
+		if (is_unsigned_int_v<INT_T>) {
+			const auto bu = static_cast<make_unsigned_t<INT_T>>(b);
+			return operator_neq_uint(bu);
+
+		} else {
+			auto bu = static_cast<make_unsigned_t<INT_T>>(b);
+			return (b < 0) | operator_neq_uint(bu);
+		}
+	}
+
+	template<typename INT_T>
+	__host__ __device__
+	inline constexpr bool operator==(const INT_T &b) const {
+		if (is_unsigned_int_v<INT_T>) {
+			return operator_eq_uint(b);
+		} else {
+			const auto bu = static_cast<make_unsigned_t<INT_T>>(b);
+			return (b >= 0) & operator_eq_uint(bu);
+		}
+	}
+
+	template<typename INT_T>
+	__host__ __device__
+	inline constexpr bool operator>(const INT_T &b) const {
+		if (is_unsigned_int_v<INT_T>) {
+			return operator_gt_uint(b);
+		} else {
+			return (b < 0) | operator_gt_uint(b);
+		}
+	}
+
+	template<typename INT_T>
+	__host__ __device__
+	inline constexpr bool operator<(const INT_T &b) const {
+		if (is_unsigned_int_v<INT_T>) {
+			return operator_lt_uint(b);
+		} else {
+			return (b >= 0) & operator_lt_uint(b);
+		}
+	}
+
+	template<typename INT_T>
+	__host__ __device__
+	inline constexpr bool operator>=(const INT_T &b) const {
+		if (is_unsigned_int_v<INT_T>) {
+			return operator_geq_uint(b);
+		} else {
+			return (b < 0) | operator_geq_uint(b);
+		}
+	}
+
+	template<typename INT_T>
+	__host__ __device__
+	inline constexpr bool operator<=(const INT_T &b) const {
+		if (is_unsigned_int_v<INT_T>) {
+			return operator_leq_uint(b);
+		} else {
+			return (b >= 0) & operator_leq_uint(b);
+		}
+	}
+
+	/*
+	 * Returns -1, 0 or 1 if this object is less than, equal to or greater than
+	 * b, which may have a different size. See els_cmp, and els_cmp_vartime
+	 * for vartime.
+	 */
+	template<typename POLICY = ct, size_t B_SIZE_IN_BITS>
+	__host__ __device__
+	inline constexpr int compare(const bui<B_SIZE_IN_BITS, EL_T> &b) const {
+		static_assert_policy<POLICY>();
+
+		if constexpr (is_vartime_v<POLICY>) {
+			return els_cmp_vartime<SIZE_IN_ELS, bui<B_SIZE_IN_BITS, EL_T>::SIZE_IN_ELS>(el, b.el);
+		} else {
+			return els_cmp<SIZE_IN_ELS, bui<B_SIZE_IN_BITS, EL_T>::SIZE_IN_ELS>(el, b.el);
+		}
+	}
+
+	template<size_t B_SIZE_IN_BITS>
+	__host__ __device__
+	inline constexpr bool operator==(const bui<B_SIZE_IN_BITS, EL_T> &b) const {
+		return els_eq<SIZE_IN_ELS, bui<B_SIZE_IN_BITS, EL_T>::SIZE_IN_ELS>(el, b.el);
+	}
+
+	template<size_t B_SIZE_IN_BITS>
+	__host__ __device__
+	inline constexpr bool operator!=(const bui<B_SIZE_IN_BITS, EL_T> &b) const {
+		return !els_eq<SIZE_IN_ELS, bui<B_SIZE_IN_BITS, EL_T>::SIZE_IN_ELS>(el, b.el);
+	}
+
+	template<size_t B_SIZE_IN_BITS>
+	__host__ __device__
+	inline constexpr bool operator<(const bui<B_SIZE_IN_BITS, EL_T> &b) const {
+		return compare(b) < 0;
+	}
+
+	template<size_t B_SIZE_IN_BITS>
+	__host__ __device__
+	inline constexpr bool operator>(const bui<B_SIZE_IN_BITS, EL_T> &b) const {
+		return compare(b) > 0;
+	}
+
+	template<size_t B_SIZE_IN_BITS>
+	__host__ __device__
+	inline constexpr bool operator<=(const bui<B_SIZE_IN_BITS, EL_T> &b) const {
+		return compare(b) <= 0;
+	}
+
+	template<size_t B_SIZE_IN_BITS>
+	__host__ __device__
+	inline constexpr bool operator>=(const bui<B_SIZE_IN_BITS, EL_T> &b) const {
+		return compare(b) >= 0;
+	}
+
+#if __cplusplus >= 202002L
+	template<size_t B_SIZE_IN_BITS>
+	__host__ __device__
+	inline constexpr std::strong_ordering operator<=>(const bui<B_SIZE_IN_BITS, EL_T> &b) const {
+		return compare(b) <=> 0;
+	}
+#endif
+
+	template<typename INT_T>
+	__host__ __device__
+	inline constexpr bui& operator+=(const INT_T &b) {
+		if (is_unsigned_int_v<INT_T>) {
+			return operator_pluseq_uint(b);
+
+		} else if (b >= 0) {
+			const auto bu = static_cast<make_unsigned_t<INT_T>>(b);
+			return operator_pluseq_uint(bu);
+
+		} else {
+			const auto bu = static_cast<make_unsigned_t<INT_T>>(-b);
+			return operator_minuseq_uint(bu);
+		}
+	}
+
+	template<typename INT_T>
+	__host__ __device__
+	inline constexpr bui& operator-=(const INT_T &b) {
+		if (is_unsigned_int_v<INT_T>) {
+			return operator_minuseq_uint(b);
+
+		} else if (b >= 0) {
+			const auto bu = static_cast<make_unsigned_t<INT_T>>(b);
+			return operator_minuseq_uint(bu);
+
+		} else {
+			const auto bu = static_cast<make_unsigned_t<INT_T>>(-b);
+			return operator_pluseq_uint(bu);
+		}
+	}
+
+	template<typename INT_T>
+	__host__ __device__
+	inline constexpr bui& operator*=(const INT_T &b) {
+		if (is_unsigned_int_v<INT_T>) {
+			return operator_muleq_uint(b);
+
+		} else if (b >= 0) {
+			const auto bu = static_cast<make_unsigned_t<INT_T>>(b);
+			return operator_muleq_uint(bu);
+
+		} else {
+			assert(b >= 0); // fails
+			return *this; // never reached
+		}
+	}
+
+	/*
+	 * Multiplies this big int with b. The product is truncated to
+	 * SIZE_IN_BITS, i.e. it's computed modulo 2^SIZE_IN_BITS. Only the
+	 * elements of the product which are kept are computed. Depending on
+	 * SIZE_IN_ELS, the Comba or the Karatsuba kernel is selected at compile
+	 * time, see mul_els_lo.
+	 */
+	__host__ __device__
+	inline constexpr bui& operator*=(const bui &b) {
+		if (BIFSI_IS_CONSTANT_EVALUATED()) {
+			// the product can't be stored in an uninitialized temporary in
+			// constant expressions, and zeroing r costs time when it's not
+			// removed by the compiler
+			bui r = 0U;
+			mul_els_lo<SIZE_IN_ELS>(r.el, el, b.el);
+			return *this = r;
+		}
+
+		BIFSI_INSTRUMENT_BEGIN(mul);
+
+		bui r;
+		mul_els_lo<SIZE_IN_ELS>(r.el, el, b.el);
+
+		BIFSI_INSTRUMENT_END(mul, SIZE_IN_ELS * (SIZE_IN_ELS + 1) / 2);
+
+		return *this = r;
+	}
+
+	/*
+	 * Replaces this big int by its square, truncated to SIZE_IN_BITS. Each
+	 * cross product of two elements is computed only once, see sqr_els_lo.
+	 */
+	__host__ __device__
+	inline constexpr bui& square() {
+		if (BIFSI_IS_CONSTANT_EVALUATED()) {
+			// see operator*=
+			bui r = 0U;
+			sqr_els_lo<SIZE_IN_ELS>(r.el, el);
+			return *this = r;
+		}
+
+		BIFSI_INSTRUMENT_BEGIN(sqr);
+
+		bui r;
+		sqr_els_lo<SIZE_IN_ELS>(r.el, el);
+
+		BIFSI_INSTRUMENT_END(sqr, SIZE_IN_ELS * (SIZE_IN_ELS + 1) / 2);
+
+		return *this = r;
+	}
+
+	/*
+	 * Adds a * m to this big int in a single pass over a, without a temporary
+	 * for the product, and returns the element which carries out of the
+	 * topmost element, see els_mul_add_els. The sum is truncated to
+	 * SIZE_IN_BITS, like that of operator+=.
+	 */
+	__host__ __device__
+	inline constexpr el_t mul_add_scalar(const bui &a, const el_t &m) {
+		return els_mul_add_els<SIZE_IN_ELS>(el, a.el, m);
+	}
+
+	__host__ __device__
+	inline constexpr el_t operator/=(const el_t &b) {
+		BIFSI_INSTRUMENT_BEGIN(div);
+
+		tw_t tw = 0;
+
+#ifdef __NVCC__
+#pragma unroll
+#endif
+		for (size_t i = SIZE_IN_ELS - 1; i != (size_t) -1; i--) {
+			tw <<= EL_SIZE_IN_BITS;
+			tw |= el[i];
+			el[i] = (el_t) (tw / b);
+			tw %= b;
+		}
+
+		BIFSI_INSTRUMENT_END(div, SIZE_IN_ELS);
+
+		return (el_t) tw;
+	}
+
+	__host__ __device__
+	inline constexpr el_t operator%(const el_t &b) const {
+		BIFSI_INSTRUMENT_BEGIN(div);
+
+		tw_t tw = 0;
+
+#ifdef __NVCC__
+#pragma unroll
+#endif
+		for (size_t i = SIZE_IN_ELS - 1; i != (size_t) -1; i--) {
+			tw <<= EL_SIZE_IN_BITS;
+			tw |= el[i];
+			tw %= b;
+		}
+
+		BIFSI_INSTRUMENT_END(div, SIZE_IN_ELS);
+
+		return (el_t) tw;
+	}
+
+	/*
+	 * Divides this big int by d and returns the remainder, like operator/= for
+	 * an el_t, but with the precomputed reciprocal of d instead of a hardware
+	 * division per element. See divisor.
+	 */
+	__host__ __device__
+	inline constexpr el_t operator/=(const divisor<EL_T> &d) {
+		BIFSI_INSTRUMENT_BEGIN(div);
+
+		const el_t r = els_div_divisor<SIZE_IN_ELS>(el, el, d);
+
+		BIFSI_INSTRUMENT_END(div, SIZE_IN_ELS);
+
+		return r;
+	}
+
+	/*
+	 * Returns the remainder of this big int divided by d. See divisor.
+	 */
+	__host__ __device__
+	inline constexpr el_t operator%(const divisor<EL_T> &d) const {
+		BIFSI_INSTRUMENT_BEGIN(div);
+
+		const el_t r = els_mod_divisor<SIZE_IN_ELS>(el, d);
+
+		BIFSI_INSTRUMENT_END(div, SIZE_IN_ELS);
+
+		return r;
+	}
+
+	/*
+	 * Divides this big int by b, which must not be 0. See knuth_div_els.
+	 */
+	template<size_t B_SIZE_IN_BITS>
+	__host__ __device__
+	inline constexpr bui& operator/=(const bui<B_SIZE_IN_BITS, EL_T> &b) {
+		constexpr size_t B_SIZE_IN_ELS = bui<B_SIZE_IN_BITS, EL_T>::SIZE_IN_ELS;
+
+		BIFSI_INSTRUMENT_BEGIN(div);
+
+		el_t q[SIZE_IN_ELS] = { };
+		el_t r[B_SIZE_IN_ELS] = { };
+
+		knuth_div_els<SIZE_IN_ELS, B_SIZE_IN_ELS>(q, r, el, b.el);
+
+		BIFSI_INSTRUMENT_END(div, ((SIZE_IN_ELS > B_SIZE_IN_ELS) ? SIZE_IN_ELS - B_SIZE_IN_ELS + 1 : 1) * B_SIZE_IN_ELS);
+
+#ifdef __NVCC__
+#pragma unroll
+#endif
+		for (size_t i = 0; i < SIZE_IN_ELS; i++) {
+			el[i] = q[i];
+		}
+
+		return *this;
+	}
+
+	/*
+	 * Replaces this big int by the remainder of its division by b, which must
+	 * not be 0. See knuth_div_els.
+	 */
+	template<size_t B_SIZE_IN_BITS>
+	__host__ __device__
+	inline constexpr bui& operator%=(const bui<B_SIZE_IN_BITS, EL_T> &b) {
+		constexpr size_t B_SIZE_IN_ELS = bui<B_SIZE_IN_BITS, EL_T>::SIZE_IN_ELS;
+
+		BIFSI_INSTRUMENT_BEGIN(div);
+
+		el_t q[SIZE_IN_ELS] = { };
+		el_t r[B_SIZE_IN_ELS] = { };
+
+		knuth_div_els<SIZE_IN_ELS, B_SIZE_IN_ELS>(q, r, el, b.el);
+
+		BIFSI_INSTRUMENT_END(div, ((SIZE_IN_ELS > B_SIZE_IN_ELS) ? SIZE_IN_ELS - B_SIZE_IN_ELS + 1 : 1) * B_SIZE_IN_ELS);
+
+#ifdef __NVCC__
+#pragma unroll
+#endif
+		for (size_t i = 0; i < SIZE_IN_ELS; i++) {
+			el[i] = (i < B_SIZE_IN_ELS) ? r[i] : 0;
+		}
+
+		return *this;
+	}
+
+	__host__ __device__
+	inline constexpr el_t operator&(const el_t &b) const {
+		return el[0] & b;
+	}
+
+	__host__ __device__
+	inline constexpr el_t operator&(const tw_t &b) const {
+		tw_t tw = (tw_t) *this;
+		return tw & b;
+	}
+
+	__host__ __device__
+	inline constexpr el_t operator&(const int &b) const {
+		if (sizeof(el_t) >= sizeof(int)) {
+			return ((el_t) *this) & (el_t) b;
+		}
+
+		assert(false);
+		return 0; // will never be reached
+	}
+
+	/*
+	 * Shift the bits of this number by WIDTH many bit positions towards lower bit indices (right shift).
+	 */
+	template<uint32_t WIDTH>
+	__host__ __device__
+	inline constexpr bui& loshift_bits() {
+		static_assert(WIDTH < EL_SIZE_IN_BITS);
+
+		// a WIDTH of 0 would shift by EL_SIZE_IN_BITS below
+		if constexpr (WIDTH > 0) {
+			el[0] >>= WIDTH;
+
+#ifdef __NVCC__
+#pragma unroll
+#endif
+			for (size_t i = 1; i < SIZE_IN_ELS; i++) {
+				el[i - 1] |= el[i] << (EL_SIZE_IN_BITS - WIDTH);
+				el[i] >>= WIDTH;
+			}
+		}
+
+		return *this;
+	}
+
+	/*
+	 * Shift the bits of this number by WIDTH many bit positions towards higher bit indices (left shift).
+	 */
+	template<uint32_t WIDTH>
+	__host__ __device__
+	inline constexpr bui& hishift_bits() {
+		static_assert(WIDTH < EL_SIZE_IN_BITS);
+
+		// a WIDTH of 0 would shift by EL_SIZE_IN_BITS below
+		if constexpr (WIDTH > 0) {
+			el[SIZE_IN_ELS - 1] <<= WIDTH;
+
+#ifdef __NVCC__
+#pragma unroll
+#endif
+			for (size_t i = SIZE_IN_ELS - 2; i != (size_t) -1; i--) {
+				el[i + 1] |= el[i] >> (EL_SIZE_IN_BITS - WIDTH);
+				el[i] <<= WIDTH;
+			}
+		}
+
+		return *this;
+	}
+
+	/*
+	 * Shift the elements of this number by one position towards lower bit indices (right shift).
+	 */
+	__host__ __device__
+	inline constexpr bui& loshift_1el() {
+#ifdef __NVCC__
+#pragma unroll
+#endif
+		for (size_t i = 0; i < SIZE_IN_ELS - 1; i++) {
+			el[i] = el[i + 1];
+		}
+
+		el[SIZE_IN_ELS - 1] = 0;
+
+		return *this;
+	}
+
+	/*
+	 * Shift the elements of this number by one position towards higher bit indices (right shift).
+	 */
+	__host__ __device__
+	inline constexpr bui& hishift_1el() {
+#ifdef __NVCC__
+#pragma unroll
+#endif
+		for (size_t i = SIZE_IN_ELS - 1; i > 0; i--) {
+			el[i] = el[i - 1];
+		}
+
+		el[0] = 0;
+
+		return *this;
+	}
+
+	/*
+	 * Shift the elements of this number by COUNT many positions towards lower bit indices (right shift).
+	 */
+	template<size_t COUNT>
+	__host__ __device__
+	inline constexpr bui& loshift_els() {
+#ifdef __NVCC__
+#pragma unroll
+#endif
+		for (size_t i = 0; i < SIZE_IN_ELS; i++) {
+			el[i] = (i + COUNT < SIZE_IN_ELS) ? el[i + COUNT] : 0;
+		}
+
+		return *this;
+	}
+
+	/*
+	 * Shift the elements of this number by COUNT many positions towards higher bit indices (left shift).
+	 */
+	template<size_t COUNT>
+	__host__ __device__
+	inline constexpr bui& hishift_els() {
+#ifdef __NVCC__
+#pragma unroll
+#endif
+		for (size_t i = SIZE_IN_ELS - 1; i != (size_t) -1; i--) {
+			el[i] = (i >= COUNT) ? el[i - COUNT] : 0;
+		}
 
 		return *this;
 	}
 
 	/*
-	 * Returns true if, and only if, b represents a different value than this
-	 * object.
-	 *
-	 * This function calls
-	 *
-	 * assert(
-	 *   sizeof(el_t) % sizeof(UINT_T) == 0 ||
-	 *   sizeof(UINT_T) % sizeof(el_t) == 0
-	 * ),
-	 *
-	 * which fails if the condition is not met, because the implementation is
-	 * not ready for such cases.
+	 * Shift the bits of this number by WIDTH many bit positions towards lower bit indices (right shift), for
+	 * any WIDTH. WIDTH >= SIZE_IN_BITS yields 0.
 	 */
-	template<typename UINT_T>
+	template<size_t WIDTH>
 	__host__ __device__
-	inline constexpr bool operator_neq_uint(const UINT_T &b) const {
-		assert_unsigned_int_type<UINT_T>();
+	inline constexpr bui& loshift() {
+		loshift_els<WIDTH / EL_SIZE_IN_BITS>();
 
-		bool result;
+		return loshift_bits<WIDTH % EL_SIZE_IN_BITS>();
+	}
 
-		if (sizeof(el_t) >= sizeof(UINT_T)) {
-			assert(sizeof(el_t) % sizeof(UINT_T) == 0);
+	/*
+	 * Shift the bits of this number by WIDTH many bit positions towards higher bit indices (left shift), for
+	 * any WIDTH. WIDTH >= SIZE_IN_BITS yields 0.
+	 */
+	template<size_t WIDTH>
+	__host__ __device__
+	inline constexpr bui& hishift() {
+		hishift_els<WIDTH / EL_SIZE_IN_BITS>();
 
-			result = (to_el_t() != b);
-			result |= is_nonzero_starting_at_el<1>();
+		return hishift_bits<WIDTH % EL_SIZE_IN_BITS>();
+	}
 
-		} else {
-			assert(sizeof(UINT_T) % sizeof(el_t) == 0);
+	/*
+	 * Shift the bits of this number by n many bit positions towards higher bit indices (left shift). n >=
+	 * SIZE_IN_BITS yields 0. The run time doesn't depend on n. n is split into an element offset and a bit
+	 * offset. The element offset is applied by a select network with one stage per bit of the offset, where
+	 * stage k moves all elements by 2^k positions or leaves them, selected by a mask instead of a branch.
+	 * The bit offset is applied in one more pass over the elements. See hishift for constant n.
+	 */
+	__host__ __device__
+	inline constexpr bui& operator<<=(const size_t &n) {
+		const size_t els = n / EL_SIZE_IN_BITS;
+		const size_t bits = n % EL_SIZE_IN_BITS;
 
-			result = (as_uint<UINT_T>() != b);
-			result |= is_nonzero_starting_at_el<sizeof(UINT_T) / sizeof(el_t)>();
+#ifdef __NVCC__
+#pragma unroll
+#endif
+		for (size_t k = 1; k < SIZE_IN_ELS; k <<= 1) {
+			const el_t mask = (el_t) -(el_t) ((els & k) != 0);
+
+#ifdef __NVCC__
+#pragma unroll
+#endif
+			for (size_t i = SIZE_IN_ELS - 1; i != (size_t) -1; i--) {
+				const el_t moved = (i >= k) ? el[i - k] : 0;
+				el[i] = (el[i] & ~mask) | (moved & mask);
+			}
 		}
 
-		return result;
+		// all bits are shifted out if els >= SIZE_IN_ELS, which the stages
+		// don't cover
+		const el_t keep = (el_t) ((el_t) -(el_t) (n >= SIZE_IN_BITS) ^ (el_t) -1);
+
+		// the lower element is shifted in two steps, so a bit offset of 0
+		// doesn't shift by EL_SIZE_IN_BITS
+#ifdef __NVCC__
+#pragma unroll
+#endif
+		for (size_t i = SIZE_IN_ELS - 1; i > 0; i--) {
+			el[i] = (el_t) (((el_t) (el[i] << bits) | (el_t) ((el_t) (el[i - 1] >> 1) >> (EL_SIZE_IN_BITS - 1 - bits))) & keep);
+		}
+
+		el[0] = (el_t) ((el_t) (el[0] << bits) & keep);
+
+		return *this;
 	}
 
 	/*
-	 * Returns true if, and only if, b represents a the same value as this
-	 * object.
-	 *
-	 * This function calls
-	 *
-	 * assert(
-	 *   sizeof(el_t) % sizeof(UINT_T) == 0 ||
-	 *   sizeof(UINT_T) % sizeof(el_t) == 0
-	 * ),
-	 *
-	 * which fails if the condition is not met, because the implementation is
-	 * not ready for such cases.
+	 * Shift the bits of this number by n many bit positions towards lower bit indices (right shift). n >=
+	 * SIZE_IN_BITS yields 0. The run time doesn't depend on n, see operator<<=. See loshift for constant n.
 	 */
-	template<typename UINT_T>
 	__host__ __device__
-	inline constexpr bool operator_eq_uint(const UINT_T &b) const {
-		assert_unsigned_int_type<UINT_T>();
+	inline constexpr bui& operator>>=(const size_t &n) {
+		const size_t els = n / EL_SIZE_IN_BITS;
+		const size_t bits = n % EL_SIZE_IN_BITS;
 
-		bool result;
+#ifdef __NVCC__
+#pragma unroll
+#endif
+		for (size_t k = 1; k < SIZE_IN_ELS; k <<= 1) {
+			const el_t mask = (el_t) -(el_t) ((els & k) != 0);
 
-		if (sizeof(el_t) >= sizeof(UINT_T)) {
-			assert(sizeof(el_t) % sizeof(UINT_T) == 0);
+#ifdef __NVCC__
+#pragma unroll
+#endif
+			for (size_t i = 0; i < SIZE_IN_ELS; i++) {
+				const el_t moved = (i + k < SIZE_IN_ELS) ? el[i + k] : 0;
+				el[i] = (el[i] & ~mask) | (moved & mask);
+			}
+		}
 
-			result = (to_el_t() == b);
-			result &= is_zero_starting_at_el<1>();
+		const el_t keep = (el_t) ((el_t) -(el_t) (n >= SIZE_IN_BITS) ^ (el_t) -1);
 
-		} else {
-			assert(sizeof(UINT_T) % sizeof(el_t) == 0);
+#ifdef __NVCC__
+#pragma unroll
+#endif
+		for (size_t i = 0; i < SIZE_IN_ELS - 1; i++) {
+			el[i] = (el_t) (((el_t) (el[i] >> bits) | (el_t) ((el_t) (el[i + 1] << 1) << (EL_SIZE_IN_BITS - 1 - bits))) & keep);
+		}
 
-			result = (as_uint<UINT_T>() == b);
-			result &= is_zero_starting_at_el<sizeof(UINT_T) / sizeof(el_t)>();
+		el[SIZE_IN_ELS - 1] = (el_t) ((el_t) (el[SIZE_IN_ELS - 1] >> bits) & keep);
+
+		return *this;
+	}
+
+	/*
+	 * Returns the decimal representation of this big int. See
+	 * write_dec_digits. With vartime, a value which uses at most half of the
+	 * elements is converted as a bui of half the size, recursively.
+	 */
+	template<typename POLICY = ct>
+	inline std::string str() const {
+		constexpr size_t MAX_DIGITS = max_dec_digits<SIZE_IN_BITS>();
+
+		static_assert_policy<POLICY>();
+
+		if constexpr (is_vartime_v<POLICY> && SIZE_IN_ELS % 2 == 0) {
+			if (els_used<SIZE_IN_ELS>(el) <= SIZE_IN_ELS / 2) {
+				bui<SIZE_IN_BITS / 2, EL_T> lo;
+
+				for (size_t i = 0; i < SIZE_IN_ELS / 2; i++) {
+					lo.el[i] = el[i];
+				}
+
+				return lo.template str<vartime>();
+			}
 		}
 
-		return result;
+		BIFSI_INSTRUMENT_BEGIN(str);
+
+		char result[MAX_DIGITS];
+
+		write_dec_digits(*this, result, MAX_DIGITS);
+
+		BIFSI_INSTRUMENT_END(str, SIZE_IN_ELS);
+
+		size_t first = 0;
+
+		while (first < MAX_DIGITS - 1 && result[first] == '0') {
+			first++;
+		}
+
+		return std::string(result + first, MAX_DIGITS - first);
 	}
 
 	/*
-	 * Returns true if, and only if, b represents a value less than this
-	 * object.
-	 *
-	 * This function calls
-	 *
-	 * assert(
-	 *   sizeof(el_t) % sizeof(UINT_T) == 0 ||
-	 *   sizeof(UINT_T) % sizeof(el_t) == 0
-	 * ),
-	 *
-	 * which fails if the condition is not met, because the implementation is
-	 * not ready for such cases.
+	 * Writes the SIZE_IN_BYTES bytes of this big int to dst, the most
+	 * significant one first for byte_order::big and last for
+	 * byte_order::little. This only copies the bytes of el, so on a little
+	 * endian host, byte_order::little is a memcpy of el.
 	 */
-	template<typename UINT_T>
 	__host__ __device__
-	inline constexpr bool operator_lt_uint(const UINT_T &b) const {
-		assert_unsigned_int_type<UINT_T>();
+	inline constexpr void to_bytes(uint8_t *dst, const byte_order &order) const {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+		if (!BIFSI_IS_CONSTANT_EVALUATED() && order == byte_order::little) {
+			std::memcpy(dst, el, SIZE_IN_BYTES);
+			return;
+		}
+#endif
+
+#ifdef __NVCC__
+#pragma unroll
+#endif
+		for (size_t i = 0; i < SIZE_IN_ELS; i++) {
+			for (size_t j = 0; j < sizeof(el_t); j++) {
+				const size_t k = i * sizeof(el_t) + j;
+
+				dst[(order == byte_order::little) ? k : SIZE_IN_BYTES - 1 - k] = (uint8_t) (el[i] >> (8 * j));
+			}
+		}
+	}
+
+	/*
+	 * Sets this big int to the SIZE_IN_BYTES bytes at src, in the order
+	 * written by to_bytes.
+	 */
+	__host__ __device__
+	inline constexpr bui& from_bytes(const uint8_t *src, const byte_order &order) {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+		if (!BIFSI_IS_CONSTANT_EVALUATED() && order == byte_order::little) {
+			std::memcpy(el, src, SIZE_IN_BYTES);
+			return *this;
+		}
+#endif
+
+#ifdef __NVCC__
+#pragma unroll
+#endif
+		for (size_t i = 0; i < SIZE_IN_ELS; i++) {
+			el_t x = 0;
+
+			for (size_t j = 0; j < sizeof(el_t); j++) {
+				const size_t k = i * sizeof(el_t) + j;
+
+				x |= (el_t) ((el_t) src[(order == byte_order::little) ? k : SIZE_IN_BYTES - 1 - k] << (8 * j));
+			}
+
+			el[i] = x;
+		}
+
+		return *this;
+	}
+}
+;
+
+/*
+ * Returns a * b truncated to the size of the factors, like a *= b, but with
+ * an execution policy. With vartime, only the used elements of a and b are
+ * multiplied, see mul_els_lo_vartime.
+ */
+template<typename POLICY = ct, size_t SIZE_IN_BITS, typename EL_T>
+__host__ __device__
+inline constexpr bui<SIZE_IN_BITS, EL_T> mul(const bui<SIZE_IN_BITS, EL_T> &a, const bui<SIZE_IN_BITS, EL_T> &b) {
+	constexpr size_t N = bui<SIZE_IN_BITS, EL_T>::SIZE_IN_ELS;
+
+	static_assert_policy<POLICY>();
+
+	if (!is_vartime_v<POLICY> || BIFSI_IS_CONSTANT_EVALUATED()) {
+		bui<SIZE_IN_BITS, EL_T> result = a;
+		result *= b;
+		return result;
+	}
+
+	BIFSI_INSTRUMENT_BEGIN(mul);
+
+	bui<SIZE_IN_BITS, EL_T> result;
+	mul_els_lo_vartime<N>(result.el, a.el, b.el, els_used<N>(a.el), els_used<N>(b.el));
+
+	BIFSI_INSTRUMENT_END(mul, N * N);
+
+	return result;
+}
+
+/*
+ * Returns the full product of a and b, which has twice the size of the
+ * factors, so no bits are lost. Depending on SIZE_IN_ELS, the Comba or the
+ * Karatsuba kernel is selected at compile time, see mul_els. With vartime,
+ * only the used elements of a and b are multiplied, see mul_els_vartime.
+ */
+template<typename POLICY = ct, size_t SIZE_IN_BITS, typename EL_T>
+__host__ __device__
+inline constexpr bui<2 * SIZE_IN_BITS, EL_T> mul_full(const bui<SIZE_IN_BITS, EL_T> &a, const bui<SIZE_IN_BITS, EL_T> &b) {
+	constexpr size_t N = bui<SIZE_IN_BITS, EL_T>::SIZE_IN_ELS;
+
+	static_assert_policy<POLICY>();
+
+	if (BIFSI_IS_CONSTANT_EVALUATED()) {
+		// see bui::operator*=
+		bui<2 * SIZE_IN_BITS, EL_T> result = 0U;
+		mul_els<N>(result.el, a.el, b.el);
+		return result;
+	}
+
+	BIFSI_INSTRUMENT_BEGIN(mul);
+
+	bui<2 * SIZE_IN_BITS, EL_T> result;
+
+	if constexpr (is_vartime_v<POLICY>) {
+		mul_els_vartime<N>(result.el, a.el, b.el, els_used<N>(a.el), els_used<N>(b.el));
+	} else {
+		mul_els<N>(result.el, a.el, b.el);
+	}
+
+	BIFSI_INSTRUMENT_END(mul, (bui<SIZE_IN_BITS, EL_T>::SIZE_IN_ELS * bui<SIZE_IN_BITS, EL_T>::SIZE_IN_ELS));
+
+	return result;
+}
+
+/*
+ * Returns a * b + c with twice the size of the operands, which can't
+ * overflow. The product isn't stored in a temporary before c is added, see
+ * mul_add_els.
+ */
+template<size_t SIZE_IN_BITS, typename EL_T>
+__host__ __device__
+inline constexpr bui<2 * SIZE_IN_BITS, EL_T> mul_add(const bui<SIZE_IN_BITS, EL_T> &a, const bui<SIZE_IN_BITS, EL_T> &b, const bui<SIZE_IN_BITS, EL_T> &c) {
+	if (BIFSI_IS_CONSTANT_EVALUATED()) {
+		// see bui::operator*=
+		bui<2 * SIZE_IN_BITS, EL_T> result = 0U;
+		mul_add_els<bui<SIZE_IN_BITS, EL_T>::SIZE_IN_ELS>(result.el, a.el, b.el, c.el);
+		return result;
+	}
+
+	bui<2 * SIZE_IN_BITS, EL_T> result;
+	mul_add_els<bui<SIZE_IN_BITS, EL_T>::SIZE_IN_ELS>(result.el, a.el, b.el, c.el);
+
+	return result;
+}
+
+/*
+ * Returns (a + b) mod n. a and b must be less than n. The conditional
+ * subtraction of n is selected with a mask, see els_add_mod.
+ */
+template<size_t SIZE_IN_BITS, typename EL_T>
+__host__ __device__
+inline constexpr bui<SIZE_IN_BITS, EL_T> add_mod(const bui<SIZE_IN_BITS, EL_T> &a, const bui<SIZE_IN_BITS, EL_T> &b, const bui<SIZE_IN_BITS, EL_T> &n) {
+	bui<SIZE_IN_BITS, EL_T> result = 0U;
+
+	els_add_mod<bui<SIZE_IN_BITS, EL_T>::SIZE_IN_ELS>(result.el, a.el, b.el, n.el);
+
+	return result;
+}
+
+/*
+ * Returns (a - b) mod n. a and b must be less than n. The conditional
+ * addition of n is masked, see els_sub_mod.
+ */
+template<size_t SIZE_IN_BITS, typename EL_T>
+__host__ __device__
+inline constexpr bui<SIZE_IN_BITS, EL_T> sub_mod(const bui<SIZE_IN_BITS, EL_T> &a, const bui<SIZE_IN_BITS, EL_T> &b, const bui<SIZE_IN_BITS, EL_T> &n) {
+	bui<SIZE_IN_BITS, EL_T> result = 0U;
+
+	els_sub_mod<bui<SIZE_IN_BITS, EL_T>::SIZE_IN_ELS>(result.el, a.el, b.el, n.el);
+
+	return result;
+}
+
+/*
+ * Returns the full square of a, which has twice the size of a. Each cross
+ * product of two elements is computed only once, see sqr_els. With vartime,
+ * only the used elements of a are squared, see sqr_els_vartime.
+ */
+template<typename POLICY = ct, size_t SIZE_IN_BITS, typename EL_T>
+__host__ __device__
+inline constexpr bui<2 * SIZE_IN_BITS, EL_T> sqr(const bui<SIZE_IN_BITS, EL_T> &a) {
+	constexpr size_t N = bui<SIZE_IN_BITS, EL_T>::SIZE_IN_ELS;
+
+	static_assert_policy<POLICY>();
+
+	if (BIFSI_IS_CONSTANT_EVALUATED()) {
+		// see bui::operator*=
+		bui<2 * SIZE_IN_BITS, EL_T> result = 0U;
+		sqr_els<N>(result.el, a.el);
+		return result;
+	}
+
+	BIFSI_INSTRUMENT_BEGIN(sqr);
+
+	bui<2 * SIZE_IN_BITS, EL_T> result;
+
+	if constexpr (is_vartime_v<POLICY>) {
+		sqr_els_vartime<N>(result.el, a.el, els_used<N>(a.el));
+	} else {
+		sqr_els<N>(result.el, a.el);
+	}
+
+	BIFSI_INSTRUMENT_END(sqr, (bui<SIZE_IN_BITS, EL_T>::SIZE_IN_ELS * bui<SIZE_IN_BITS, EL_T>::SIZE_IN_ELS));
+
+	return result;
+}
+
+/*
+ * Quotient and remainder of a division, see divmod.
+ */
+template<size_t Q_SIZE_IN_BITS, size_t R_SIZE_IN_BITS, typename EL_T = el_t>
+struct divmod_result {
+	bui<Q_SIZE_IN_BITS, EL_T> q = 0U;
+	bui<R_SIZE_IN_BITS, EL_T> r = 0U;
+};
+
+/*
+ * Returns quotient and remainder of a divided by d, computed with Knuth's
+ * algorithm D. d must not be 0. The number of iterations depends on the number
+ * of nonzero elements of d, see knuth_div_els, and with vartime also on that
+ * of a. Use divmod_ct for a fixed number of iterations.
+ */
+template<typename POLICY = ct, size_t A_SIZE_IN_BITS, size_t D_SIZE_IN_BITS, typename EL_T>
+__host__ __device__
+inline constexpr divmod_result<A_SIZE_IN_BITS, D_SIZE_IN_BITS, EL_T> divmod(const bui<A_SIZE_IN_BITS, EL_T> &a, const bui<D_SIZE_IN_BITS, EL_T> &d) {
+	constexpr size_t A_SIZE_IN_ELS = bui<A_SIZE_IN_BITS, EL_T>::SIZE_IN_ELS;
+	constexpr size_t D_SIZE_IN_ELS = bui<D_SIZE_IN_BITS, EL_T>::SIZE_IN_ELS;
+
+	static_assert_policy<POLICY>();
+
+	BIFSI_INSTRUMENT_BEGIN(div);
+
+	divmod_result<A_SIZE_IN_BITS, D_SIZE_IN_BITS, EL_T> result;
+
+	const size_t na = is_vartime_v<POLICY> ? els_used<A_SIZE_IN_ELS>(a.el) : A_SIZE_IN_ELS;
+
+	knuth_div_els<A_SIZE_IN_ELS, D_SIZE_IN_ELS>(result.q.el, result.r.el, a.el, d.el, na);
+
+	BIFSI_INSTRUMENT_END(div, ((A_SIZE_IN_ELS > D_SIZE_IN_ELS) ? A_SIZE_IN_ELS - D_SIZE_IN_ELS + 1 : 1) * D_SIZE_IN_ELS);
+
+	return result;
+}
+
+/*
+ * Returns quotient and remainder of a divided by d with a fixed number of
+ * iterations and without branches which depend on the values. d must not be
+ * 0. This is meant for CUDA, where a data dependent number of iterations makes
+ * the threads of a warp diverge, and for values that must not leak through
+ * timing. See ct_div_els.
+ */
+template<size_t A_SIZE_IN_BITS, size_t D_SIZE_IN_BITS, typename EL_T>
+__host__ __device__
+inline constexpr divmod_result<A_SIZE_IN_BITS, D_SIZE_IN_BITS, EL_T> divmod_ct(const bui<A_SIZE_IN_BITS, EL_T> &a, const bui<D_SIZE_IN_BITS, EL_T> &d) {
+	constexpr size_t A_SIZE_IN_ELS = bui<A_SIZE_IN_BITS, EL_T>::SIZE_IN_ELS;
+	constexpr size_t D_SIZE_IN_ELS = bui<D_SIZE_IN_BITS, EL_T>::SIZE_IN_ELS;
+
+	BIFSI_INSTRUMENT_BEGIN(div);
 
-		bool result;
+	divmod_result<A_SIZE_IN_BITS, D_SIZE_IN_BITS, EL_T> result;
 
-		if (sizeof(el_t) >= sizeof(UINT_T)) {
-			assert(sizeof(el_t) % sizeof(UINT_T) == 0);
+	ct_div_els<A_SIZE_IN_ELS, D_SIZE_IN_ELS>(result.q.el, result.r.el, a.el, d.el);
 
-			result = (to_el_t() < b);
-			result &= is_zero_starting_at_el<1>();
+	BIFSI_INSTRUMENT_END(div, ((A_SIZE_IN_ELS > D_SIZE_IN_ELS) ? A_SIZE_IN_ELS - D_SIZE_IN_ELS + 1 : 1) * D_SIZE_IN_ELS);
 
-		} else {
-			assert(sizeof(UINT_T) % sizeof(el_t) == 0);
+	return result;
+}
 
-			result = (as_uint<UINT_T>() < b);
-			result &= is_zero_starting_at_el<sizeof(UINT_T) / sizeof(el_t)>();
-		}
+/*
+ * Returns quotient and remainder of a divided by d, with the precomputed
+ * reciprocal of d, see divisor. The number of iterations is fixed, like for
+ * divmod_ct, unless the policy is vartime, with which the leading zero
+ * elements of a are skipped.
+ */
+template<typename POLICY = ct, size_t A_SIZE_IN_BITS, typename EL_T>
+__host__ __device__
+inline constexpr divmod_result<A_SIZE_IN_BITS, sizeof(EL_T) * 8, EL_T> divmod(const bui<A_SIZE_IN_BITS, EL_T> &a, const divisor<EL_T> &d) {
+	constexpr size_t A_SIZE_IN_ELS = bui<A_SIZE_IN_BITS, EL_T>::SIZE_IN_ELS;
 
-		return result;
+	static_assert_policy<POLICY>();
+
+	BIFSI_INSTRUMENT_BEGIN(div);
+
+	divmod_result<A_SIZE_IN_BITS, sizeof(EL_T) * 8, EL_T> result;
+
+	size_t na = A_SIZE_IN_ELS;
+
+	if constexpr (is_vartime_v<POLICY>) {
+		// els_div_divisor needs at least one element
+		na = els_used<A_SIZE_IN_ELS>(a.el);
+		na += (na == 0);
 	}
 
-	/*
-	 * Returns true if, and only if, b represents a value greater than this
-	 * object.
-	 *
-	 * This function calls
-	 *
-	 * assert(
-	 *   sizeof(el_t) % sizeof(UINT_T) == 0 ||
-	 *   sizeof(UINT_T) % sizeof(el_t) == 0
-	 * ),
-	 *
-	 * which fails if the condition is not met, because the implementation is
-	 * not ready for such cases.
-	 */
-	template<typename UINT_T>
-	__host__ __device__
-	inline constexpr bool operator_gt_uint(const UINT_T &b) const {
-		assert_unsigned_int_type<UINT_T>();
+	result.r.el[0] = els_div_divisor<A_SIZE_IN_ELS>(result.q.el, a.el, d, na);
 
-		bool result;
+	BIFSI_INSTRUMENT_END(div, (bui<A_SIZE_IN_BITS, EL_T>::SIZE_IN_ELS));
 
-		if (sizeof(el_t) >= sizeof(UINT_T)) {
-			assert(sizeof(el_t) % sizeof(UINT_T) == 0);
+	return result;
+}
 
-			result = (to_el_t() > b);
-			result |= is_nonzero_starting_at_el<1>();
+#ifndef BIFSI_DEC_DC_THRESHOLD_ELS
+#define BIFSI_DEC_DC_THRESHOLD_ELS 32
+#endif
 
-		} else {
-			assert(sizeof(UINT_T) % sizeof(el_t) == 0);
+/*
+ * Number of elements starting at which the conversion to decimal switches
+ * from repeated division by a power of 10 to divide and conquer, see
+ * write_dec_digits. Define BIFSI_DEC_DC_THRESHOLD_ELS before including this
+ * file to override the default.
+ */
+const size_t DEC_DC_THRESHOLD_ELS = BIFSI_DEC_DC_THRESHOLD_ELS;
 
-			result = (as_uint<UINT_T>() > b);
-			result |= is_nonzero_starting_at_el<sizeof(UINT_T) / sizeof(el_t)>();
-		}
+#ifndef BIFSI_DEC_POW10_CONSTEXPR_MAX_ELS
+#define BIFSI_DEC_POW10_CONSTEXPR_MAX_ELS 64
+#endif
 
-		return result;
-	}
+/*
+ * Number of elements up to which dec_pow10::instance is computed at compile
+ * time. Bigger instances exceed the default limits of constant evaluation of
+ * the compilers, so they are computed at the first use instead. Define
+ * BIFSI_DEC_POW10_CONSTEXPR_MAX_ELS before including this file to override
+ * the default.
+ */
+const size_t DEC_POW10_CONSTEXPR_MAX_ELS = BIFSI_DEC_POW10_CONSTEXPR_MAX_ELS;
 
-	/*
-	 * Returns true if, and only if, b represents a value less than or equal to
-	 * this object.
-	 *
-	 * This function calls
-	 *
-	 * assert(
-	 *   sizeof(el_t) % sizeof(UINT_T) == 0 ||
-	 *   sizeof(UINT_T) % sizeof(el_t) == 0
-	 * ),
-	 *
-	 * which fails if the condition is not met, because the implementation is
-	 * not ready for such cases.
-	 */
-	template<typename UINT_T>
-	__host__ __device__
-	inline constexpr bool operator_leq_uint(const UINT_T &b) const {
-		assert_unsigned_int_type<UINT_T>();
+/*
+ * The biggest power of 10 which has K_ELS elements, d = 10^e, together with
+ * mu = floor(2^(2 * K_ELS * EL_SIZE_IN_BITS) / d) for Barrett division by d.
+ * Computing these is expensive compared to a single conversion, so
+ * write_dec_digits uses one cached instance per size, see instance().
+ */
+template<size_t K_ELS, typename EL_T = el_t>
+struct dec_pow10 {
+	static const size_t EL_SIZE_IN_BITS = sizeof(EL_T) * 8;
+	static const size_t D_SIZE_IN_BITS = K_ELS * EL_SIZE_IN_BITS;
+	static const size_t MU_SIZE_IN_BITS = (K_ELS + 2) * EL_SIZE_IN_BITS;
+
+	bui<D_SIZE_IN_BITS, EL_T> d = 0U;
+	bui<MU_SIZE_IN_BITS, EL_T> mu = 0U;
+	size_t e = 0;
+
+	inline constexpr dec_pow10() {
+		bui<D_SIZE_IN_BITS + EL_SIZE_IN_BITS, EL_T> p = 1;
+		e = 0;
+
+		while (true) {
+			bui<D_SIZE_IN_BITS + EL_SIZE_IN_BITS, EL_T> t = p;
+			t *= (EL_T) 10;
+
+			if (t.el[K_ELS] != 0) {
+				break;
+			}
 
-		bool result;
+			p = t;
+			e++;
+		}
 
-		if (sizeof(el_t) >= sizeof(UINT_T)) {
-			assert(sizeof(el_t) % sizeof(UINT_T) == 0);
+		for (size_t i = 0; i < K_ELS; i++) {
+			d.el[i] = p.el[i];
+		}
 
-			result = (to_el_t() <= b);
-			result &= is_zero_starting_at_el<1>();
+		EL_T num[2 * K_ELS + 1] = { };
+		EL_T q[2 * K_ELS + 1] = { };
+		EL_T r[K_ELS] = { };
 
-		} else {
-			assert(sizeof(UINT_T) % sizeof(el_t) == 0);
+		for (size_t i = 0; i < 2 * K_ELS; i++) {
+			num[i] = 0;
+		}
 
-			result = (as_uint<UINT_T>() <= b);
-			result &= is_zero_starting_at_el<sizeof(UINT_T) / sizeof(el_t)>();
+		num[2 * K_ELS] = 1;
+
+		knuth_div_els<2 * K_ELS + 1, K_ELS>(q, r, num, d.el);
+
+		for (size_t i = 0; i < K_ELS + 2; i++) {
+			mu.el[i] = q[i];
 		}
+	}
 
-		return result;
+	/*
+	 * Returns the instance of this size, which is computed at compile time up
+	 * to DEC_POW10_CONSTEXPR_MAX_ELS elements and at the first call otherwise.
+	 */
+	static inline const dec_pow10& instance() {
+		if constexpr (K_ELS <= DEC_POW10_CONSTEXPR_MAX_ELS) {
+			static constexpr dec_pow10 result { };
+			return result;
+		} else {
+			static const dec_pow10 result = compute();
+			return result;
+		}
 	}
 
+private:
 	/*
-	 * Returns true if, and only if, b represents a value greater than or equal
-	 * to this object.
-	 *
-	 * This function calls
-	 *
-	 * assert(
-	 *   sizeof(el_t) % sizeof(UINT_T) == 0 ||
-	 *   sizeof(UINT_T) % sizeof(el_t) == 0
-	 * ),
-	 *
-	 * which fails if the condition is not met, because the implementation is
-	 * not ready for such cases.
+	 * Not constexpr, so the compiler doesn't attempt the constant
+	 * initialization of the instances exceeding DEC_POW10_CONSTEXPR_MAX_ELS.
 	 */
-	template<typename UINT_T>
-	__host__ __device__
-	inline constexpr bool operator_geq_uint(const UINT_T &b) const {
-		assert_unsigned_int_type<UINT_T>();
+	static inline dec_pow10 compute() {
+		return dec_pow10();
+	}
+};
 
-		bool result;
+/*
+ * Writes exactly width decimal digits of x to out, padded with leading zeros.
+ * x must be less than 10^width. No terminating '\0' is written.
+ *
+ * Up to DEC_DC_THRESHOLD_ELS elements, x is divided repeatedly by the biggest
+ * power of 10 that fits into EL_T, e.g. 10^9 for uint32_t, which produces
+ * dec_chunk_digits<EL_T>() digits per pass of operator/= over the elements.
+ * The reciprocal of this power of 10 is computed at compile time, see
+ * CONST_DIVISOR.
+ *
+ * For bigger sizes, x is split into a high and a low part by division by a
+ * power of 10 with half the size of x, both of which are converted
+ * recursively. The division is a Barrett division (HAC 14.42) with the cached
+ * reciprocal of dec_pow10, so it costs two multiplications, which are
+ * subquadratic for Karatsuba sizes.
+ */
+template<size_t SIZE_IN_BITS, typename EL_T>
+inline void write_dec_digits(const bui<SIZE_IN_BITS, EL_T> &x, char *out, size_t width) {
+	constexpr size_t N = bui<SIZE_IN_BITS, EL_T>::SIZE_IN_ELS;
 
-		if (sizeof(el_t) >= sizeof(UINT_T)) {
-			assert(sizeof(el_t) % sizeof(UINT_T) == 0);
+	if constexpr (N <= DEC_DC_THRESHOLD_ELS || N < 4) {
+		constexpr size_t CHUNK_DIGITS = dec_chunk_digits<EL_T>();
+		constexpr EL_T CHUNK = dec_chunk<EL_T>();
 
-			result = (to_el_t() >= b);
-			result |= is_nonzero_starting_at_el<1>();
+		bui<SIZE_IN_BITS, EL_T> tmp = x;
+		size_t pos = width;
 
-		} else {
-			assert(sizeof(UINT_T) % sizeof(el_t) == 0);
+		while (pos > 0) {
+			EL_T chunk = (tmp /= CONST_DIVISOR<EL_T, CHUNK>);
 
-			result = (as_uint<UINT_T>() >= b);
-			result |= is_nonzero_starting_at_el<sizeof(UINT_T) / sizeof(el_t)>();
+			for (size_t i = 0; i < CHUNK_DIGITS && pos > 0; i++) {
+				out[--pos] = '0' + (char) (chunk % 10);
+				chunk /= 10;
+			}
 		}
 
-		return result;
-	}
+	} else {
+		constexpr size_t K = (N + 1) / 2;
+		constexpr size_t HI_ELS = N - K + 1;
+		constexpr size_t W = sizeof(EL_T) * 8;
 
-	template<typename UINT_T>
-	__host__ __device__
-	inline constexpr bui& operator_pluseq_uint(const UINT_T &b) {
-		assert_unsigned_int_type<UINT_T>();
+		const dec_pow10<K, EL_T> &pow10 = dec_pow10<K, EL_T>::instance();
+
+		// q3 = floor(floor(x / b^(K - 1)) * mu / b^(K + 1)), with b = 2^W
+		bui<(K + 2) * W, EL_T> q1 = 0;
 
-		if (sizeof(UINT_T) < sizeof(el_t)) {
-			return operator_pluseq_uint((el_t) b);
+		for (size_t i = K - 1; i < N; i++) {
+			q1.el[i - (K - 1)] = x.el[i];
 		}
 
-		assert(sizeof(UINT_T) % sizeof(el_t) == 0); // compiled to 0 instructions on success
+		const bui<2 * (K + 2) * W, EL_T> q2 = mul_full(q1, pow10.mu);
 
-		size_t B_EL_COUNT = std::min(sizeof(UINT_T) / sizeof(el_t), SIZE_IN_ELS);
+		bui<HI_ELS * W, EL_T> q3 = 0U;
 
-		el_t carry = 0;
+		for (size_t i = 0; i < HI_ELS; i++) {
+			q3.el[i] = q2.el[K + 1 + i];
+		}
 
-#ifdef __NVCC__
-		#pragma unroll
-		#endif
-		for (size_t i = 0; i < B_EL_COUNT; i++) {
-			el[i] += carry;
-			carry = (el[i] < carry);
+		// r = (x - q3 * d) mod b^(K + 1)
+		bui<(K + 1) * W, EL_T> r;
+		bui<(K + 1) * W, EL_T> q3_d = 0;
+		bui<(K + 1) * W, EL_T> d = 0;
 
-			el_t b_i = (el_t) (b >> i * EL_SIZE_IN_BITS);
-			el[i] += b_i;
-			carry |= (el[i] < b_i);
+		for (size_t i = 0; i < K + 1; i++) {
+			r.el[i] = x.el[i];
+			q3_d.el[i] = (i < HI_ELS) ? q3.el[i] : 0;
+			d.el[i] = (i < K) ? pow10.d.el[i] : 0;
 		}
 
-#ifdef __NVCC__
-		#pragma unroll
-		#endif
-		for (size_t i = B_EL_COUNT; i < SIZE_IN_ELS; i++) {
-			el[i] += carry;
-			carry = (el[i] < carry);
-		}
+		q3_d *= d;
+		els_sub<K + 1, K + 1>(r.el, q3_d.el);
 
-		return *this;
-	}
+		// q3 is at most 2 less than the quotient
+		for (size_t correction = 0; correction < 2; correction++) {
+			bui<(K + 1) * W, EL_T> t = r;
+			const EL_T borrow = els_sub<K + 1, K + 1>(t.el, d.el);
+			const EL_T mask = (EL_T) (borrow - 1);
 
-	template<typename UINT_T>
-	__host__ __device__
-	inline constexpr bui& operator_minuseq_uint(const UINT_T &b) {
-		assert_unsigned_int_type<UINT_T>();
+			for (size_t i = 0; i < K + 1; i++) {
+				r.el[i] = (t.el[i] & mask) | (r.el[i] & ~mask);
+			}
 
-		if (sizeof(UINT_T) < sizeof(el_t)) {
-			return operator_minuseq_uint((el_t) b);
+			q3 += (EL_T) (mask & 1);
 		}
 
-		assert(sizeof(UINT_T) % sizeof(el_t) == 0); // compiled to 0 instructions on success
+		bui<K * W, EL_T> lo = 0U;
+
+		for (size_t i = 0; i < K; i++) {
+			lo.el[i] = r.el[i];
+		}
 
-		size_t B_EL_COUNT = std::min(sizeof(UINT_T) / sizeof(el_t), SIZE_IN_ELS);
+		if (width > pow10.e) {
+			write_dec_digits(q3, out, width - pow10.e);
+			write_dec_digits(lo, out + width - pow10.e, pow10.e);
+		} else {
+			// x < 10^width <= d, so q3 is 0. This depends only on the sizes.
+			write_dec_digits(lo, out, width);
+		}
+	}
+}
 
-		el_t carry = 0;
+/*
+ * Parses the digits in [first, last) in the given base into value, analogous
+ * to std::from_chars. There is no sign and no prefix like 0x, and the range
+ * doesn't need to be terminated by '\0'. On error, value is not modified, see
+ * from_chars_result.
+ *
+ * For base 10, the digits are consumed in chunks of dec_chunk_digits<EL_T>()
+ * digits, e.g. 9 for uint32_t. Each chunk is accumulated in an EL_T and then
+ * added with a single multiply-accumulate pass over the elements of value.
+ * For bases 2, 4, 16 and 8, the bits of the digits are written directly into
+ * the elements, without arithmetic. Other bases from 2 to 36 are parsed with
+ * one multiply-accumulate pass per digit. With vartime, the passes only cover
+ * the elements used so far, see els_mul_add_el_vartime.
+ */
+template<typename POLICY = ct, size_t SIZE_IN_BITS, typename EL_T>
+__host__ __device__
+inline constexpr from_chars_result from_chars(const char *first, const char *last, bui<SIZE_IN_BITS, EL_T> &value, int base = 10) {
+	constexpr size_t N = bui<SIZE_IN_BITS, EL_T>::SIZE_IN_ELS;
+	constexpr size_t EL_SIZE_IN_BITS = sizeof(EL_T) * 8;
 
-#ifdef __NVCC__
-		#pragma unroll
-		#endif
-		for (size_t i = 0; i < B_EL_COUNT; i++) {
-			el_t el_i_before;
+	static_assert_policy<POLICY>();
 
-			el_i_before = el[i];
+	assert(base >= 2 && base <= 36);
 
-			el[i] -= carry;
-			carry = (el[i] > el_i_before);
+	BIFSI_INSTRUMENT_BEGIN(from_chars);
 
-			el_t b_i = (el_t) (b >> i * EL_SIZE_IN_BITS);
-			el_i_before = el[i];
-			el[i] -= b_i;
-			carry |= (el[i] > el_i_before);
-		}
+	const unsigned int ubase = base;
 
-#ifdef __NVCC__
-		#pragma unroll
-		#endif
-		for (size_t i = B_EL_COUNT; i < SIZE_IN_ELS; i++) {
-			el_t el_i_before = el[i];
-			el[i] -= carry;
-			carry = (el[i] > el_i_before);
-		}
+	const char *end = first;
 
-		return *this;
+	while (end != last && digit_value(*end, ubase) < ubase) {
+		end++;
 	}
 
-	template<typename UINT_T>
-	__host__ __device__
-	inline constexpr bui& operator_muleq_uint(const UINT_T &b) {
-		assert_unsigned_int_type<UINT_T>();
+	if (end == first) {
+		return {first, std::errc::invalid_argument};
+	}
 
-		if (sizeof(UINT_T) < sizeof(el_t)) {
-			return operator_muleq_uint((el_t) b);
-		}
+	bui<SIZE_IN_BITS, EL_T> result = 0;
+	bool overflow = false;
 
-		assert(sizeof(UINT_T) % sizeof(el_t) == 0); // compiled to 0 instructions on success
+	// the elements of result used so far, only tracked for vartime
+	size_t used = 0;
 
-		if (sizeof(UINT_T) == sizeof(el_t)) {
-			tw_t tw = 0;
+	if (ubase == 2 || ubase == 4 || ubase == 8 || ubase == 16) {
+		const size_t digit_bits = (ubase == 2) ? 1 : (ubase == 4) ? 2 : (ubase == 8) ? 3 : 4;
 
-#ifdef __NVCC__
-			#pragma unroll
-			#endif
-			for (size_t i = 0; i < SIZE_IN_ELS; i++) {
-				tw += ((tw_t) el[i]) * b;
+		size_t bit_idx = 0;
+
+		for (const char *p = end; p != first;) {
+			p--;
 
-				el[i] = (el_t) tw;
+			const EL_T digit = digit_value(*p, ubase);
 
-				tw >>= EL_SIZE_IN_BITS;
+			if (bit_idx < SIZE_IN_BITS) {
+				const size_t el_idx = bit_idx / EL_SIZE_IN_BITS;
+				const size_t shift = bit_idx % EL_SIZE_IN_BITS;
+
+				result.el[el_idx] |= (EL_T) (digit << shift);
+
+				// bits of the digit that continue in the next element or
+				// that are beyond SIZE_IN_BITS
+				const EL_T spill = (shift + digit_bits > EL_SIZE_IN_BITS) ? (EL_T) (digit >> (EL_SIZE_IN_BITS - shift)) : 0;
+
+				if (el_idx + 1 < N) {
+					result.el[el_idx + 1] |= spill;
+				} else {
+					overflow |= (spill != 0);
+				}
+			} else {
+				overflow |= (digit != 0);
 			}
 
-		} else /* if (sizeof(UINT_T) > sizeof(el_t)) */{
-			el_t b_0 = (el_t) b;
-			const UINT_T b_upper = b >> EL_SIZE_IN_BITS;
+			bit_idx += digit_bits;
+		}
 
-			UINT_T ui = 0;
-			tw_t tw = 0;
+	} else if (ubase == 10) {
+		constexpr size_t CHUNK_DIGITS = dec_chunk_digits<EL_T>();
 
-#ifdef __NVCC__
-			#pragma unroll
-			#endif
-			for (size_t i = 0; i < SIZE_IN_ELS; i++) {
-				tw += ((tw_t) b_0) * el[i];
+		const size_t len = end - first;
+		size_t chunk_len = len % CHUNK_DIGITS;
+		chunk_len = (chunk_len == 0) ? CHUNK_DIGITS : chunk_len;
 
-				el[i] = (el_t) tw;
-				tw >>= EL_SIZE_IN_BITS;
+		for (const char *p = first; p != end; p += chunk_len, chunk_len = CHUNK_DIGITS) {
+			EL_T chunk = 0;
+			EL_T multiplier = 1;
 
-				ui += b_upper * el[i];
+			for (size_t i = 0; i < chunk_len; i++) {
+				chunk = (EL_T) (chunk * 10 + (EL_T) (p[i] - '0'));
+				multiplier = (EL_T) (multiplier * 10);
+			}
 
-				tw += (el_t) ui;
-				ui >>= EL_SIZE_IN_BITS;
+			if constexpr (is_vartime_v<POLICY>) {
+				overflow |= (els_mul_add_el_vartime<N>(result.el, used, multiplier, chunk) != 0);
+			} else {
+				overflow |= (els_mul_add_el<N>(result.el, multiplier, chunk) != 0);
 			}
 		}
 
-		return *this;
+	} else {
+		for (const char *p = first; p != end; p++) {
+			if constexpr (is_vartime_v<POLICY>) {
+				overflow |= (els_mul_add_el_vartime<N>(result.el, used, (EL_T) ubase, (EL_T) digit_value(*p, ubase)) != 0);
+			} else {
+				overflow |= (els_mul_add_el<N>(result.el, (EL_T) ubase, (EL_T) digit_value(*p, ubase)) != 0);
+			}
+		}
 	}
 
-	template<typename UINT_T>
-	__host__ __device__
-	inline constexpr bui& operator_diveq_uint(const UINT_T &b) {
-		assert_unsigned_int_type<UINT_T>();
+	BIFSI_INSTRUMENT_END(from_chars, N);
 
-		if (sizeof(UINT_T) < sizeof(el_t)) {
-			return operator_diveq_uint((el_t) b);
-		}
+	if (overflow) {
+		return {end, std::errc::result_out_of_range};
+	}
 
-		assert(sizeof(UINT_T) % sizeof(el_t) == 0); // compiled to 0 instructions on success
+	value = result;
 
-		if (sizeof(UINT_T) == sizeof(el_t)) {
-			tw_t tw = 0;
+	return {end, std::errc()};
+}
 
-#ifdef __NVCC__
-	#pragma unroll
-	#endif
-			for (size_t i = SIZE_IN_ELS - 1; i != (size_t) -1; i--) {
-				tw <<= EL_SIZE_IN_BITS;
-				tw |= el[i];
-				el[i] = (el_t) (tw / b);
-				tw %= b;
-			}
+template<size_t SIZE_IN_BITS, typename EL_T>
+inline std::string to_string(const bui<SIZE_IN_BITS, EL_T> &x) {
+	return x.str();
+}
 
-			return (el_t) tw;
-		} else /* if (sizeof(UINT_T) > sizeof(el_t)) */{
+template<size_t SIZE_IN_BITS, typename EL_T>
+inline std::ostream& operator<<(std::ostream &os, const bui<SIZE_IN_BITS, EL_T> &x) {
+	return os << x.str();
+}
 
+/*
+ * Returns the value of x with TO_EL_T as element type, see els_convert.
+ */
+template<typename TO_EL_T, size_t SIZE_IN_BITS, typename EL_T>
+__host__ __device__
+inline constexpr bui<SIZE_IN_BITS, TO_EL_T> el_cast(const bui<SIZE_IN_BITS, EL_T> &x) {
+	return bui<SIZE_IN_BITS, TO_EL_T>(x);
+}
 
-		}
+/*
+ * Returns the value of x with TO_SIZE_IN_BITS bits, zero extended or cut off to
+ * the lowest TO_SIZE_IN_BITS bits.
+ */
+template<size_t TO_SIZE_IN_BITS, size_t SIZE_IN_BITS, typename EL_T>
+__host__ __device__
+inline constexpr bui<TO_SIZE_IN_BITS, EL_T> width_cast(const bui<SIZE_IN_BITS, EL_T> &x) {
+	if constexpr (TO_SIZE_IN_BITS == SIZE_IN_BITS) {
+		return x;
+	} else {
+		return bui<TO_SIZE_IN_BITS, EL_T>(x);
 	}
+}
+
+/*
+ * Returns the number of trailing 0 bits of x, which is SIZE_IN_BITS for x = 0.
+ * Every element is visited, the count is accumulated with masks.
+ */
+template<size_t SIZE_IN_BITS, typename EL_T>
+__host__ __device__
+inline constexpr size_t trailing_0_bits(const bui<SIZE_IN_BITS, EL_T> &x) {
+	size_t result = 0;
+	size_t found = 0;
 
-public:
-	template<size_t START_EL_IDX>
-	__host__ __device__
-	inline void set_zero_starting_at_el() {
 #ifdef __NVCC__
 #pragma unroll
 #endif
-		for (size_t i = START_EL_IDX; i < SIZE_IN_ELS; i++) {
-			el[i] = 0;
-		}
+	for (size_t i = 0; i < bui<SIZE_IN_BITS, EL_T>::SIZE_IN_ELS; i++) {
+		const size_t mask = found - 1; // all bits set while nothing found yet
+		result += number_of_trailing_0_bits(x.el[i]) & mask;
+		found |= (x.el[i] != 0);
 	}
 
-	__host__ __device__
-	inline constexpr void set_zero() {
-		set_zero_starting_at_el<0>();
+	return result;
+}
+
+/*
+ * Returns table[idx] by reading every entry of the table, so the memory
+ * access pattern doesn't depend on idx. idx must be less than TABLE_SIZE.
+ */
+template<size_t SIZE_IN_BITS, size_t TABLE_SIZE, typename EL_T>
+__host__ __device__
+inline constexpr bui<SIZE_IN_BITS, EL_T> ct_select(const fixed_array<bui<SIZE_IN_BITS, EL_T>, TABLE_SIZE> &table, const size_t &idx) {
+	bui<SIZE_IN_BITS, EL_T> result = 0;
+
+#ifdef __NVCC__
+#pragma unroll
+#endif
+	for (size_t i = 0; i < TABLE_SIZE; i++) {
+		const EL_T mask = (EL_T) -(EL_T) (i == idx);
+
+#ifdef __NVCC__
+#pragma unroll
+#endif
+		for (size_t j = 0; j < bui<SIZE_IN_BITS, EL_T>::SIZE_IN_ELS; j++) {
+			result.el[j] |= table[i].el[j] & mask;
+		}
 	}
 
-	template<typename INT_T>
-	__host__ __device__
-	inline constexpr INT_T as() const {
-		static_assert_singed_or_unsigned_int_type<INT_T>();
+	return result;
+}
+
+/**
+ * Context for Montgomery multiplication modulo an odd modulus n with
+ * R = 2^SIZE_IN_BITS. The constants n' = -n^-1 mod 2^EL_SIZE_IN_BITS and
+ * R^2 mod n are computed once in the constructor, so an object of this class
+ * is meant to be created once per modulus and then be used for many
+ * multiplications and exponentiations.
+ *
+ * Values in Montgomery form are represented by x * R mod n. Use to_mont and
+ * from_mont for converting from and to the normal form. Like bui, all
+ * operations are branchless and have a fixed number of iterations, which
+ * doesn't depend on the values, so they are thread coherent and constant time.
+ */
+template<size_t SIZE_IN_BITS, typename EL_T = el_t>
+class montgomery {
+public:
+	typedef EL_T el_t;
+
+	typedef twice_size_t<EL_T> tw_t;
+
+	static const size_t EL_SIZE_IN_BITS = sizeof(EL_T) * 8;
+
+	static const size_t SIZE_IN_ELS = bui<SIZE_IN_BITS, EL_T>::SIZE_IN_ELS;
+
+	/*
+	 * The modulus. Must be odd and greater than 1.
+	 */
+	bui<SIZE_IN_BITS, EL_T> n;
+
+	/*
+	 * -n^-1 mod 2^EL_SIZE_IN_BITS
+	 */
+	el_t n_prime;
 
-		if (std::is_unsigned_v<INT_T>) {
-			return as_uint<INT_T>();
-		} else {
-			return as_uint<std::make_unsigned_t<INT_T>>();
-		}
-	}
+	/*
+	 * R^2 mod n, for converting to Montgomery form.
+	 */
+	bui<SIZE_IN_BITS, EL_T> r2;
 
-	template<typename INT_T>
-	__host__ __device__
-	inline bui& set(const INT_T &value) {
-		if (std::is_unsigned_v<INT_T>) {
-			return set_uint(value);
-		} else {
-			return set_uint(static_cast<std::make_unsigned_t<INT_T>>(value));
-		}
-	}
+	/*
+	 * R mod n, which is 1 in Montgomery form.
+	 */
+	bui<SIZE_IN_BITS, EL_T> one;
 
-	template<typename INT_T>
 	__host__ __device__
-	inline constexpr bui& operator=(const INT_T &value) {
-		return set(value);
-	}
+	inline constexpr montgomery(const bui<SIZE_IN_BITS, EL_T> &modulus) :
+			n(modulus), n_prime(0), r2(0U), one(1U) {
+		assert((n.el[0] & 1) == 1);
+		assert(n != 1);
 
-	__host__ __device__
-	inline constexpr bui& operator=(const char *str) {
-		set_from_str(str);
-	}
+		n_prime = (el_t) -inverse_el(n.el[0]);
 
-	__host__ __device__
-	inline constexpr size_t bitlen() const {
+		// R mod n = 2^SIZE_IN_BITS mod n by doubling 1 SIZE_IN_BITS times,
+		// then R^2 mod n by doubling another SIZE_IN_BITS times.
 #ifdef __NVCC__
 #pragma unroll
 #endif
-		for (size_t i = SIZE_IN_ELS - 1; i < SIZE_IN_ELS; i--) {
-			if (el[i] != 0) {
-				size_t sub_el_bitlen = bitlen(el[i]);
-				return i * EL_SIZE_IN_BITS + sub_el_bitlen;
-			}
+		for (size_t i = 0; i < SIZE_IN_BITS; i++) {
+			double_mod(one);
 		}
 
-		return 0;
-	}
-
-	template<size_t START_EL_IDX>
-	__host__ __device__
-	inline constexpr bool is_zero_starting_at_el() const {
-		bool result = true;
+		r2 = one;
 
 #ifdef __NVCC__
 #pragma unroll
 #endif
-		for (size_t i = START_EL_IDX; i < SIZE_IN_ELS; i++) {
-			result &= (el[i] == 0);
+		for (size_t i = 0; i < SIZE_IN_BITS; i++) {
+			double_mod(r2);
 		}
-
-		return result;
 	}
 
-	template<size_t START_EL_IDX>
+	/*
+	 * Returns a * b * R^-1 mod n, computed with the CIOS (coarsely integrated
+	 * operand scanning) method. a must be less than R and b must be less than
+	 * n, which is fulfilled by every value in Montgomery form.
+	 */
 	__host__ __device__
-	inline constexpr bool is_nonzero_starting_at_el() const {
-		bool result = false;
+	inline constexpr bui<SIZE_IN_BITS, EL_T> mont_mul(const bui<SIZE_IN_BITS, EL_T> &a, const bui<SIZE_IN_BITS, EL_T> &b) const {
+		BIFSI_INSTRUMENT_BEGIN(mont_mul);
+
+		el_t t[SIZE_IN_ELS + 2] = { };
 
 #ifdef __NVCC__
 #pragma unroll
 #endif
-		for (size_t i = START_EL_IDX; i < SIZE_IN_ELS; i++) {
-			result |= (el[i] != 0);
+		for (size_t j = 0; j < SIZE_IN_ELS + 2; j++) {
+			t[j] = 0;
 		}
 
-		return result;
-	}
-
-	__host__ __device__
-	inline constexpr bool is_zero() const {
-		return is_zero_starting_at_el<0>();
-	}
-
-	__host__ __device__
-	inline constexpr bool is_nonzero() const {
-		return is_nonzero_starting_at_el<0>();
-	}
+#ifdef __NVCC__
+#pragma unroll
+#endif
+		for (size_t i = 0; i < SIZE_IN_ELS; i++) {
+			// t += a * b[i]
+			el_t c = 0;
 
-	template<typename INT_T>
-	__host__ __device__
-	inline constexpr bool operator!=(const INT_T &b) const {
-		static_assert_singed_or_unsigned_int_type<INT_T>();
+#ifdef __NVCC__
+#pragma unroll
+#endif
+			for (size_t j = 0; j < SIZE_IN_ELS; j++) {
+				t[j] = mul_add_wide(a.el[j], b.el[i], t[j], c, c);
+			}
 
-		if (std::is_unsigned_v<INT_T>) {
-			const auto bu = static_cast<std::make_unsigned_t<INT_T>>(b);
-			return operator_neq_uint(bu);
+			el_t carry = 0;
+			t[SIZE_IN_ELS] = addc(t[SIZE_IN_ELS], c, carry);
+			t[SIZE_IN_ELS + 1] = carry;
 
-		} else {
-			auto bu = static_cast<std::make_unsigned_t<INT_T>>(b);
-			return (b < 0) | operator_neq_uint(bu);
-		}
-	}
+			// t = (t + m * n) / 2^EL_SIZE_IN_BITS, where m is chosen such
+			// that the division is exact
+			const el_t m = (el_t) (t[0] * n_prime);
 
-	template<typename INT_T>
-	__host__ __device__
-	inline constexpr bool operator==(const INT_T &b) const {
-		if (std::is_unsigned_v<INT_T>) {
-			return operator_eq_uint(b);
-		} else {
-			const auto bu = static_cast<std::make_unsigned_t<INT_T>>(b);
-			return (b >= 0) & operator_eq_uint(bu);
-		}
-	}
+			(void) mul_add_wide(m, n.el[0], t[0], c);
 
-	template<typename INT_T>
-	__host__ __device__
-	inline constexpr bool operator>(const INT_T &b) const {
-		if (std::is_unsigned_v<INT_T>) {
-			return operator_gt_uint(b);
-		} else {
-			return (b < 0) | operator_gt_uint(b);
-		}
-	}
+#ifdef __NVCC__
+#pragma unroll
+#endif
+			for (size_t j = 1; j < SIZE_IN_ELS; j++) {
+				t[j - 1] = mul_add_wide(m, n.el[j], t[j], c, c);
+			}
 
-	template<typename INT_T>
-	__host__ __device__
-	inline constexpr bool operator<(const INT_T &b) const {
-		if (std::is_unsigned_v<INT_T>) {
-			return operator_lt_uint(b);
-		} else {
-			return (b >= 0) & operator_lt_uint(b);
+			carry = 0;
+			t[SIZE_IN_ELS - 1] = addc(t[SIZE_IN_ELS], c, carry);
+			t[SIZE_IN_ELS] = t[SIZE_IN_ELS + 1] + carry;
 		}
-	}
 
-	template<typename INT_T>
-	__host__ __device__
-	inline constexpr bool operator>=(const INT_T &b) const {
-		if (std::is_unsigned_v<INT_T>) {
-			return operator_geq_uint(b);
-		} else {
-			return (b < 0) | operator_geq_uint(b);
-		}
-	}
+		bui<SIZE_IN_BITS, EL_T> result = 0U;
 
-	template<typename INT_T>
-	__host__ __device__
-	inline constexpr bool operator<=(const INT_T &b) const {
-		if (std::is_unsigned_v<INT_T>) {
-			return operator_leq_uint(b);
-		} else {
-			return (b >= 0) & operator_leq_uint(b);
+#ifdef __NVCC__
+#pragma unroll
+#endif
+		for (size_t j = 0; j < SIZE_IN_ELS; j++) {
+			result.el[j] = t[j];
 		}
-	}
 
-	template<typename INT_T>
-	__host__ __device__
-	inline constexpr bui& operator+=(const INT_T &b) {
-		if (std::is_unsigned_v<INT_T>) {
-			return operator_pluseq_uint(b);
+		sub_n_if_geq(result, t[SIZE_IN_ELS]);
 
-		} else if (b >= 0) {
-			const auto bu = static_cast<std::make_unsigned_t<INT_T>>(b);
-			return operator_pluseq_uint(bu);
+		BIFSI_INSTRUMENT_END(mont_mul, 2 * SIZE_IN_ELS * SIZE_IN_ELS);
 
-		} else {
-			const auto bu = static_cast<std::make_unsigned_t<INT_T>>(-b);
-			return operator_minuseq_uint(bu);
-		}
+		return result;
 	}
 
-	template<typename INT_T>
+	/*
+	 * Returns a * a * R^-1 mod n. a must be less than n, which is fulfilled by
+	 * every value in Montgomery form. Starting at MONT_SQR_THRESHOLD_ELS, the
+	 * square is computed with sqr_els, which needs about half the element
+	 * multiplications of mont_mul's product, and is then reduced with the
+	 * separated operand scanning method. Below the threshold, the
+	 * instrumentation counts it as mont_mul.
+	 */
 	__host__ __device__
-	inline constexpr bui& operator-=(const INT_T &b) {
-		if (std::is_unsigned_v<INT_T>) {
-			return operator_minuseq_uint(b);
-
-		} else if (b >= 0) {
-			const auto bu = static_cast<std::make_unsigned_t<INT_T>>(b);
-			return operator_minuseq_uint(bu);
-
-		} else {
-			const auto bu = static_cast<std::make_unsigned_t<INT_T>>(-b);
-			return operator_pluseq_uint(bu);
+	inline constexpr bui<SIZE_IN_BITS, EL_T> mont_sqr(const bui<SIZE_IN_BITS, EL_T> &a) const {
+		if constexpr (SIZE_IN_ELS < MONT_SQR_THRESHOLD_ELS) {
+			return mont_mul(a, a);
 		}
-	}
 
-	template<typename INT_T>
-	__host__ __device__
-	inline constexpr bui& operator*=(const INT_T &b) {
-		if (std::is_unsigned_v<INT_T>) {
-			return operator_muleq_uint(b);
+		BIFSI_INSTRUMENT_BEGIN(mont_sqr);
 
-		} else if (b >= 0) {
-			const auto bu = static_cast<std::make_unsigned_t<INT_T>>(b);
-			return operator_muleq_uint(bu);
+		el_t t[2 * SIZE_IN_ELS] = { };
 
-		} else {
-			assert(b >= 0); // fails
-			return *this; // never reached
-		}
-	}
+		sqr_els<SIZE_IN_ELS>(t, a.el);
 
-	__host__ __device__
-	inline constexpr el_t operator/=(const el_t &b) {
-		tw_t tw = 0;
+		// carry into t[i + SIZE_IN_ELS] from the previous row
+		el_t top = 0;
 
 #ifdef __NVCC__
 #pragma unroll
 #endif
-		for (size_t i = SIZE_IN_ELS - 1; i != (size_t) -1; i--) {
-			tw <<= EL_SIZE_IN_BITS;
-			tw |= el[i];
-			el[i] = (el_t) (tw / b);
-			tw %= b;
-		}
+		for (size_t i = 0; i < SIZE_IN_ELS; i++) {
+			// t += m * n * 2^(i * EL_SIZE_IN_BITS), where m is chosen such
+			// that t[i] becomes 0
+			const el_t m = (el_t) (t[i] * n_prime);
 
-		return (el_t) tw;
-	}
+			const el_t c = els_mul_add_els<SIZE_IN_ELS>(t + i, n.el, m);
 
-	__host__ __device__
-	inline constexpr el_t operator%(const el_t &b) const {
-		tw_t tw = 0;
+			t[i + SIZE_IN_ELS] = addc(t[i + SIZE_IN_ELS], c, top);
+		}
+
+		bui<SIZE_IN_BITS, EL_T> result = 0U;
 
 #ifdef __NVCC__
 #pragma unroll
 #endif
-		for (size_t i = SIZE_IN_ELS - 1; i != (size_t) -1; i--) {
-			tw <<= EL_SIZE_IN_BITS;
-			tw |= el[i];
-			tw %= b;
+		for (size_t j = 0; j < SIZE_IN_ELS; j++) {
+			result.el[j] = t[SIZE_IN_ELS + j];
 		}
 
-		return (el_t) tw;
-	}
+		sub_n_if_geq(result, top);
 
-	__host__ __device__
-	inline constexpr el_t operator&(const el_t &b) const {
-		return el[0] & b;
+		BIFSI_INSTRUMENT_END(mont_sqr, SIZE_IN_ELS * (SIZE_IN_ELS + 1) / 2 + SIZE_IN_ELS * SIZE_IN_ELS);
+
+		return result;
 	}
 
+	/*
+	 * Returns a * R mod n. a must be less than R, i.e. a can be any value, it
+	 * doesn't need to be reduced modulo n.
+	 */
 	__host__ __device__
-	inline constexpr el_t operator&(const tw_t &b) const {
-		tw_t tw = (tw_t) *this;
-		return tw & b;
+	inline constexpr bui<SIZE_IN_BITS, EL_T> to_mont(const bui<SIZE_IN_BITS, EL_T> &a) const {
+		return mont_mul(a, r2);
 	}
 
+	/*
+	 * Returns a * R^-1 mod n, i.e. converts a from Montgomery form to the
+	 * normal form.
+	 */
 	__host__ __device__
-	inline constexpr el_t operator&(const int &b) const {
-		if (sizeof(el_t) >= sizeof(int)) {
-			return ((el_t) *this) & (el_t) b;
-		}
-
-		assert(false);
-		return 0; // will never be reached
+	inline constexpr bui<SIZE_IN_BITS, EL_T> from_mont(const bui<SIZE_IN_BITS, EL_T> &a) const {
+		bui<SIZE_IN_BITS, EL_T> b = 1;
+		return mont_mul(a, b);
 	}
 
 	/*
-	 * Shift the bits of this number by WIDTH many bit positions towards lower bit indices (right shift).
+	 * Returns base^exp mod n, computed with a fixed window of WINDOW_BITS bits.
+	 * All EXP_BITS bits of exp are processed, including leading zero bits, and
+	 * the table entry for each window is read by scanning the whole table, so
+	 * neither the control flow nor the memory access pattern depend on exp.
+	 * base doesn't need to be reduced modulo n.
 	 */
-	template<uint32_t WIDTH>
+	template<size_t WINDOW_BITS = 4, size_t EXP_BITS>
 	__host__ __device__
-	inline constexpr bui& loshift_bits() {
-		static_assert(WIDTH < EL_SIZE_IN_BITS);
+	inline constexpr bui<SIZE_IN_BITS, EL_T> mod_pow(const bui<SIZE_IN_BITS, EL_T> &base, const bui<EXP_BITS, EL_T> &exp) const {
+		static_assert(WINDOW_BITS > 0, "constraint not fulfilled: WINDOW_BITS > 0");
+		static_assert(EL_SIZE_IN_BITS % WINDOW_BITS == 0, "constraint not fulfilled: EL_SIZE_IN_BITS % WINDOW_BITS == 0");
+
+		constexpr size_t TABLE_SIZE = ((size_t) 1) << WINDOW_BITS;
+		constexpr el_t WINDOW_MASK = (el_t) (TABLE_SIZE - 1);
 
-		el[0] >>= WIDTH;
+		BIFSI_INSTRUMENT_BEGIN(mod_pow);
+
+		fixed_array<bui<SIZE_IN_BITS, EL_T>, TABLE_SIZE> table = fixed_array<bui<SIZE_IN_BITS, EL_T>, TABLE_SIZE>::filled(one);
+
+		table[1] = to_mont(base);
 
 #ifdef __NVCC__
 #pragma unroll
 #endif
-		for (size_t i = 1; i < SIZE_IN_ELS; i++) {
-			el[i - 1] |= el[i] << (EL_SIZE_IN_BITS - WIDTH);
-			el[i] >>= WIDTH;
+		for (size_t i = 2; i < TABLE_SIZE; i++) {
+			table[i] = mont_mul(table[i - 1], table[1]);
 		}
 
-		return *this;
+		bui<SIZE_IN_BITS, EL_T> result = one;
+
+#ifdef __NVCC__
+#pragma unroll
+#endif
+		for (size_t bit_idx = EXP_BITS - WINDOW_BITS; bit_idx < EXP_BITS; bit_idx -= WINDOW_BITS) {
+#ifdef __NVCC__
+#pragma unroll
+#endif
+			for (size_t i = 0; i < WINDOW_BITS; i++) {
+				result = mont_sqr(result);
+			}
+
+			const el_t window = (exp.el[bit_idx / EL_SIZE_IN_BITS] >> (bit_idx % EL_SIZE_IN_BITS)) & WINDOW_MASK;
+
+			result = mont_mul(result, ct_select(table, window));
+		}
+
+		result = from_mont(result);
+
+		BIFSI_INSTRUMENT_END(mod_pow, SIZE_IN_ELS);
+
+		return result;
 	}
 
+private:
 	/*
-	 * Shift the bits of this number by WIDTH many bit positions towards higher bit indices (left shift).
+	 * Returns x^-1 mod 2^EL_SIZE_IN_BITS for odd x with Newton's iteration.
+	 * x is its own inverse modulo 2^3 and each iteration doubles the number of
+	 * correct bits.
 	 */
-	template<uint32_t WIDTH>
 	__host__ __device__
-	inline constexpr bui& hishift_bits() {
-		static_assert(WIDTH < EL_SIZE_IN_BITS);
-
-		el[SIZE_IN_ELS - 1] <<= WIDTH;
+	static inline constexpr el_t inverse_el(const el_t &x) {
+		el_t inv = x;
 
 #ifdef __NVCC__
 #pragma unroll
 #endif
-		for (size_t i = SIZE_IN_ELS - 2; i != (size_t) -1; i--) {
-			el[i + 1] |= el[i] >> (EL_SIZE_IN_BITS - WIDTH);
-			el[i] <<= WIDTH;
+		for (size_t correct_bits = 3; correct_bits < EL_SIZE_IN_BITS; correct_bits *= 2) {
+			inv = (el_t) (inv * (el_t) (2 - (el_t) (x * inv)));
 		}
 
-		return *this;
+		return inv;
 	}
 
 	/*
-	 * Shift the elements of this number by one position towards lower bit indices (right shift).
+	 * Replaces x with x - n if x, extended by the element x_hi on top, is
+	 * greater than or equal to n. x_hi must be 0 or 1. The choice is made with
+	 * a mask instead of a branch.
 	 */
 	__host__ __device__
-	inline constexpr bui& loshift_1el() {
+	inline constexpr void sub_n_if_geq(bui<SIZE_IN_BITS, EL_T> &x, const el_t &x_hi) const {
+		bui<SIZE_IN_BITS, EL_T> d = x;
+		const el_t borrow = els_sub<SIZE_IN_ELS, SIZE_IN_ELS>(d.el, n.el);
+
+		const el_t mask = (el_t) -(el_t) ((x_hi != 0) | (borrow == 0));
+
 #ifdef __NVCC__
 #pragma unroll
 #endif
-		for (size_t i = 0; i < SIZE_IN_ELS - 1; i++) {
-			el[i] = el[i + 1];
+		for (size_t j = 0; j < SIZE_IN_ELS; j++) {
+			x.el[j] = (d.el[j] & mask) | (x.el[j] & ~mask);
 		}
-
-		el[SIZE_IN_ELS - 1] = 0;
-
-		return *this;
 	}
 
 	/*
-	 * Shift the elements of this number by one position towards higher bit indices (right shift).
+	 * Replaces x with 2 * x mod n. x must be less than n.
 	 */
 	__host__ __device__
-	inline constexpr bui& hishift_1el() {
+	inline constexpr void double_mod(bui<SIZE_IN_BITS, EL_T> &x) const {
+		const el_t x_hi = x.el[SIZE_IN_ELS - 1] >> (EL_SIZE_IN_BITS - 1);
+
 #ifdef __NVCC__
 #pragma unroll
 #endif
-		for (size_t i = SIZE_IN_ELS - 1; i < SIZE_IN_ELS; i--) {
-			el[i] = el[i - 1];
+		for (size_t j = SIZE_IN_ELS - 1; j > 0; j--) {
+			x.el[j] = (el_t) (x.el[j] << 1) | (x.el[j - 1] >> (EL_SIZE_IN_BITS - 1));
 		}
 
-		el[0] = 0;
-
-		return *this;
-	}
+		x.el[0] = (el_t) (x.el[0] << 1);
 
-	inline std::string str() const {
-		return uint_to_string(*this);
+		sub_n_if_geq(x, x_hi);
 	}
-}
-;
-
-template<size_t SIZE_IN_BITS>
-inline std::string to_string(const bui<SIZE_IN_BITS> &x) {
-	return x.str();
-}
-
-template<size_t SIZE_IN_BITS>
-inline std::ostream& operator<<(std::ostream &os, const bui<SIZE_IN_BITS> &x) {
-	return os << x.str();
-}
+};
 
 } /* namespace bifsi */
 
@@ -0,0 +1,574 @@
+/*
+ * bifsi_batch.h
+ * published: 2022-09-04
+ * last change: 2022-09-04
+ *
+ * Copyright 2022 Daniel Strecker
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Structure of arrays (SoA) container for many bui values of the same size.
+ * bui stores the elements of one value next to each other, which is the right
+ * layout for working on a single value, but it keeps the compiler from
+ * processing element i of many values with one vector instruction. bui_batch
+ * stores element 0 of all values next to each other, then element 1 of all
+ * values, and so on. On the host, the batch operations process as many values
+ * at once as fit into an AVX2 or AVX-512 register, with the carries of all
+ * these values in one register. The exceptions are mul_scalar, which is only
+ * vectorized for 32 bit el_t, and mod_scalar, which is never vectorized. On
+ * CUDA, the same layout gives coalesced global memory accesses when thread t
+ * works on value t, see the *_lane functions.
+ *
+ * The carry and borrow of the arithmetic is computed from the top bits of the
+ * operands and the result instead of with comparisons, because there are no
+ * unsigned vector comparisons in AVX2. Like bui, all operations are
+ * branchless.
+ */
+
+#ifndef BIFSI_BATCH_H_
+#define BIFSI_BATCH_H_
+
+#include "bifsi.h"
+
+#if defined(__AVX512F__) || defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+namespace bifsi {
+
+namespace simd {
+
+#if defined(__AVX512F__)
+
+typedef __m512i vec_t;
+
+/*
+ * Number of EL_T that fit into one vector register, or 0 if there are no
+ * vector instructions for EL_T.
+ */
+template<typename EL_T>
+constexpr size_t VEC_SIZE_IN_ELS = (sizeof(EL_T) == 4 || sizeof(EL_T) == 8) ? 64 / sizeof(EL_T) : 0;
+
+template<typename EL_T>
+inline vec_t load(const EL_T *p) {
+	return _mm512_loadu_si512(p);
+}
+
+template<typename EL_T>
+inline void store(EL_T *p, const vec_t &v) {
+	_mm512_storeu_si512(p, v);
+}
+
+inline vec_t zero() {
+	return _mm512_setzero_si512();
+}
+
+template<typename EL_T>
+inline vec_t set1(const EL_T &x) {
+	if constexpr (sizeof(EL_T) == 4) {
+		return _mm512_set1_epi32(x);
+	} else {
+		return _mm512_set1_epi64(x);
+	}
+}
+
+template<typename EL_T>
+inline vec_t add(const vec_t &a, const vec_t &b) {
+	if constexpr (sizeof(EL_T) == 4) {
+		return _mm512_add_epi32(a, b);
+	} else {
+		return _mm512_add_epi64(a, b);
+	}
+}
+
+template<typename EL_T>
+inline vec_t sub(const vec_t &a, const vec_t &b) {
+	if constexpr (sizeof(EL_T) == 4) {
+		return _mm512_sub_epi32(a, b);
+	} else {
+		return _mm512_sub_epi64(a, b);
+	}
+}
+
+/*
+ * Shifts the top bit of each element down to bit 0.
+ */
+template<typename EL_T>
+inline vec_t top_bit(const vec_t &a) {
+	if constexpr (sizeof(EL_T) == 4) {
+		return _mm512_srli_epi32(a, 31);
+	} else {
+		return _mm512_srli_epi64(a, 63);
+	}
+}
+
+inline vec_t and_(const vec_t &a, const vec_t &b) {
+	return _mm512_and_si512(a, b);
+}
+
+inline vec_t or_(const vec_t &a, const vec_t &b) {
+	return _mm512_or_si512(a, b);
+}
+
+inline vec_t xor_(const vec_t &a, const vec_t &b) {
+	return _mm512_xor_si512(a, b);
+}
+
+/*
+ * ~a & b
+ */
+inline vec_t andnot(const vec_t &a, const vec_t &b) {
+	return _mm512_andnot_si512(a, b);
+}
+
+/*
+ * Multiplies the even 32 bit elements of a and b to 64 bit elements.
+ */
+inline vec_t mul_epu32(const vec_t &a, const vec_t &b) {
+	return _mm512_mul_epu32(a, b);
+}
+
+inline vec_t srli_epi64(const vec_t &a, const unsigned int &n) {
+	return _mm512_srli_epi64(a, n);
+}
+
+inline vec_t slli_epi64(const vec_t &a, const unsigned int &n) {
+	return _mm512_slli_epi64(a, n);
+}
+
+inline vec_t add_epi64(const vec_t &a, const vec_t &b) {
+	return _mm512_add_epi64(a, b);
+}
+
+inline vec_t set1_epi64(const uint64_t &x) {
+	return _mm512_set1_epi64(x);
+}
+
+#elif defined(__AVX2__)
+
+typedef __m256i vec_t;
+
+template<typename EL_T>
+constexpr size_t VEC_SIZE_IN_ELS = (sizeof(EL_T) == 4 || sizeof(EL_T) == 8) ? 32 / sizeof(EL_T) : 0;
+
+template<typename EL_T>
+inline vec_t load(const EL_T *p) {
+	return _mm256_loadu_si256((const __m256i*) p);
+}
+
+template<typename EL_T>
+inline void store(EL_T *p, const vec_t &v) {
+	_mm256_storeu_si256((__m256i*) p, v);
+}
+
+inline vec_t zero() {
+	return _mm256_setzero_si256();
+}
+
+template<typename EL_T>
+inline vec_t set1(const EL_T &x) {
+	if constexpr (sizeof(EL_T) == 4) {
+		return _mm256_set1_epi32(x);
+	} else {
+		return _mm256_set1_epi64x(x);
+	}
+}
+
+template<typename EL_T>
+inline vec_t add(const vec_t &a, const vec_t &b) {
+	if constexpr (sizeof(EL_T) == 4) {
+		return _mm256_add_epi32(a, b);
+	} else {
+		return _mm256_add_epi64(a, b);
+	}
+}
+
+template<typename EL_T>
+inline vec_t sub(const vec_t &a, const vec_t &b) {
+	if constexpr (sizeof(EL_T) == 4) {
+		return _mm256_sub_epi32(a, b);
+	} else {
+		return _mm256_sub_epi64(a, b);
+	}
+}
+
+template<typename EL_T>
+inline vec_t top_bit(const vec_t &a) {
+	if constexpr (sizeof(EL_T) == 4) {
+		return _mm256_srli_epi32(a, 31);
+	} else {
+		return _mm256_srli_epi64(a, 63);
+	}
+}
+
+inline vec_t and_(const vec_t &a, const vec_t &b) {
+	return _mm256_and_si256(a, b);
+}
+
+inline vec_t or_(const vec_t &a, const vec_t &b) {
+	return _mm256_or_si256(a, b);
+}
+
+inline vec_t xor_(const vec_t &a, const vec_t &b) {
+	return _mm256_xor_si256(a, b);
+}
+
+inline vec_t andnot(const vec_t &a, const vec_t &b) {
+	return _mm256_andnot_si256(a, b);
+}
+
+inline vec_t mul_epu32(const vec_t &a, const vec_t &b) {
+	return _mm256_mul_epu32(a, b);
+}
+
+inline vec_t srli_epi64(const vec_t &a, const unsigned int &n) {
+	return _mm256_srli_epi64(a, n);
+}
+
+inline vec_t slli_epi64(const vec_t &a, const unsigned int &n) {
+	return _mm256_slli_epi64(a, n);
+}
+
+inline vec_t add_epi64(const vec_t &a, const vec_t &b) {
+	return _mm256_add_epi64(a, b);
+}
+
+inline vec_t set1_epi64(const uint64_t &x) {
+	return _mm256_set1_epi64x(x);
+}
+
+#else
+
+template<typename EL_T>
+constexpr size_t VEC_SIZE_IN_ELS = 0;
+
+#endif
+
+} /* namespace simd */
+
+/**
+ * Structure of arrays container for LANES values of type
+ * bui<SIZE_IN_BITS, EL_T>. el[i][lane] is element i of value lane.
+ */
+template<size_t SIZE_IN_BITS, size_t LANES, typename EL_T = el_t>
+class bui_batch {
+	static_assert(LANES > 0, "constraint not fulfilled: LANES > 0");
+
+public:
+	typedef EL_T el_t;
+
+	typedef twice_size_t<EL_T> tw_t;
+
+	static const size_t EL_SIZE_IN_BITS = sizeof(EL_T) * 8;
+
+	static const size_t SIZE_IN_ELS = bui<SIZE_IN_BITS, EL_T>::SIZE_IN_ELS;
+
+	static const size_t LANE_COUNT = LANES;
+
+	/*
+	 * Element i of value lane is el[i][lane].
+	 */
+	alignas(64) el_t el[SIZE_IN_ELS][LANES];
+
+	__host__ __device__
+	inline bui<SIZE_IN_BITS, EL_T> get(const size_t &lane) const {
+		bui<SIZE_IN_BITS, EL_T> result;
+
+#ifdef __NVCC__
+#pragma unroll
+#endif
+		for (size_t i = 0; i < SIZE_IN_ELS; i++) {
+			result.el[i] = el[i][lane];
+		}
+
+		return result;
+	}
+
+	__host__ __device__
+	inline void set(const size_t &lane, const bui<SIZE_IN_BITS, EL_T> &value) {
+#ifdef __NVCC__
+#pragma unroll
+#endif
+		for (size_t i = 0; i < SIZE_IN_ELS; i++) {
+			el[i][lane] = value.el[i];
+		}
+	}
+
+	/*
+	 * Value lane += value lane of b.
+	 */
+	__host__ __device__
+	inline void add_lane(const size_t &lane, const bui_batch &b) {
+		el_t carry = 0;
+
+#ifdef __NVCC__
+#pragma unroll
+#endif
+		for (size_t i = 0; i < SIZE_IN_ELS; i++) {
+			el[i][lane] = addc(el[i][lane], b.el[i][lane], carry);
+		}
+	}
+
+	/*
+	 * Value lane -= value lane of b.
+	 */
+	__host__ __device__
+	inline void sub_lane(const size_t &lane, const bui_batch &b) {
+		el_t borrow = 0;
+
+#ifdef __NVCC__
+#pragma unroll
+#endif
+		for (size_t i = 0; i < SIZE_IN_ELS; i++) {
+			el[i][lane] = subb(el[i][lane], b.el[i][lane], borrow);
+		}
+	}
+
+	/*
+	 * Value lane *= m, truncated to SIZE_IN_BITS.
+	 */
+	__host__ __device__
+	inline void mul_scalar_lane(const size_t &lane, const el_t &m) {
+		el_t carry = 0;
+
+#ifdef __NVCC__
+#pragma unroll
+#endif
+		for (size_t i = 0; i < SIZE_IN_ELS; i++) {
+			el[i][lane] = mul_add_wide(el[i][lane], m, carry, carry);
+		}
+	}
+
+	/*
+	 * Returns value lane % m.
+	 */
+	__host__ __device__
+	inline el_t mod_scalar_lane(const size_t &lane, const el_t &m) const {
+		tw_t tw = 0;
+
+#ifdef __NVCC__
+#pragma unroll
+#endif
+		for (size_t i = SIZE_IN_ELS - 1; i != (size_t) -1; i--) {
+			tw <<= EL_SIZE_IN_BITS;
+			tw |= el[i][lane];
+			tw %= m;
+		}
+
+		return (el_t) tw;
+	}
+
+	/*
+	 * Returns -1, 0 or 1 if value lane is less than, equal to or greater than
+	 * value lane of b. It's computed from the borrow of the subtraction and
+	 * the zeroness of the difference.
+	 */
+	__host__ __device__
+	inline int compare_lane(const size_t &lane, const bui_batch &b) const {
+		el_t borrow = 0;
+		el_t nonzero = 0;
+
+#ifdef __NVCC__
+#pragma unroll
+#endif
+		for (size_t i = 0; i < SIZE_IN_ELS; i++) {
+			nonzero |= subb(el[i][lane], b.el[i][lane], borrow);
+		}
+
+		return (int) (nonzero != 0) - 2 * (int) borrow;
+	}
+
+	/*
+	 * Adds each value of b to the value of this batch in the same lane.
+	 */
+	inline void add(const bui_batch &b) {
+		size_t lane = 0;
+
+#if defined(__AVX512F__) || defined(__AVX2__)
+		if constexpr (simd::VEC_SIZE_IN_ELS<EL_T> > 0) {
+			for (; lane + simd::VEC_SIZE_IN_ELS<EL_T> <= LANES; lane += simd::VEC_SIZE_IN_ELS<EL_T>) {
+				simd::vec_t carry = simd::zero();
+
+				for (size_t i = 0; i < SIZE_IN_ELS; i++) {
+					const simd::vec_t x = simd::load(&el[i][lane]);
+					const simd::vec_t y = simd::load(&b.el[i][lane]);
+					const simd::vec_t s = simd::add<EL_T>(simd::add<EL_T>(x, y), carry);
+
+					// carry out of x + y + carry_in, from the top bit of
+					// (x & y) | ((x ^ y) & ~s)
+					carry = simd::top_bit<EL_T>(simd::or_(simd::and_(x, y), simd::andnot(s, simd::xor_(x, y))));
+					simd::store(&el[i][lane], s);
+				}
+			}
+		}
+#endif
+
+		for (; lane < LANES; lane++) {
+			add_lane(lane, b);
+		}
+	}
+
+	/*
+	 * Subtracts each value of b from the value of this batch in the same lane.
+	 */
+	inline void sub(const bui_batch &b) {
+		size_t lane = 0;
+
+#if defined(__AVX512F__) || defined(__AVX2__)
+		if constexpr (simd::VEC_SIZE_IN_ELS<EL_T> > 0) {
+			for (; lane + simd::VEC_SIZE_IN_ELS<EL_T> <= LANES; lane += simd::VEC_SIZE_IN_ELS<EL_T>) {
+				simd::vec_t borrow = simd::zero();
+
+				for (size_t i = 0; i < SIZE_IN_ELS; i++) {
+					const simd::vec_t x = simd::load(&el[i][lane]);
+					const simd::vec_t y = simd::load(&b.el[i][lane]);
+					const simd::vec_t d = simd::sub<EL_T>(simd::sub<EL_T>(x, y), borrow);
+
+					// borrow out of x - y - borrow_in, from the top bit of
+					// (~x & y) | (~(x ^ y) & d)
+					borrow = simd::top_bit<EL_T>(simd::or_(simd::andnot(x, y), simd::andnot(simd::xor_(x, y), d)));
+					simd::store(&el[i][lane], d);
+				}
+			}
+		}
+#endif
+
+		for (; lane < LANES; lane++) {
+			sub_lane(lane, b);
+		}
+	}
+
+	/*
+	 * Multiplies each value of this batch by m, truncated to SIZE_IN_BITS.
+	 * With vector instructions, this is only vectorized for 32 bit el_t,
+	 * because AVX2 and AVX-512F can't multiply 64 bit elements to 128 bit.
+	 * Putting a 64 x 64 bit product together from four 32 x 32 bit ones is
+	 * slower than the scalar loop, so the default 64 bit el_t of the host
+	 * always takes the scalar loop.
+	 */
+	inline void mul_scalar(const el_t &m) {
+		size_t lane = 0;
+
+#if defined(__AVX512F__) || defined(__AVX2__)
+		if constexpr (sizeof(el_t) == 4) {
+			// even and odd 32 bit elements are multiplied separately to
+			// 64 bit products, each with its own carries
+			const simd::vec_t vm = simd::set1(m);
+			const simd::vec_t lo_mask = simd::set1_epi64(0xffffffff);
+
+			for (; lane + simd::VEC_SIZE_IN_ELS<EL_T> <= LANES; lane += simd::VEC_SIZE_IN_ELS<EL_T>) {
+				simd::vec_t carry_even = simd::zero();
+				simd::vec_t carry_odd = simd::zero();
+
+				for (size_t i = 0; i < SIZE_IN_ELS; i++) {
+					const simd::vec_t x = simd::load(&el[i][lane]);
+
+					const simd::vec_t p_even = simd::add_epi64(simd::mul_epu32(x, vm), carry_even);
+					const simd::vec_t p_odd = simd::add_epi64(simd::mul_epu32(simd::srli_epi64(x, 32), vm), carry_odd);
+
+					carry_even = simd::srli_epi64(p_even, 32);
+					carry_odd = simd::srli_epi64(p_odd, 32);
+
+					simd::store(&el[i][lane], simd::or_(simd::and_(p_even, lo_mask), simd::slli_epi64(p_odd, 32)));
+				}
+			}
+		}
+#endif
+
+		for (; lane < LANES; lane++) {
+			mul_scalar_lane(lane, m);
+		}
+	}
+
+	/*
+	 * Stores value lane % m in result[lane] for each lane. There is no
+	 * integer division in AVX2 and AVX-512F, so this isn't vectorized for any
+	 * el_t. The lanes are processed in blocks, with element i of all values of
+	 * a block before element i - 1, which at least keeps the memory accesses
+	 * sequential.
+	 */
+	inline void mod_scalar(const el_t &m, el_t (&result)[LANES]) const {
+		constexpr size_t BLOCK_SIZE = 64;
+
+		for (size_t lane_begin = 0; lane_begin < LANES; lane_begin += BLOCK_SIZE) {
+			const size_t lane_end = std::min(lane_begin + BLOCK_SIZE, LANES);
+
+			tw_t tw[BLOCK_SIZE];
+
+			for (size_t lane = lane_begin; lane < lane_end; lane++) {
+				tw[lane - lane_begin] = 0;
+			}
+
+			for (size_t i = SIZE_IN_ELS - 1; i != (size_t) -1; i--) {
+				for (size_t lane = lane_begin; lane < lane_end; lane++) {
+					tw_t &r = tw[lane - lane_begin];
+
+					r <<= EL_SIZE_IN_BITS;
+					r |= el[i][lane];
+					r %= m;
+				}
+			}
+
+			for (size_t lane = lane_begin; lane < lane_end; lane++) {
+				result[lane] = (el_t) tw[lane - lane_begin];
+			}
+		}
+	}
+
+	/*
+	 * Stores -1, 0 or 1 in result[lane], if value lane is less than, equal to
+	 * or greater than value lane of b, see compare_lane.
+	 */
+	inline void compare(const bui_batch &b, int (&result)[LANES]) const {
+		size_t lane = 0;
+
+#if defined(__AVX512F__) || defined(__AVX2__)
+		if constexpr (simd::VEC_SIZE_IN_ELS<EL_T> > 0) {
+			for (; lane + simd::VEC_SIZE_IN_ELS<EL_T> <= LANES; lane += simd::VEC_SIZE_IN_ELS<EL_T>) {
+				simd::vec_t borrow = simd::zero();
+				simd::vec_t nonzero = simd::zero();
+
+				for (size_t i = 0; i < SIZE_IN_ELS; i++) {
+					const simd::vec_t x = simd::load(&el[i][lane]);
+					const simd::vec_t y = simd::load(&b.el[i][lane]);
+					const simd::vec_t d = simd::sub<EL_T>(simd::sub<EL_T>(x, y), borrow);
+
+					borrow = simd::top_bit<EL_T>(simd::or_(simd::andnot(x, y), simd::andnot(simd::xor_(x, y), d)));
+					nonzero = simd::or_(nonzero, d);
+				}
+
+				el_t borrows[simd::VEC_SIZE_IN_ELS<EL_T>];
+				el_t nonzeros[simd::VEC_SIZE_IN_ELS<EL_T>];
+
+				simd::store(borrows, borrow);
+				simd::store(nonzeros, nonzero);
+
+				for (size_t j = 0; j < simd::VEC_SIZE_IN_ELS<EL_T>; j++) {
+					result[lane + j] = (int) (nonzeros[j] != 0) - 2 * (int) borrows[j];
+				}
+			}
+		}
+#endif
+
+		for (; lane < LANES; lane++) {
+			result[lane] = compare_lane(lane, b);
+		}
+	}
+};
+
+} /* namespace bifsi */
+
+#endif /* BIFSI_BATCH_H_ */
@@ -0,0 +1,611 @@
+/*
+ * bifsi_cg.h
+ * published: 2022-09-04
+ * last change: 2022-09-04
+ *
+ * Copyright 2022 Daniel Strecker
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Cooperative arithmetic on very wide integers, where one value is spread
+ * over the THREADS_PER_INT threads of a tile. With bui<4096>, a single CUDA
+ * thread holds 128 elements of uint32_t per operand, which don't fit into its
+ * registers and spill into local memory. cg_bui holds only the
+ * SIZE_IN_ELS / THREADS_PER_INT elements of one slice of the value per
+ * thread, e.g. 4 elements with 32 threads per value, so the operands stay in
+ * registers.
+ *
+ * The thread with rank r in the tile holds the elements from
+ * r * ELS_PER_THREAD to (r + 1) * ELS_PER_THREAD - 1. Carries between the
+ * slices are resolved with one ballot: each thread computes whether its slice
+ * generates a carry and whether it would propagate an incoming one, and the
+ * carry into each slice follows from adding these two bit masks, like in a
+ * carry lookahead adder, see carry_resolve.
+ *
+ * The multiplications scan the elements of b, broadcast by shuffles, and add
+ * a * b[i] to an accumulator of SIZE_IN_ELS elements, which is then shifted
+ * down by one element. Each thread owns the columns of its slice of the
+ * accumulator, and the carry out of its slice is passed to the next thread
+ * with a shuffle in the next step, so there is no carry chain across the
+ * threads in the loop. Only the final value needs a carry resolution. The
+ * Montgomery multiplication adds m * n in the same step, with m computed by
+ * the thread holding element 0.
+ *
+ * TILE_T is cooperative_groups::thread_block_tile<THREADS_PER_INT> on CUDA,
+ * see bifsi_cuda.cuh, or any type with the same thread_rank, shfl, shfl_up,
+ * shfl_down and ballot functions. All threads of the tile must call the
+ * functions of this file together with the same arguments except for the
+ * slices. Like bui, all operations are branchless and the number of
+ * iterations depends only on the sizes.
+ */
+
+#ifndef BIFSI_CG_H_
+#define BIFSI_CG_H_
+
+#include "bifsi.h"
+
+namespace bifsi {
+
+/*
+ * The integer type that shuffles of EL_T are done with. The smallest one the
+ * shuffles of CUDA support is 32 bits.
+ */
+template<typename EL_T>
+using cg_shfl_t = std::conditional_t<(sizeof(EL_T) > 4), unsigned long long, unsigned int>;
+
+/*
+ * x of the thread with rank src_rank.
+ */
+template<typename TILE_T, typename EL_T>
+__host__ __device__
+inline EL_T cg_shfl(const TILE_T &tile, const EL_T &x, const unsigned int &src_rank) {
+	return (EL_T) tile.shfl((cg_shfl_t<EL_T>) x, src_rank);
+}
+
+/*
+ * x of the thread with the next lower rank, 0 for rank 0.
+ */
+template<typename TILE_T, typename EL_T>
+__host__ __device__
+inline EL_T cg_shfl_up(const TILE_T &tile, const EL_T &x) {
+	const EL_T y = (EL_T) tile.shfl_up((cg_shfl_t<EL_T>) x, 1);
+
+	return y & (EL_T) -(EL_T) (tile.thread_rank() != 0);
+}
+
+/*
+ * x of the thread with the next higher rank, 0 for the highest rank.
+ */
+template<size_t THREADS_PER_INT, typename TILE_T, typename EL_T>
+__host__ __device__
+inline EL_T cg_shfl_down(const TILE_T &tile, const EL_T &x) {
+	const EL_T y = (EL_T) tile.shfl_down((cg_shfl_t<EL_T>) x, 1);
+
+	return y & (EL_T) -(EL_T) (tile.thread_rank() != THREADS_PER_INT - 1);
+}
+
+/**
+ * Unsigned integer of SIZE_IN_BITS bits, spread over the THREADS_PER_INT
+ * threads of a tile, see the top of this file. An object of this class is the
+ * slice of one thread.
+ */
+template<size_t SIZE_IN_BITS, size_t THREADS_PER_INT, typename EL_T = el_t>
+class cg_bui {
+	static_assert(THREADS_PER_INT > 0 && THREADS_PER_INT <= 32 && (THREADS_PER_INT & (THREADS_PER_INT - 1)) == 0, "constraint not fulfilled: THREADS_PER_INT is a power of 2 up to 32");
+	static_assert(bui<SIZE_IN_BITS, EL_T>::SIZE_IN_ELS % THREADS_PER_INT == 0, "constraint not fulfilled: SIZE_IN_ELS % THREADS_PER_INT == 0");
+
+public:
+	typedef EL_T el_t;
+
+	static const size_t EL_SIZE_IN_BITS = sizeof(EL_T) * 8;
+
+	static const size_t SIZE_IN_ELS = bui<SIZE_IN_BITS, EL_T>::SIZE_IN_ELS;
+
+	static const size_t THREAD_COUNT = THREADS_PER_INT;
+
+	static const size_t ELS_PER_THREAD = SIZE_IN_ELS / THREADS_PER_INT;
+
+	/*
+	 * Elements thread_rank * ELS_PER_THREAD + i of the value.
+	 */
+	el_t el[ELS_PER_THREAD];
+
+	/*
+	 * Copies the slice of this thread from x.
+	 */
+	template<typename TILE_T>
+	__host__ __device__
+	inline cg_bui& load(const TILE_T &tile, const bui<SIZE_IN_BITS, EL_T> &x) {
+		const size_t first = tile.thread_rank() * ELS_PER_THREAD;
+
+#ifdef __NVCC__
+#pragma unroll
+#endif
+		for (size_t i = 0; i < ELS_PER_THREAD; i++) {
+			el[i] = x.el[first + i];
+		}
+
+		return *this;
+	}
+
+	/*
+	 * Copies the slice of this thread to x. After all threads have stored,
+	 * x is the whole value.
+	 */
+	template<typename TILE_T>
+	__host__ __device__
+	inline void store(const TILE_T &tile, bui<SIZE_IN_BITS, EL_T> &x) const {
+		const size_t first = tile.thread_rank() * ELS_PER_THREAD;
+
+#ifdef __NVCC__
+#pragma unroll
+#endif
+		for (size_t i = 0; i < ELS_PER_THREAD; i++) {
+			x.el[first + i] = el[i];
+		}
+	}
+
+	/*
+	 * Adds b and returns the carry out of the topmost element, which is the
+	 * same on all threads.
+	 */
+	template<typename TILE_T>
+	__host__ __device__
+	inline el_t add(const TILE_T &tile, const cg_bui &b) {
+		el_t carry = 0;
+
+#ifdef __NVCC__
+#pragma unroll
+#endif
+		for (size_t i = 0; i < ELS_PER_THREAD; i++) {
+			el[i] = addc(el[i], b.el[i], carry);
+		}
+
+		return carry_resolve(tile, el, carry);
+	}
+
+	/*
+	 * Subtracts b and returns the borrow out of the topmost element, which is
+	 * the same on all threads.
+	 */
+	template<typename TILE_T>
+	__host__ __device__
+	inline el_t sub(const TILE_T &tile, const cg_bui &b) {
+		el_t borrow = 0;
+
+#ifdef __NVCC__
+#pragma unroll
+#endif
+		for (size_t i = 0; i < ELS_PER_THREAD; i++) {
+			el[i] = subb(el[i], b.el[i], borrow);
+		}
+
+		return borrow_resolve(tile, el, borrow);
+	}
+
+	/*
+	 * Returns -1, 0 or 1 if this value is less than, equal to or greater than
+	 * b, the same on all threads. The topmost slice that differs decides.
+	 */
+	template<typename TILE_T>
+	__host__ __device__
+	inline int compare(const TILE_T &tile, const cg_bui &b) const {
+		const int local = els_cmp<ELS_PER_THREAD, ELS_PER_THREAD>(el, b.el);
+
+		// the masks don't overlap, so the one with the highest bit, of the
+		// topmost slice that differs, is the greater one
+		const unsigned int greater = tile.ballot(local > 0);
+		const unsigned int less = tile.ballot(local < 0);
+
+		return (int) (greater > less) - (int) (greater < less);
+	}
+
+	/*
+	 * Stores the full product of a and b with twice the size in lo and hi,
+	 * see the top of this file. lo must not be a.
+	 */
+	template<typename TILE_T>
+	__host__ __device__
+	static inline void mul_full(const TILE_T &tile, const cg_bui &a, const cg_bui &b, cg_bui &lo, cg_bui &hi) {
+		const unsigned int rank = tile.thread_rank();
+
+		el_t acc[ELS_PER_THREAD] = { };
+
+		// carry out of the slice of this thread into the next one
+		el_t c = 0;
+
+		for (unsigned int t = 0; t < THREADS_PER_INT; t++) {
+			const el_t mine = (el_t) -(el_t) (rank == t);
+
+#ifdef __NVCC__
+#pragma unroll
+#endif
+			for (size_t k = 0; k < ELS_PER_THREAD; k++) {
+				const el_t carry = mul_add_step(tile, acc, a.el, cg_shfl(tile, b.el[k], t), c);
+
+				// the lowest element of the accumulator is final now
+				const el_t low = cg_shfl(tile, acc[0], 0);
+				lo.el[k] = (low & mine) | (lo.el[k] & ~mine);
+
+				el_t overflow = 0;
+				acc[ELS_PER_THREAD - 1] = addc(shift_down(tile, acc), carry, overflow);
+				c = overflow;
+			}
+		}
+
+		// the product is less than 2^(2 * SIZE_IN_BITS), so nothing carries
+		// out of hi
+		carry_resolve_shifted(tile, acc, c);
+
+#ifdef __NVCC__
+#pragma unroll
+#endif
+		for (size_t i = 0; i < ELS_PER_THREAD; i++) {
+			hi.el[i] = acc[i];
+		}
+	}
+
+	/*
+	 * Multiplies this value with b, truncated to SIZE_IN_BITS.
+	 */
+	template<typename TILE_T>
+	__host__ __device__
+	inline cg_bui& mul(const TILE_T &tile, const cg_bui &b) {
+		// the low half is written while a is still read
+		const cg_bui a = *this;
+		cg_bui hi;
+		mul_full(tile, a, b, *this, hi);
+
+		return *this;
+	}
+
+	/*
+	 * Adds x * m + c_in of the previous thread to the elements of acc, where
+	 * x is the slice of a value, and returns the element that carries out of
+	 * the slice. c is the carry of the previous step of this thread, which is
+	 * passed to the next thread. This can't overflow, because
+	 * (2^W - 1)^2 + 2 * (2^W - 1) < 2^(2 * W).
+	 */
+	template<typename TILE_T>
+	__host__ __device__
+	static inline el_t mul_add_step(const TILE_T &tile, el_t *acc, const el_t *x, const el_t &m, const el_t &c) {
+		el_t carry = cg_shfl_up(tile, c);
+
+#ifdef __NVCC__
+#pragma unroll
+#endif
+		for (size_t i = 0; i < ELS_PER_THREAD; i++) {
+			acc[i] = mul_add_wide(x[i], m, acc[i], carry, carry);
+		}
+
+		return carry;
+	}
+
+	/*
+	 * Shifts the slice acc of the accumulator down by one element and returns
+	 * the lowest element of the next thread's slice, which moves into
+	 * acc[ELS_PER_THREAD - 1]. The lowest element of the slice of rank 0 is
+	 * shifted out.
+	 */
+	template<typename TILE_T>
+	__host__ __device__
+	static inline el_t shift_down(const TILE_T &tile, el_t *acc) {
+		const el_t down = cg_shfl_down<THREADS_PER_INT>(tile, acc[0]);
+
+#ifdef __NVCC__
+#pragma unroll
+#endif
+		for (size_t i = 0; i + 1 < ELS_PER_THREAD; i++) {
+			acc[i] = acc[i + 1];
+		}
+
+		return down;
+	}
+
+	/*
+	 * Adds the carry c of each thread to the lowest element of the next
+	 * thread's slice of x and resolves the carries, see carry_resolve.
+	 * Returns the carry out of the topmost element, including the c of the
+	 * highest rank, the same on all threads.
+	 */
+	template<typename TILE_T>
+	__host__ __device__
+	static inline el_t carry_resolve_shifted(const TILE_T &tile, el_t *x, const el_t &c) {
+		const el_t c_in = cg_shfl_up(tile, c);
+		const el_t c_top = cg_shfl(tile, c, THREADS_PER_INT - 1);
+
+		el_t carry = 0;
+		x[0] = addc(x[0], c_in, carry);
+
+#ifdef __NVCC__
+#pragma unroll
+#endif
+		for (size_t i = 1; i < ELS_PER_THREAD; i++) {
+			x[i] = addc(x[i], carry);
+		}
+
+		return (el_t) (c_top + carry_resolve(tile, x, carry));
+	}
+
+	/*
+	 * Adds the carries between the slices of x, where generate is the carry
+	 * out of the slice of this thread, 0 or 1. A slice passes an incoming
+	 * carry on if all its elements are all ones. With the bit of rank r in G
+	 * set if slice r generates a carry and in P if it propagates one, the
+	 * carries into the slices are the carries of the binary addition
+	 * (G | P) + G, because the generating slices have both bits set and the
+	 * propagating ones only one of them. A slice that generates a carry can't
+	 * propagate one, because its elements are at most 2^SIZE - 2. Returns the
+	 * carry out of the topmost slice, the same on all threads.
+	 */
+	template<typename TILE_T>
+	__host__ __device__
+	static inline el_t carry_resolve(const TILE_T &tile, el_t *x, const el_t &generate) {
+		bool propagate = true;
+
+#ifdef __NVCC__
+#pragma unroll
+#endif
+		for (size_t i = 0; i < ELS_PER_THREAD; i++) {
+			propagate &= (x[i] == (el_t) ~(el_t) 0);
+		}
+
+		const uint64_t g = tile.ballot(generate != 0);
+		const uint64_t a = g | tile.ballot(propagate);
+		const uint64_t sum = a + g;
+		const uint64_t carries = sum ^ a ^ g;
+
+		el_t carry = (el_t) ((carries >> tile.thread_rank()) & 1);
+
+#ifdef __NVCC__
+#pragma unroll
+#endif
+		for (size_t i = 0; i < ELS_PER_THREAD; i++) {
+			x[i] = addc(x[i], carry);
+		}
+
+		return (el_t) ((sum >> THREADS_PER_INT) & 1);
+	}
+
+	/*
+	 * Same as carry_resolve, but for the borrows of a subtraction, which a
+	 * slice passes on if all its elements are 0.
+	 */
+	template<typename TILE_T>
+	__host__ __device__
+	static inline el_t borrow_resolve(const TILE_T &tile, el_t *x, const el_t &generate) {
+		bool propagate = true;
+
+#ifdef __NVCC__
+#pragma unroll
+#endif
+		for (size_t i = 0; i < ELS_PER_THREAD; i++) {
+			propagate &= (x[i] == 0);
+		}
+
+		const uint64_t g = tile.ballot(generate != 0);
+		const uint64_t a = g | tile.ballot(propagate);
+		const uint64_t sum = a + g;
+		const uint64_t borrows = sum ^ a ^ g;
+
+		el_t borrow = (el_t) ((borrows >> tile.thread_rank()) & 1);
+
+#ifdef __NVCC__
+#pragma unroll
+#endif
+		for (size_t i = 0; i < ELS_PER_THREAD; i++) {
+			x[i] = subb(x[i], borrow);
+		}
+
+		return (el_t) ((sum >> THREADS_PER_INT) & 1);
+	}
+};
+
+/**
+ * Montgomery multiplication like montgomery, for values spread over the
+ * threads of a tile, see cg_bui. The constants are the slices of those of a
+ * montgomery object, which is computed once on the host.
+ */
+template<size_t SIZE_IN_BITS, size_t THREADS_PER_INT, typename EL_T = el_t>
+class cg_montgomery {
+public:
+	typedef EL_T el_t;
+	typedef cg_bui<SIZE_IN_BITS, THREADS_PER_INT, EL_T> cg_bui_t;
+
+	static const size_t EL_SIZE_IN_BITS = sizeof(EL_T) * 8;
+
+	static const size_t ELS_PER_THREAD = cg_bui_t::ELS_PER_THREAD;
+
+	cg_bui_t n;
+
+	el_t n_prime;
+
+	cg_bui_t r2;
+
+	cg_bui_t one;
+
+	template<typename TILE_T>
+	__host__ __device__
+	inline cg_montgomery(const TILE_T &tile, const montgomery<SIZE_IN_BITS, EL_T> &mont) :
+			n_prime(mont.n_prime) {
+		n.load(tile, mont.n);
+		r2.load(tile, mont.r2);
+		one.load(tile, mont.one);
+	}
+
+	/*
+	 * Returns a * b * R^-1 mod n, for a * b less than R * n. Each of the
+	 * SIZE_IN_ELS steps adds a * b[i] and then m * n to the accumulator, with
+	 * m chosen such that the lowest element becomes 0, and shifts it down by
+	 * one element, see the top of bifsi_cg.h. The accumulator ends up less
+	 * than 2 * n, with one extra bit, so n is subtracted once if it's not
+	 * less than n, selected with a mask.
+	 */
+	template<typename TILE_T>
+	__host__ __device__
+	inline cg_bui_t mont_mul(const TILE_T &tile, const cg_bui_t &a, const cg_bui_t &b) const {
+		el_t acc[ELS_PER_THREAD] = { };
+
+		// carries out of the slice of this thread into the next one, see
+		// cg_bui::mul_full, at most 2, because two products are added
+		el_t c = 0;
+
+		for (unsigned int t = 0; t < THREADS_PER_INT; t++) {
+#ifdef __NVCC__
+#pragma unroll
+#endif
+			for (size_t k = 0; k < ELS_PER_THREAD; k++) {
+				const el_t carry_ab = cg_bui_t::mul_add_step(tile, acc, a.el, cg_shfl(tile, b.el[k], t), c);
+
+				const el_t m = (el_t) (cg_shfl(tile, acc[0], 0) * n_prime);
+				const el_t carry_mn = cg_bui_t::mul_add_step(tile, acc, n.el, m, 0);
+
+				// the lowest element of the accumulator is 0 now. Unlike in a
+				// product, the accumulator can exceed SIZE_IN_BITS bits
+				// between the steps, so the carry of the highest rank, which
+				// has no next thread, moves down into its own slice.
+				const el_t top_c = c & (el_t) -(el_t) (tile.thread_rank() == THREADS_PER_INT - 1);
+
+				el_t overflow_ab = 0;
+				el_t overflow_mn = 0;
+				acc[ELS_PER_THREAD - 1] = addc((el_t) (cg_bui_t::shift_down(tile, acc) + top_c), carry_ab, overflow_ab);
+				acc[ELS_PER_THREAD - 1] = addc(acc[ELS_PER_THREAD - 1], carry_mn, overflow_mn);
+				c = (el_t) (overflow_ab + overflow_mn);
+			}
+		}
+
+		const el_t top = cg_bui_t::carry_resolve_shifted(tile, acc, c);
+
+		cg_bui_t result;
+		cg_bui_t diff;
+
+#ifdef __NVCC__
+#pragma unroll
+#endif
+		for (size_t i = 0; i < ELS_PER_THREAD; i++) {
+			result.el[i] = acc[i];
+			diff.el[i] = acc[i];
+		}
+
+		const el_t borrow = diff.sub(tile, n);
+		const el_t mask = (el_t) -(el_t) ((top != 0) | (borrow == 0));
+
+#ifdef __NVCC__
+#pragma unroll
+#endif
+		for (size_t i = 0; i < ELS_PER_THREAD; i++) {
+			result.el[i] = (diff.el[i] & mask) | (result.el[i] & ~mask);
+		}
+
+		return result;
+	}
+
+	template<typename TILE_T>
+	__host__ __device__
+	inline cg_bui_t mont_sqr(const TILE_T &tile, const cg_bui_t &a) const {
+		return mont_mul(tile, a, a);
+	}
+
+	/*
+	 * Returns a * R mod n. a must be less than n.
+	 */
+	template<typename TILE_T>
+	__host__ __device__
+	inline cg_bui_t to_mont(const TILE_T &tile, const cg_bui_t &a) const {
+		return mont_mul(tile, a, r2);
+	}
+
+	/*
+	 * Returns a * R^-1 mod n.
+	 */
+	template<typename TILE_T>
+	__host__ __device__
+	inline cg_bui_t from_mont(const TILE_T &tile, const cg_bui_t &a) const {
+		cg_bui_t b;
+
+#ifdef __NVCC__
+#pragma unroll
+#endif
+		for (size_t i = 0; i < ELS_PER_THREAD; i++) {
+			b.el[i] = (el_t) (i == 0 && tile.thread_rank() == 0);
+		}
+
+		return mont_mul(tile, a, b);
+	}
+
+	/*
+	 * Returns base^exp mod n with a fixed window of WINDOW_BITS bits, like
+	 * montgomery::mod_pow. base doesn't need to be reduced modulo n. exp is the
+	 * same on all threads.
+	 */
+	template<size_t WINDOW_BITS = 4, size_t EXP_BITS, typename TILE_T>
+	__host__ __device__
+	inline cg_bui_t mod_pow(const TILE_T &tile, const cg_bui_t &base, const bui<EXP_BITS, EL_T> &exp) const {
+		static_assert(WINDOW_BITS > 0, "constraint not fulfilled: WINDOW_BITS > 0");
+		static_assert(EL_SIZE_IN_BITS % WINDOW_BITS == 0, "constraint not fulfilled: EL_SIZE_IN_BITS % WINDOW_BITS == 0");
+
+		constexpr size_t TABLE_SIZE = ((size_t) 1) << WINDOW_BITS;
+		constexpr el_t WINDOW_MASK = (el_t) (TABLE_SIZE - 1);
+
+		cg_bui_t table[TABLE_SIZE];
+
+		table[0] = one;
+		table[1] = to_mont(tile, base);
+
+		for (size_t i = 2; i < TABLE_SIZE; i++) {
+			table[i] = mont_mul(tile, table[i - 1], table[1]);
+		}
+
+		cg_bui_t result = one;
+
+		for (size_t bit_idx = EXP_BITS - WINDOW_BITS; bit_idx < EXP_BITS; bit_idx -= WINDOW_BITS) {
+			for (size_t i = 0; i < WINDOW_BITS; i++) {
+				result = mont_sqr(tile, result);
+			}
+
+			const el_t window = (exp.el[bit_idx / EL_SIZE_IN_BITS] >> (bit_idx % EL_SIZE_IN_BITS)) & WINDOW_MASK;
+
+			// see ct_select
+			cg_bui_t entry;
+
+#ifdef __NVCC__
+#pragma unroll
+#endif
+			for (size_t j = 0; j < ELS_PER_THREAD; j++) {
+				entry.el[j] = 0;
+			}
+
+			for (size_t i = 0; i < TABLE_SIZE; i++) {
+				const el_t mask = (el_t) -(el_t) (i == window);
+
+#ifdef __NVCC__
+#pragma unroll
+#endif
+				for (size_t j = 0; j < ELS_PER_THREAD; j++) {
+					entry.el[j] |= table[i].el[j] & mask;
+				}
+			}
+
+			result = mont_mul(tile, result, entry);
+		}
+
+		return from_mont(tile, result);
+	}
+};
+
+}
+
+#endif /* BIFSI_CG_H_ */
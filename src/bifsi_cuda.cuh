@@ -0,0 +1,679 @@
+/*
+ * bifsi_cuda.cuh
+ * published: 2022-09-04
+ * last change: 2022-09-04
+ *
+ * Copyright 2022 Daniel Strecker
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * CUDA kernels for elementwise arithmetic on device arrays of bui, and a host
+ * side launcher which streams host arrays through these kernels. Compile with
+ * nvcc. Each thread works on one array element at a time, in a grid stride
+ * loop, so any grid size works for any number of elements.
+ *
+ * The launcher splits the arrays into chunks and distributes the chunks round
+ * robin over several streams. Each stream has its own pinned staging buffers
+ * and device buffers, so while one stream copies its inputs to the device,
+ * another one computes and a third one copies its results back.
+ */
+
+#ifndef BIFSI_CUDA_CUH_
+#define BIFSI_CUDA_CUH_
+
+#include <cooperative_groups.h>
+#include <cuda_runtime.h>
+
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "bifsi.h"
+#include "bifsi_cg.h"
+#include "bifsi_pow.h"
+#include "bifsi_prime.h"
+
+/*
+ * Throws std::runtime_error if the CUDA runtime call expr fails.
+ */
+#define BIFSI_CUDA_CHECK(expr) \
+	do { \
+		const cudaError_t bifsi_cuda_check_err = (expr); \
+		if (bifsi_cuda_check_err != cudaSuccess) { \
+			throw std::runtime_error(std::string(#expr) + ": " + cudaGetErrorString(bifsi_cuda_check_err)); \
+		} \
+	} while (false)
+
+namespace bifsi {
+
+namespace cuda {
+
+/*
+ * r[i] = a[i] + b[i], truncated to SIZE_IN_BITS.
+ */
+template<size_t SIZE_IN_BITS, typename EL_T>
+__global__ void add_kernel(bui<SIZE_IN_BITS, EL_T> *r, const bui<SIZE_IN_BITS, EL_T> *a, const bui<SIZE_IN_BITS, EL_T> *b, size_t count) {
+	constexpr size_t N = bui<SIZE_IN_BITS, EL_T>::SIZE_IN_ELS;
+
+	for (size_t i = blockIdx.x * (size_t) blockDim.x + threadIdx.x; i < count; i += (size_t) blockDim.x * gridDim.x) {
+		bui<SIZE_IN_BITS, EL_T> x = a[i];
+		els_add<N, N>(x.el, b[i].el);
+		r[i] = x;
+	}
+}
+
+/*
+ * r[i] = a[i] * b[i], truncated to SIZE_IN_BITS.
+ */
+template<size_t SIZE_IN_BITS, typename EL_T>
+__global__ void mul_kernel(bui<SIZE_IN_BITS, EL_T> *r, const bui<SIZE_IN_BITS, EL_T> *a, const bui<SIZE_IN_BITS, EL_T> *b, size_t count) {
+	for (size_t i = blockIdx.x * (size_t) blockDim.x + threadIdx.x; i < count; i += (size_t) blockDim.x * gridDim.x) {
+		bui<SIZE_IN_BITS, EL_T> x = a[i];
+		x *= b[i];
+		r[i] = x;
+	}
+}
+
+/*
+ * r[i] = a[i] mod b[i]. Uses the fixed iteration division divmod_ct, so the
+ * threads of a warp don't diverge on different divisors.
+ */
+template<size_t SIZE_IN_BITS, typename EL_T>
+__global__ void mod_kernel(bui<SIZE_IN_BITS, EL_T> *r, const bui<SIZE_IN_BITS, EL_T> *a, const bui<SIZE_IN_BITS, EL_T> *b, size_t count) {
+	for (size_t i = blockIdx.x * (size_t) blockDim.x + threadIdx.x; i < count; i += (size_t) blockDim.x * gridDim.x) {
+		r[i] = divmod_ct(a[i], b[i]).r;
+	}
+}
+
+/*
+ * r[i] = base[i]^exp[i] mod n, with n being the modulus of *dev_mont, which is
+ * in device memory. A montgomery holds several values of SIZE_IN_BITS, so for
+ * big sizes, it doesn't fit into the 4 KiB of kernel parameters.
+ */
+template<size_t SIZE_IN_BITS, size_t EXP_BITS, typename EL_T>
+__global__ void mod_pow_kernel(bui<SIZE_IN_BITS, EL_T> *r, const bui<SIZE_IN_BITS, EL_T> *base, const bui<EXP_BITS, EL_T> *exp, size_t count, const montgomery<SIZE_IN_BITS, EL_T> *dev_mont) {
+	const montgomery<SIZE_IN_BITS, EL_T> &mont = *dev_mont;
+
+	for (size_t i = blockIdx.x * (size_t) blockDim.x + threadIdx.x; i < count; i += (size_t) blockDim.x * gridDim.x) {
+		r[i] = mont.mod_pow(base[i], exp[i]);
+	}
+}
+
+/*
+ * r[i] = base[i]^exp[i] mod n like mod_pow_kernel, but each value is computed
+ * by a tile of THREADS_PER_INT threads, which hold one slice of the operands
+ * each, see cg_bui. The tiles loop over the values in a grid stride loop, so
+ * all threads of a tile always work on the same value. The block size must be
+ * a multiple of THREADS_PER_INT.
+ */
+template<size_t SIZE_IN_BITS, size_t EXP_BITS, size_t THREADS_PER_INT, typename EL_T>
+__global__ void cg_mod_pow_kernel(bui<SIZE_IN_BITS, EL_T> *r, const bui<SIZE_IN_BITS, EL_T> *base, const bui<EXP_BITS, EL_T> *exp, size_t count, const montgomery<SIZE_IN_BITS, EL_T> *dev_mont) {
+	typedef cg_bui<SIZE_IN_BITS, THREADS_PER_INT, EL_T> cg_bui_t;
+
+	const montgomery<SIZE_IN_BITS, EL_T> &mont = *dev_mont;
+
+	const cooperative_groups::thread_block_tile<THREADS_PER_INT> tile = cooperative_groups::tiled_partition<THREADS_PER_INT>(cooperative_groups::this_thread_block());
+	const cg_montgomery<SIZE_IN_BITS, THREADS_PER_INT, EL_T> cg_mont(tile, mont);
+
+	const size_t first = (blockIdx.x * (size_t) blockDim.x + threadIdx.x) / THREADS_PER_INT;
+	const size_t stride = (size_t) blockDim.x * gridDim.x / THREADS_PER_INT;
+
+	for (size_t i = first; i < count; i += stride) {
+		cg_bui_t b;
+		b.load(tile, base[i]);
+
+		cg_mont.mod_pow(tile, b, exp[i]).store(tile, r[i]);
+	}
+}
+
+/*
+ * r[i] = g^exp[i] mod n, with n being the modulus of *dev_mont and table
+ * being computed for g with it, see fixed_base_table. Both are in device
+ * memory, see mod_pow_kernel.
+ *
+ * Each block first copies the table from global to shared memory, so the
+ * dynamic shared memory size of the launch must be sizeof(*table). All
+ * threads of a warp read the same table entry at the same time, which shared
+ * memory broadcasts without bank conflicts.
+ */
+template<size_t SIZE_IN_BITS, size_t EXP_BITS, size_t TEETH, typename EL_T>
+__global__ void fixed_base_mod_pow_kernel(bui<SIZE_IN_BITS, EL_T> *r, const bui<EXP_BITS, EL_T> *exp, size_t count, const fixed_base_table<SIZE_IN_BITS, EXP_BITS, TEETH, EL_T> *table, const montgomery<SIZE_IN_BITS, EL_T> *dev_mont) {
+	typedef fixed_base_table<SIZE_IN_BITS, EXP_BITS, TEETH, EL_T> table_t;
+
+	const montgomery<SIZE_IN_BITS, EL_T> &mont = *dev_mont;
+
+	// one untyped buffer for all instantiations, extern __shared__ arrays of
+	// different types would conflict
+	extern __shared__ __align__(16) unsigned char fixed_base_shared[];
+
+	const size_t table_size_in_els = sizeof(table_t) / sizeof(EL_T);
+
+	for (size_t j = threadIdx.x; j < table_size_in_els; j += blockDim.x) {
+		((EL_T*) fixed_base_shared)[j] = ((const EL_T*) table)[j];
+	}
+
+	__syncthreads();
+
+	const table_t &shared_table = *(const table_t*) fixed_base_shared;
+
+	for (size_t i = blockIdx.x * (size_t) blockDim.x + threadIdx.x; i < count; i += (size_t) blockDim.x * gridDim.x) {
+		r[i] = shared_table.mod_pow(mont, exp[i]);
+	}
+}
+
+/*
+ * r[s] = prod_{i in slice s} bases[i]^exps[i] mod n, with n being the
+ * modulus of *dev_mont, which is in device memory, see mod_pow_kernel, and
+ * slice s being the terms from s * slice_size, for all slices of the count
+ * terms. plan must be the one of get_multi_pow_plan for slice_size terms,
+ * and each slice has plan.scratch_size values of scratch memory from
+ * scratch + s * plan.scratch_size.
+ */
+template<size_t SIZE_IN_BITS, size_t EXP_BITS, typename EL_T>
+__global__ void multi_pow_kernel(bui<SIZE_IN_BITS, EL_T> *r, const bui<SIZE_IN_BITS, EL_T> *bases, const bui<EXP_BITS, EL_T> *exps, size_t count, size_t slice_size, bui<SIZE_IN_BITS, EL_T> *scratch, const multi_pow_plan plan, const montgomery<SIZE_IN_BITS, EL_T> *dev_mont) {
+	const montgomery<SIZE_IN_BITS, EL_T> &mont = *dev_mont;
+
+	const size_t slice_count = (count + slice_size - 1) / slice_size;
+
+	for (size_t s = blockIdx.x * (size_t) blockDim.x + threadIdx.x; s < slice_count; s += (size_t) blockDim.x * gridDim.x) {
+		const size_t begin = s * slice_size;
+		const size_t n = (count - begin < slice_size) ? count - begin : slice_size;
+
+		r[s] = multi_pow(mont, bases + begin, exps + begin, n, scratch + s * plan.scratch_size, plan);
+	}
+}
+
+/*
+ * r[i] = 1 if n[i] is a strong probable prime to the first ROUNDS bases of
+ * prime::miller_rabin_base, else 0. n[i] must be odd and greater than 2 plus
+ * the largest of these bases, e.g. a survivor of prime::sieve.
+ *
+ * Each warp tests 32 candidates in lockstep. All rounds are run, without
+ * stopping at the first base which proves a candidate composite, and all
+ * threads of a warp do the same number of squarings per round, the maximum
+ * over the candidates of the warp, see prime::miller_rabin_round. The grid
+ * stride loop advances by whole blocks, so the threads past count stay in the
+ * loop until the end of the block and compute on n[count - 1] without storing
+ * the result.
+ */
+template<size_t SIZE_IN_BITS, size_t ROUNDS, typename EL_T>
+__global__ void miller_rabin_kernel(uint8_t *r, const bui<SIZE_IN_BITS, EL_T> *n, size_t count) {
+	static_assert(ROUNDS > 0 && ROUNDS <= prime::MAX_MILLER_RABIN_ROUNDS, "constraint not fulfilled: ROUNDS > 0 && ROUNDS <= prime::MAX_MILLER_RABIN_ROUNDS");
+
+	for (size_t block_begin = blockIdx.x * (size_t) blockDim.x; block_begin < count; block_begin += (size_t) blockDim.x * gridDim.x) {
+		const size_t i = block_begin + threadIdx.x;
+		const bool active = i < count;
+
+		const montgomery<SIZE_IN_BITS, EL_T> mont(n[active ? i : count - 1]);
+
+		bui<SIZE_IN_BITS, EL_T> d = mont.n;
+		d -= 1;
+
+		const unsigned int s = (unsigned int) trailing_0_bits(d);
+		d >>= s;
+
+		unsigned int s_max = s;
+
+#ifdef __NVCC__
+#pragma unroll
+#endif
+		for (int offset = 16; offset > 0; offset /= 2) {
+			s_max = max(s_max, __shfl_xor_sync(0xffffffff, s_max, offset));
+		}
+
+		bool result = true;
+
+		for (size_t j = 0; j < ROUNDS; j++) {
+			const bui<SIZE_IN_BITS, EL_T> base = prime::miller_rabin_base(j);
+			result &= prime::miller_rabin_round(mont, d, s, s_max, base);
+		}
+
+		if (active) {
+			r[i] = result;
+		}
+	}
+}
+
+/*
+ * Block and grid size of a kernel launch.
+ */
+struct launch_config {
+	int block_size;
+	int grid_size;
+};
+
+/*
+ * Block and grid size for launching kernel on count elements. The block size
+ * is the one with the maximum occupancy according to the CUDA runtime, which
+ * takes the register usage of the kernel into account, and this grows with
+ * SIZE_IN_ELS. Additionally, the block size is limited such that a block
+ * doesn't hold much more than 64 KiB of bui values, because wide values spill
+ * into local memory, which is cached per SM. The grid is not bigger than what
+ * fits onto the device at once, the kernels loop over the rest.
+ * shared_bytes is the dynamic shared memory size per block of the launch,
+ * which also limits the occupancy.
+ */
+template<size_t SIZE_IN_BITS, typename KERNEL_T>
+inline launch_config get_launch_config(KERNEL_T kernel, const size_t &count, const size_t &shared_bytes = 0) {
+	constexpr int MAX_BYTES_PER_BLOCK = 64 * 1024;
+	constexpr int BYTES_PER_THREAD = SIZE_IN_BITS / 8;
+	constexpr int WARP_SIZE = 32;
+
+	int min_grid_size = 0;
+	int block_size = 0;
+
+	BIFSI_CUDA_CHECK(cudaOccupancyMaxPotentialBlockSize(&min_grid_size, &block_size, kernel, shared_bytes, 0));
+
+	const int size_limited_block_size = std::max(WARP_SIZE, (MAX_BYTES_PER_BLOCK / BYTES_PER_THREAD) / WARP_SIZE * WARP_SIZE);
+	block_size = std::min(block_size, size_limited_block_size);
+
+	int device = 0;
+	int sm_count = 0;
+	int blocks_per_sm = 0;
+
+	BIFSI_CUDA_CHECK(cudaGetDevice(&device));
+	BIFSI_CUDA_CHECK(cudaDeviceGetAttribute(&sm_count, cudaDevAttrMultiProcessorCount, device));
+	BIFSI_CUDA_CHECK(cudaOccupancyMaxActiveBlocksPerMultiprocessor(&blocks_per_sm, kernel, block_size, shared_bytes));
+
+	const size_t needed_grid_size = (count + block_size - 1) / block_size;
+	const size_t max_grid_size = (size_t) std::max(1, sm_count * blocks_per_sm);
+
+	launch_config result;
+	result.block_size = block_size;
+	result.grid_size = (int) std::max((size_t) 1, std::min(needed_grid_size, max_grid_size));
+
+	return result;
+}
+
+/**
+ * Host side launcher for the kernels of this file on host arrays of bui
+ * values. The arrays are processed in chunks of chunk_size elements, which are
+ * distributed round robin over stream_count streams, such that the copies to
+ * the device, the computation and the copies back overlap. The staging
+ * buffers on the host are pinned, because only copies from and to pinned
+ * memory are asynchronous.
+ *
+ * An object of this class keeps its streams and buffers until it's destroyed,
+ * so it's meant to be created once and used for many calls. The calls are
+ * synchronous, i.e. all results are in the output array when they return.
+ */
+class launcher {
+public:
+	inline launcher(size_t chunk_size = 1 << 16, int stream_count = 4) :
+			chunk_size(chunk_size), slots(stream_count) {
+		assert(chunk_size > 0);
+		assert(stream_count > 0);
+
+		for (slot &s : slots) {
+			BIFSI_CUDA_CHECK(cudaStreamCreateWithFlags(&s.stream, cudaStreamNonBlocking));
+		}
+
+		BIFSI_CUDA_CHECK(cudaEventCreateWithFlags(&copy_done, cudaEventDisableTiming));
+	}
+
+	launcher(const launcher&) = delete;
+	launcher& operator=(const launcher&) = delete;
+
+	inline ~launcher() {
+		for (slot &s : slots) {
+			cudaStreamSynchronize(s.stream);
+
+			for (size_t i = 0; i < BUFFER_COUNT; i++) {
+				cudaFreeHost(s.host[i]);
+				cudaFree(s.dev[i]);
+			}
+
+			cudaStreamDestroy(s.stream);
+		}
+
+		cudaEventDestroy(copy_done);
+		cudaFree(table_dev);
+		cudaFree(mont_dev);
+	}
+
+	/*
+	 * r[i] = a[i] + b[i] for i < count. r may be a.
+	 */
+	template<size_t SIZE_IN_BITS, typename EL_T>
+	inline void add(bui<SIZE_IN_BITS, EL_T> *r, const bui<SIZE_IN_BITS, EL_T> *a, const bui<SIZE_IN_BITS, EL_T> *b, size_t count) {
+		const launch_config c = get_launch_config<SIZE_IN_BITS>(add_kernel<SIZE_IN_BITS, EL_T>, std::min(count, chunk_size));
+
+		run(r, a, b, count, [c](bui<SIZE_IN_BITS, EL_T> *dr, const bui<SIZE_IN_BITS, EL_T> *da, const bui<SIZE_IN_BITS, EL_T> *db, size_t n, cudaStream_t stream) {
+			add_kernel<SIZE_IN_BITS, EL_T><<<c.grid_size, c.block_size, 0, stream>>>(dr, da, db, n);
+		});
+	}
+
+	/*
+	 * r[i] = a[i] * b[i] for i < count. r may be a.
+	 */
+	template<size_t SIZE_IN_BITS, typename EL_T>
+	inline void mul(bui<SIZE_IN_BITS, EL_T> *r, const bui<SIZE_IN_BITS, EL_T> *a, const bui<SIZE_IN_BITS, EL_T> *b, size_t count) {
+		const launch_config c = get_launch_config<SIZE_IN_BITS>(mul_kernel<SIZE_IN_BITS, EL_T>, std::min(count, chunk_size));
+
+		run(r, a, b, count, [c](bui<SIZE_IN_BITS, EL_T> *dr, const bui<SIZE_IN_BITS, EL_T> *da, const bui<SIZE_IN_BITS, EL_T> *db, size_t n, cudaStream_t stream) {
+			mul_kernel<SIZE_IN_BITS, EL_T><<<c.grid_size, c.block_size, 0, stream>>>(dr, da, db, n);
+		});
+	}
+
+	/*
+	 * r[i] = a[i] mod b[i] for i < count. r may be a.
+	 */
+	template<size_t SIZE_IN_BITS, typename EL_T>
+	inline void mod(bui<SIZE_IN_BITS, EL_T> *r, const bui<SIZE_IN_BITS, EL_T> *a, const bui<SIZE_IN_BITS, EL_T> *b, size_t count) {
+		const launch_config c = get_launch_config<SIZE_IN_BITS>(mod_kernel<SIZE_IN_BITS, EL_T>, std::min(count, chunk_size));
+
+		run(r, a, b, count, [c](bui<SIZE_IN_BITS, EL_T> *dr, const bui<SIZE_IN_BITS, EL_T> *da, const bui<SIZE_IN_BITS, EL_T> *db, size_t n, cudaStream_t stream) {
+			mod_kernel<SIZE_IN_BITS, EL_T><<<c.grid_size, c.block_size, 0, stream>>>(dr, da, db, n);
+		});
+	}
+
+	/*
+	 * r[i] = base[i]^exp[i] mod n for i < count, with n being the modulus of
+	 * mont. r may be base.
+	 */
+	template<size_t SIZE_IN_BITS, size_t EXP_BITS, typename EL_T>
+	inline void mod_pow(bui<SIZE_IN_BITS, EL_T> *r, const bui<SIZE_IN_BITS, EL_T> *base, const bui<EXP_BITS, EL_T> *exp, size_t count, const montgomery<SIZE_IN_BITS, EL_T> &mont) {
+		const montgomery<SIZE_IN_BITS, EL_T> *dev_mont = copy_mont(mont);
+		const launch_config c = get_launch_config<SIZE_IN_BITS>(mod_pow_kernel<SIZE_IN_BITS, EXP_BITS, EL_T>, std::min(count, chunk_size));
+
+		run(r, base, exp, count, [c, dev_mont](bui<SIZE_IN_BITS, EL_T> *dr, const bui<SIZE_IN_BITS, EL_T> *da, const bui<EXP_BITS, EL_T> *db, size_t n, cudaStream_t stream) {
+			mod_pow_kernel<SIZE_IN_BITS, EXP_BITS, EL_T><<<c.grid_size, c.block_size, 0, stream>>>(dr, da, db, n, dev_mont);
+		});
+	}
+
+	/*
+	 * Same as mod_pow, but with THREADS_PER_INT threads per value, see
+	 * cg_mod_pow_kernel. For big sizes like 4096 bits, a single thread can't
+	 * hold its operands in registers, while a warp per value can.
+	 */
+	template<size_t THREADS_PER_INT, size_t SIZE_IN_BITS, size_t EXP_BITS, typename EL_T>
+	inline void cg_mod_pow(bui<SIZE_IN_BITS, EL_T> *r, const bui<SIZE_IN_BITS, EL_T> *base, const bui<EXP_BITS, EL_T> *exp, size_t count, const montgomery<SIZE_IN_BITS, EL_T> &mont) {
+		const montgomery<SIZE_IN_BITS, EL_T> *dev_mont = copy_mont(mont);
+
+		// the block size is a multiple of the warp size, so of THREADS_PER_INT
+		const launch_config c = get_launch_config<SIZE_IN_BITS / THREADS_PER_INT>(cg_mod_pow_kernel<SIZE_IN_BITS, EXP_BITS, THREADS_PER_INT, EL_T>, std::min(count, chunk_size) * THREADS_PER_INT);
+
+		run(r, base, exp, count, [c, dev_mont](bui<SIZE_IN_BITS, EL_T> *dr, const bui<SIZE_IN_BITS, EL_T> *da, const bui<EXP_BITS, EL_T> *db, size_t n, cudaStream_t stream) {
+			cg_mod_pow_kernel<SIZE_IN_BITS, EXP_BITS, THREADS_PER_INT, EL_T><<<c.grid_size, c.block_size, 0, stream>>>(dr, da, db, n, dev_mont);
+		});
+	}
+
+	/*
+	 * r[i] = g^exp[i] mod n for i < count, with n being the modulus of mont
+	 * and table being computed for g with mont. The table is copied to the
+	 * device once per call and staged in shared memory by each block, see
+	 * fixed_base_mod_pow_kernel.
+	 */
+	template<size_t SIZE_IN_BITS, size_t EXP_BITS, size_t TEETH, typename EL_T>
+	inline void fixed_base_mod_pow(bui<SIZE_IN_BITS, EL_T> *r, const bui<EXP_BITS, EL_T> *exp, size_t count, const montgomery<SIZE_IN_BITS, EL_T> &mont, const fixed_base_table<SIZE_IN_BITS, EXP_BITS, TEETH, EL_T> &table) {
+		typedef fixed_base_table<SIZE_IN_BITS, EXP_BITS, TEETH, EL_T> table_t;
+
+		static_assert(sizeof(table_t) <= 48 * 1024, "constraint not fulfilled: sizeof(table_t) <= 48 KiB of shared memory");
+
+		copy_to_device(table_dev, table_capacity_in_bytes, &table, sizeof(table_t));
+
+		const table_t *dev_table = (const table_t*) table_dev;
+		const montgomery<SIZE_IN_BITS, EL_T> *dev_mont = copy_mont(mont);
+
+		const size_t shared_bytes = sizeof(table_t);
+		const launch_config c = get_launch_config<SIZE_IN_BITS>(fixed_base_mod_pow_kernel<SIZE_IN_BITS, EXP_BITS, TEETH, EL_T>, std::min(count, chunk_size), shared_bytes);
+
+		run(r, exp, (const uint8_t*) nullptr, count, [c, dev_table, dev_mont, shared_bytes](bui<SIZE_IN_BITS, EL_T> *dr, const bui<EXP_BITS, EL_T> *de, const uint8_t*, size_t n, cudaStream_t stream) {
+			fixed_base_mod_pow_kernel<SIZE_IN_BITS, EXP_BITS, TEETH, EL_T><<<c.grid_size, c.block_size, shared_bytes, stream>>>(dr, de, n, dev_table, dev_mont);
+		});
+	}
+
+	/*
+	 * Returns prod_{i < count} bases[i]^exps[i] mod n, with n being the
+	 * modulus of mont. The terms are split into slices of at least
+	 * MULTI_POW_MIN_SLICE_SIZE terms, about one per thread that fits onto the
+	 * device at once, see multi_pow_kernel. The products of the slices are
+	 * multiplied on the host. Unlike the elementwise operations, all terms
+	 * are copied to the device at once, on the first stream.
+	 */
+	template<size_t SIZE_IN_BITS, size_t EXP_BITS, typename EL_T>
+	inline bui<SIZE_IN_BITS, EL_T> multi_pow(const bui<SIZE_IN_BITS, EL_T> *bases, const bui<EXP_BITS, EL_T> *exps, size_t count, const montgomery<SIZE_IN_BITS, EL_T> &mont) {
+		typedef bui<SIZE_IN_BITS, EL_T> bui_t;
+
+		if (count == 0) {
+			return mont.from_mont(mont.one);
+		}
+
+		const size_t max_slice_count = std::max((size_t) 1, count / MULTI_POW_MIN_SLICE_SIZE);
+		const launch_config c = get_launch_config<SIZE_IN_BITS>(multi_pow_kernel<SIZE_IN_BITS, EXP_BITS, EL_T>, max_slice_count);
+
+		const size_t thread_count = std::min(max_slice_count, (size_t) c.grid_size * c.block_size);
+		const size_t slice_size = (count + thread_count - 1) / thread_count;
+		const size_t slice_count = (count + slice_size - 1) / slice_size;
+
+		const multi_pow_plan plan = get_multi_pow_plan<EXP_BITS>(slice_size);
+
+		// the results of the slices are followed by their scratch memory
+		slot &s = slots[0];
+		retire(s);
+
+		ensure_capacity(s, IN_A, count * sizeof(bui_t));
+		ensure_capacity(s, IN_B, count * sizeof(bui<EXP_BITS, EL_T>));
+		ensure_capacity(s, OUT_R, slice_count * (1 + plan.scratch_size) * sizeof(bui_t));
+
+		std::memcpy(s.host[IN_A], bases, count * sizeof(bui_t));
+		std::memcpy(s.host[IN_B], exps, count * sizeof(bui<EXP_BITS, EL_T>));
+		BIFSI_CUDA_CHECK(cudaMemcpyAsync(s.dev[IN_A], s.host[IN_A], count * sizeof(bui_t), cudaMemcpyHostToDevice, s.stream));
+		BIFSI_CUDA_CHECK(cudaMemcpyAsync(s.dev[IN_B], s.host[IN_B], count * sizeof(bui<EXP_BITS, EL_T>), cudaMemcpyHostToDevice, s.stream));
+
+		bui_t *dev_r = (bui_t*) s.dev[OUT_R];
+
+		const montgomery<SIZE_IN_BITS, EL_T> *dev_mont = copy_mont(mont);
+
+		multi_pow_kernel<SIZE_IN_BITS, EXP_BITS, EL_T><<<c.grid_size, c.block_size, 0, s.stream>>>(dev_r, (const bui_t*) s.dev[IN_A], (const bui<EXP_BITS, EL_T>*) s.dev[IN_B], count, slice_size, dev_r + slice_count, plan, dev_mont);
+		BIFSI_CUDA_CHECK(cudaGetLastError());
+
+		BIFSI_CUDA_CHECK(cudaMemcpyAsync(s.host[OUT_R], s.dev[OUT_R], slice_count * sizeof(bui_t), cudaMemcpyDeviceToHost, s.stream));
+		BIFSI_CUDA_CHECK(cudaStreamSynchronize(s.stream));
+
+		const bui_t *partial = (const bui_t*) s.host[OUT_R];
+
+		bui_t result = mont.one;
+
+		for (size_t i = 0; i < slice_count; i++) {
+			result = mont.mont_mul(result, mont.to_mont(partial[i]));
+		}
+
+		return mont.from_mont(result);
+	}
+
+	/*
+	 * r[i] = 1 if n[i] is a strong probable prime to the first ROUNDS bases of
+	 * prime::miller_rabin_base, else 0, for i < count. See
+	 * miller_rabin_kernel for the requirements on n[i].
+	 */
+	template<size_t ROUNDS = 16, size_t SIZE_IN_BITS, typename EL_T>
+	inline void miller_rabin(uint8_t *r, const bui<SIZE_IN_BITS, EL_T> *n, size_t count) {
+		const launch_config c = get_launch_config<SIZE_IN_BITS>(miller_rabin_kernel<SIZE_IN_BITS, ROUNDS, EL_T>, std::min(count, chunk_size));
+
+		run(r, n, (const uint8_t*) nullptr, count, [c](uint8_t *dr, const bui<SIZE_IN_BITS, EL_T> *dn, const uint8_t*, size_t n, cudaStream_t stream) {
+			miller_rabin_kernel<SIZE_IN_BITS, ROUNDS, EL_T><<<c.grid_size, c.block_size, 0, stream>>>(dr, dn, n);
+		});
+	}
+
+private:
+	/*
+	 * Indices of the buffers of a slot: two inputs and one result.
+	 */
+	static const size_t IN_A = 0;
+	static const size_t IN_B = 1;
+	static const size_t OUT_R = 2;
+	static const size_t BUFFER_COUNT = 3;
+
+	/*
+	 * A stream with its buffers and the chunk it's currently working on.
+	 */
+	struct slot {
+		cudaStream_t stream = 0;
+
+		void *host[BUFFER_COUNT] = { nullptr, nullptr, nullptr };
+		void *dev[BUFFER_COUNT] = { nullptr, nullptr, nullptr };
+		size_t capacity_in_bytes[BUFFER_COUNT] = { 0, 0, 0 };
+
+		// destination of the result of the chunk in flight, or nullptr
+		void *pending_dst = nullptr;
+		size_t pending_bytes = 0;
+	};
+
+	size_t chunk_size;
+
+	std::vector<slot> slots;
+
+	// device copy of the table of fixed_base_mod_pow
+	void *table_dev = nullptr;
+	size_t table_capacity_in_bytes = 0;
+
+	// device copy of the montgomery of the current call
+	void *mont_dev = nullptr;
+	size_t mont_capacity_in_bytes = 0;
+
+	// recorded on the default stream after each copy_to_device
+	cudaEvent_t copy_done = nullptr;
+
+	/*
+	 * Copies the bytes at src to the device buffer dev, which is reallocated
+	 * if its capacity is too small. A cudaMemcpy from pageable memory may
+	 * return before the copy has reached the device, and the streams of the
+	 * slots don't synchronize with the default stream it runs on, so each of
+	 * them waits for an event recorded after the copy. No kernel of an
+	 * earlier call is still reading dev, because the calls wait for all their
+	 * results.
+	 */
+	inline void copy_to_device(void *&dev, size_t &capacity_in_bytes, const void *src, const size_t &bytes) {
+		if (capacity_in_bytes < bytes) {
+			BIFSI_CUDA_CHECK(cudaFree(dev));
+
+			dev = nullptr;
+			capacity_in_bytes = 0;
+
+			BIFSI_CUDA_CHECK(cudaMalloc(&dev, bytes));
+
+			capacity_in_bytes = bytes;
+		}
+
+		BIFSI_CUDA_CHECK(cudaMemcpy(dev, src, bytes, cudaMemcpyHostToDevice));
+		BIFSI_CUDA_CHECK(cudaEventRecord(copy_done, 0));
+
+		for (slot &s : slots) {
+			BIFSI_CUDA_CHECK(cudaStreamWaitEvent(s.stream, copy_done, 0));
+		}
+	}
+
+	/*
+	 * Copies mont to the device for the kernels of the current call, see
+	 * mod_pow_kernel.
+	 */
+	template<size_t SIZE_IN_BITS, typename EL_T>
+	inline const montgomery<SIZE_IN_BITS, EL_T>* copy_mont(const montgomery<SIZE_IN_BITS, EL_T> &mont) {
+		copy_to_device(mont_dev, mont_capacity_in_bytes, &mont, sizeof(mont));
+
+		return (const montgomery<SIZE_IN_BITS, EL_T>*) mont_dev;
+	}
+
+	inline static void ensure_capacity(slot &s, const size_t &buffer_idx, const size_t &bytes) {
+		if (s.capacity_in_bytes[buffer_idx] < bytes) {
+			BIFSI_CUDA_CHECK(cudaFreeHost(s.host[buffer_idx]));
+			BIFSI_CUDA_CHECK(cudaFree(s.dev[buffer_idx]));
+
+			s.host[buffer_idx] = nullptr;
+			s.dev[buffer_idx] = nullptr;
+			s.capacity_in_bytes[buffer_idx] = 0;
+
+			BIFSI_CUDA_CHECK(cudaMallocHost(&s.host[buffer_idx], bytes));
+			BIFSI_CUDA_CHECK(cudaMalloc(&s.dev[buffer_idx], bytes));
+
+			s.capacity_in_bytes[buffer_idx] = bytes;
+		}
+	}
+
+	/*
+	 * Waits for the chunk in flight on s, if any, and copies its result from
+	 * the pinned staging buffer to its destination.
+	 */
+	inline static void retire(slot &s) {
+		if (s.pending_dst != nullptr) {
+			BIFSI_CUDA_CHECK(cudaStreamSynchronize(s.stream));
+			std::memcpy(s.pending_dst, s.host[OUT_R], s.pending_bytes);
+
+			s.pending_dst = nullptr;
+			s.pending_bytes = 0;
+		}
+	}
+
+	/*
+	 * Streams the arrays a and b through the kernel started by launch and
+	 * stores the results in r. b may be nullptr for kernels with one input,
+	 * then launch gets nullptr instead of a device array. launch is called
+	 * once per chunk, so the callers compute the launch configuration before,
+	 * for min(count, chunk_size) elements.
+	 */
+	template<typename R_T, typename A_T, typename B_T, typename LAUNCH_T>
+	inline void run(R_T *r, const A_T *a, const B_T *b, const size_t &count, const LAUNCH_T &launch) {
+		for (slot &s : slots) {
+			ensure_capacity(s, IN_A, chunk_size * sizeof(A_T));
+
+			if (b != nullptr) {
+				ensure_capacity(s, IN_B, chunk_size * sizeof(B_T));
+			}
+
+			ensure_capacity(s, OUT_R, chunk_size * sizeof(R_T));
+		}
+
+		// the inputs of a chunk are staged before its result is written back
+		// and the chunks don't overlap, so r may be a
+		size_t slot_idx = 0;
+
+		for (size_t begin = 0; begin < count; begin += chunk_size) {
+			const size_t n = std::min(chunk_size, count - begin);
+
+			slot &s = slots[slot_idx];
+			retire(s);
+
+			std::memcpy(s.host[IN_A], a + begin, n * sizeof(A_T));
+			BIFSI_CUDA_CHECK(cudaMemcpyAsync(s.dev[IN_A], s.host[IN_A], n * sizeof(A_T), cudaMemcpyHostToDevice, s.stream));
+
+			if (b != nullptr) {
+				std::memcpy(s.host[IN_B], b + begin, n * sizeof(B_T));
+				BIFSI_CUDA_CHECK(cudaMemcpyAsync(s.dev[IN_B], s.host[IN_B], n * sizeof(B_T), cudaMemcpyHostToDevice, s.stream));
+			}
+
+			launch((R_T*) s.dev[OUT_R], (const A_T*) s.dev[IN_A], (b != nullptr) ? (const B_T*) s.dev[IN_B] : nullptr, n, s.stream);
+			BIFSI_CUDA_CHECK(cudaGetLastError());
+
+			BIFSI_CUDA_CHECK(cudaMemcpyAsync(s.host[OUT_R], s.dev[OUT_R], n * sizeof(R_T), cudaMemcpyDeviceToHost, s.stream));
+
+			s.pending_dst = r + begin;
+			s.pending_bytes = n * sizeof(R_T);
+
+			slot_idx = (slot_idx + 1) % slots.size();
+		}
+
+		for (slot &s : slots) {
+			retire(s);
+		}
+	}
+};
+
+} /* namespace cuda */
+
+} /* namespace bifsi */
+
+#endif /* BIFSI_CUDA_CUH_ */
@@ -0,0 +1,552 @@
+/*
+ * bifsi_gcd.h
+ * published: 2022-09-04
+ * last change: 2022-09-04
+ *
+ * Copyright 2022 Daniel Strecker
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Greatest common divisor, extended GCD and modular inverse with the divstep
+ * algorithm of Bernstein and Yang, "Fast constant-time gcd computation and
+ * modular inversion" (safegcd). A divstep replaces the odd f and g by g and
+ * (g - f) / 2, or f and (g + f) / 2, or f and g / 2, depending on the lowest
+ * bit of g and the sign of a counter delta. After a number of divsteps which
+ * only depends on the size of the inputs, g is 0 and f is +-gcd.
+ *
+ * The divsteps are done in batches of EL_SIZE_IN_BITS - 2 on the lowest
+ * element of f and g only. A batch yields a 2x2 matrix with entries below
+ * 2^(EL_SIZE_IN_BITS - 2), which is then applied to the full f and g, and to
+ * the cofactor d, e modulo the odd modulus. So the big ints are updated only
+ * once per batch, with multiplications by single elements.
+ *
+ * The number of batches is fixed and all steps are branchless, so all
+ * functions in this file are constant time and thread coherent.
+ */
+
+#ifndef BIFSI_GCD_H_
+#define BIFSI_GCD_H_
+
+#include <stdint.h>
+
+#include <type_traits>
+
+#include "bifsi.h"
+#include "bifsi_batch.h"
+#include "bifsi_signed.h"
+
+namespace bifsi {
+
+/*
+ * Number of divsteps that bring g to 0 for odd f and any g with
+ * |f|, |g| < 2^BITS, see Theorem 11.2 of the paper.
+ */
+template<size_t BITS>
+__host__ __device__
+inline constexpr size_t divstep_count() {
+	return (BITS < 46) ? (49 * BITS + 80) / 17 : (49 * BITS + 57) / 17;
+}
+
+/*
+ * Number of divsteps per batch, so the sum of the absolute values of each
+ * row of the transition matrix, which is at most 2^DIVSTEP_BATCH, fits into a
+ * signed EL_T.
+ */
+template<typename EL_T>
+constexpr size_t DIVSTEP_BATCH = sizeof(EL_T) * 8 - 2;
+
+/*
+ * Transition matrix of a batch of divsteps. The entries are two's complement
+ * values. With the values f, g before and f', g' after the batch,
+ *
+ * 2^DIVSTEP_BATCH * f' = u * f + v * g,
+ * 2^DIVSTEP_BATCH * g' = q * f + r * g.
+ */
+template<typename EL_T>
+struct divstep_matrix {
+	EL_T u;
+	EL_T v;
+	EL_T q;
+	EL_T r;
+};
+
+/*
+ * Runs DIVSTEP_BATCH<EL_T> divsteps on the lowest elements f and g of the
+ * odd f and any g, updates delta and returns the transition matrix. In each
+ * step f and g stay within EL_T, because only the lowest bits of them are
+ * needed for the remaining steps, and instead of halving g the row of f is
+ * doubled. The two cases of an odd g are combined with masks:
+ *
+ * if delta > 0 and g is odd: delta, f, g = 1 - delta, g, (g - f) / 2
+ * else if g is odd:          delta, f, g = 1 + delta, f, (g + f) / 2
+ * else:                      delta, f, g = 1 + delta, f, g / 2
+ */
+template<typename EL_T>
+__host__ __device__
+inline divstep_matrix<EL_T> divsteps(int32_t &delta, EL_T f, EL_T g) {
+	EL_T u = 1;
+	EL_T v = 0;
+	EL_T q = 0;
+	EL_T r = 1;
+
+#ifdef __NVCC__
+#pragma unroll
+#endif
+	for (size_t i = 0; i < DIVSTEP_BATCH<EL_T>; i++) {
+		// c1: delta > 0, c2: g is odd
+		EL_T c1 = (EL_T) -(EL_T) (delta > 0);
+		const EL_T c2 = (EL_T) -(EL_T) (g & 1);
+
+		// g += f, or g -= f if delta > 0, if g is odd
+		const EL_T x = (EL_T) ((f ^ c1) - c1);
+		const EL_T y = (EL_T) ((u ^ c1) - c1);
+		const EL_T z = (EL_T) ((v ^ c1) - c1);
+
+		g = (EL_T) (g + (x & c2));
+		q = (EL_T) (q + (y & c2));
+		r = (EL_T) (r + (z & c2));
+
+		// the swap, as f += g - f
+		c1 &= c2;
+
+		const int32_t swap = -(int32_t) (c1 & 1);
+		delta = ((delta ^ swap) - swap) + 1;
+
+		f = (EL_T) (f + (g & c1));
+		u = (EL_T) (u + (q & c1));
+		v = (EL_T) (v + (r & c1));
+
+		g = (EL_T) (g >> 1);
+		u = (EL_T) (u << 1);
+		v = (EL_T) (v << 1);
+	}
+
+	return {u, v, q, r};
+}
+
+/*
+ * Returns (a * m_a + b * m_b) / 2^DIVSTEP_BATCH<EL_T>, where the division
+ * must be exact.
+ */
+template<size_t SIZE_IN_BITS, typename EL_T>
+__host__ __device__
+inline bsi<SIZE_IN_BITS, EL_T> mul_add_shift(const bsi<SIZE_IN_BITS, EL_T> &a, const EL_T &m_a, const bsi<SIZE_IN_BITS, EL_T> &b, const EL_T &m_b) {
+	typedef std::make_signed_t<EL_T> S_T;
+
+	bsi<SIZE_IN_BITS, EL_T> result = a;
+	result *= (S_T) m_a;
+
+	bsi<SIZE_IN_BITS, EL_T> t = b;
+	t *= (S_T) m_b;
+
+	result += t;
+	result >>= DIVSTEP_BATCH<EL_T>;
+
+	return result;
+}
+
+/*
+ * Returns (a * m_a + b * m_b) / 2^DIVSTEP_BATCH<EL_T> mod n for a and b in
+ * [0, n). n_inv is n^-1 mod 2^EL_SIZE_IN_BITS. A multiple k * n with
+ * 0 <= k < 2^DIVSTEP_BATCH<EL_T> is added to make the division exact, so the
+ * quotient is in (-n, 2 * n) and is brought into [0, n) with masks.
+ */
+template<size_t SIZE_IN_BITS, typename EL_T>
+__host__ __device__
+inline bsi<SIZE_IN_BITS, EL_T> mul_add_shift_mod(const bsi<SIZE_IN_BITS, EL_T> &a, const EL_T &m_a, const bsi<SIZE_IN_BITS, EL_T> &b, const EL_T &m_b, const bsi<SIZE_IN_BITS, EL_T> &n, const EL_T &n_inv) {
+	typedef std::make_signed_t<EL_T> S_T;
+
+	constexpr size_t N = bsi<SIZE_IN_BITS, EL_T>::SIZE_IN_ELS;
+	constexpr EL_T BATCH_MASK = (EL_T) (((EL_T) 1 << DIVSTEP_BATCH<EL_T>) - 1);
+
+	bsi<SIZE_IN_BITS, EL_T> result = a;
+	result *= (S_T) m_a;
+
+	bsi<SIZE_IN_BITS, EL_T> t = b;
+	t *= (S_T) m_b;
+
+	result += t;
+
+	const EL_T k = (EL_T) ((EL_T) -(EL_T) (result.bits.el[0] * n_inv) & BATCH_MASK);
+
+	t = n;
+	t.bits *= k;
+
+	result += t;
+	result >>= DIVSTEP_BATCH<EL_T>;
+
+	// add n if negative
+	EL_T mask = result.sign_mask();
+
+#ifdef __NVCC__
+#pragma unroll
+#endif
+	for (size_t i = 0; i < N; i++) {
+		t.bits.el[i] = n.bits.el[i] & mask;
+	}
+
+	result += t;
+
+	// subtract n, and add it again if that's negative
+	result -= n;
+
+	mask = result.sign_mask();
+
+#ifdef __NVCC__
+#pragma unroll
+#endif
+	for (size_t i = 0; i < N; i++) {
+		t.bits.el[i] = n.bits.el[i] & mask;
+	}
+
+	result += t;
+
+	return result;
+}
+
+/*
+ * Result of safegcd: f is +-gcd(n, x) and, if the cofactor is tracked,
+ * d is in [0, n) with d * x = f mod n.
+ */
+template<size_t SIZE_IN_BITS, typename EL_T>
+struct safegcd_result {
+	bsi<SIZE_IN_BITS + sizeof(EL_T) * 8, EL_T> f;
+	bui<SIZE_IN_BITS, EL_T> d;
+};
+
+/*
+ * Runs divstep_count<SIZE_IN_BITS>() divsteps on f = n and g = x. n must be
+ * odd. With TRACK_COFACTOR, the cofactors d and e of f and g modulo n are
+ * updated along, starting with d = 0 and e = 1, which requires n > 1.
+ * f and g are kept with one more element than n, so the products with the
+ * matrix entries fit before the division by 2^DIVSTEP_BATCH<EL_T>.
+ */
+template<bool TRACK_COFACTOR, size_t SIZE_IN_BITS, typename EL_T>
+__host__ __device__
+inline safegcd_result<SIZE_IN_BITS, EL_T> safegcd(const bui<SIZE_IN_BITS, EL_T> &n, const bui<SIZE_IN_BITS, EL_T> &x) {
+	typedef bsi<SIZE_IN_BITS + sizeof(EL_T) * 8, EL_T> wide_t;
+
+	constexpr size_t N = bui<SIZE_IN_BITS, EL_T>::SIZE_IN_ELS;
+	constexpr size_t BATCH_COUNT = (divstep_count<SIZE_IN_BITS>() + DIVSTEP_BATCH<EL_T> - 1) / DIVSTEP_BATCH<EL_T>;
+
+	const wide_t n_wide(width_cast<SIZE_IN_BITS + sizeof(EL_T) * 8>(n));
+	wide_t g(width_cast<SIZE_IN_BITS + sizeof(EL_T) * 8>(x));
+
+	wide_t f = n_wide;
+
+	wide_t d(0);
+	wide_t e(1);
+
+	// n^-1 mod 2^EL_SIZE_IN_BITS with Newton's method, each iteration
+	// doubles the number of correct bits, starting with 3
+	EL_T n_inv = n.el[0];
+
+#ifdef __NVCC__
+#pragma unroll
+#endif
+	for (size_t i = 3; i < sizeof(EL_T) * 8; i *= 2) {
+		n_inv = (EL_T) (n_inv * (EL_T) (2 - (EL_T) (n.el[0] * n_inv)));
+	}
+
+	int32_t delta = 1;
+
+	for (size_t i = 0; i < BATCH_COUNT; i++) {
+		const divstep_matrix<EL_T> t = divsteps(delta, f.bits.el[0], g.bits.el[0]);
+
+		const wide_t f_next = mul_add_shift(f, t.u, g, t.v);
+		g = mul_add_shift(f, t.q, g, t.r);
+		f = f_next;
+
+		if constexpr (TRACK_COFACTOR) {
+			const wide_t d_next = mul_add_shift_mod(d, t.u, e, t.v, n_wide, n_inv);
+			e = mul_add_shift_mod(d, t.q, e, t.r, n_wide, n_inv);
+			d = d_next;
+		}
+	}
+
+	safegcd_result<SIZE_IN_BITS, EL_T> result;
+	result.f = f;
+
+#ifdef __NVCC__
+#pragma unroll
+#endif
+	for (size_t i = 0; i < N; i++) {
+		result.d.el[i] = d.bits.el[i];
+	}
+
+	return result;
+}
+
+/*
+ * Returns gcd(a, b), with gcd(0, 0) = 0. The common factor 2^k is removed
+ * first, because safegcd needs an odd f. If a is 0, b is taken as f instead,
+ * which is selected with masks.
+ */
+template<size_t SIZE_IN_BITS, typename EL_T>
+__host__ __device__
+inline bui<SIZE_IN_BITS, EL_T> gcd(const bui<SIZE_IN_BITS, EL_T> &a, const bui<SIZE_IN_BITS, EL_T> &b) {
+	constexpr size_t N = bui<SIZE_IN_BITS, EL_T>::SIZE_IN_ELS;
+
+	const size_t a_tz = trailing_0_bits(a);
+	const size_t b_tz = trailing_0_bits(b);
+	const size_t k = (a_tz < b_tz) ? a_tz : b_tz;
+
+	bui<SIZE_IN_BITS, EL_T> a_odd = a;
+	a_odd >>= a_tz;
+
+	bui<SIZE_IN_BITS, EL_T> b_odd = b;
+	b_odd >>= b_tz;
+
+	// f = a_odd, g = b, or if a is 0, f = b_odd, g = 0
+	const EL_T a_zero = (EL_T) -(EL_T) a.is_zero();
+
+	bui<SIZE_IN_BITS, EL_T> f;
+	bui<SIZE_IN_BITS, EL_T> g;
+
+#ifdef __NVCC__
+#pragma unroll
+#endif
+	for (size_t i = 0; i < N; i++) {
+		f.el[i] = (b_odd.el[i] & a_zero) | (a_odd.el[i] & ~a_zero);
+		g.el[i] = b.el[i] & ~a_zero;
+	}
+
+	bui<SIZE_IN_BITS, EL_T> result;
+
+	const bsi<SIZE_IN_BITS + sizeof(EL_T) * 8, EL_T> gcd_odd = safegcd<false>(f, g).f;
+	const auto gcd_odd_abs = gcd_odd.abs();
+
+#ifdef __NVCC__
+#pragma unroll
+#endif
+	for (size_t i = 0; i < N; i++) {
+		result.el[i] = gcd_odd_abs.el[i];
+	}
+
+	result <<= k;
+
+	return result;
+}
+
+/*
+ * Returns x^-1 mod n for an odd n > 1, or 0 if x and n are not coprime. x
+ * doesn't need to be reduced mod n.
+ */
+template<size_t SIZE_IN_BITS, typename EL_T>
+__host__ __device__
+inline bui<SIZE_IN_BITS, EL_T> mod_inverse(const bui<SIZE_IN_BITS, EL_T> &x, const bui<SIZE_IN_BITS, EL_T> &n) {
+	assert((n.el[0] & 1) == 1);
+	assert(n != 1);
+
+	constexpr size_t N = bui<SIZE_IN_BITS, EL_T>::SIZE_IN_ELS;
+
+	const safegcd_result<SIZE_IN_BITS, EL_T> s = safegcd<true>(n, x);
+
+	// d * x = f = +-1 mod n, so the inverse is d or n - d, and d isn't 0
+	// if the inverse exists
+	bui<SIZE_IN_BITS, EL_T> n_minus_d = n;
+	els_sub<N, N>(n_minus_d.el, s.d.el);
+
+	const EL_T negative = s.f.sign_mask();
+	const EL_T coprime = (EL_T) -(EL_T) (s.f.abs() == 1U);
+
+	bui<SIZE_IN_BITS, EL_T> result;
+
+#ifdef __NVCC__
+#pragma unroll
+#endif
+	for (size_t i = 0; i < N; i++) {
+		result.el[i] = ((n_minus_d.el[i] & negative) | (s.d.el[i] & ~negative)) & coprime;
+	}
+
+	return result;
+}
+
+/*
+ * Result of ext_gcd: a * x + b * y = g.
+ */
+template<size_t SIZE_IN_BITS, typename EL_T>
+struct ext_gcd_result {
+	bui<SIZE_IN_BITS, EL_T> g;
+	bsi<SIZE_IN_BITS + sizeof(EL_T) * 8, EL_T> x;
+	bsi<SIZE_IN_BITS + sizeof(EL_T) * 8, EL_T> y;
+};
+
+/*
+ * Returns g = gcd(a, b) and the cofactors x and y with a * x + b * y = g for
+ * an odd a. y is in [0, a) and comes from the cofactor that safegcd tracks
+ * modulo a, x = (g - b * y) / a is an exact division, so |x| < b.
+ */
+template<size_t SIZE_IN_BITS, typename EL_T>
+__host__ __device__
+inline ext_gcd_result<SIZE_IN_BITS, EL_T> ext_gcd(const bui<SIZE_IN_BITS, EL_T> &a, const bui<SIZE_IN_BITS, EL_T> &b) {
+	assert((a.el[0] & 1) == 1);
+
+	typedef bsi<2 * SIZE_IN_BITS + sizeof(EL_T) * 8, EL_T> wide_t;
+
+	constexpr size_t N = bui<SIZE_IN_BITS, EL_T>::SIZE_IN_ELS;
+
+	ext_gcd_result<SIZE_IN_BITS, EL_T> result;
+
+	// safegcd with cofactors needs a > 1, so a = 1 is replaced by 3, and the
+	// result for a = 1, which is g = 1, x = 1 and y = 0, is selected at the
+	// end
+	const EL_T a_is_one = (EL_T) -(EL_T) (a == 1U);
+
+	bui<SIZE_IN_BITS, EL_T> a_safe = a;
+	a_safe.el[0] |= (EL_T) (2 & a_is_one);
+
+	const safegcd_result<SIZE_IN_BITS, EL_T> s = safegcd<true>(a_safe, b);
+
+	const auto g = s.f.abs();
+
+	// y = d or a - d, so b * y = g mod a, and 0 if d is 0
+	bui<SIZE_IN_BITS, EL_T> a_minus_d = a_safe;
+	els_sub<N, N>(a_minus_d.el, s.d.el);
+
+	const EL_T negative = (EL_T) (s.f.sign_mask() & -(EL_T) s.d.is_nonzero());
+
+	bui<SIZE_IN_BITS, EL_T> y;
+
+	result.y = 0;
+
+#ifdef __NVCC__
+#pragma unroll
+#endif
+	for (size_t i = 0; i < N; i++) {
+		result.g.el[i] = g.el[i];
+		y.el[i] = (a_minus_d.el[i] & negative) | (s.d.el[i] & ~negative);
+		result.y.bits.el[i] = y.el[i];
+	}
+
+	// x = -(b * y - g) / a
+	const bui<2 * SIZE_IN_BITS, EL_T> by = mul_full(b, y);
+
+	wide_t numerator(0);
+	wide_t g_wide(0);
+
+#ifdef __NVCC__
+#pragma unroll
+#endif
+	for (size_t i = 0; i < 2 * N; i++) {
+		numerator.bits.el[i] = by.el[i];
+	}
+
+#ifdef __NVCC__
+#pragma unroll
+#endif
+	for (size_t i = 0; i < N; i++) {
+		g_wide.bits.el[i] = result.g.el[i];
+	}
+
+	numerator -= g_wide;
+
+	const EL_T numerator_negative = numerator.sign_mask();
+
+	const auto quotient = divmod_ct(numerator.abs(), a_safe).q;
+
+	result.x = 0;
+
+#ifdef __NVCC__
+#pragma unroll
+#endif
+	for (size_t i = 0; i < N; i++) {
+		result.x.bits.el[i] = quotient.el[i];
+	}
+
+	result.x.conditional_negate((EL_T) ~numerator_negative);
+
+#ifdef __NVCC__
+#pragma unroll
+#endif
+	for (size_t i = 0; i < N; i++) {
+		result.g.el[i] = (result.g.el[i] & ~a_is_one) | ((EL_T) (i == 0) & a_is_one);
+	}
+
+#ifdef __NVCC__
+#pragma unroll
+#endif
+	for (size_t i = 0; i < result.x.SIZE_IN_ELS; i++) {
+		result.x.bits.el[i] = (result.x.bits.el[i] & ~a_is_one) | ((EL_T) (i == 0) & a_is_one);
+		result.y.bits.el[i] &= ~a_is_one;
+	}
+
+	return result;
+}
+
+/*
+ * Stores a[i]^-1 mod n in r[i] for i < count, with Montgomery's trick: the
+ * prefix products of a are inverted with one mod_inverse and the single
+ * inverses are peeled off from it with two multiplications each. The prefix
+ * products go into r, so r must not overlap with a. If any a[i] isn't
+ * invertible, all r[i] are 0.
+ */
+template<size_t SIZE_IN_BITS, typename EL_T>
+inline void batch_mod_inverse(bui<SIZE_IN_BITS, EL_T> *r, const bui<SIZE_IN_BITS, EL_T> *a, const size_t &count, const montgomery<SIZE_IN_BITS, EL_T> &mont) {
+	if (count == 0) {
+		return;
+	}
+
+	// r[i] = (a[0] * ... * a[i]) * R mod n
+	bui<SIZE_IN_BITS, EL_T> prefix = mont.to_mont(a[0]);
+	r[0] = prefix;
+
+	for (size_t i = 1; i < count; i++) {
+		prefix = mont.mont_mul(prefix, mont.to_mont(a[i]));
+		r[i] = prefix;
+	}
+
+	// (a[0] * ... * a[i])^-1 * R mod n
+	bui<SIZE_IN_BITS, EL_T> inverse = mont.to_mont(mod_inverse(mont.from_mont(prefix), mont.n));
+
+	for (size_t i = count - 1; i > 0; i--) {
+		const bui<SIZE_IN_BITS, EL_T> a_i = mont.to_mont(a[i]);
+
+		r[i] = mont.from_mont(mont.mont_mul(inverse, r[i - 1]));
+		inverse = mont.mont_mul(inverse, a_i);
+	}
+
+	r[0] = mont.from_mont(inverse);
+}
+
+template<size_t SIZE_IN_BITS, typename EL_T>
+inline void batch_mod_inverse(bui<SIZE_IN_BITS, EL_T> *r, const bui<SIZE_IN_BITS, EL_T> *a, const size_t &count, const bui<SIZE_IN_BITS, EL_T> &n) {
+	batch_mod_inverse(r, a, count, montgomery<SIZE_IN_BITS, EL_T>(n));
+}
+
+/*
+ * Replaces each value of the batch x by its inverse mod n, see
+ * batch_mod_inverse.
+ */
+template<size_t SIZE_IN_BITS, size_t LANES, typename EL_T>
+inline void batch_mod_inverse(bui_batch<SIZE_IN_BITS, LANES, EL_T> &x, const bui<SIZE_IN_BITS, EL_T> &n) {
+	bui<SIZE_IN_BITS, EL_T> values[LANES];
+	bui<SIZE_IN_BITS, EL_T> inverses[LANES];
+
+	for (size_t lane = 0; lane < LANES; lane++) {
+		values[lane] = x.get(lane);
+	}
+
+	batch_mod_inverse(inverses, values, LANES, n);
+
+	for (size_t lane = 0; lane < LANES; lane++) {
+		x.set(lane, inverses[lane]);
+	}
+}
+
+} /* namespace bifsi */
+
+#endif /* BIFSI_GCD_H_ */
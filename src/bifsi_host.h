@@ -0,0 +1,501 @@
+/*
+ * bifsi_host.h
+ * published: 2022-09-04
+ * last change: 2022-09-04
+ *
+ * Copyright 2022 Daniel Strecker
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Multithreaded host side counterpart of the launcher in bifsi_cuda.cuh, for
+ * elementwise arithmetic on large host arrays of bui. The methods of
+ * host::launcher have the same signatures as the ones of cuda::launcher, so
+ * code can switch between the two by changing the type of the launcher.
+ *
+ * The arrays are split into chunks whose inputs and result fit into the L2
+ * cache of a core. Each worker thread starts on its own contiguous range of
+ * chunks and, when that's exhausted, steals the upper half of the remaining
+ * range of another worker, so uneven run times per element (e.g. variable
+ * time division or early exits of Miller-Rabin) don't leave threads idle.
+ *
+ * Memory is placed on the NUMA node of the thread which first writes it.
+ * launcher::allocate() first-touches an array with the same split over the
+ * workers as the initial chunk ranges, so most chunks are processed by a
+ * thread close to their memory.
+ */
+
+#ifndef BIFSI_HOST_H_
+#define BIFSI_HOST_H_
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bifsi.h"
+#include "bifsi_pow.h"
+#include "bifsi_prime.h"
+
+namespace bifsi {
+
+namespace host {
+
+/*
+ * Returns the size of the L2 cache in bytes as reported by the OS, or
+ * 1 MiB if it isn't available.
+ */
+inline size_t l2_cache_size() {
+#ifdef _SC_LEVEL2_CACHE_SIZE
+	const long size = sysconf(_SC_LEVEL2_CACHE_SIZE);
+
+	if (size > 0) {
+		return (size_t) size;
+	}
+#endif
+
+	return (size_t) 1 << 20;
+}
+
+/**
+ * Host side launcher for elementwise operations on host arrays of bui
+ * values, with a pool of worker threads. The calling thread works as one of
+ * the workers, so thread_count includes it and thread_count 1 computes
+ * everything on the calling thread.
+ *
+ * The chunk size of a call is the number of elements whose inputs and result
+ * fit into cache_size bytes, but at least 1, and at most such that each
+ * worker starts with 4 chunks, so there's something to steal.
+ *
+ * An object of this class keeps its threads until it's destroyed, so it's
+ * meant to be created once and used for many calls. The calls are
+ * synchronous, i.e. all results are in the output array when they return,
+ * and must not be made concurrently on the same object.
+ */
+class launcher {
+public:
+	inline launcher(size_t thread_count = std::max(1U, std::thread::hardware_concurrency()), size_t cache_size = l2_cache_size()) :
+			cache_size(cache_size), ranges(thread_count) {
+		assert(thread_count > 0);
+		assert(cache_size > 0);
+
+		for (size_t i = 1; i < thread_count; i++) {
+			threads.emplace_back(&launcher::worker, this, i);
+		}
+	}
+
+	launcher(const launcher&) = delete;
+	launcher& operator=(const launcher&) = delete;
+
+	inline ~launcher() {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stopping = true;
+		}
+
+		start_cv.notify_all();
+
+		for (std::thread &t : threads) {
+			t.join();
+		}
+	}
+
+	inline size_t thread_count() const {
+		return ranges.size();
+	}
+
+	/*
+	 * Allocates an uninitialized array of count objects of type T, aligned to
+	 * cache lines, and zeroes it with the workers, each one the part it
+	 * starts on in a call with count elements. Release it with deallocate().
+	 */
+	template<typename T>
+	inline T* allocate(size_t count) {
+		static_assert(std::is_trivially_copyable_v<T>, "constraint not fulfilled: std::is_trivially_copyable_v<T>");
+
+		constexpr size_t ALIGNMENT = 64;
+
+		const size_t bytes = std::max(ALIGNMENT, (count * sizeof(T) + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT);
+
+		T *result = static_cast<T*>(std::aligned_alloc(ALIGNMENT, bytes));
+
+		if (result == nullptr) {
+			throw std::bad_alloc();
+		}
+
+		run(result, (const T*) nullptr, (const T*) nullptr, count, [](T *r, const T*, const T*, size_t n) {
+			std::memset((void*) r, 0, n * sizeof(T));
+		});
+
+		return result;
+	}
+
+	template<typename T>
+	inline void deallocate(T *p) {
+		std::free((void*) p);
+	}
+
+	/*
+	 * r[i] = a[i] + b[i] for i < count. r may be a.
+	 */
+	template<size_t SIZE_IN_BITS, typename EL_T>
+	inline void add(bui<SIZE_IN_BITS, EL_T> *r, const bui<SIZE_IN_BITS, EL_T> *a, const bui<SIZE_IN_BITS, EL_T> *b, size_t count) {
+		constexpr size_t N = bui<SIZE_IN_BITS, EL_T>::SIZE_IN_ELS;
+
+		run(r, a, b, count, [](bui<SIZE_IN_BITS, EL_T> *cr, const bui<SIZE_IN_BITS, EL_T> *ca, const bui<SIZE_IN_BITS, EL_T> *cb, size_t n) {
+			for (size_t i = 0; i < n; i++) {
+				bui<SIZE_IN_BITS, EL_T> x = ca[i];
+				els_add<N, N>(x.el, cb[i].el);
+				cr[i] = x;
+			}
+		});
+	}
+
+	/*
+	 * r[i] = a[i] * b[i] for i < count. r may be a.
+	 */
+	template<size_t SIZE_IN_BITS, typename EL_T>
+	inline void mul(bui<SIZE_IN_BITS, EL_T> *r, const bui<SIZE_IN_BITS, EL_T> *a, const bui<SIZE_IN_BITS, EL_T> *b, size_t count) {
+		run(r, a, b, count, [](bui<SIZE_IN_BITS, EL_T> *cr, const bui<SIZE_IN_BITS, EL_T> *ca, const bui<SIZE_IN_BITS, EL_T> *cb, size_t n) {
+			for (size_t i = 0; i < n; i++) {
+				bui<SIZE_IN_BITS, EL_T> x = ca[i];
+				x *= cb[i];
+				cr[i] = x;
+			}
+		});
+	}
+
+	/*
+	 * r[i] = a[i] mod b[i] for i < count. r may be a. Unlike the CUDA kernel,
+	 * this uses the variable time divmod, because threads on the host don't
+	 * diverge.
+	 */
+	template<size_t SIZE_IN_BITS, typename EL_T>
+	inline void mod(bui<SIZE_IN_BITS, EL_T> *r, const bui<SIZE_IN_BITS, EL_T> *a, const bui<SIZE_IN_BITS, EL_T> *b, size_t count) {
+		run(r, a, b, count, [](bui<SIZE_IN_BITS, EL_T> *cr, const bui<SIZE_IN_BITS, EL_T> *ca, const bui<SIZE_IN_BITS, EL_T> *cb, size_t n) {
+			for (size_t i = 0; i < n; i++) {
+				cr[i] = divmod(ca[i], cb[i]).r;
+			}
+		});
+	}
+
+	/*
+	 * r[i] = base[i]^exp[i] mod n for i < count, with n being the modulus of
+	 * mont. r may be base.
+	 */
+	template<size_t SIZE_IN_BITS, size_t EXP_BITS, typename EL_T>
+	inline void mod_pow(bui<SIZE_IN_BITS, EL_T> *r, const bui<SIZE_IN_BITS, EL_T> *base, const bui<EXP_BITS, EL_T> *exp, size_t count, const montgomery<SIZE_IN_BITS, EL_T> &mont) {
+		run(r, base, exp, count, [&mont](bui<SIZE_IN_BITS, EL_T> *cr, const bui<SIZE_IN_BITS, EL_T> *ca, const bui<EXP_BITS, EL_T> *cb, size_t n) {
+			for (size_t i = 0; i < n; i++) {
+				cr[i] = mont.mod_pow(ca[i], cb[i]);
+			}
+		});
+	}
+
+	/*
+	 * r[i] = g^exp[i] mod n for i < count, with n being the modulus of mont
+	 * and table being computed for g with mont. All threads share the table.
+	 */
+	template<size_t SIZE_IN_BITS, size_t EXP_BITS, size_t TEETH, typename EL_T>
+	inline void fixed_base_mod_pow(bui<SIZE_IN_BITS, EL_T> *r, const bui<EXP_BITS, EL_T> *exp, size_t count, const montgomery<SIZE_IN_BITS, EL_T> &mont, const fixed_base_table<SIZE_IN_BITS, EXP_BITS, TEETH, EL_T> &table) {
+		run(r, exp, (const uint8_t*) nullptr, count, [&mont, &table](bui<SIZE_IN_BITS, EL_T> *cr, const bui<EXP_BITS, EL_T> *ce, const uint8_t*, size_t n) {
+			for (size_t i = 0; i < n; i++) {
+				cr[i] = table.mod_pow(mont, ce[i]);
+			}
+		});
+	}
+
+	/*
+	 * Returns prod_{i < count} bases[i]^exps[i] mod n, with n being the
+	 * modulus of mont. The terms are split into one slice per thread, but at
+	 * least MULTI_POW_MIN_SLICE_SIZE terms per slice. Each slice is computed
+	 * with multi_pow, then the products of the slices are multiplied.
+	 */
+	template<size_t SIZE_IN_BITS, size_t EXP_BITS, typename EL_T>
+	inline bui<SIZE_IN_BITS, EL_T> multi_pow(const bui<SIZE_IN_BITS, EL_T> *bases, const bui<EXP_BITS, EL_T> *exps, size_t count, const montgomery<SIZE_IN_BITS, EL_T> &mont) {
+		const size_t slice_count = std::max((size_t) 1, std::min(thread_count(), count / MULTI_POW_MIN_SLICE_SIZE));
+		const size_t slice_size = (count + slice_count - 1) / slice_count;
+
+		std::vector<bui<SIZE_IN_BITS, EL_T>> partial(slice_count);
+		bui<SIZE_IN_BITS, EL_T> *partial_begin = partial.data();
+
+		run(partial_begin, (const uint8_t*) nullptr, (const uint8_t*) nullptr, slice_count, [&](bui<SIZE_IN_BITS, EL_T> *cr, const uint8_t*, const uint8_t*, size_t n) {
+			for (size_t i = 0; i < n; i++) {
+				const size_t begin = std::min(count, (size_t) (cr + i - partial_begin) * slice_size);
+				const size_t end = std::min(count, begin + slice_size);
+
+				cr[i] = bifsi::multi_pow(mont, bases + begin, exps + begin, end - begin);
+			}
+		});
+
+		bui<SIZE_IN_BITS, EL_T> result = mont.one;
+
+		for (const bui<SIZE_IN_BITS, EL_T> &p : partial) {
+			result = mont.mont_mul(result, mont.to_mont(p));
+		}
+
+		return mont.from_mont(result);
+	}
+
+	/*
+	 * r[i] = 1 if n[i] is a strong probable prime to the first ROUNDS bases of
+	 * prime::miller_rabin_base, else 0, for i < count. See
+	 * prime::miller_rabin for the requirements on n[i].
+	 */
+	template<size_t ROUNDS = 16, size_t SIZE_IN_BITS, typename EL_T>
+	inline void miller_rabin(uint8_t *r, const bui<SIZE_IN_BITS, EL_T> *n, size_t count) {
+		run(r, n, (const uint8_t*) nullptr, count, [](uint8_t *cr, const bui<SIZE_IN_BITS, EL_T> *cn, const uint8_t*, size_t n) {
+			for (size_t i = 0; i < n; i++) {
+				cr[i] = (uint8_t) prime::miller_rabin<ROUNDS>(cn[i]);
+			}
+		});
+	}
+
+	/*
+	 * r[i] = a[i].str() for i < count.
+	 */
+	template<size_t SIZE_IN_BITS, typename EL_T>
+	inline void str(std::string *r, const bui<SIZE_IN_BITS, EL_T> *a, size_t count) {
+		run(r, a, (const uint8_t*) nullptr, count, [](std::string *cr, const bui<SIZE_IN_BITS, EL_T> *ca, const uint8_t*, size_t n) {
+			for (size_t i = 0; i < n; i++) {
+				cr[i] = ca[i].str();
+			}
+		});
+	}
+
+	/*
+	 * Runs process on all chunks of the arrays a and b, with the results going
+	 * to r, which is what the operations above are made of, and can be used
+	 * for other elementwise operations the same way. b may be nullptr for
+	 * operations with one input, and a too, then process gets nullptr instead
+	 * of the chunk of the input. The chunks don't overlap and process reads an
+	 * element before writing its result, so r may be a.
+	 *
+	 * If process throws, the chunks which haven't been started yet are
+	 * skipped, and the first exception is rethrown once all threads are done
+	 * with process, so only a part of r has been written then.
+	 */
+	template<typename R_T, typename A_T, typename B_T, typename PROCESS_T>
+	inline void run(R_T *r, const A_T *a, const B_T *b, const size_t &count, const PROCESS_T &process) {
+		if (count == 0) {
+			return;
+		}
+
+		const size_t workers = ranges.size();
+
+		const size_t bytes_per_el = sizeof(R_T) + ((a != nullptr) ? sizeof(A_T) : 0) + ((b != nullptr) ? sizeof(B_T) : 0);
+		const size_t max_balanced_chunk_size = (count + 4 * workers - 1) / (4 * workers);
+		const size_t chunk_size = std::max((size_t) 1, std::min(cache_size / bytes_per_el, max_balanced_chunk_size));
+		const size_t chunk_count = (count + chunk_size - 1) / chunk_size;
+
+		for (size_t w = 0; w < workers; w++) {
+			ranges[w].begin = chunk_count * w / workers;
+			ranges[w].end = chunk_count * (w + 1) / workers;
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+
+			job = [&](size_t chunk_idx) {
+				const size_t begin = chunk_idx * chunk_size;
+				const size_t n = std::min(chunk_size, count - begin);
+
+				process(r + begin, (a != nullptr) ? a + begin : nullptr, (b != nullptr) ? b + begin : nullptr, n);
+			};
+
+			busy = workers - 1;
+			generation++;
+		}
+
+		start_cv.notify_all();
+
+		work(0);
+
+		std::unique_lock<std::mutex> lock(mutex);
+		done_cv.wait(lock, [&]() {
+			return busy == 0;
+		});
+
+		job = nullptr;
+
+		if (error) {
+			std::exception_ptr e = nullptr;
+			std::swap(e, error);
+
+			std::rethrow_exception(e);
+		}
+	}
+private:
+	/*
+	 * The chunks [begin, end) a worker hasn't started yet. The owner takes
+	 * chunks from the front, thieves take the upper half.
+	 */
+	struct chunk_range {
+		std::mutex mutex;
+		size_t begin = 0;
+		size_t end = 0;
+	};
+
+	size_t cache_size;
+
+	std::vector<chunk_range> ranges;
+
+	std::vector<std::thread> threads;
+
+	std::mutex mutex;
+	std::condition_variable start_cv;
+	std::condition_variable done_cv;
+
+	// incremented for each call, so the workers see that a new one started
+	size_t generation = 0;
+
+	// number of worker threads, i.e. not the calling one, still in the call
+	size_t busy = 0;
+
+	bool stopping = false;
+
+	std::function<void(size_t)> job;
+
+	// the first exception thrown by job in the current call
+	std::exception_ptr error;
+
+	/*
+	 * Takes the next chunk of worker w into chunk_idx.
+	 */
+	inline bool pop(const size_t &w, size_t &chunk_idx) {
+		chunk_range &cr = ranges[w];
+		std::lock_guard<std::mutex> lock(cr.mutex);
+
+		if (cr.begin == cr.end) {
+			return false;
+		}
+
+		chunk_idx = cr.begin++;
+
+		return true;
+	}
+
+	/*
+	 * Moves the upper half, rounded up, of the remaining chunks of another
+	 * worker to the empty range of worker w. Returns false if all other
+	 * ranges are empty, which means that there's no more work in this call.
+	 */
+	inline bool steal(const size_t &w) {
+		const size_t count = ranges.size();
+
+		for (size_t i = 1; i < count; i++) {
+			chunk_range &victim = ranges[(w + i) % count];
+
+			size_t begin;
+			size_t end;
+
+			{
+				std::lock_guard<std::mutex> lock(victim.mutex);
+
+				if (victim.begin == victim.end) {
+					continue;
+				}
+
+				end = victim.end;
+				begin = victim.end - (victim.end - victim.begin + 1) / 2;
+				victim.end = begin;
+			}
+
+			chunk_range &own = ranges[w];
+			std::lock_guard<std::mutex> lock(own.mutex);
+
+			own.begin = begin;
+			own.end = end;
+
+			return true;
+		}
+
+		return false;
+	}
+
+	/*
+	 * Runs job on the chunks of worker w and then on stolen ones, until there
+	 * are none left. An exception of job is stored in error, and the chunks
+	 * of all workers are dropped, so the call ends early.
+	 */
+	inline void work(const size_t &w) {
+		try {
+			size_t chunk_idx;
+
+			do {
+				while (pop(w, chunk_idx)) {
+					job(chunk_idx);
+				}
+			} while (steal(w));
+		} catch (...) {
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+
+				if (!error) {
+					error = std::current_exception();
+				}
+			}
+
+			for (chunk_range &cr : ranges) {
+				std::lock_guard<std::mutex> lock(cr.mutex);
+				cr.begin = cr.end;
+			}
+		}
+	}
+
+	inline void worker(const size_t w) {
+		size_t seen_generation = 0;
+
+		while (true) {
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				start_cv.wait(lock, [&]() {
+					return stopping || generation != seen_generation;
+				});
+
+				if (stopping) {
+					return;
+				}
+
+				seen_generation = generation;
+			}
+
+			work(w);
+
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+
+				if (--busy == 0) {
+					done_cv.notify_one();
+				}
+			}
+		}
+	}
+};
+
+} /* namespace host */
+
+} /* namespace bifsi */
+
+#endif /* BIFSI_HOST_H_ */
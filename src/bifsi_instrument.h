@@ -0,0 +1,462 @@
+/*
+ * bifsi_instrument.h
+ * published: 2022-09-04
+ * last change: 2022-09-04
+ *
+ * Copyright 2022 Daniel Strecker
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Opt-in counters for the expensive operations of bifsi.h, for finding out
+ * where the time goes without a profiler. bifsi.h includes this file if
+ * BIFSI_INSTRUMENT is defined before including bifsi.h, it's not meant to be
+ * included directly. Without BIFSI_INSTRUMENT, the hooks
+ * BIFSI_INSTRUMENT_BEGIN and BIFSI_INSTRUMENT_END in the operations are
+ * defined empty, i.e. they are 0 instructions.
+ *
+ * Each instrumented operation counts its calls and its limb operations, an
+ * estimate of the work by the sizes of the operands, see op. With
+ * BIFSI_INSTRUMENT_CYCLES defined too, one of every
+ * 2^BIFSI_INSTRUMENT_SAMPLE_BITS calls is also timed, with rdtsc on x86,
+ * clock64() on CUDA devices, and with std::chrono::steady_clock in
+ * nanoseconds elsewhere. The times are inclusive, e.g. the time of mod_pow
+ * contains the time of its mont_mul calls, which are counted as mont_mul as
+ * well.
+ *
+ * On the host, each thread has its own counters, which only it writes, so
+ * counting needs no locks or atomic read-modify-write operations. collect()
+ * sums the counters of all threads, including those of threads which have
+ * ended. On CUDA devices, all threads add to the counters of the translation
+ * unit in device memory with atomicAdd, see collect_device().
+ *
+ * Operations which are evaluated at compile time aren't counted.
+ */
+
+#ifndef BIFSI_INSTRUMENT_H_
+#define BIFSI_INSTRUMENT_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <mutex>
+#include <ostream>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#ifdef __NVCC__
+#include <cuda_runtime.h>
+#include <stdexcept>
+#include <string>
+#endif
+
+#ifndef BIFSI_INSTRUMENT_SAMPLE_BITS
+#define BIFSI_INSTRUMENT_SAMPLE_BITS 0
+#endif
+
+namespace bifsi {
+
+namespace instrument {
+
+/*
+ * The instrumented operations. The limb operations of a call are:
+ *
+ * mul: the element by element products of the schoolbook method for the
+ *   kept elements of the product, for operator*= by a big int or an integer
+ *   and mul_full,
+ * sqr: like mul, for square and sqr,
+ * div: the quotient elements times the divisor elements, for operator/=,
+ *   operator%=, operator% and divmod, also by an el_t or a divisor,
+ * mont_mul, mont_sqr: the element by element products of the product and the
+ *   reduction, mont_sqr for the squares which don't use mont_mul, see
+ *   montgomery::mont_sqr,
+ * mod_pow, str, from_chars: the elements of the value, as these consist of
+ *   operations which are counted themselves, or of element operations.
+ */
+enum class op {
+	mul, sqr, div, mont_mul, mont_sqr, mod_pow, str, from_chars
+};
+
+const size_t OP_COUNT = 8;
+
+/*
+ * Returns the name of o, which is the name of the enumerator.
+ */
+inline const char* op_name(const op &o) {
+	static const char *const NAMES[OP_COUNT] = { "mul", "sqr", "div", "mont_mul", "mont_sqr", "mod_pow", "str", "from_chars" };
+
+	return NAMES[(size_t) o];
+}
+
+/*
+ * Counters of one operation. cycles is the sum of the times of the sampled
+ * calls, so cycles / samples is the mean time of a call.
+ */
+struct count {
+	uint64_t calls = 0;
+	uint64_t limb_ops = 0;
+	uint64_t samples = 0;
+	uint64_t cycles = 0;
+
+	inline count& operator+=(const count &b) {
+		calls += b.calls;
+		limb_ops += b.limb_ops;
+		samples += b.samples;
+		cycles += b.cycles;
+
+		return *this;
+	}
+};
+
+/*
+ * The counters of all operations, indexed by op.
+ */
+struct counts {
+	count ops[OP_COUNT];
+
+	inline count& operator[](const op &o) {
+		return ops[(size_t) o];
+	}
+
+	inline const count& operator[](const op &o) const {
+		return ops[(size_t) o];
+	}
+
+	inline counts& operator+=(const counts &b) {
+		for (size_t i = 0; i < OP_COUNT; i++) {
+			ops[i] += b.ops[i];
+		}
+
+		return *this;
+	}
+};
+
+/*
+ * Returns the current time stamp for the cycle samples.
+ */
+__host__ __device__
+inline uint64_t timestamp() {
+#ifdef __CUDA_ARCH__
+	return (uint64_t) clock64();
+#elif defined(__x86_64__) || defined(__i386__)
+	return (uint64_t) __rdtsc();
+#else
+	return (uint64_t) std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+/*
+ * Counters of one operation in a thread. Only the owning thread writes them,
+ * with plain loads and stores, and collect() may read them concurrently.
+ */
+struct thread_count {
+	std::atomic<uint64_t> calls { 0 };
+	std::atomic<uint64_t> limb_ops { 0 };
+	std::atomic<uint64_t> samples { 0 };
+	std::atomic<uint64_t> cycles { 0 };
+};
+
+/*
+ * Adds x to a counter of the own thread.
+ */
+inline void add_relaxed(std::atomic<uint64_t> &counter, const uint64_t &x) {
+	counter.store(counter.load(std::memory_order_relaxed) + x, std::memory_order_relaxed);
+}
+
+struct thread_counts;
+
+/*
+ * The counters of the running threads, and the sum of those of the ended
+ * threads.
+ */
+struct registry {
+	std::mutex mutex;
+	std::vector<thread_counts*> threads;
+	counts ended;
+
+	static inline registry& instance() {
+		static registry result;
+
+		return result;
+	}
+};
+
+/*
+ * Counters of all operations in a thread, registered for its lifetime.
+ */
+struct thread_counts {
+	thread_count ops[OP_COUNT];
+
+	inline thread_counts() {
+		registry &reg = registry::instance();
+		std::lock_guard<std::mutex> lock(reg.mutex);
+
+		reg.threads.push_back(this);
+	}
+
+	thread_counts(const thread_counts&) = delete;
+	thread_counts& operator=(const thread_counts&) = delete;
+
+	inline ~thread_counts() {
+		registry &reg = registry::instance();
+		std::lock_guard<std::mutex> lock(reg.mutex);
+
+		reg.ended += get();
+
+		for (size_t i = 0; i < reg.threads.size(); i++) {
+			if (reg.threads[i] == this) {
+				reg.threads[i] = reg.threads.back();
+				reg.threads.pop_back();
+				break;
+			}
+		}
+	}
+
+	inline counts get() const {
+		counts result;
+
+		for (size_t i = 0; i < OP_COUNT; i++) {
+			result.ops[i].calls = ops[i].calls.load(std::memory_order_relaxed);
+			result.ops[i].limb_ops = ops[i].limb_ops.load(std::memory_order_relaxed);
+			result.ops[i].samples = ops[i].samples.load(std::memory_order_relaxed);
+			result.ops[i].cycles = ops[i].cycles.load(std::memory_order_relaxed);
+		}
+
+		return result;
+	}
+
+	inline void clear() {
+		for (size_t i = 0; i < OP_COUNT; i++) {
+			ops[i].calls.store(0, std::memory_order_relaxed);
+			ops[i].limb_ops.store(0, std::memory_order_relaxed);
+			ops[i].samples.store(0, std::memory_order_relaxed);
+			ops[i].cycles.store(0, std::memory_order_relaxed);
+		}
+	}
+
+	static inline thread_counts& instance() {
+		// destroyed before the registry, even in the main thread, because all
+		// objects with thread storage duration are destroyed before the
+		// static ones
+		static thread_local thread_counts result;
+
+		return result;
+	}
+};
+
+#ifdef __NVCC__
+/*
+ * Counters of all operations on the device, for the kernels of this
+ * translation unit. The fields are unsigned long long for atomicAdd.
+ */
+struct device_counts {
+	unsigned long long calls[OP_COUNT];
+	unsigned long long limb_ops[OP_COUNT];
+	unsigned long long samples[OP_COUNT];
+	unsigned long long cycles[OP_COUNT];
+};
+
+static __device__ device_counts device_counters;
+#endif
+
+/*
+ * Returns the time stamp of the begin of a call of o, if it's a sample, else
+ * 0. See BIFSI_INSTRUMENT_BEGIN.
+ */
+__host__ __device__
+inline uint64_t begin(const op &o) {
+#ifdef BIFSI_INSTRUMENT_CYCLES
+	constexpr uint64_t SAMPLE_MASK = (((uint64_t) 1) << BIFSI_INSTRUMENT_SAMPLE_BITS) - 1;
+
+#ifdef __CUDA_ARCH__
+	const uint64_t calls = device_counters.calls[(size_t) o];
+#else
+	const uint64_t calls = thread_counts::instance().ops[(size_t) o].calls.load(std::memory_order_relaxed);
+#endif
+
+	// never 0 for a sample, at the cost of at most 1 cycle
+	return ((calls & SAMPLE_MASK) == 0) ? timestamp() | 1 : 0;
+#else
+	(void) o;
+
+	return 0;
+#endif
+}
+
+/*
+ * Counts a call of o with limb_ops limb operations, and its time if
+ * begin_timestamp isn't 0. See BIFSI_INSTRUMENT_END.
+ */
+__host__ __device__
+inline void end(const op &o, const uint64_t &limb_ops, const uint64_t &begin_timestamp) {
+	const uint64_t cycles = (begin_timestamp != 0) ? timestamp() - begin_timestamp : 0;
+
+#ifdef __CUDA_ARCH__
+	atomicAdd(&device_counters.calls[(size_t) o], 1ULL);
+	atomicAdd(&device_counters.limb_ops[(size_t) o], (unsigned long long) limb_ops);
+
+	if (begin_timestamp != 0) {
+		atomicAdd(&device_counters.samples[(size_t) o], 1ULL);
+		atomicAdd(&device_counters.cycles[(size_t) o], (unsigned long long) cycles);
+	}
+#else
+	thread_count &c = thread_counts::instance().ops[(size_t) o];
+
+	add_relaxed(c.calls, 1);
+	add_relaxed(c.limb_ops, limb_ops);
+
+	if (begin_timestamp != 0) {
+		add_relaxed(c.samples, 1);
+		add_relaxed(c.cycles, cycles);
+	}
+#endif
+}
+
+/*
+ * Returns the sum of the counters of all host threads since the start of the
+ * program or the last reset().
+ */
+inline counts collect() {
+	registry &reg = registry::instance();
+	std::lock_guard<std::mutex> lock(reg.mutex);
+
+	counts result = reg.ended;
+
+	for (const thread_counts *t : reg.threads) {
+		result += t->get();
+	}
+
+	return result;
+}
+
+/*
+ * Sets the counters of all host threads to 0. The counters of threads which
+ * are in an instrumented operation at the same time may be left incomplete.
+ */
+inline void reset() {
+	registry &reg = registry::instance();
+	std::lock_guard<std::mutex> lock(reg.mutex);
+
+	reg.ended = counts();
+
+	for (thread_counts *t : reg.threads) {
+		t->clear();
+	}
+}
+
+#ifdef __NVCC__
+/*
+ * Returns the counters of the kernels of this translation unit since the
+ * start of the program or the last reset_device(). Call it after the
+ * kernels have finished.
+ */
+inline counts collect_device() {
+	device_counts d;
+
+	const cudaError_t err = cudaMemcpyFromSymbol(&d, device_counters, sizeof(d));
+
+	if (err != cudaSuccess) {
+		throw std::runtime_error(std::string("cudaMemcpyFromSymbol: ") + cudaGetErrorString(err));
+	}
+
+	counts result;
+
+	for (size_t i = 0; i < OP_COUNT; i++) {
+		result.ops[i].calls = d.calls[i];
+		result.ops[i].limb_ops = d.limb_ops[i];
+		result.ops[i].samples = d.samples[i];
+		result.ops[i].cycles = d.cycles[i];
+	}
+
+	return result;
+}
+
+/*
+ * Sets the device counters of this translation unit to 0.
+ */
+inline void reset_device() {
+	const device_counts d = { };
+
+	const cudaError_t err = cudaMemcpyToSymbol(device_counters, &d, sizeof(d));
+
+	if (err != cudaSuccess) {
+		throw std::runtime_error(std::string("cudaMemcpyToSymbol: ") + cudaGetErrorString(err));
+	}
+}
+#endif
+
+/*
+ * Writes one line per operation with calls to os, with the calls, the limb
+ * operations and, for sampled operations, the mean time per call.
+ */
+inline void dump(std::ostream &os, const counts &c) {
+	os << std::left << std::setw(12) << "op" << std::right << std::setw(16) << "calls" << std::setw(20) << "limb_ops" << std::setw(12) << "samples" << std::setw(16) << "cycles/call" << std::endl;
+
+	for (size_t i = 0; i < OP_COUNT; i++) {
+		const count &x = c.ops[i];
+
+		if (x.calls == 0) {
+			continue;
+		}
+
+		os << std::left << std::setw(12) << op_name((op) i) << std::right << std::setw(16) << x.calls << std::setw(20) << x.limb_ops << std::setw(12) << x.samples << std::setw(16);
+
+		if (x.samples != 0) {
+			os << x.cycles / x.samples;
+		} else {
+			os << "-";
+		}
+
+		os << std::endl;
+	}
+}
+
+/*
+ * Writes the counters of all host threads to os, see collect().
+ */
+inline void dump(std::ostream &os) {
+	dump(os, collect());
+}
+
+} /* namespace instrument */
+
+} /* namespace bifsi */
+
+/*
+ * Begins a call of an instrumented operation. With BIFSI_INSTRUMENT_END, this
+ * encloses the part of the operation which runs at run time. The time stamp
+ * isn't const, because the initializer of a const integer would be evaluated
+ * as a constant expression first, where BIFSI_IS_CONSTANT_EVALUATED() is
+ * true.
+ */
+#define BIFSI_INSTRUMENT_BEGIN(OP) \
+	uint64_t bifsi_instrument_begin = BIFSI_IS_CONSTANT_EVALUATED() ? 0 : ::bifsi::instrument::begin(::bifsi::instrument::op::OP)
+
+/*
+ * Ends a call of an instrumented operation with LIMB_OPS limb operations,
+ * see op. Must be in the scope of BIFSI_INSTRUMENT_BEGIN.
+ */
+#define BIFSI_INSTRUMENT_END(OP, LIMB_OPS) \
+	do { \
+		if (!BIFSI_IS_CONSTANT_EVALUATED()) { \
+			::bifsi::instrument::end(::bifsi::instrument::op::OP, (uint64_t) (LIMB_OPS), bifsi_instrument_begin); \
+		} \
+	} while (false)
+
+#endif /* BIFSI_INSTRUMENT_H_ */
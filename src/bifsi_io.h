@@ -0,0 +1,256 @@
+/*
+ * bifsi_io.h
+ * published: 2022-09-04
+ * last change: 2022-09-04
+ *
+ * Copyright 2022 Daniel Strecker
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Binary array files of bui or bui_batch records, which are read by mapping
+ * the file into memory instead of parsing it. The file is a header of
+ * DATA_OFFSET bytes followed by the records exactly as they are in memory, so
+ * the mapped records can be used in place as an array of bui or bui_batch,
+ * e.g. as the source of a cudaMemcpy or for host::launcher.
+ *
+ * Because the records are in the memory layout of the host which wrote the
+ * file, the header stores the byte order, the element size, the size in bits,
+ * the number of lanes and the size of a record, and mapped_array_file only
+ * accepts files which match the record type it's instantiated with. For an
+ * exchange format between hosts of different byte order, use bui::to_bytes.
+ *
+ * Layout, all integers in the byte order of the writer:
+ *
+ * offset  size  field
+ *      0     8  magic "BIFSIARR"
+ *      8     4  version, 1
+ *     12     4  byte order mark, 0x01020304
+ *     16     4  size in bits of a value
+ *     20     4  size in bytes of an element
+ *     24     4  lanes per record, 1 for bui
+ *     28     4  size in bytes of a record
+ *     32     8  number of records
+ *     40     8  offset of the first record, DATA_OFFSET
+ *     48  4048  zero
+ *   4096        records
+ */
+
+#ifndef BIFSI_IO_H_
+#define BIFSI_IO_H_
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+
+#include "bifsi.h"
+#include "bifsi_batch.h"
+
+namespace bifsi {
+
+namespace io {
+
+/*
+ * Offset of the first record in an array file. A page, so the records of a
+ * mapped file are page aligned, which is more than the alignment of any
+ * record type.
+ */
+constexpr size_t DATA_OFFSET = 4096;
+
+constexpr uint32_t VERSION = 1;
+
+constexpr uint32_t BYTE_ORDER_MARK = 0x01020304;
+
+struct array_file_header {
+	char magic[8];
+	uint32_t version;
+	uint32_t byte_order_mark;
+	uint32_t size_in_bits;
+	uint32_t el_size;
+	uint32_t lanes;
+	uint32_t record_size;
+	uint64_t count;
+	uint64_t data_offset;
+};
+
+static_assert(sizeof(array_file_header) == 48, "constraint not fulfilled: sizeof(array_file_header) == 48");
+
+/*
+ * Properties of the record types of array files, for the header fields.
+ */
+template<typename T>
+struct record_traits;
+
+template<size_t SIZE_IN_BITS, typename EL_T>
+struct record_traits<bui<SIZE_IN_BITS, EL_T>> {
+	static const size_t SIZE = SIZE_IN_BITS;
+	typedef EL_T el_t;
+	static const size_t LANES = 1;
+};
+
+template<size_t SIZE_IN_BITS, size_t LANES_, typename EL_T>
+struct record_traits<bui_batch<SIZE_IN_BITS, LANES_, EL_T>> {
+	static const size_t SIZE = SIZE_IN_BITS;
+	typedef EL_T el_t;
+	static const size_t LANES = LANES_;
+};
+
+/*
+ * Returns the header of an array file of count records of type T.
+ */
+template<typename T>
+inline array_file_header make_header(const size_t &count) {
+	array_file_header result = { };
+
+	std::memcpy(result.magic, "BIFSIARR", sizeof(result.magic));
+	result.version = VERSION;
+	result.byte_order_mark = BYTE_ORDER_MARK;
+	result.size_in_bits = (uint32_t) record_traits<T>::SIZE;
+	result.el_size = (uint32_t) sizeof(typename record_traits<T>::el_t);
+	result.lanes = (uint32_t) record_traits<T>::LANES;
+	result.record_size = (uint32_t) sizeof(T);
+	result.count = count;
+	result.data_offset = DATA_OFFSET;
+
+	return result;
+}
+
+/*
+ * Writes the count records at records to a new array file at path, or
+ * replaces the file. Throws std::runtime_error if writing fails.
+ */
+template<typename T>
+inline void write_array_file(const std::string &path, const T *records, const size_t &count) {
+	static_assert(std::is_trivially_copyable_v<T>, "constraint not fulfilled: std::is_trivially_copyable_v<T>");
+
+	unsigned char header[DATA_OFFSET] = { };
+
+	const array_file_header h = make_header<T>(count);
+	std::memcpy(header, &h, sizeof(h));
+
+	std::FILE *f = std::fopen(path.c_str(), "wb");
+
+	if (f == nullptr) {
+		throw std::runtime_error("cannot create " + path + ": " + std::strerror(errno));
+	}
+
+	bool ok = std::fwrite(header, 1, DATA_OFFSET, f) == DATA_OFFSET;
+	ok = ok && (count == 0 || std::fwrite(records, sizeof(T), count, f) == count);
+	ok = (std::fclose(f) == 0) && ok;
+
+	if (!ok) {
+		throw std::runtime_error("cannot write " + path);
+	}
+}
+
+/**
+ * Read only mapping of an array file with records of type T, so data() points
+ * directly into the page cache and nothing is copied or parsed. The
+ * constructor throws std::runtime_error if the file can't be mapped, or if
+ * its header doesn't match T, e.g. a different size, element type or byte
+ * order.
+ */
+template<typename T>
+class mapped_array_file {
+	static_assert(std::is_trivially_copyable_v<T>, "constraint not fulfilled: std::is_trivially_copyable_v<T>");
+
+public:
+	inline explicit mapped_array_file(const std::string &path) {
+		const int fd = ::open(path.c_str(), O_RDONLY);
+
+		if (fd < 0) {
+			throw std::runtime_error("cannot open " + path + ": " + std::strerror(errno));
+		}
+
+		struct stat st;
+
+		if (::fstat(fd, &st) != 0 || (size_t) st.st_size < DATA_OFFSET) {
+			::close(fd);
+			throw std::runtime_error(path + " is no array file");
+		}
+
+		map_size = (size_t) st.st_size;
+		map = ::mmap(nullptr, map_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+		::close(fd);
+
+		if (map == MAP_FAILED) {
+			throw std::runtime_error("cannot map " + path + ": " + std::strerror(errno));
+		}
+
+		array_file_header h;
+		std::memcpy(&h, map, sizeof(h));
+
+		const array_file_header expected = make_header<T>(h.count);
+
+		if (std::memcmp(&h, &expected, sizeof(h)) != 0 || (map_size - DATA_OFFSET) / sizeof(T) < h.count) {
+			::munmap(map, map_size);
+			throw std::runtime_error(path + " is no array file of " + std::to_string(record_traits<T>::SIZE) + " bit values with " + std::to_string(sizeof(typename record_traits<T>::el_t)) + " byte elements and " + std::to_string(record_traits<T>::LANES) + " lanes in the byte order of this host");
+		}
+
+		count = (size_t) h.count;
+	}
+
+	mapped_array_file(const mapped_array_file&) = delete;
+	mapped_array_file& operator=(const mapped_array_file&) = delete;
+
+	inline ~mapped_array_file() {
+		::munmap(map, map_size);
+	}
+
+	inline const T* data() const {
+		return reinterpret_cast<const T*>(static_cast<const unsigned char*>(map) + DATA_OFFSET);
+	}
+
+	/*
+	 * Number of records, i.e. LANES values each for bui_batch.
+	 */
+	inline size_t size() const {
+		return count;
+	}
+
+	inline const T& operator[](const size_t &i) const {
+		assert(i < count);
+		return data()[i];
+	}
+
+	inline const T* begin() const {
+		return data();
+	}
+
+	inline const T* end() const {
+		return data() + count;
+	}
+
+private:
+	void *map = nullptr;
+	size_t map_size = 0;
+	size_t count = 0;
+};
+
+} /* namespace io */
+
+} /* namespace bifsi */
+
+#endif /* BIFSI_IO_H_ */
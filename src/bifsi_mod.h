@@ -0,0 +1,559 @@
+/*
+ * bifsi_mod.h
+ * published: 2022-09-04
+ * last change: 2022-09-04
+ *
+ * Copyright 2022 Daniel Strecker
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Arithmetic modulo a fixed modulus known at compile time, e.g. the field
+ * primes of elliptic curves. The modulus is given by a type with a static
+ * constexpr bui member named value, which is usually constructed from a
+ * decimal string:
+ *
+ * struct my_modulus {
+ *     static constexpr bifsi::bui<256> value = "1157920892...";
+ * };
+ *
+ * typedef bifsi::mod_bui<256, my_modulus> fe;
+ *
+ * The reduction after a multiplication is chosen at compile time. Moduli of
+ * the special form 2^SIZE_IN_BITS - c with a small or sparse c, like the
+ * pseudo-Mersenne prime of secp256k1 and the Solinas primes of NIST P-256 and
+ * P-384, are reduced by folding, see special_form. All other odd moduli get
+ * Montgomery multiplication. Addition and subtraction use a conditional
+ * subtraction or addition of the modulus, selected with a mask, so no
+ * operation needs a division.
+ */
+
+#ifndef BIFSI_MOD_H_
+#define BIFSI_MOD_H_
+
+#include <stdint.h>
+
+#include <type_traits>
+
+#include "bifsi.h"
+
+namespace bifsi {
+
+/**
+ * Analysis and reduction for moduli n = 2^SIZE_IN_BITS - c. The product x of
+ * two residues is split into digits of D = min(EL_SIZE_IN_BITS, 32) bits. For
+ * each digit position k from SIZE_IN_BITS / D on, 2^(k * D) mod n is written
+ * as a combination of the lower digit positions with small signed
+ * coefficients, which is found at compile time by replacing
+ * 2^SIZE_IN_BITS = c repeatedly. The reduction then adds the high digits of x,
+ * multiplied by these coefficients, to the low digits in signed 64 bit
+ * accumulators. Only the nonzero coefficients are stored, so for the NIST
+ * primes, whose c consists of a few powers of 2^32 with coefficients 1 and -1,
+ * this is the well known reduction by sums and differences of 32 bit words.
+ *
+ * The accumulated value is congruent to x and has a small signed carry into
+ * 2^SIZE_IN_BITS, which is folded twice more with the coefficients of c
+ * itself. This leaves a value less than 2^SIZE_IN_BITS, i.e. less than 2 * n,
+ * and one conditional subtraction of n completes the reduction.
+ *
+ * IS_SPECIAL_FORM tells whether the bounds for this hold, which requires that
+ * the highest bit of n is set, that the accumulators can't overflow and that
+ * (T + 1) * c < 2^SIZE_IN_BITS for the bound T of the carry after the first
+ * pass. Additionally, the coefficients must be sparse enough to be faster than
+ * Montgomery multiplication, see MAX_TERMS_PER_DIGIT.
+ *
+ * Reference: J. A. Solinas, Generalized Mersenne Numbers, CACR technical
+ * report CORR 99-39, 1999.
+ */
+template<size_t SIZE_IN_BITS, typename EL_T>
+struct special_form {
+	static const size_t EL_SIZE_IN_BITS = sizeof(EL_T) * 8;
+	static const size_t D = (EL_SIZE_IN_BITS < 32) ? EL_SIZE_IN_BITS : 32;
+	static const size_t DIGITS_PER_EL = EL_SIZE_IN_BITS / D;
+	static const size_t ND = SIZE_IN_BITS / D;
+	static const size_t N = bui<SIZE_IN_BITS, EL_T>::SIZE_IN_ELS;
+
+	static constexpr uint64_t DIGIT_MASK = (((uint64_t) 1) << D) - 1;
+
+	/*
+	 * Number of nonzero coefficients per digit on average up to which the
+	 * folding is used instead of Montgomery multiplication.
+	 */
+	static const size_t MAX_TERMS_PER_DIGIT = 8;
+
+	/*
+	 * Bound for the sum of the absolute values of the coefficients of one
+	 * digit, so the accumulators stay below 2^62.
+	 */
+	static constexpr int64_t MAX_COEFFICIENT_SUM = ((int64_t) 1) << (61 - D);
+
+	bool is_special_form;
+
+	// the nonzero coefficients: high digit position ND + k[t] goes with
+	// coefficient coef[t] into digit j[t]
+	size_t term_count;
+	uint16_t k[ND * ND];
+	uint16_t j[ND * ND];
+	int64_t coef[ND * ND];
+
+	// the signed digits of c
+	int64_t c[ND];
+
+	/*
+	 * Analyzes n. All of this is done at compile time.
+	 */
+	inline constexpr special_form(const bui<SIZE_IN_BITS, EL_T> &n) :
+			is_special_form(false), term_count(0), k(), j(), coef(), c() {
+		static_assert(SIZE_IN_BITS % EL_SIZE_IN_BITS == 0, "constraint not fulfilled: SIZE_IN_BITS % EL_SIZE_IN_BITS == 0");
+
+		if ((n.el[N - 1] >> (EL_SIZE_IN_BITS - 1)) == 0) {
+			return;
+		}
+
+		// c = 2^SIZE_IN_BITS - n in balanced digits in [-2^(D - 1), 2^(D - 1)]
+		int64_t borrow = 0;
+		int64_t carry = 0;
+
+		for (size_t i = 0; i < ND; i++) {
+			const int64_t n_digit = (int64_t) digit(n.el, i);
+			int64_t d = -n_digit - borrow;
+			borrow = (d < 0);
+			d += (int64_t) (borrow << D);
+
+			d += carry;
+			carry = (d > ((int64_t) 1 << (D - 1)));
+			c[i] = d - (carry << D);
+		}
+
+		if (carry != 0) {
+			return;
+		}
+
+		// rows[r][i] is the coefficient of digit i in 2^((ND + r) * D) mod n,
+		// row r + 1 is row r shifted by one digit, with the digit shifted out
+		// replaced by c
+		int64_t rows[ND][ND] = { };
+		int64_t sums[ND] = { };
+
+		for (size_t i = 0; i < ND; i++) {
+			rows[0][i] = c[i];
+		}
+
+		for (size_t r = 1; r < ND; r++) {
+			const int64_t top = rows[r - 1][ND - 1];
+
+			if (abs(top) > MAX_COEFFICIENT_SUM) {
+				return;
+			}
+
+			for (size_t i = 0; i < ND; i++) {
+				rows[r][i] = ((i > 0) ? rows[r - 1][i - 1] : 0) + top * c[i];
+			}
+		}
+
+		int64_t max_sum = 0;
+
+		for (size_t r = 0; r < ND; r++) {
+			for (size_t i = 0; i < ND; i++) {
+				if (abs(rows[r][i]) > MAX_COEFFICIENT_SUM) {
+					return;
+				}
+
+				sums[i] += abs(rows[r][i]);
+
+				if (sums[i] > MAX_COEFFICIENT_SUM) {
+					return;
+				}
+
+				max_sum = (sums[i] > max_sum) ? sums[i] : max_sum;
+			}
+		}
+
+		// the carry after the first pass is less than T = max_sum + 2 in
+		// absolute value, the two folds then need (T + 1) * c < 2^SIZE_IN_BITS
+		const size_t c_bits = bitlen_els(c);
+		const size_t t_bits = bitlen_u64((uint64_t) (max_sum + 3));
+
+		if (c_bits + t_bits > SIZE_IN_BITS) {
+			return;
+		}
+
+		for (size_t r = 0; r < ND; r++) {
+			for (size_t i = 0; i < ND; i++) {
+				if (rows[r][i] != 0) {
+					k[term_count] = (uint16_t) r;
+					j[term_count] = (uint16_t) i;
+					coef[term_count] = rows[r][i];
+					term_count++;
+				}
+			}
+		}
+
+		is_special_form = (term_count <= MAX_TERMS_PER_DIGIT * ND);
+	}
+
+	/*
+	 * Digit i of the elements a.
+	 */
+	__host__ __device__
+	static inline constexpr uint64_t digit(const EL_T *a, const size_t &i) {
+		return (uint64_t) (a[i / DIGITS_PER_EL] >> (D * (i % DIGITS_PER_EL))) & DIGIT_MASK;
+	}
+
+	/*
+	 * Stores the ND digits of acc, which must be less than 2^D, in r.
+	 */
+	__host__ __device__
+	static inline constexpr void set_digits(EL_T *r, const int64_t *acc) {
+#ifdef __NVCC__
+#pragma unroll
+#endif
+		for (size_t i = 0; i < N; i++) {
+			r[i] = 0;
+		}
+
+#ifdef __NVCC__
+#pragma unroll
+#endif
+		for (size_t i = 0; i < ND; i++) {
+			r[i / DIGITS_PER_EL] |= (EL_T) ((uint64_t) acc[i] << (D * (i % DIGITS_PER_EL)));
+		}
+	}
+
+	/*
+	 * Propagates the carries through the signed digits of acc, so that each
+	 * digit is less than 2^D, and returns the signed carry out of the top
+	 * digit.
+	 */
+	__host__ __device__
+	static inline constexpr int64_t propagate(int64_t *acc) {
+		int64_t carry = 0;
+
+#ifdef __NVCC__
+#pragma unroll
+#endif
+		for (size_t i = 0; i < ND; i++) {
+			acc[i] += carry;
+			carry = acc[i] >> D; // arithmetic shift, floor division
+			acc[i] &= (int64_t) DIGIT_MASK;
+		}
+
+		return carry;
+	}
+
+	/*
+	 * Reduces the 2 * N elements of x modulo n to N elements in r, see above.
+	 */
+	__host__ __device__
+	inline constexpr void reduce(EL_T *r, const EL_T *x, const bui<SIZE_IN_BITS, EL_T> &n) const {
+		int64_t acc[ND] = { };
+
+#ifdef __NVCC__
+#pragma unroll
+#endif
+		for (size_t i = 0; i < ND; i++) {
+			acc[i] = (int64_t) digit(x, i);
+		}
+
+		for (size_t t = 0; t < term_count; t++) {
+			acc[j[t]] += coef[t] * (int64_t) digit(x, ND + k[t]);
+		}
+
+		int64_t top = propagate(acc);
+
+		for (size_t fold = 0; fold < 2; fold++) {
+#ifdef __NVCC__
+#pragma unroll
+#endif
+			for (size_t i = 0; i < ND; i++) {
+				acc[i] += c[i] * top;
+			}
+
+			top = propagate(acc);
+		}
+
+		// the value is less than 2^SIZE_IN_BITS now, i.e. less than 2 * n
+		set_digits(r, acc);
+
+		EL_T d[N] = { };
+
+#ifdef __NVCC__
+#pragma unroll
+#endif
+		for (size_t i = 0; i < N; i++) {
+			d[i] = r[i];
+		}
+
+		const EL_T borrow = els_sub<N, N>(d, n.el);
+		const EL_T mask = (EL_T) (borrow - 1);
+
+#ifdef __NVCC__
+#pragma unroll
+#endif
+		for (size_t i = 0; i < N; i++) {
+			r[i] = (d[i] & mask) | (r[i] & ~mask);
+		}
+	}
+
+private:
+	static inline constexpr int64_t abs(const int64_t &x) {
+		return (x < 0) ? -x : x;
+	}
+
+	static inline constexpr size_t bitlen_u64(uint64_t x) {
+		size_t result = 0;
+
+		for (; x != 0; x >>= 1) {
+			result++;
+		}
+
+		return result;
+	}
+
+	/*
+	 * Bit length of the value of the balanced digits a, which must be
+	 * positive.
+	 */
+	static inline constexpr size_t bitlen_els(const int64_t *a) {
+		int64_t plain[ND] = { };
+		int64_t carry = 0;
+
+		for (size_t i = 0; i < ND; i++) {
+			plain[i] = a[i] + carry;
+			carry = plain[i] >> D;
+			plain[i] &= (int64_t) DIGIT_MASK;
+		}
+
+		for (size_t i = ND - 1; i != (size_t) -1; i--) {
+			if (plain[i] != 0) {
+				return i * D + bitlen_u64((uint64_t) plain[i]);
+			}
+		}
+
+		return 0;
+	}
+};
+
+/**
+ * A residue modulo the constant MODULUS_T::value, which is a
+ * bui<SIZE_IN_BITS, EL_T> and determines EL_T. The modulus must be greater
+ * than 1 and either odd or of the special form described at special_form.
+ *
+ * Values of the Montgomery case are kept in Montgomery form internally, so the
+ * conversions happen only in the constructor and in value().
+ */
+template<size_t SIZE_IN_BITS, typename MODULUS_T>
+class mod_bui {
+public:
+	typedef typename std::remove_cv_t<decltype(MODULUS_T::value)>::el_t el_t;
+
+	typedef bui<SIZE_IN_BITS, el_t> bui_t;
+
+	static_assert(std::is_same_v<std::remove_cv_t<decltype(MODULUS_T::value)>, bui_t>, "constraint not fulfilled: MODULUS_T::value is a bui<SIZE_IN_BITS, el_t>");
+
+	static const size_t SIZE_IN_ELS = bui_t::SIZE_IN_ELS;
+
+	static constexpr bui_t MODULUS = MODULUS_T::value;
+
+	static constexpr special_form<SIZE_IN_BITS, el_t> SPECIAL_FORM = special_form<SIZE_IN_BITS, el_t>(MODULUS);
+
+	static constexpr bool IS_SPECIAL_FORM = SPECIAL_FORM.is_special_form;
+
+	static_assert(IS_SPECIAL_FORM || (MODULUS.el[0] & 1) == 1, "constraint not fulfilled: the modulus is odd or of special form");
+
+	/*
+	 * Montgomery parameters, only used if !IS_SPECIAL_FORM. For special form
+	 * moduli, which may be even, these are computed for n = 3 instead.
+	 */
+	static constexpr montgomery<SIZE_IN_BITS, el_t> MONT = montgomery<SIZE_IN_BITS, el_t>(IS_SPECIAL_FORM ? bui_t(3U) : MODULUS);
+
+	/*
+	 * Constructs a new object of this type. The value is not initialized, like
+	 * for bui().
+	 */
+	__host__ __device__
+	inline mod_bui() {
+	}
+
+	/*
+	 * Constructs a new object with the value a mod MODULUS. a is reduced by a
+	 * division if it's not less than MODULUS.
+	 */
+	__host__ __device__
+	inline constexpr explicit mod_bui(const bui_t &a) :
+			x(a) {
+		if (x >= MODULUS) {
+			x %= MODULUS;
+		}
+
+		if constexpr (!IS_SPECIAL_FORM) {
+			x = MONT.to_mont(x);
+		}
+	}
+
+	/*
+	 * Returns the value in [0, MODULUS).
+	 */
+	__host__ __device__
+	inline constexpr bui_t value() const {
+		if constexpr (IS_SPECIAL_FORM) {
+			return x;
+		} else {
+			return MONT.from_mont(x);
+		}
+	}
+
+	/*
+	 * Adds b, followed by a subtraction of MODULUS if the sum isn't less than
+	 * it, see els_add_mod.
+	 */
+	__host__ __device__
+	inline constexpr mod_bui& operator+=(const mod_bui &b) {
+		els_add_mod<SIZE_IN_ELS>(x.el, x.el, b.x.el, MODULUS.el);
+
+		return *this;
+	}
+
+	/*
+	 * Subtracts b, followed by an addition of MODULUS if the difference is
+	 * negative, see els_sub_mod.
+	 */
+	__host__ __device__
+	inline constexpr mod_bui& operator-=(const mod_bui &b) {
+		els_sub_mod<SIZE_IN_ELS>(x.el, x.el, b.x.el, MODULUS.el);
+
+		return *this;
+	}
+
+	__host__ __device__
+	inline constexpr mod_bui& operator*=(const mod_bui &b) {
+		if constexpr (IS_SPECIAL_FORM) {
+			el_t p[2 * SIZE_IN_ELS] = { };
+			mul_els<SIZE_IN_ELS>(p, x.el, b.x.el);
+			SPECIAL_FORM.reduce(x.el, p, MODULUS);
+		} else {
+			x = MONT.mont_mul(x, b.x);
+		}
+
+		return *this;
+	}
+
+	/*
+	 * Squares this value in place, with the squaring kernels of sqr_els.
+	 */
+	__host__ __device__
+	inline constexpr mod_bui& square() {
+		if constexpr (IS_SPECIAL_FORM) {
+			el_t p[2 * SIZE_IN_ELS] = { };
+			sqr_els<SIZE_IN_ELS>(p, x.el);
+			SPECIAL_FORM.reduce(x.el, p, MODULUS);
+		} else {
+			x = MONT.mont_sqr(x);
+		}
+
+		return *this;
+	}
+
+	__host__ __device__
+	inline constexpr mod_bui operator+(const mod_bui &b) const {
+		mod_bui result = *this;
+		return result += b;
+	}
+
+	__host__ __device__
+	inline constexpr mod_bui operator-(const mod_bui &b) const {
+		mod_bui result = *this;
+		return result -= b;
+	}
+
+	__host__ __device__
+	inline constexpr mod_bui operator*(const mod_bui &b) const {
+		mod_bui result = *this;
+		return result *= b;
+	}
+
+	__host__ __device__
+	inline constexpr mod_bui operator-() const {
+		mod_bui result = zero();
+		return result -= *this;
+	}
+
+	/*
+	 * Both representations are unique, so comparing them compares the values.
+	 */
+	__host__ __device__
+	inline constexpr bool operator==(const mod_bui &b) const {
+		return x == b.x;
+	}
+
+	__host__ __device__
+	inline constexpr bool operator!=(const mod_bui &b) const {
+		return x != b.x;
+	}
+
+	__host__ __device__
+	static inline constexpr mod_bui zero() {
+		return mod_bui(bui_t(0U), representation_tag());
+	}
+
+	__host__ __device__
+	static inline constexpr mod_bui one() {
+		return mod_bui(IS_SPECIAL_FORM ? bui_t(1U) : MONT.one, representation_tag());
+	}
+
+private:
+	struct representation_tag {
+	};
+
+	bui_t x;
+
+	/*
+	 * Constructs a new object with the given representation, i.e. the value
+	 * for a special form modulus and the Montgomery form of the value
+	 * otherwise. Unlike mod_bui(), this is usable in constant expressions.
+	 */
+	__host__ __device__
+	inline constexpr mod_bui(const bui_t &representation, const representation_tag&) :
+			x(representation) {
+	}
+};
+
+/*
+ * Field prime of NIST P-256, 2^256 - 2^224 + 2^192 + 2^96 - 1.
+ */
+template<typename EL_T = el_t>
+struct p256_modulus {
+	static constexpr bui<256, EL_T> value = "115792089210356248762697446949407573530086143415290314195533631308867097853951";
+};
+
+/*
+ * Field prime of NIST P-384, 2^384 - 2^128 - 2^96 + 2^32 - 1.
+ */
+template<typename EL_T = el_t>
+struct p384_modulus {
+	static constexpr bui<384, EL_T> value = "39402006196394479212279040100143613805079739270465446667948293404245721771496870329047266088258938001861606973112319";
+};
+
+/*
+ * Field prime of secp256k1, 2^256 - 2^32 - 977.
+ */
+template<typename EL_T = el_t>
+struct secp256k1_modulus {
+	static constexpr bui<256, EL_T> value = "115792089237316195423570985008687907853269984665640564039457584007908834671663";
+};
+
+} /* namespace bifsi */
+
+#endif /* BIFSI_MOD_H_ */
@@ -0,0 +1,389 @@
+/*
+ * bifsi_pow.h
+ * published: 2022-09-04
+ * last change: 2022-09-04
+ *
+ * Copyright 2022 Daniel Strecker
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Modular exponentiation with precomputation, on top of the Montgomery
+ * arithmetic of bifsi.h. montgomery::mod_pow squares once per bit of the
+ * exponent, for any base. If the same base is raised to many exponents, e.g.
+ * a generator g, most of these squarings can be computed once in advance,
+ * see fixed_base_table. If the powers of many bases are multiplied, all terms
+ * can share one chain of squarings, see multi_pow.
+ */
+
+#ifndef BIFSI_POW_H_
+#define BIFSI_POW_H_
+
+#include <vector>
+
+#include "bifsi.h"
+
+namespace bifsi {
+
+/**
+ * Precomputed powers of a fixed base g for the Lim-Lee comb method (HAC
+ * 14.117 with one column block), which computes g^e mod n with COLUMNS - 1
+ * squarings and COLUMNS multiplications, where COLUMNS = ceil(EXP_BITS /
+ * TEETH), instead of the EXP_BITS squarings of montgomery::mod_pow.
+ *
+ * The EXP_BITS bits of an exponent are arranged in TEETH rows of COLUMNS
+ * bits, bit i * COLUMNS + c of e being the bit of row i in column c. Then
+ *
+ * g^e = prod_c (prod_i (g^(2^(i * COLUMNS)))^e[i * COLUMNS + c])^(2^c),
+ *
+ * so with entries[j] = prod_{bit i of j is set} g^(2^(i * COLUMNS)), the
+ * exponentiation squares and multiplies once per column, by the entry which
+ * is indexed by the TEETH bits of the column. The table has 2^TEETH entries
+ * in Montgomery form.
+ *
+ * Like montgomery::mod_pow, all bits of the exponent are processed and each
+ * entry is read by scanning the whole table, see ct_select, so neither the
+ * control flow nor the memory access pattern depend on the exponent. All
+ * threads of a warp therefore read the same addresses in the same order,
+ * which is a broadcast for a table in CUDA constant memory. Objects of this
+ * class are trivially copyable and contain no pointers, so a table can be
+ * copied to a __constant__ variable with cudaMemcpyToSymbol, or into shared
+ * memory, see fixed_base_mod_pow_kernel in bifsi_cuda.cuh.
+ *
+ * The table belongs to the modulus it was computed with, which is passed to
+ * mod_pow again instead of being stored, such that the table is only the
+ * entries.
+ */
+template<size_t SIZE_IN_BITS, size_t EXP_BITS, size_t TEETH = 6, typename EL_T = el_t>
+class fixed_base_table {
+	static_assert(TEETH > 0 && TEETH <= 12, "constraint not fulfilled: TEETH > 0 && TEETH <= 12");
+
+public:
+	typedef EL_T el_t;
+
+	static const size_t EL_SIZE_IN_BITS = sizeof(EL_T) * 8;
+
+	static const size_t TABLE_SIZE = ((size_t) 1) << TEETH;
+
+	/*
+	 * Number of bits per row, i.e. the number of squarings plus one.
+	 */
+	static const size_t COLUMNS = (EXP_BITS + TEETH - 1) / TEETH;
+
+	/*
+	 * entries[j] = prod_{bit i of j is set} g^(2^(i * COLUMNS)) in Montgomery
+	 * form.
+	 */
+	fixed_array<bui<SIZE_IN_BITS, EL_T>, TABLE_SIZE> entries;
+
+	/*
+	 * Constructs a new object of this type. The entries are not initialized,
+	 * like for bui(), e.g. for a table in CUDA constant or shared memory,
+	 * which is filled by copying.
+	 */
+	__host__ __device__
+	inline fixed_base_table() {
+	}
+
+	/*
+	 * Computes the table for the base g modulo the modulus of mont, with
+	 * (TEETH - 1) * COLUMNS squarings and 2^TEETH - TEETH - 1 multiplications.
+	 * g doesn't need to be reduced modulo n.
+	 */
+	__host__ __device__
+	inline constexpr fixed_base_table(const montgomery<SIZE_IN_BITS, EL_T> &mont, const bui<SIZE_IN_BITS, EL_T> &g) :
+			entries(fixed_array<bui<SIZE_IN_BITS, EL_T>, TABLE_SIZE>::filled(mont.one)) {
+		// g^(2^(i * COLUMNS)) for row i, each entry with highest bit i is
+		// the entry without that bit times the power of row i
+		bui<SIZE_IN_BITS, EL_T> row_power = mont.to_mont(g);
+
+		for (size_t i = 0; i < TEETH; i++) {
+			if (i > 0) {
+				for (size_t c = 0; c < COLUMNS; c++) {
+					row_power = mont.mont_sqr(row_power);
+				}
+			}
+
+			const size_t bit = ((size_t) 1) << i;
+
+			entries[bit] = row_power;
+
+			for (size_t j = bit + 1; j < 2 * bit; j++) {
+				entries[j] = mont.mont_mul(entries[j - bit], row_power);
+			}
+		}
+	}
+
+	/*
+	 * Returns g^exp mod n, with mont being the one the table was computed
+	 * with.
+	 */
+	__host__ __device__
+	inline constexpr bui<SIZE_IN_BITS, EL_T> mod_pow(const montgomery<SIZE_IN_BITS, EL_T> &mont, const bui<EXP_BITS, EL_T> &exp) const {
+		bui<SIZE_IN_BITS, EL_T> result = mont.one;
+
+#ifdef __NVCC__
+#pragma unroll 1
+#endif
+		for (size_t c = COLUMNS - 1; c < COLUMNS; c--) {
+			if (c < COLUMNS - 1) {
+				result = mont.mont_sqr(result);
+			}
+
+			result = mont.mont_mul(result, ct_select(entries, column(exp, c)));
+		}
+
+		return mont.from_mont(result);
+	}
+
+private:
+	/*
+	 * Returns the TEETH bits of column c of exp, the bit of row i being bit i
+	 * of the result.
+	 */
+	__host__ __device__
+	static inline constexpr size_t column(const bui<EXP_BITS, EL_T> &exp, const size_t &c) {
+		size_t result = 0;
+
+#ifdef __NVCC__
+#pragma unroll
+#endif
+		for (size_t i = 0; i < TEETH; i++) {
+			const size_t bit_idx = i * COLUMNS + c;
+
+			if (bit_idx < EXP_BITS) {
+				result |= (size_t) ((exp.el[bit_idx / EL_SIZE_IN_BITS] >> (bit_idx % EL_SIZE_IN_BITS)) & 1) << i;
+			}
+		}
+
+		return result;
+	}
+};
+
+/*
+ * Maximum window size of the Straus method of multi_pow. The table of each
+ * term has 2^window_bits - 1 entries.
+ */
+const size_t MULTI_POW_MAX_STRAUS_WINDOW_BITS = 6;
+
+/*
+ * Maximum window size of the Pippenger method of multi_pow, which has
+ * 2^window_bits buckets.
+ */
+const size_t MULTI_POW_MAX_PIPPENGER_WINDOW_BITS = 12;
+
+/*
+ * Minimum number of terms per slice, when the launchers of bifsi_host.h and
+ * bifsi_cuda.cuh split a multi_pow over several threads. Each slice squares
+ * EXP_BITS times on its own, which should be small compared to the
+ * multiplications for the terms of the slice.
+ */
+const size_t MULTI_POW_MIN_SLICE_SIZE = 32;
+
+/*
+ * Method and window size of multi_pow, see get_multi_pow_plan.
+ */
+struct multi_pow_plan {
+	bool pippenger;
+	size_t window_bits;
+
+	// number of bui values multi_pow needs as scratch memory
+	size_t scratch_size;
+};
+
+/*
+ * Returns the len bits of x starting at bit pos, the bits at and above
+ * SIZE_IN_BITS being 0.
+ */
+template<size_t SIZE_IN_BITS, typename EL_T>
+__host__ __device__
+inline constexpr size_t bit_field(const bui<SIZE_IN_BITS, EL_T> &x, const size_t &pos, const size_t &len) {
+	constexpr size_t EL_SIZE_IN_BITS = bui<SIZE_IN_BITS, EL_T>::EL_SIZE_IN_BITS;
+
+	size_t result = 0;
+
+	for (size_t i = 0; i < len; i++) {
+		const size_t bit_idx = pos + i;
+
+		if (bit_idx < SIZE_IN_BITS) {
+			result |= (size_t) ((x.el[bit_idx / EL_SIZE_IN_BITS] >> (bit_idx % EL_SIZE_IN_BITS)) & 1) << i;
+		}
+	}
+
+	return result;
+}
+
+/*
+ * Returns the method and window size of multi_pow with the fewest
+ * multiplications for count terms with EXP_BITS bit exponents. Both methods
+ * square about EXP_BITS times, so only the multiplications are counted:
+ *
+ * Straus with window size w builds a table of the powers 1 to 2^w - 1 for
+ * each term, and multiplies by one entry per term and window, which are
+ * count * (2^w - 1 + ceil(EXP_BITS / w)) multiplications. The tables take
+ * count * (2^w - 1) bui values.
+ *
+ * Pippenger with window size c multiplies each base into the bucket of its
+ * digit and then combines the 2^c - 1 buckets with two running products,
+ * which are count + ceil(EXP_BITS / c) * (count + 2^(c + 1) - 1)
+ * multiplications. The buckets and the bases in Montgomery form take
+ * 2^c + count bui values.
+ *
+ * So Straus is faster for few terms, and Pippenger for many, because its
+ * cost per term and window doesn't grow with the table.
+ */
+template<size_t EXP_BITS>
+__host__ __device__
+inline constexpr multi_pow_plan get_multi_pow_plan(const size_t &count) {
+	multi_pow_plan result = { false, 1, count };
+	size_t min_cost = ~(size_t) 0;
+
+	for (size_t w = 1; w <= MULTI_POW_MAX_STRAUS_WINDOW_BITS; w++) {
+		const size_t entries = (((size_t) 1) << w) - 1;
+		const size_t cost = count * (entries + (EXP_BITS + w - 1) / w);
+
+		if (cost < min_cost) {
+			min_cost = cost;
+			result = { false, w, count * entries };
+		}
+	}
+
+	for (size_t c = 1; c <= MULTI_POW_MAX_PIPPENGER_WINDOW_BITS; c++) {
+		const size_t bucket_count = ((size_t) 1) << c;
+		const size_t cost = count + (EXP_BITS + c - 1) / c * (count + 2 * bucket_count - 1);
+
+		if (cost < min_cost) {
+			min_cost = cost;
+			result = { true, c, bucket_count + count };
+		}
+	}
+
+	return result;
+}
+
+/*
+ * Returns prod_{i < count} bases[i]^exps[i] mod n, with n being the modulus
+ * of mont, by the method of plan, which must be the one of
+ * get_multi_pow_plan for at least count terms. scratch must have room for
+ * plan.scratch_size values. The bases don't need to be reduced modulo n.
+ *
+ * Unlike montgomery::mod_pow, the multiplications by the table entries or
+ * buckets are skipped for zero digits, and the table entries and buckets are
+ * accessed by the digits, so the time and the memory access pattern depend on
+ * the exponents. This is meant for public exponents, e.g. in the batch
+ * verification of signatures.
+ */
+template<size_t SIZE_IN_BITS, size_t EXP_BITS, typename EL_T>
+__host__ __device__
+inline bui<SIZE_IN_BITS, EL_T> multi_pow(const montgomery<SIZE_IN_BITS, EL_T> &mont, const bui<SIZE_IN_BITS, EL_T> *bases, const bui<EXP_BITS, EL_T> *exps, const size_t &count, bui<SIZE_IN_BITS, EL_T> *scratch, const multi_pow_plan &plan) {
+	const size_t w = plan.window_bits;
+	const size_t window_count = (EXP_BITS + w - 1) / w;
+
+	bui<SIZE_IN_BITS, EL_T> result = mont.one;
+
+	if (!plan.pippenger) {
+		// Straus: table of term i at scratch[i * entries], entry d - 1 being
+		// bases[i]^d
+		const size_t entries = (((size_t) 1) << w) - 1;
+
+		for (size_t i = 0; i < count; i++) {
+			bui<SIZE_IN_BITS, EL_T> *table = scratch + i * entries;
+
+			table[0] = mont.to_mont(bases[i]);
+
+			for (size_t d = 1; d < entries; d++) {
+				table[d] = mont.mont_mul(table[d - 1], table[0]);
+			}
+		}
+
+		for (size_t window = window_count - 1; window < window_count; window--) {
+			if (window < window_count - 1) {
+				for (size_t j = 0; j < w; j++) {
+					result = mont.mont_sqr(result);
+				}
+			}
+
+			for (size_t i = 0; i < count; i++) {
+				const size_t d = bit_field(exps[i], window * w, w);
+
+				if (d != 0) {
+					result = mont.mont_mul(result, scratch[i * entries + d - 1]);
+				}
+			}
+		}
+	} else {
+		// Pippenger: buckets at scratch[0, 2^w), bucket 0 being unused, then
+		// the bases in Montgomery form
+		const size_t bucket_count = ((size_t) 1) << w;
+
+		bui<SIZE_IN_BITS, EL_T> *buckets = scratch;
+		bui<SIZE_IN_BITS, EL_T> *mont_bases = scratch + bucket_count;
+
+		for (size_t i = 0; i < count; i++) {
+			mont_bases[i] = mont.to_mont(bases[i]);
+		}
+
+		for (size_t window = window_count - 1; window < window_count; window--) {
+			if (window < window_count - 1) {
+				for (size_t j = 0; j < w; j++) {
+					result = mont.mont_sqr(result);
+				}
+			}
+
+			for (size_t d = 1; d < bucket_count; d++) {
+				buckets[d] = mont.one;
+			}
+
+			for (size_t i = 0; i < count; i++) {
+				const size_t d = bit_field(exps[i], window * w, w);
+
+				if (d != 0) {
+					buckets[d] = mont.mont_mul(buckets[d], mont_bases[i]);
+				}
+			}
+
+			// prod_d buckets[d]^d as the product of the running products of
+			// the buckets from the highest digit down
+			bui<SIZE_IN_BITS, EL_T> running = mont.one;
+			bui<SIZE_IN_BITS, EL_T> window_product = mont.one;
+
+			for (size_t d = bucket_count - 1; d > 0; d--) {
+				running = mont.mont_mul(running, buckets[d]);
+				window_product = mont.mont_mul(window_product, running);
+			}
+
+			result = mont.mont_mul(result, window_product);
+		}
+	}
+
+	return mont.from_mont(result);
+}
+
+/*
+ * Returns prod_{i < count} bases[i]^exps[i] mod n like above, with the plan
+ * of get_multi_pow_plan and scratch memory on the heap.
+ */
+template<size_t SIZE_IN_BITS, size_t EXP_BITS, typename EL_T>
+inline bui<SIZE_IN_BITS, EL_T> multi_pow(const montgomery<SIZE_IN_BITS, EL_T> &mont, const bui<SIZE_IN_BITS, EL_T> *bases, const bui<EXP_BITS, EL_T> *exps, const size_t &count) {
+	const multi_pow_plan plan = get_multi_pow_plan<EXP_BITS>(count);
+
+	std::vector<bui<SIZE_IN_BITS, EL_T>> scratch(plan.scratch_size);
+
+	return multi_pow(mont, bases, exps, count, scratch.data(), plan);
+}
+
+} /* namespace bifsi */
+
+#endif /* BIFSI_POW_H_ */
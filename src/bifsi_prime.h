@@ -0,0 +1,336 @@
+/*
+ * bifsi_prime.h
+ * published: 2022-09-04
+ * last change: 2022-09-04
+ *
+ * Copyright 2022 Daniel Strecker
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Primality testing for searching large primes. A search runs in two stages:
+ *
+ * 1. The sieve steps through the odd candidates starting at some value and
+ *    drops the ones with a factor among the first few thousand primes. The
+ *    residues of the candidate modulo these primes are computed once with the
+ *    scalar operator% by precomputed divisors and then updated by adding 2
+ *    for each step, so the sieve costs a few comparisons per prime and
+ *    candidate.
+ *
+ * 2. The candidates that survive the sieve are tested with Miller-Rabin,
+ *    using the Montgomery arithmetic of bifsi.h. On the host, see
+ *    miller_rabin and next_prime. On CUDA, see miller_rabin_kernel in
+ *    bifsi_cuda.cuh, where each warp tests 32 candidates in lockstep.
+ */
+
+#ifndef BIFSI_PRIME_H_
+#define BIFSI_PRIME_H_
+
+#include <utility>
+
+#include "bifsi.h"
+
+namespace bifsi {
+
+namespace prime {
+
+/*
+ * The first COUNT odd primes, i.e. 3, 5, 7, ...
+ */
+template<size_t COUNT>
+struct small_primes_table {
+	uint32_t p[COUNT];
+};
+
+/*
+ * Computes the first COUNT odd primes at compile time by trial division by
+ * the primes found so far.
+ */
+template<size_t COUNT>
+inline constexpr small_primes_table<COUNT> make_small_primes() {
+	small_primes_table<COUNT> result = { };
+
+	size_t count = 0;
+
+	for (uint32_t c = 3; count < COUNT; c += 2) {
+		bool is_prime = true;
+
+		for (size_t i = 0; i < count && result.p[i] * result.p[i] <= c; i++) {
+			is_prime &= (c % result.p[i] != 0);
+		}
+
+		if (is_prime) {
+			result.p[count] = c;
+			count++;
+		}
+	}
+
+	return result;
+}
+
+template<size_t COUNT>
+inline constexpr small_primes_table<COUNT> SMALL_PRIMES = make_small_primes<COUNT>();
+
+/*
+ * The first COUNT odd primes as divisors with precomputed reciprocals, see
+ * divisor. The primes must fit into EL_T.
+ */
+template<size_t COUNT, typename EL_T>
+struct small_prime_divisors_table {
+	divisor<EL_T> d[COUNT];
+};
+
+template<size_t COUNT, typename EL_T, size_t... I>
+inline constexpr small_prime_divisors_table<COUNT, EL_T> make_small_prime_divisors(std::index_sequence<I...>) {
+	return { { divisor<EL_T>((EL_T) SMALL_PRIMES<COUNT>.p[I])... } };
+}
+
+template<size_t COUNT, typename EL_T>
+inline constexpr small_prime_divisors_table<COUNT, EL_T> SMALL_PRIME_DIVISORS = make_small_prime_divisors<COUNT, EL_T>(std::make_index_sequence<COUNT>());
+
+/*
+ * Default number of primes of the sieve, the odd primes up to 17863.
+ */
+const size_t DEFAULT_SIEVE_PRIME_COUNT = 2048;
+
+/*
+ * Maximum number of Miller-Rabin rounds, see miller_rabin_base.
+ */
+const size_t MAX_MILLER_RABIN_ROUNDS = 64;
+
+/*
+ * Returns the base of Miller-Rabin round idx, which is the prime with index
+ * idx, i.e. 2, 3, 5, ... The first 12 of these bases make Miller-Rabin
+ * deterministic for n < 2^64.
+ */
+__host__ __device__
+inline constexpr uint32_t miller_rabin_base(const size_t &idx) {
+	constexpr uint32_t BASES[MAX_MILLER_RABIN_ROUNDS] = { 2, 3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37, 41, 43, 47, 53, 59, 61, 67, 71, 73, 79, 83, 89, 97, 101, 103, 107, 109, 113, 127, 131, 137, 139, 149, 151, 157, 163, 167, 173, 179, 181, 191, 193, 197, 199, 211, 223, 227, 229, 233, 239, 241, 251, 257, 263, 269, 271, 277, 281, 283, 293, 307, 311 };
+
+	assert(idx < MAX_MILLER_RABIN_ROUNDS);
+
+	return BASES[idx];
+}
+
+/*
+ * One Miller-Rabin round with base for the modulus n of mont, where
+ * n - 1 = d * 2^s with odd d. Returns false if base proves n composite, true
+ * if n is a strong probable prime to base. base must be less than n - 1.
+ *
+ * The squarings are done in Montgomery form. There are s_loop - 1 of them,
+ * which must be at least s - 1, and only the first s - 1 count. This lets the
+ * threads of a warp run the same number of iterations, the maximum s - 1 of
+ * the warp, see miller_rabin_kernel. Otherwise, the round is branchless.
+ */
+template<size_t SIZE_IN_BITS, typename EL_T>
+__host__ __device__
+inline constexpr bool miller_rabin_round(const montgomery<SIZE_IN_BITS, EL_T> &mont, const bui<SIZE_IN_BITS, EL_T> &d, const size_t &s, const size_t &s_loop, const bui<SIZE_IN_BITS, EL_T> &base) {
+	constexpr size_t N = bui<SIZE_IN_BITS, EL_T>::SIZE_IN_ELS;
+
+	// n - 1 in Montgomery form is n - R mod n
+	bui<SIZE_IN_BITS, EL_T> minus_one = mont.n;
+	els_sub<N, N>(minus_one.el, mont.one.el);
+
+	bui<SIZE_IN_BITS, EL_T> x = mont.to_mont(mont.mod_pow(base, d));
+
+	bool result = (x == mont.one) | (x == minus_one);
+
+	for (size_t j = 1; j < s_loop; j++) {
+		x = mont.mont_sqr(x);
+		result |= (j < s) & (x == minus_one);
+	}
+
+	return result;
+}
+
+/*
+ * Miller-Rabin test of n with the first ROUNDS bases of miller_rabin_base.
+ * Returns false if n is composite, true if n is a strong probable prime to
+ * all these bases. n must be odd and greater than 2 plus the largest base.
+ *
+ * The test stops at the first base that proves n composite, so unlike the
+ * rounds, the test as a whole isn't branchless.
+ */
+template<size_t ROUNDS = 16, size_t SIZE_IN_BITS, typename EL_T>
+__host__ __device__
+inline constexpr bool miller_rabin(const bui<SIZE_IN_BITS, EL_T> &n) {
+	static_assert(ROUNDS > 0 && ROUNDS <= MAX_MILLER_RABIN_ROUNDS, "constraint not fulfilled: ROUNDS > 0 && ROUNDS <= MAX_MILLER_RABIN_ROUNDS");
+
+	const montgomery<SIZE_IN_BITS, EL_T> mont(n);
+
+	bui<SIZE_IN_BITS, EL_T> d = n;
+	d -= 1;
+
+	const size_t s = trailing_0_bits(d);
+	d >>= s;
+
+	for (size_t i = 0; i < ROUNDS; i++) {
+		const bui<SIZE_IN_BITS, EL_T> base = miller_rabin_base(i);
+
+		if (!miller_rabin_round(mont, d, s, s, base)) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/*
+ * Returns false if n is composite, true if it's prime or a strong probable
+ * prime to the first ROUNDS bases of miller_rabin_base. Small factors are
+ * found by trial division by the first PRIME_COUNT odd primes, which also
+ * decides all n less than the square of the largest of these primes.
+ */
+template<size_t ROUNDS = 16, size_t PRIME_COUNT = DEFAULT_SIEVE_PRIME_COUNT, size_t SIZE_IN_BITS, typename EL_T>
+inline constexpr bool is_probable_prime(const bui<SIZE_IN_BITS, EL_T> &n) {
+	constexpr uint32_t P_MAX = SMALL_PRIMES<PRIME_COUNT>.p[PRIME_COUNT - 1];
+
+	static_assert(P_MAX <= (EL_T) -1, "constraint not fulfilled: the primes of the table fit into EL_T");
+	static_assert(P_MAX > 2 + 311, "constraint not fulfilled: trial division decides n up to the largest Miller-Rabin base");
+
+	if (n < 2U) {
+		return false;
+	}
+
+	if ((n.el[0] & 1) == 0) {
+		return n == 2U;
+	}
+
+	for (size_t i = 0; i < PRIME_COUNT; i++) {
+		const divisor<EL_T> &p = SMALL_PRIME_DIVISORS<PRIME_COUNT, EL_T>.d[i];
+
+		if (n % p == 0) {
+			return n == p.d;
+		}
+	}
+
+	if (n < (uint64_t) P_MAX * P_MAX) {
+		return true;
+	}
+
+	return miller_rabin<ROUNDS>(n);
+}
+
+/**
+ * Incremental sieve over the odd candidates starting at some value. The
+ * residues of the current candidate modulo the first PRIME_COUNT odd primes
+ * are computed once in the constructor with the scalar operator% by the
+ * divisors of SMALL_PRIME_DIVISORS, then each step adds 2 to the candidate
+ * and to the residues, with a conditional subtraction of the prime done by a
+ * mask. A candidate survives the sieve if none of its residues is 0.
+ *
+ * Candidates equal to one of the primes of the table don't survive, so the
+ * sieve is meant for candidates greater than the largest of these primes.
+ * Candidates wrap around to 0 at 2^SIZE_IN_BITS.
+ */
+template<size_t SIZE_IN_BITS, typename EL_T = el_t, size_t PRIME_COUNT = DEFAULT_SIEVE_PRIME_COUNT>
+class sieve {
+	static_assert(SMALL_PRIMES<PRIME_COUNT>.p[PRIME_COUNT - 1] <= (EL_T) -1, "constraint not fulfilled: the primes of the table fit into EL_T");
+
+public:
+	/*
+	 * Starts the sieve at the smallest odd number greater than or equal to
+	 * start.
+	 */
+	inline sieve(const bui<SIZE_IN_BITS, EL_T> &start) :
+			value(start) {
+		value.el[0] |= 1;
+
+		for (size_t i = 0; i < PRIME_COUNT; i++) {
+			residues[i] = (uint32_t) (value % SMALL_PRIME_DIVISORS<PRIME_COUNT, EL_T>.d[i]);
+		}
+	}
+
+	/*
+	 * The current candidate.
+	 */
+	inline const bui<SIZE_IN_BITS, EL_T>& candidate() const {
+		return value;
+	}
+
+	/*
+	 * Returns true if the current candidate has no factor among the primes of
+	 * the table.
+	 */
+	inline bool survives() const {
+		uint32_t divisible = 0;
+
+		for (size_t i = 0; i < PRIME_COUNT; i++) {
+			divisible |= (residues[i] == 0);
+		}
+
+		return divisible == 0;
+	}
+
+	/*
+	 * Advances to the next odd candidate.
+	 */
+	inline void step() {
+		value += 2U;
+
+		for (size_t i = 0; i < PRIME_COUNT; i++) {
+			const uint32_t p = SMALL_PRIMES<PRIME_COUNT>.p[i];
+			const uint32_t r = residues[i] + 2;
+
+			// r is less than p + 2 and p is at least 3, so subtracting p once
+			// is enough
+			residues[i] = r - (p & (uint32_t) -(uint32_t) (r >= p));
+		}
+	}
+
+	/*
+	 * Advances to the next candidate which survives the sieve and returns it.
+	 */
+	inline const bui<SIZE_IN_BITS, EL_T>& next() {
+		do {
+			step();
+		} while (!survives());
+
+		return value;
+	}
+
+	/*
+	 * Stores the next count candidates which survive the sieve in r, e.g. for
+	 * testing them on CUDA with cuda::launcher::miller_rabin.
+	 */
+	inline void next(bui<SIZE_IN_BITS, EL_T> *r, const size_t &count) {
+		for (size_t i = 0; i < count; i++) {
+			r[i] = next();
+		}
+	}
+
+private:
+	bui<SIZE_IN_BITS, EL_T> value;
+
+	uint32_t residues[PRIME_COUNT];
+};
+
+/*
+ * Returns the smallest probable prime greater than the current candidate of
+ * s, see sieve and miller_rabin, and leaves s at it.
+ */
+template<size_t ROUNDS = 16, size_t SIZE_IN_BITS, typename EL_T, size_t PRIME_COUNT>
+inline bui<SIZE_IN_BITS, EL_T> next_prime(sieve<SIZE_IN_BITS, EL_T, PRIME_COUNT> &s) {
+	while (!miller_rabin<ROUNDS>(s.next())) {
+	}
+
+	return s.candidate();
+}
+
+} /* namespace prime */
+
+} /* namespace bifsi */
+
+#endif /* BIFSI_PRIME_H_ */
@@ -0,0 +1,388 @@
+/*
+ * bifsi_signed.h
+ * published: 2022-09-04
+ * last change: 2022-09-04
+ *
+ * Copyright 2022 Daniel Strecker
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Signed big ints of fixed size in two's complement, e.g. for the cofactors
+ * of the extended GCD. The bit pattern is stored in a bui, so addition,
+ * subtraction, the truncated multiplication and the left shift are the
+ * unsigned kernels of bui, which compute the same bits for two's complement
+ * values. Only the sign dependent operations are added: arithmetic right
+ * shift, comparison, the widening multiplication, negation and conversion.
+ * All of them use the sign as a mask instead of a branch, so threads of a
+ * warp with different signs don't diverge.
+ */
+
+#ifndef BIFSI_SIGNED_H_
+#define BIFSI_SIGNED_H_
+
+#include <stdint.h>
+
+#include <string>
+#include <type_traits>
+
+#include "bifsi.h"
+
+namespace bifsi {
+
+/**
+ * Signed big int with SIZE_IN_BITS bits in two's complement, so its values
+ * are -2^(SIZE_IN_BITS - 1) to 2^(SIZE_IN_BITS - 1) - 1. Like bui, all
+ * operations are computed modulo 2^SIZE_IN_BITS, i.e. they wrap around on
+ * overflow.
+ */
+template<size_t SIZE_IN_BITS, typename EL_T = el_t>
+class bsi {
+public:
+	/*
+	 * Integer type of the elements of this big int.
+	 */
+	typedef EL_T el_t;
+
+	/*
+	 * Unsigned big int type that stores the bit pattern.
+	 */
+	typedef bui<SIZE_IN_BITS, EL_T> bui_t;
+
+	static const size_t EL_SIZE_IN_BITS = sizeof(EL_T) * 8;
+
+	static const size_t SIZE_IN_ELS = bui_t::SIZE_IN_ELS;
+
+	/*
+	 * Two's complement bit pattern of this big int.
+	 */
+	bui_t bits;
+
+	/*
+	 * Constructs a new object of this type. The value is not initialized, see
+	 * bui().
+	 */
+	__host__ __device__
+	inline bsi() {
+	}
+
+	/*
+	 * Constructs a new object with the given value, sign extended to
+	 * SIZE_IN_BITS.
+	 */
+	template<typename INT_T>
+	__host__ __device__
+	inline constexpr bsi(const INT_T &value) :
+			bits(0U) {
+		static_assert_singed_or_unsigned_int_type<INT_T>();
+		static_assert(sizeof(INT_T) <= sizeof(uint64_t), "constraint not fulfilled: sizeof(INT_T) <= sizeof(uint64_t)");
+
+		const uint64_t u = std::is_signed_v<INT_T> ? (uint64_t) (int64_t) value : (uint64_t) value;
+		const el_t mask = (el_t) -(el_t) (std::is_signed_v<INT_T> && (u >> 63) != 0);
+
+#ifdef __NVCC__
+#pragma unroll
+#endif
+		for (size_t i = 0; i < SIZE_IN_ELS; i++) {
+			const size_t shift = i * EL_SIZE_IN_BITS;
+			bits.el[i] = (shift < 64) ? (el_t) (u >> shift) : mask;
+		}
+	}
+
+	/*
+	 * Constructs a new object from a decimal string with an optional leading
+	 * '-'.
+	 */
+	__host__ __device__
+	inline constexpr bsi(const char *str) :
+			bits(str + (str[0] == '-')) {
+		conditional_negate((el_t) -(el_t) (str[0] == '-'));
+	}
+
+	/*
+	 * Constructs a new object with the bit pattern of b, so values of b from
+	 * 2^(SIZE_IN_BITS - 1) on become negative.
+	 */
+	__host__ __device__
+	inline explicit constexpr bsi(const bui_t &b) :
+			bits(b) {
+	}
+
+	/*
+	 * Returns all bits set if this big int is negative, else 0.
+	 */
+	__host__ __device__
+	inline constexpr el_t sign_mask() const {
+		return (el_t) -(el_t) (bits.el[SIZE_IN_ELS - 1] >> (EL_SIZE_IN_BITS - 1));
+	}
+
+	__host__ __device__
+	inline constexpr bool is_negative() const {
+		return (bits.el[SIZE_IN_ELS - 1] >> (EL_SIZE_IN_BITS - 1)) != 0;
+	}
+
+	__host__ __device__
+	inline constexpr bool is_zero() const {
+		return bits.is_zero();
+	}
+
+	/*
+	 * Returns the lowest bits of this big int as INT_T, which keeps the value
+	 * if it fits into INT_T.
+	 */
+	template<typename INT_T>
+	__host__ __device__
+	inline constexpr INT_T as() const {
+		static_assert_singed_or_unsigned_int_type<INT_T>();
+
+		return (INT_T) bits.template as<std::make_unsigned_t<INT_T>>();
+	}
+
+	/*
+	 * Negates this big int if mask has all bits set and keeps it if mask is 0,
+	 * by computing (x ^ mask) - mask.
+	 */
+	__host__ __device__
+	inline constexpr bsi& conditional_negate(const el_t &mask) {
+		el_t carry = (el_t) (mask & 1);
+
+#ifdef __NVCC__
+#pragma unroll
+#endif
+		for (size_t i = 0; i < SIZE_IN_ELS; i++) {
+			bits.el[i] = addc((el_t) (bits.el[i] ^ mask), carry);
+		}
+
+		return *this;
+	}
+
+	__host__ __device__
+	inline constexpr bsi& negate() {
+		return conditional_negate((el_t) -1);
+	}
+
+	__host__ __device__
+	inline constexpr bsi operator-() const {
+		bsi result = *this;
+		return result.negate();
+	}
+
+	/*
+	 * Returns the absolute value, which always fits into bui_t, even for
+	 * -2^(SIZE_IN_BITS - 1).
+	 */
+	__host__ __device__
+	inline constexpr bui_t abs() const {
+		bsi result = *this;
+		return result.conditional_negate(sign_mask()).bits;
+	}
+
+	__host__ __device__
+	inline constexpr bsi& operator+=(const bsi &b) {
+		els_add<SIZE_IN_ELS, SIZE_IN_ELS>(bits.el, b.bits.el);
+		return *this;
+	}
+
+	__host__ __device__
+	inline constexpr bsi& operator-=(const bsi &b) {
+		els_sub<SIZE_IN_ELS, SIZE_IN_ELS>(bits.el, b.bits.el);
+		return *this;
+	}
+
+	/*
+	 * Multiplies this big int with b, truncated to SIZE_IN_BITS. The lowest
+	 * bits of a product are the same for two's complement and unsigned
+	 * factors, so this is the multiplication of bui.
+	 */
+	__host__ __device__
+	inline constexpr bsi& operator*=(const bsi &b) {
+		bits *= b.bits;
+		return *this;
+	}
+
+	/*
+	 * Multiplies this big int with the integer b. If b fits into el_t, this
+	 * big int is multiplied with |b| and then negated by the sign mask of b,
+	 * which avoids sign extending b to SIZE_IN_BITS.
+	 */
+	template<typename INT_T>
+	__host__ __device__
+	inline constexpr bsi& operator*=(const INT_T &b) {
+		static_assert_singed_or_unsigned_int_type<INT_T>();
+
+		if constexpr (sizeof(INT_T) <= sizeof(el_t)) {
+			const el_t mask = (el_t) -(el_t) (b < 0);
+			const el_t magnitude = (el_t) (((el_t) b ^ mask) - mask);
+
+			bits *= magnitude;
+
+			return conditional_negate(mask);
+
+		} else {
+			return *this *= bsi(b);
+		}
+	}
+
+	__host__ __device__
+	inline constexpr bsi& operator<<=(const size_t &n) {
+		bits <<= n;
+		return *this;
+	}
+
+	/*
+	 * Arithmetic right shift, i.e. rounds towards negative infinity. For
+	 * negative x, ~x is not negative and x >> n = ~(~x >> n), so the logical
+	 * shift of bui is framed by two complements with the sign mask.
+	 */
+	__host__ __device__
+	inline constexpr bsi& operator>>=(const size_t &n) {
+		const el_t mask = sign_mask();
+
+		flip(mask);
+		bits >>= n;
+		flip(mask);
+
+		return *this;
+	}
+
+	/*
+	 * Returns -1, 0 or 1 if this big int is less than, equal to or greater
+	 * than b. Values of equal signs compare like their bit patterns, else
+	 * the negative one is less.
+	 */
+	__host__ __device__
+	inline constexpr int compare(const bsi &b) const {
+		const int unsigned_cmp = bits.compare(b.bits);
+		const int sign_cmp = (int) b.is_negative() - (int) is_negative();
+
+		return (sign_cmp != 0) ? sign_cmp : unsigned_cmp;
+	}
+
+	__host__ __device__
+	inline constexpr bool operator==(const bsi &b) const {
+		return bits == b.bits;
+	}
+
+	__host__ __device__
+	inline constexpr bool operator!=(const bsi &b) const {
+		return bits != b.bits;
+	}
+
+	__host__ __device__
+	inline constexpr bool operator<(const bsi &b) const {
+		return compare(b) < 0;
+	}
+
+	__host__ __device__
+	inline constexpr bool operator>(const bsi &b) const {
+		return compare(b) > 0;
+	}
+
+	__host__ __device__
+	inline constexpr bool operator<=(const bsi &b) const {
+		return compare(b) <= 0;
+	}
+
+	__host__ __device__
+	inline constexpr bool operator>=(const bsi &b) const {
+		return compare(b) >= 0;
+	}
+
+#if __cplusplus >= 202002L
+	__host__ __device__
+	inline constexpr std::strong_ordering operator<=>(const bsi &b) const {
+		return compare(b) <=> 0;
+	}
+#endif
+
+	/*
+	 * Returns the decimal representation of this big int, with a leading '-'
+	 * if it's negative.
+	 */
+	inline std::string str() const {
+		return is_negative() ? "-" + abs().str() : abs().str();
+	}
+
+private:
+	/*
+	 * Replaces the bits of this big int by bits ^ mask.
+	 */
+	__host__ __device__
+	inline constexpr void flip(const el_t &mask) {
+#ifdef __NVCC__
+#pragma unroll
+#endif
+		for (size_t i = 0; i < SIZE_IN_ELS; i++) {
+			bits.el[i] ^= mask;
+		}
+	}
+};
+
+/*
+ * Returns the full product of a and b with twice the size of the factors.
+ * For a = u_a - s_a * 2^SIZE_IN_BITS with the bit pattern u_a and the sign
+ * bit s_a, and b likewise, the product modulo 2^(2 * SIZE_IN_BITS) is
+ *
+ * u_a * u_b - (s_a * u_b + s_b * u_a) * 2^SIZE_IN_BITS,
+ *
+ * so the unsigned full product is corrected by subtracting the bit patterns,
+ * masked by the sign of the other factor, from its upper half.
+ */
+template<size_t SIZE_IN_BITS, typename EL_T>
+__host__ __device__
+inline constexpr bsi<2 * SIZE_IN_BITS, EL_T> mul_full(const bsi<SIZE_IN_BITS, EL_T> &a, const bsi<SIZE_IN_BITS, EL_T> &b) {
+	constexpr size_t N = bsi<SIZE_IN_BITS, EL_T>::SIZE_IN_ELS;
+
+	bsi<2 * SIZE_IN_BITS, EL_T> result(mul_full(a.bits, b.bits));
+
+	const EL_T a_mask = a.sign_mask();
+	const EL_T b_mask = b.sign_mask();
+
+	EL_T t[N] = { };
+
+#ifdef __NVCC__
+#pragma unroll
+#endif
+	for (size_t i = 0; i < N; i++) {
+		t[i] = b.bits.el[i] & a_mask;
+	}
+
+	els_sub<N, N>(result.bits.el + N, t);
+
+#ifdef __NVCC__
+#pragma unroll
+#endif
+	for (size_t i = 0; i < N; i++) {
+		t[i] = a.bits.el[i] & b_mask;
+	}
+
+	els_sub<N, N>(result.bits.el + N, t);
+
+	return result;
+}
+
+template<size_t SIZE_IN_BITS, typename EL_T>
+inline std::string to_string(const bsi<SIZE_IN_BITS, EL_T> &x) {
+	return x.str();
+}
+
+template<size_t SIZE_IN_BITS, typename EL_T>
+inline std::ostream& operator<<(std::ostream &os, const bsi<SIZE_IN_BITS, EL_T> &x) {
+	return os << x.str();
+}
+
+} /* namespace bifsi */
+
+#endif /* BIFSI_SIGNED_H_ */
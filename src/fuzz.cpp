@@ -0,0 +1,799 @@
+/*
+ * fuzz.cpp
+ * published: 2022-09-04
+ * last change: 2022-09-04
+ *
+ * Copyright 2022 Daniel Strecker
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Stand alone program for differential testing of the bifsi library against
+ * GMP. You don't need this file for using the library. Link with -lgmp.
+ *
+ * Each worker thread checks the operations of bui for sizes from 64 to 4096
+ * bits and the element types uint8_t, uint16_t, uint32_t and uint64_t against
+ * the mpn and mpz functions of GMP, round after round, until the time is up
+ * or a check fails. The results are compared by their limbs, without
+ * converting them to strings, except for the checks of str and from_chars.
+ *
+ * Half of the operands are uniformly random, the other half are biased
+ * towards the edge cases of the carry chains and the division: their
+ * elements are 0, 1, all ones, all ones but the lowest bit, only the top bit,
+ * all but the top bit or random, and some of them have leading zero elements.
+ * The random numbers come from one xoshiro256** generator per thread, seeded
+ * with the seed and the index of the thread.
+ *
+ * Compiled with nvcc, --cuda additionally checks the results of the kernels
+ * of bifsi_cuda.cuh, including the warp-cooperative ones of bifsi_cg.h,
+ * against the same operations on the host, on the main thread.
+ *
+ * Usage: fuzz [--threads <n>] [--seconds <s>] [--seed <seed>] [--cuda]
+ */
+
+#include <gmp.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bifsi.h"
+#include "bifsi_gcd.h"
+#include "bifsi_pow.h"
+
+#ifdef __NVCC__
+#include "bifsi_cuda.cuh"
+#endif
+
+using std::cout;
+using std::endl;
+using std::string;
+
+static_assert(GMP_NUMB_BITS == 64 && GMP_NAIL_BITS == 0, "constraint not fulfilled: 64 bit GMP limbs without nails");
+
+#if !defined(__BYTE_ORDER__) || __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+#error "fuzz.cpp compares the bytes of bui and mpn limbs, which needs a little endian host"
+#endif
+
+/*
+ * xoshiro256** of Blackman and Vigna, with the state initialized by
+ * splitmix64.
+ */
+class xoshiro256ss {
+public:
+	inline explicit xoshiro256ss(uint64_t seed) {
+		for (uint64_t &x : s) {
+			seed += 0x9e3779b97f4a7c15ULL;
+
+			uint64_t z = seed;
+			z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+			z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+
+			x = z ^ (z >> 31);
+		}
+	}
+
+	inline uint64_t operator()() {
+		const uint64_t result = rotl(s[1] * 5, 7) * 9;
+		const uint64_t t = s[1] << 17;
+
+		s[2] ^= s[0];
+		s[3] ^= s[1];
+		s[1] ^= s[2];
+		s[0] ^= s[3];
+		s[2] ^= t;
+		s[3] = rotl(s[3], 45);
+
+		return result;
+	}
+
+	/*
+	 * Returns a random number less than n, which must not be 0.
+	 */
+	inline size_t below(const size_t &n) {
+		return (size_t) (((unsigned __int128) (*this)() * n) >> 64);
+	}
+
+private:
+	uint64_t s[4];
+
+	static inline uint64_t rotl(const uint64_t &x, const int &k) {
+		return (x << k) | (x >> (64 - k));
+	}
+};
+
+/*
+ * Returns a random value, biased towards edge cases for half of the calls,
+ * see the comment at the top of this file.
+ */
+template<size_t SIZE_IN_BITS, typename EL_T>
+bifsi::bui<SIZE_IN_BITS, EL_T> random_value(xoshiro256ss &rng) {
+	typedef bifsi::bui<SIZE_IN_BITS, EL_T> bui_t;
+
+	constexpr size_t N = bui_t::SIZE_IN_ELS;
+	constexpr EL_T ONES = (EL_T) ~(EL_T) 0;
+	constexpr EL_T TOP = (EL_T) ((EL_T) 1 << (sizeof(EL_T) * 8 - 1));
+	constexpr size_t PATTERN_COUNT = 6;
+
+	const EL_T patterns[PATTERN_COUNT] = { 0, 1, ONES, (EL_T) (ONES - 1), TOP, (EL_T) (TOP - 1) };
+
+	bui_t result;
+
+	const uint64_t mode = rng();
+
+	if ((mode & 1) == 0) {
+		for (size_t i = 0; i < N; i++) {
+			result.el[i] = (EL_T) rng();
+		}
+
+		return result;
+	}
+
+	// the same pattern for all elements, or one per element, one more for
+	// random elements
+	const bool same = (mode & 2) != 0;
+	const size_t pattern = rng.below(PATTERN_COUNT + 1);
+
+	for (size_t i = 0; i < N; i++) {
+		const size_t p = same ? pattern : rng.below(PATTERN_COUNT + 1);
+		result.el[i] = (p < PATTERN_COUNT) ? patterns[p] : (EL_T) rng();
+	}
+
+	if ((mode & 4) != 0) {
+		for (size_t i = rng.below(N) + 1; i < N; i++) {
+			result.el[i] = 0;
+		}
+	}
+
+	return result;
+}
+
+/*
+ * Number of 64 bit GMP limbs of a bui of SIZE_IN_BITS.
+ */
+template<size_t SIZE_IN_BITS>
+constexpr size_t limb_count() {
+	static_assert(SIZE_IN_BITS % GMP_NUMB_BITS == 0, "constraint not fulfilled: SIZE_IN_BITS % GMP_NUMB_BITS == 0");
+
+	return SIZE_IN_BITS / GMP_NUMB_BITS;
+}
+
+template<size_t SIZE_IN_BITS, typename EL_T>
+void to_limbs(const bifsi::bui<SIZE_IN_BITS, EL_T> &x, mp_limb_t *r) {
+	x.to_bytes((uint8_t*) r, bifsi::byte_order::little);
+}
+
+template<size_t SIZE_IN_BITS, typename EL_T>
+bool equal_limbs(const bifsi::bui<SIZE_IN_BITS, EL_T> &x, const mp_limb_t *expected) {
+	mp_limb_t actual[limb_count<SIZE_IN_BITS>()];
+	to_limbs(x, actual);
+
+	return std::memcmp(actual, expected, sizeof(actual)) == 0;
+}
+
+template<size_t SIZE_IN_BITS, typename EL_T>
+void to_mpz(mpz_t r, const bifsi::bui<SIZE_IN_BITS, EL_T> &x) {
+	mpz_import(r, bifsi::bui<SIZE_IN_BITS, EL_T>::SIZE_IN_ELS, -1, sizeof(EL_T), 0, 0, x.el);
+}
+
+/*
+ * Returns true if x equals the nonnegative expected.
+ */
+template<size_t SIZE_IN_BITS, typename EL_T>
+bool equal_mpz(const bifsi::bui<SIZE_IN_BITS, EL_T> &x, const mpz_t expected) {
+	constexpr size_t N = bifsi::bui<SIZE_IN_BITS, EL_T>::SIZE_IN_ELS;
+
+	if (mpz_sgn(expected) < 0 || mpz_sizeinbase(expected, 2) > SIZE_IN_BITS) {
+		return false;
+	}
+
+	EL_T els[N] = { };
+	mpz_export(els, nullptr, -1, sizeof(EL_T), 0, 0, expected);
+
+	return std::memcmp(els, x.el, sizeof(els)) == 0;
+}
+
+/*
+ * Returns the hexadecimal representation of x, for the failure reports.
+ */
+template<size_t SIZE_IN_BITS, typename EL_T>
+string hex(const bifsi::bui<SIZE_IN_BITS, EL_T> &x) {
+	mpz_t z;
+	mpz_init(z);
+	to_mpz(z, x);
+
+	std::vector<char> buf(mpz_sizeinbase(z, 16) + 2);
+	mpz_get_str(buf.data(), 16, z);
+
+	mpz_clear(z);
+
+	return string("0x") + buf.data();
+}
+
+/*
+ * GMP integers of a worker, initialized once, so the checks with mpz don't
+ * allocate in each round.
+ */
+struct mpz_temps {
+	mpz_t a;
+	mpz_t b;
+	mpz_t n;
+	mpz_t e;
+	mpz_t r;
+	mpz_t s;
+
+	inline mpz_temps() {
+		mpz_inits(a, b, n, e, r, s, nullptr);
+	}
+
+	mpz_temps(const mpz_temps&) = delete;
+	mpz_temps& operator=(const mpz_temps&) = delete;
+
+	inline ~mpz_temps() {
+		mpz_clears(a, b, n, e, r, s, nullptr);
+	}
+};
+
+std::atomic<bool> stopping(false);
+std::atomic<bool> failed(false);
+std::atomic<uint64_t> total_checks(0);
+
+std::mutex report_mutex;
+
+/*
+ * Prints the failure of a check of op with the operands of the round and
+ * stops all workers.
+ */
+template<size_t SIZE_IN_BITS, typename EL_T>
+void report(const char *op, const bifsi::bui<SIZE_IN_BITS, EL_T> &a, const bifsi::bui<SIZE_IN_BITS, EL_T> &b, const bifsi::bui<SIZE_IN_BITS, EL_T> &c, const size_t &shift, const EL_T &m) {
+	std::lock_guard<std::mutex> lock(report_mutex);
+
+	cout << "check failed: " << op << " of " << bifsi::type_name<bifsi::bui<SIZE_IN_BITS, EL_T>>() << ":" << endl;
+	cout << "a    : " << hex(a) << endl;
+	cout << "b    : " << hex(b) << endl;
+	cout << "c    : " << hex(c) << endl;
+	cout << "shift: " << shift << endl;
+	cout << "m    : " << (uint64_t) m << endl;
+
+	failed = true;
+	stopping = true;
+}
+
+/*
+ * Checks rounds rounds of all operations of bui<SIZE_IN_BITS, EL_T> against
+ * GMP and adds the number of checks to checks. The cheap operations are
+ * checked in each round, the ones which are much more expensive than a
+ * multiplication in one of 16 rounds, and the fixed base and multi
+ * exponentiation in one of 64. Returns false on the first failure.
+ */
+template<size_t SIZE_IN_BITS, typename EL_T>
+bool fuzz(xoshiro256ss &rng, mpz_temps &z, const size_t &rounds, uint64_t &checks) {
+	typedef bifsi::bui<SIZE_IN_BITS, EL_T> bui_t;
+	typedef bifsi::bui<64, EL_T> exp_t;
+
+	constexpr size_t L = limb_count<SIZE_IN_BITS>();
+
+	for (size_t round = 0; round < rounds; round++) {
+		const bui_t a = random_value<SIZE_IN_BITS, EL_T>(rng);
+		const bui_t b = random_value<SIZE_IN_BITS, EL_T>(rng);
+		const bui_t c = random_value<SIZE_IN_BITS, EL_T>(rng);
+		const size_t shift = rng.below(SIZE_IN_BITS + 16);
+
+		EL_T m = (EL_T) ((rng() & 1) ? rng() : rng() >> rng.below(64));
+		m += (m == 0);
+
+		bool ok = true;
+
+		auto check = [&](const char *op, const bool &passed) {
+			checks++;
+
+			if (!passed && ok) {
+				report<SIZE_IN_BITS, EL_T>(op, a, b, c, shift, m);
+				ok = false;
+			}
+		};
+
+		mp_limb_t al[L];
+		mp_limb_t bl[L];
+		mp_limb_t cl[L];
+		mp_limb_t t[2 * L];
+		mp_limb_t u[2 * L];
+
+		to_limbs(a, al);
+		to_limbs(b, bl);
+		to_limbs(c, cl);
+
+		// carry chains
+		bui_t x = a;
+		bifsi::els_add<bui_t::SIZE_IN_ELS, bui_t::SIZE_IN_ELS>(x.el, b.el);
+		mpn_add_n(t, al, bl, L);
+		check("add", equal_limbs(x, t));
+
+		x = a;
+		bifsi::els_sub<bui_t::SIZE_IN_ELS, bui_t::SIZE_IN_ELS>(x.el, b.el);
+		mpn_sub_n(t, al, bl, L);
+		check("sub", equal_limbs(x, t));
+
+		// products, truncated and full
+		mpn_mul_n(t, al, bl, L);
+
+		x = a;
+		x *= b;
+		check("mul", equal_limbs(x, t));
+		check("mul vartime", equal_limbs(bifsi::mul<bifsi::vartime>(a, b), t));
+		check("mul_full", equal_limbs(bifsi::mul_full(a, b), t));
+		check("mul_full vartime", equal_limbs(bifsi::mul_full<bifsi::vartime>(a, b), t));
+
+		mpn_add(u, t, 2 * L, cl, L);
+		check("mul_add", equal_limbs(bifsi::mul_add(a, b, c), u));
+
+		mpn_sqr(t, al, L);
+
+		x = a;
+		x.square();
+		check("square", equal_limbs(x, t));
+		check("sqr", equal_limbs(bifsi::sqr(a), t));
+		check("sqr vartime", equal_limbs(bifsi::sqr<bifsi::vartime>(a), t));
+
+		// division by a bui, normalized to its highest nonzero limb for GMP
+		bui_t d = b;
+		d += (unsigned int) d.is_zero();
+
+		mp_limb_t dl[L];
+		to_limbs(d, dl);
+
+		size_t dn = L;
+
+		while (dl[dn - 1] == 0) {
+			dn--;
+		}
+
+		mp_limb_t q[L + 1] = { };
+		mp_limb_t r[L] = { };
+		mpn_tdiv_qr(q, r, 0, al, L, dl, dn);
+
+		const bifsi::divmod_result<SIZE_IN_BITS, SIZE_IN_BITS, EL_T> qr = bifsi::divmod(a, d);
+		check("divmod q", equal_limbs(qr.q, q));
+		check("divmod r", equal_limbs(qr.r, r));
+
+		const bifsi::divmod_result<SIZE_IN_BITS, SIZE_IN_BITS, EL_T> qr_ct = bifsi::divmod_ct(a, d);
+		check("divmod_ct q", equal_limbs(qr_ct.q, q));
+		check("divmod_ct r", equal_limbs(qr_ct.r, r));
+
+		const bifsi::divmod_result<SIZE_IN_BITS, SIZE_IN_BITS, EL_T> qr_vt = bifsi::divmod<bifsi::vartime>(a, d);
+		check("divmod vartime q", equal_limbs(qr_vt.q, q));
+		check("divmod vartime r", equal_limbs(qr_vt.r, r));
+
+		// division by an element, with and without its reciprocal
+		x = a;
+		const EL_T rem = x /= m;
+		const mp_limb_t rem_expected = mpn_divrem_1(t, 0, al, L, (mp_limb_t) m);
+		check("div_el q", equal_limbs(x, t));
+		check("div_el r", rem == rem_expected);
+
+		const bifsi::divmod_result<SIZE_IN_BITS, sizeof(EL_T) * 8, EL_T> qr_el = bifsi::divmod(a, bifsi::divisor<EL_T>(m));
+		check("divmod divisor q", equal_limbs(qr_el.q, t));
+		check("divmod divisor r", qr_el.r.el[0] == rem_expected);
+
+		const bifsi::divmod_result<SIZE_IN_BITS, sizeof(EL_T) * 8, EL_T> qr_el_vt = bifsi::divmod<bifsi::vartime>(a, bifsi::divisor<EL_T>(m));
+		check("divmod divisor vartime q", equal_limbs(qr_el_vt.q, t));
+		check("divmod divisor vartime r", qr_el_vt.r.el[0] == rem_expected);
+
+		// shifts by limbs and bits
+		std::memset(t, 0, sizeof(t));
+		std::memset(u, 0, sizeof(u));
+
+		if (shift < SIZE_IN_BITS) {
+			const size_t limbs = shift / GMP_NUMB_BITS;
+			const unsigned int bits = shift % GMP_NUMB_BITS;
+
+			if (bits != 0) {
+				mpn_lshift(t + limbs, al, L - limbs, bits);
+				mpn_rshift(u, al + limbs, L - limbs, bits);
+			} else {
+				std::memcpy(t + limbs, al, (L - limbs) * sizeof(mp_limb_t));
+				std::memcpy(u, al + limbs, (L - limbs) * sizeof(mp_limb_t));
+			}
+		}
+
+		x = a;
+		x <<= shift;
+		check("shl", equal_limbs(x, t));
+
+		x = a;
+		x >>= shift;
+		check("shr", equal_limbs(x, u));
+
+		const int cmp = mpn_cmp(al, bl, L);
+		check("compare", ((a.compare(b) > 0) - (a.compare(b) < 0)) == ((cmp > 0) - (cmp < 0)));
+		check("compare vartime", a.template compare<bifsi::vartime>(b) == ((cmp > 0) - (cmp < 0)));
+		check("==", (a == b) == (cmp == 0));
+		check("<", (a < b) == (cmp < 0));
+
+		if (!ok) {
+			return false;
+		}
+
+		if (rng.below(16) != 0) {
+			continue;
+		}
+
+		// the expensive ones with mpz
+		to_mpz(z.a, a);
+		to_mpz(z.b, b);
+
+		if constexpr (SIZE_IN_BITS / 2 % (sizeof(EL_T) * 8) == 0) {
+			typedef bifsi::bui<SIZE_IN_BITS / 2, EL_T> half_t;
+
+			half_t dh = random_value<SIZE_IN_BITS / 2, EL_T>(rng);
+			dh += (unsigned int) dh.is_zero();
+
+			to_mpz(z.n, dh);
+			mpz_tdiv_qr(z.r, z.s, z.a, z.n);
+
+			const bifsi::divmod_result<SIZE_IN_BITS, SIZE_IN_BITS / 2, EL_T> qr_half = bifsi::divmod(a, dh);
+			check("divmod half q", equal_mpz(qr_half.q, z.r));
+			check("divmod half r", equal_mpz(qr_half.r, z.s));
+		}
+
+		// an odd modulus > 1
+		bui_t n = c;
+		n.el[0] |= 1;
+		n += (n == 1U) * 2U;
+
+		const bifsi::montgomery<SIZE_IN_BITS, EL_T> mont(n);
+		to_mpz(z.n, n);
+
+		mpz_mul(z.r, z.a, z.b);
+		mpz_mod(z.r, z.r, z.n);
+		check("mont_mul", equal_mpz(mont.from_mont(mont.mont_mul(mont.to_mont(a), mont.to_mont(b))), z.r));
+
+		mpz_mul(z.r, z.a, z.a);
+		mpz_mod(z.r, z.r, z.n);
+		check("mont_sqr", equal_mpz(mont.from_mont(mont.mont_sqr(mont.to_mont(a))), z.r));
+
+		const exp_t e = random_value<64, EL_T>(rng);
+		to_mpz(z.e, e);
+
+		mpz_powm(z.r, z.a, z.e, z.n);
+		check("mod_pow", equal_mpz(mont.mod_pow(a, e), z.r));
+
+		check("gcd", (mpz_gcd(z.r, z.a, z.b), equal_mpz(bifsi::gcd(a, b), z.r)));
+
+		const bool invertible = mpz_invert(z.r, z.a, z.n) != 0;
+		check("mod_inverse", invertible ? equal_mpz(bifsi::mod_inverse(a, n), z.r) : bifsi::mod_inverse(a, n).is_zero());
+
+		// conversions to and from text
+		std::vector<char> buf(mpz_sizeinbase(z.a, 10) + 2);
+		mpz_get_str(buf.data(), 10, z.a);
+		check("str", a.str() == buf.data());
+		check("str vartime", a.template str<bifsi::vartime>() == buf.data());
+
+		buf.resize(mpz_sizeinbase(z.a, 16) + 2);
+		mpz_get_str(buf.data(), 16, z.a);
+
+		bui_t parsed = 0U;
+		bifsi::from_chars(buf.data(), buf.data() + std::strlen(buf.data()), parsed, 16);
+		check("from_chars hex", parsed == a);
+
+		buf.resize(mpz_sizeinbase(z.a, 10) + 2);
+		mpz_get_str(buf.data(), 10, z.a);
+
+		parsed = 0U;
+		bifsi::from_chars<bifsi::vartime>(buf.data(), buf.data() + std::strlen(buf.data()), parsed);
+		check("from_chars vartime", parsed == a);
+
+		if (rng.below(4) == 0) {
+			// fixed base with g = a, and the product of a^e * b^e2 * c^e3,
+			// with a random method
+			const bifsi::fixed_base_table<SIZE_IN_BITS, 64, 4, EL_T> table(mont, a);
+			check("fixed_base_table", equal_mpz(table.mod_pow(mont, e), (mpz_powm(z.r, z.a, z.e, z.n), z.r)));
+
+			const bui_t bases[3] = { a, b, c };
+			const exp_t exps[3] = { e, random_value<64, EL_T>(rng), random_value<64, EL_T>(rng) };
+
+			mpz_set_ui(z.s, 1);
+
+			for (size_t i = 0; i < 3; i++) {
+				to_mpz(z.a, bases[i]);
+				to_mpz(z.e, exps[i]);
+				mpz_powm(z.r, z.a, z.e, z.n);
+				mpz_mul(z.s, z.s, z.r);
+				mpz_mod(z.s, z.s, z.n);
+			}
+
+			const size_t w = rng.below(4) + 1;
+			const bool pippenger = (rng() & 1) != 0;
+			const bifsi::multi_pow_plan plan = { pippenger, w, pippenger ? (((size_t) 1) << w) + 3 : 3 * ((((size_t) 1) << w) - 1) };
+
+			std::vector<bui_t> scratch(plan.scratch_size);
+			check(pippenger ? "multi_pow pippenger" : "multi_pow straus", equal_mpz(bifsi::multi_pow(mont, bases, exps, 3, scratch.data(), plan), z.s));
+		}
+
+		if (!ok) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/*
+ * One round over the sizes of the element type EL_T, each one with about
+ * the same time per round.
+ */
+template<typename EL_T>
+bool fuzz_el_type(xoshiro256ss &rng, mpz_temps &z, uint64_t &checks) {
+	bool ok = fuzz<64, EL_T>(rng, z, 64, checks);
+	ok = ok && fuzz<128, EL_T>(rng, z, 32, checks);
+	ok = ok && fuzz<192, EL_T>(rng, z, 24, checks);
+	ok = ok && fuzz<256, EL_T>(rng, z, 16, checks);
+	ok = ok && fuzz<384, EL_T>(rng, z, 12, checks);
+	ok = ok && fuzz<512, EL_T>(rng, z, 8, checks);
+	ok = ok && fuzz<1024, EL_T>(rng, z, 4, checks);
+
+	if (sizeof(EL_T) >= 2) {
+		ok = ok && fuzz<2048, EL_T>(rng, z, 2, checks);
+	}
+
+	if (sizeof(EL_T) >= 4) {
+		ok = ok && fuzz<4096, EL_T>(rng, z, 1, checks);
+	}
+
+	return ok;
+}
+
+void worker(const uint64_t seed, const size_t idx) {
+	xoshiro256ss rng(seed ^ (0x9e3779b97f4a7c15ULL * (idx + 1)));
+	mpz_temps z;
+
+	while (!stopping) {
+		uint64_t checks = 0;
+
+		const bool ok = fuzz_el_type<uint8_t>(rng, z, checks) && fuzz_el_type<uint16_t>(rng, z, checks) && fuzz_el_type<uint32_t>(rng, z, checks) && fuzz_el_type<uint64_t>(rng, z, checks);
+
+		total_checks += checks;
+
+		if (!ok) {
+			return;
+		}
+	}
+}
+
+#ifdef __NVCC__
+/*
+ * Checks the kernels of bifsi_cuda.cuh for count elements against the same
+ * operations on the host, which the workers check against GMP.
+ */
+template<size_t SIZE_IN_BITS, typename EL_T>
+bool fuzz_cuda(bifsi::cuda::launcher &launcher, xoshiro256ss &rng, const size_t &count, uint64_t &checks) {
+	typedef bifsi::bui<SIZE_IN_BITS, EL_T> bui_t;
+	typedef bifsi::bui<64, EL_T> exp_t;
+
+	std::vector<bui_t> a(count);
+	std::vector<bui_t> b(count);
+	std::vector<bui_t> r(count);
+	std::vector<exp_t> e(count);
+	std::vector<uint8_t> p(count);
+
+	for (size_t i = 0; i < count; i++) {
+		a[i] = random_value<SIZE_IN_BITS, EL_T>(rng);
+		b[i] = random_value<SIZE_IN_BITS, EL_T>(rng);
+		e[i] = random_value<64, EL_T>(rng);
+
+		// nonzero for mod, and odd and greater than 2 plus the largest
+		// Miller-Rabin base for miller_rabin
+		b[i].el[0] |= 0x83;
+	}
+
+	const bifsi::montgomery<SIZE_IN_BITS, EL_T> mont(b[0]);
+	const bifsi::fixed_base_table<SIZE_IN_BITS, 64, 4, EL_T> table(mont, a[0]);
+
+	bool ok = true;
+
+	auto check = [&](const char *op, const size_t &i, const bool &passed) {
+		checks++;
+
+		if (!passed && ok) {
+			report<SIZE_IN_BITS, EL_T>(op, a[i], b[i], bui_t(0U), 0, 0);
+			ok = false;
+		}
+	};
+
+	launcher.add(r.data(), a.data(), b.data(), count);
+
+	for (size_t i = 0; i < count; i++) {
+		bui_t x = a[i];
+		bifsi::els_add<bui_t::SIZE_IN_ELS, bui_t::SIZE_IN_ELS>(x.el, b[i].el);
+		check("cuda add", i, r[i] == x);
+	}
+
+	launcher.mul(r.data(), a.data(), b.data(), count);
+
+	for (size_t i = 0; i < count; i++) {
+		bui_t x = a[i];
+		x *= b[i];
+		check("cuda mul", i, r[i] == x);
+	}
+
+	launcher.mod(r.data(), a.data(), b.data(), count);
+
+	for (size_t i = 0; i < count; i++) {
+		check("cuda mod", i, r[i] == bifsi::divmod(a[i], b[i]).r);
+	}
+
+	launcher.mod_pow(r.data(), a.data(), e.data(), count, mont);
+
+	for (size_t i = 0; i < count; i++) {
+		check("cuda mod_pow", i, r[i] == mont.mod_pow(a[i], e[i]));
+	}
+
+	launcher.fixed_base_mod_pow(r.data(), e.data(), count, mont, table);
+
+	for (size_t i = 0; i < count; i++) {
+		check("cuda fixed_base_mod_pow", i, r[i] == table.mod_pow(mont, e[i]));
+	}
+
+	launcher.miller_rabin<4>(p.data(), b.data(), count);
+
+	for (size_t i = 0; i < count; i++) {
+		check("cuda miller_rabin", i, p[i] == (uint8_t) bifsi::prime::miller_rabin<4>(b[i]));
+	}
+
+	check("cuda multi_pow", 0, launcher.multi_pow(a.data(), e.data(), count, mont) == bifsi::multi_pow(mont, a.data(), e.data(), count));
+
+	return ok;
+}
+
+/*
+ * Checks cg_mod_pow_kernel with THREADS_PER_INT threads per value, which runs
+ * the cg_bui and cg_montgomery of bifsi_cg.h on real tiles, against mod_pow
+ * on the host.
+ */
+template<size_t SIZE_IN_BITS, size_t THREADS_PER_INT, typename EL_T>
+bool fuzz_cuda_cg(bifsi::cuda::launcher &launcher, xoshiro256ss &rng, const size_t &count, uint64_t &checks) {
+	typedef bifsi::bui<SIZE_IN_BITS, EL_T> bui_t;
+	typedef bifsi::bui<64, EL_T> exp_t;
+
+	std::vector<bui_t> a(count);
+	std::vector<bui_t> r(count);
+	std::vector<exp_t> e(count);
+
+	for (size_t i = 0; i < count; i++) {
+		a[i] = random_value<SIZE_IN_BITS, EL_T>(rng);
+		e[i] = random_value<64, EL_T>(rng);
+	}
+
+	bui_t n = random_value<SIZE_IN_BITS, EL_T>(rng);
+	n.el[0] |= 1;
+	n.el[bui_t::SIZE_IN_ELS - 1] |= (EL_T) 1 << (sizeof(EL_T) * 8 - 1);
+
+	const bifsi::montgomery<SIZE_IN_BITS, EL_T> mont(n);
+
+	launcher.cg_mod_pow<THREADS_PER_INT>(r.data(), a.data(), e.data(), count, mont);
+
+	for (size_t i = 0; i < count; i++) {
+		checks++;
+
+		if (r[i] != mont.mod_pow(a[i], e[i])) {
+			report<SIZE_IN_BITS, EL_T>("cuda cg_mod_pow", a[i], n, bui_t(0U), 0, 0);
+
+			return false;
+		}
+	}
+
+	return true;
+}
+
+template<typename EL_T>
+bool fuzz_cuda_el_type(bifsi::cuda::launcher &launcher, xoshiro256ss &rng, uint64_t &checks) {
+	bool ok = fuzz_cuda<128, EL_T>(launcher, rng, 1 << 14, checks);
+	ok = ok && fuzz_cuda<256, EL_T>(launcher, rng, 1 << 12, checks);
+	ok = ok && fuzz_cuda<1024, EL_T>(launcher, rng, 1 << 8, checks);
+	ok = ok && fuzz_cuda_cg<256, 2, EL_T>(launcher, rng, 1 << 10, checks);
+	ok = ok && fuzz_cuda_cg<1024, 8, EL_T>(launcher, rng, 1 << 8, checks);
+	ok = ok && fuzz_cuda_cg<4096, 32, EL_T>(launcher, rng, 1 << 6, checks);
+
+	return ok;
+}
+#endif
+
+int main(int argc, char **argv) {
+	size_t thread_count = std::max(1U, std::thread::hardware_concurrency());
+	double seconds = 10;
+	uint64_t seed = 12345;
+	bool cuda = false;
+
+	for (int i = 1; i < argc; i++) {
+		if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+			thread_count = std::max(1L, std::atol(argv[++i]));
+
+		} else if (std::strcmp(argv[i], "--seconds") == 0 && i + 1 < argc) {
+			seconds = std::atof(argv[++i]);
+
+		} else if (std::strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+			seed = std::strtoull(argv[++i], nullptr, 0);
+
+#ifdef __NVCC__
+		} else if (std::strcmp(argv[i], "--cuda") == 0) {
+			cuda = true;
+#endif
+
+		} else {
+			std::cerr << "usage: " << argv[0] << " [--threads <n>] [--seconds <s>] [--seed <seed>]"
+#ifdef __NVCC__
+					<< " [--cuda]"
+#endif
+					<< endl;
+			return 1;
+		}
+	}
+
+	cout << "fuzzing with " << thread_count << " threads for " << seconds << " s, seed " << seed << (cuda ? ", with cuda" : "") << endl;
+
+	const auto start = std::chrono::steady_clock::now();
+	const auto deadline = start + std::chrono::duration<double>(seconds);
+
+	std::vector<std::thread> threads;
+
+	for (size_t i = 0; i < thread_count; i++) {
+		threads.emplace_back(worker, seed, i);
+	}
+
+#ifdef __NVCC__
+	if (cuda) {
+		bifsi::cuda::launcher launcher;
+		xoshiro256ss rng(seed);
+
+		while (!stopping && std::chrono::steady_clock::now() < deadline) {
+			uint64_t checks = 0;
+
+			if (!fuzz_cuda_el_type<uint32_t>(launcher, rng, checks) || !fuzz_cuda_el_type<uint64_t>(launcher, rng, checks)) {
+				stopping = true;
+			}
+
+			total_checks += checks;
+		}
+	}
+#endif
+
+	while (!stopping && std::chrono::steady_clock::now() < deadline) {
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	}
+
+	stopping = true;
+
+	for (std::thread &t : threads) {
+		t.join();
+	}
+
+	const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	cout << total_checks << " checks in " << elapsed << " s, " << (uint64_t) (total_checks / elapsed) << " checks/s" << endl;
+
+	if (failed) {
+		return 1;
+	}
+
+	cout << "fuzzing completed successfully." << endl;
+
+	return 0;
+}
@@ -29,60 +29,2866 @@
 #include <bits/stdint-uintn.h>
 #include <stddef.h>
 #include <algorithm>
+#include <condition_variable>
+#include <cstdio>
 #include <cstdlib>
 #include <iostream>
+#include <mutex>
+#include <sstream>
 #include <stdexcept>
 #include <string>
+#include <thread>
 #include <typeinfo>
+#include <vector>
 
 #include "bifsi.h"
+#include "bifsi_batch.h"
+#include "bifsi_cg.h"
+#include "bifsi_gcd.h"
+#include "bifsi_host.h"
+#include "bifsi_io.h"
+#include "bifsi_mod.h"
+#include "bifsi_pow.h"
+#include "bifsi_prime.h"
+#include "bifsi_signed.h"
 
 using std::cout;
 using std::endl;
 using std::flush;
 using std::string;
-using bifsi::bui;
 using bifsi::to_string;
 
+/*
+ * Element type of the values of most tests. The sizes of these tests are
+ * multiples of 32 bits, so they don't depend on the default element type of
+ * the platform. test_el_types runs the operations with the other element
+ * types.
+ */
+typedef uint32_t el_t;
+
+const size_t EL_SIZE_IN_BITS = sizeof(el_t) * 8;
+
+template<size_t SIZE_IN_BITS>
+using bui = bifsi::bui<SIZE_IN_BITS, el_t>;
+
 typedef unsigned __int128 uint128_t;
 
-inline std::string to_string(uint128_t x) {
-	constexpr double LOG_BASE10_2 = 0.301029995663981195; //std::log10((double) 2);
+inline std::string to_string(uint128_t x) {
+	constexpr double LOG_BASE10_2 = 0.301029995663981195; //std::log10((double) 2);
+
+	constexpr int32_t INT128_SIZE_IN_BITS = sizeof(uint128_t) * 8;
+
+	constexpr int32_t MAX_DIGITS = bifsi::ceil_constexpr(INT128_SIZE_IN_BITS * LOG_BASE10_2);
+
+	char result[MAX_DIGITS + 1];
+
+	uint32_t i = 0;
+
+	while (x != 0) {
+		result[i] = '0' + (char) (x % 10);
+		x /= 10;
+
+		i++;
+	}
+
+	if (i == 0) {
+		return "0";
+	}
+
+	result[i] = '\0';
+
+	std::reverse(result, result + i);
+
+	return std::string(result);
+}
+
+inline std::ostream& operator<<(std::ostream &os, const uint128_t &x) {
+	return os << to_string(x);
+}
+
+inline uint128_t to_uint128(const bui<128> &x) {
+	uint128_t result = 0;
+
+	for (size_t i = bui<128>::SIZE_IN_ELS - 1; i != (size_t) -1; i--) {
+		result <<= EL_SIZE_IN_BITS;
+		result |= x.el[i];
+	}
+
+	return result;
+}
+
+inline bui<128> from_uint128(uint128_t x) {
+	bui<128> result;
+
+	for (size_t i = 0; i < bui<128>::SIZE_IN_ELS; i++) {
+		result.el[i] = (el_t) (x >> i * EL_SIZE_IN_BITS);
+	}
+
+	return result;
+}
+
+template<size_t SIZE_IN_BITS>
+bui<SIZE_IN_BITS> random_bui() {
+	bui<SIZE_IN_BITS> result;
+
+	for (size_t i = 0; i < bui<SIZE_IN_BITS>::SIZE_IN_ELS; i++) {
+		result.el[i] = (el_t) (((uint64_t) std::rand() << 33) ^ ((uint64_t) std::rand() << 16) ^ std::rand());
+	}
+
+	return result;
+}
+
+template<size_t SIZE_IN_BITS>
+bool equal_els(const bui<SIZE_IN_BITS> &a, const el_t *b) {
+	for (size_t i = 0; i < bui<SIZE_IN_BITS>::SIZE_IN_ELS; i++) {
+		if (a.el[i] != b[i]) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/*
+ * Checks the Karatsuba and NTT dispatch of bui<SIZE_IN_BITS> multiplication
+ * against the plain Comba kernel.
+ */
+template<size_t SIZE_IN_BITS>
+int test_mul_against_comba(size_t test_count) {
+	constexpr size_t N = bui<SIZE_IN_BITS>::SIZE_IN_ELS;
+
+	for (size_t i = 0; i < test_count; i++) {
+		bui<SIZE_IN_BITS> a = random_bui<SIZE_IN_BITS>();
+		bui<SIZE_IN_BITS> b = random_bui<SIZE_IN_BITS>();
+
+		if (i == 0) {
+			// all ones, maximizes carries
+			a = 0;
+			a -= 1;
+			b = a;
+		}
+
+		el_t expected[2 * N];
+		bifsi::comba_mul<2 * N, N, N>(expected, a.el, b.el);
+
+		bui<2 * SIZE_IN_BITS> actual_full = bifsi::mul_full(a, b);
+
+		bui<SIZE_IN_BITS> actual = a;
+		actual *= b;
+
+		if (!equal_els(actual_full, expected) || !equal_els(actual, expected)) {
+			cout << "test failed: mul of " << bifsi::type_name<bui<SIZE_IN_BITS>>() << " differs from comba_mul:" << endl;
+			cout << "i       : " << i << endl;
+			cout << "a       : " << a << endl;
+			cout << "b       : " << b << endl;
+			cout << "actual  : " << actual_full << endl;
+
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+/*
+ * Checks the NTT kernel ntt_mul for the full and the truncated product and
+ * the square, with the temporaries on the stack and from the caller, against
+ * the plain Comba kernel, also below the size at which mul_els dispatches to
+ * it.
+ */
+template<size_t SIZE_IN_BITS, typename EL_T>
+int test_ntt_against_comba(size_t test_count) {
+	typedef bifsi::bui<SIZE_IN_BITS, EL_T> bui_t;
+
+	constexpr size_t N = bui_t::SIZE_IN_ELS;
+
+	// the temporaries of ntt_mul from the caller, on the heap
+	std::vector<uint32_t> scratch(bifsi::ntt_scratch_size<N, EL_T>());
+
+	for (size_t i = 0; i < test_count; i++) {
+		bui_t a = bifsi::el_cast<EL_T>(random_bui<SIZE_IN_BITS>());
+		bui_t b = bifsi::el_cast<EL_T>(random_bui<SIZE_IN_BITS>());
+
+		if (i == 0) {
+			// all ones, maximizes the coefficients and carries
+			a = 0U;
+			a -= 1U;
+			b = a;
+		}
+
+		EL_T expected[2 * N];
+		EL_T expected_sqr[2 * N];
+		bifsi::comba_mul<2 * N, N, N>(expected, a.el, b.el);
+		bifsi::comba_mul<2 * N, N, N>(expected_sqr, a.el, a.el);
+
+		EL_T actual[2 * N];
+		EL_T actual_lo[N];
+		EL_T actual_sqr[2 * N];
+		EL_T actual_heap[2 * N];
+		bifsi::ntt_mul<2 * N, N>(actual, a.el, b.el);
+		bifsi::ntt_mul<N, N>(actual_lo, a.el, b.el);
+		bifsi::ntt_mul<2 * N, N>(actual_sqr, a.el, (const EL_T*) nullptr);
+		bifsi::ntt_mul<2 * N, N>(actual_heap, a.el, b.el, scratch.data());
+
+		const bool ok = std::equal(actual, actual + 2 * N, expected) //
+				&& std::equal(actual_lo, actual_lo + N, expected) //
+				&& std::equal(actual_sqr, actual_sqr + 2 * N, expected_sqr) //
+				&& std::equal(actual_heap, actual_heap + 2 * N, expected);
+
+		if (!ok) {
+			cout << "test failed: ntt_mul of " << bifsi::type_name<bui_t>() << " differs from comba_mul:" << endl;
+			cout << "i       : " << i << endl;
+			cout << "a       : " << a << endl;
+			cout << "b       : " << b << endl;
+
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+/*
+ * Checks sqr and square of bui<SIZE_IN_BITS, EL_T> against the
+ * multiplication of a with itself.
+ */
+template<size_t SIZE_IN_BITS, typename EL_T>
+int test_sqr_against_mul(size_t test_count) {
+	typedef bifsi::bui<SIZE_IN_BITS, EL_T> bui_t;
+
+	for (size_t i = 0; i < test_count; i++) {
+		bui_t a = bifsi::el_cast<EL_T>(random_bui<SIZE_IN_BITS>());
+
+		if (i == 0) {
+			// all ones, maximizes carries
+			a = 0;
+			a -= 1;
+		}
+
+		const bifsi::bui<2 * SIZE_IN_BITS, EL_T> expected_full = bifsi::mul_full(a, a);
+		const bifsi::bui<2 * SIZE_IN_BITS, EL_T> actual_full = bifsi::sqr(a);
+
+		bui_t expected = a;
+		expected *= a;
+
+		bui_t actual = a;
+		actual.square();
+
+		if (actual_full.str() != expected_full.str() || actual.str() != expected.str()) {
+			cout << "test failed: sqr of " << bifsi::type_name<bui_t>() << " differs from mul:" << endl;
+			cout << "i       : " << i << endl;
+			cout << "a       : " << a << endl;
+			cout << "expected: " << expected_full << endl;
+			cout << "actual  : " << actual_full << endl;
+
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+/*
+ * Checks the fused operations mul_add, mul_add_scalar, add_mod and sub_mod of
+ * bui<SIZE_IN_BITS, EL_T> against the same computations in separate steps.
+ */
+template<size_t SIZE_IN_BITS, typename EL_T>
+int test_fused(size_t test_count) {
+	typedef bifsi::bui<SIZE_IN_BITS, EL_T> bui_t;
+	typedef bifsi::bui<2 * SIZE_IN_BITS, EL_T> wide_t;
+
+	constexpr size_t N = bui_t::SIZE_IN_ELS;
+
+	for (size_t i = 0; i < test_count; i++) {
+		bui_t a = bifsi::el_cast<EL_T>(random_bui<SIZE_IN_BITS>());
+		bui_t b = bifsi::el_cast<EL_T>(random_bui<SIZE_IN_BITS>());
+		bui_t c = bifsi::el_cast<EL_T>(random_bui<SIZE_IN_BITS>());
+		bui_t n = bifsi::el_cast<EL_T>(random_bui<SIZE_IN_BITS>());
+		EL_T m = (EL_T) std::rand();
+
+		if (i == 0) {
+			// all ones, maximizes carries
+			a = 0;
+			a -= 1;
+			b = a;
+			c = a;
+			n = a;
+			m = (EL_T) -1;
+		}
+
+		n.el[0] |= 1;
+
+		wide_t expected_mul_add = bifsi::mul_full(a, b);
+		bifsi::els_add<2 * N, N>(expected_mul_add.el, c.el);
+
+		const wide_t actual_mul_add = bifsi::mul_add(a, b, c);
+
+		// a * m + c has at most N + 1 elements
+		wide_t expected_scalar = bifsi::mul_full(a, bui_t(m));
+		bifsi::els_add<2 * N, N>(expected_scalar.el, c.el);
+		const EL_T expected_scalar_carry = expected_scalar.el[N];
+		expected_scalar.el[N] = 0;
+
+		bui_t actual_scalar = c;
+		const EL_T actual_scalar_carry = actual_scalar.mul_add_scalar(a, m);
+
+		if (i == 0) {
+			a = n;
+			a -= 1;
+			b = a;
+		} else {
+			a %= n;
+			b %= n;
+		}
+
+		wide_t sum = bifsi::mul_full(a, bui_t(1U));
+		bifsi::els_add<2 * N, N>(sum.el, b.el);
+
+		wide_t diff = bifsi::mul_full(a, bui_t(1U));
+		bifsi::els_add<2 * N, N>(diff.el, n.el);
+		bifsi::els_sub<2 * N, N>(diff.el, b.el);
+
+		const bool ok = actual_mul_add == expected_mul_add //
+				&& actual_scalar == expected_scalar //
+				&& actual_scalar_carry == expected_scalar_carry //
+				&& bifsi::add_mod(a, b, n) == bifsi::divmod(sum, n).r //
+				&& bifsi::sub_mod(a, b, n) == bifsi::divmod(diff, n).r;
+
+		if (!ok) {
+			cout << "test failed: fused operations of " << bifsi::type_name<bui_t>() << ":" << endl;
+			cout << "i: " << i << endl;
+			cout << "a: " << a << endl;
+			cout << "b: " << b << endl;
+			cout << "c: " << c << endl;
+			cout << "n: " << n << endl;
+			cout << "m: " << (uint64_t) m << endl;
+
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+int test_mul() {
+	const size_t TEST_COUNT = 1000000;
+
+	cout << "running mul tests" << endl;
+
+	// the Karatsuba sizes use the Comba kernels in constant expressions,
+	// (2^1024 - 1)^2 = 2^2048 - 2^1025 + 1
+	constexpr bui<1024> M = bui<1024>(0U) -= 1U;
+	constexpr bui<2048> M2 = bifsi::mul_full(M, M);
+	static_assert(M2.el[0] == 1 && M2.el[31] == 0 && M2.el[32] == 0xfffffffe && M2.el[63] == 0xffffffff, "constexpr mul_full");
+	static_assert(bifsi::sqr(M) == M2 && (bui<1024>(M) *= M) == 1U && bui<1024>(M).square() == 1U, "constexpr sqr");
+	static_assert(bifsi::mul_add(M, M, M) == (bui<2048>(M) <<= 1024), "constexpr mul_add");
+
+	for (size_t i = 0; i < TEST_COUNT; i++) {
+		bui<128> a = random_bui<128>();
+		bui<128> b = random_bui<128>();
+
+		uint128_t expected = to_uint128(a) * to_uint128(b);
+
+		bui<128> actual = a;
+		actual *= b;
+
+		bui<64> a64 = random_bui<64>();
+		bui<64> b64 = random_bui<64>();
+
+		uint128_t expected_full = ((uint128_t) a64.as<uint64_t>()) * b64.as<uint64_t>();
+
+		bui<128> actual_full = bifsi::mul_full(a64, b64);
+
+		if (to_uint128(actual) != expected || to_uint128(actual_full) != expected_full) {
+			cout << "test failed: mul:" << endl;
+			cout << "i            : " << i << endl;
+			cout << "a            : " << a << endl;
+			cout << "b            : " << b << endl;
+			cout << "expected     : " << expected << endl;
+			cout << "actual       : " << actual << endl;
+			cout << "a64          : " << a64 << endl;
+			cout << "b64          : " << b64 << endl;
+			cout << "expected_full: " << expected_full << endl;
+			cout << "actual_full  : " << actual_full << endl;
+
+			return 1;
+		}
+	}
+
+	int result = 0;
+
+	result |= test_mul_against_comba<1024>(1000);
+	result |= test_mul_against_comba<1056>(1000);
+	result |= test_mul_against_comba<2048>(1000);
+	result |= test_mul_against_comba<4096>(200);
+	result |= test_mul_against_comba<65536>(3);
+	result |= test_ntt_against_comba<32, el_t>(1000);
+	result |= test_ntt_against_comba<96, uint8_t>(1000);
+	result |= test_ntt_against_comba<160, uint16_t>(1000);
+	result |= test_ntt_against_comba<2048, el_t>(100);
+	result |= test_ntt_against_comba<4160, uint64_t>(50);
+	result |= test_sqr_against_mul<32, el_t>(10000);
+	result |= test_sqr_against_mul<96, el_t>(10000);
+	result |= test_sqr_against_mul<1024, el_t>(1000);
+	result |= test_sqr_against_mul<1056, el_t>(1000);
+	result |= test_sqr_against_mul<2080, el_t>(200);
+	result |= test_sqr_against_mul<4096, el_t>(200);
+	result |= test_sqr_against_mul<256, uint8_t>(200);
+	result |= test_sqr_against_mul<2048, uint8_t>(20);
+	result |= test_sqr_against_mul<192, uint64_t>(1000);
+	result |= test_sqr_against_mul<2112, uint64_t>(200);
+	result |= test_sqr_against_mul<16384, uint8_t>(3);
+	result |= test_sqr_against_mul<131072, uint64_t>(2);
+	result |= test_fused<64, el_t>(10000);
+	result |= test_fused<256, uint32_t>(10000);
+	result |= test_fused<256, uint64_t>(10000);
+	result |= test_fused<256, uint8_t>(1000);
+	result |= test_fused<2048, uint64_t>(200);
+
+	if (result == 0) {
+		cout << "mul tests completed successfully." << endl;
+	}
+
+	return result;
+}
+
+/*
+ * Checks bit j of the result of shifting x by n against bit j - n or j + n of
+ * x, for the runtime shift operators and the compile-time shifts by WIDTHS.
+ */
+template<size_t SIZE_IN_BITS, typename EL_T, size_t ... WIDTHS>
+int test_shift_el_type(size_t test_count) {
+	typedef bifsi::bui<SIZE_IN_BITS, EL_T> bui_t;
+
+	constexpr size_t W = bui_t::EL_SIZE_IN_BITS;
+
+	auto bit = [](const bui_t &x, size_t j) -> int {
+		return (j < SIZE_IN_BITS) ? (x.el[j / W] >> (j % W)) & 1 : 0;
+	};
+
+	for (size_t t = 0; t < test_count; t++) {
+		const bui_t x = bifsi::el_cast<EL_T>(random_bui<SIZE_IN_BITS>());
+		const size_t n = (t < SIZE_IN_BITS + 2) ? t : std::rand() % (2 * SIZE_IN_BITS);
+
+		bui_t lo = x;
+		lo >>= n;
+
+		bui_t hi = x;
+		hi <<= n;
+
+		for (size_t j = 0; j < SIZE_IN_BITS; j++) {
+			if (bit(lo, j) != bit(x, j + n) || bit(hi, j) != ((j >= n) ? bit(x, j - n) : 0)) {
+				cout << "test failed: shift of " << bifsi::type_name<bui_t>() << ":" << endl;
+				cout << "x: " << x << endl;
+				cout << "n: " << n << endl;
+
+				return 1;
+			}
+		}
+	}
+
+	const bui_t x = bifsi::el_cast<EL_T>(random_bui<SIZE_IN_BITS>());
+
+	int result = 0;
+
+	auto check_width = [&](auto width) {
+		constexpr size_t WIDTH = decltype(width)::value;
+
+		bui_t lo = x;
+		bui_t lo_expected = x;
+		lo.template loshift<WIDTH>();
+		lo_expected >>= WIDTH;
+
+		bui_t hi = x;
+		bui_t hi_expected = x;
+		hi.template hishift<WIDTH>();
+		hi_expected <<= WIDTH;
+
+		if (lo.str() != lo_expected.str() || hi.str() != hi_expected.str()) {
+			cout << "test failed: constant shift of " << bifsi::type_name<bui_t>() << " by " << WIDTH << ":" << endl;
+			cout << "x: " << x << endl;
+
+			result = 1;
+		}
+	};
+
+	(check_width(std::integral_constant<size_t, WIDTHS>()), ...);
+
+	return result;
+}
+
+int test_shift() {
+	const size_t TEST_COUNT = 1000000;
+
+	cout << "running shift tests" << endl;
+
+	for (size_t i = 0; i < TEST_COUNT; i++) {
+		const bui<128> a = random_bui<128>();
+		const size_t n = std::rand() % 140;
+
+		const uint128_t expected_lo = (n < 128) ? to_uint128(a) >> n : 0;
+		const uint128_t expected_hi = (n < 128) ? to_uint128(a) << n : 0;
+
+		bui<128> actual_lo = a;
+		actual_lo >>= n;
+
+		bui<128> actual_hi = a;
+		actual_hi <<= n;
+
+		if (to_uint128(actual_lo) != expected_lo || to_uint128(actual_hi) != expected_hi) {
+			cout << "test failed: shift:" << endl;
+			cout << "i          : " << i << endl;
+			cout << "a          : " << a << endl;
+			cout << "n          : " << n << endl;
+			cout << "expected_lo: " << expected_lo << endl;
+			cout << "actual_lo  : " << actual_lo << endl;
+			cout << "expected_hi: " << expected_hi << endl;
+			cout << "actual_hi  : " << actual_hi << endl;
+
+			return 1;
+		}
+	}
+
+	int result = 0;
+
+	result |= test_shift_el_type<32, uint8_t, 0, 1, 7, 8, 9, 31, 32>(100);
+	result |= test_shift_el_type<256, uint8_t, 0, 1, 8, 13, 255, 256, 300>(1000);
+	result |= test_shift_el_type<256, uint32_t, 0, 1, 31, 32, 33, 200, 256>(1000);
+	result |= test_shift_el_type<1056, uint32_t, 0, 5, 64, 1055, 1056>(500);
+	result |= test_shift_el_type<2048, uint64_t, 0, 63, 64, 65, 1000, 2047, 4096>(500);
+
+	if (result == 0) {
+		cout << "shift tests completed successfully." << endl;
+	}
+
+	return result;
+}
+
+/*
+ * Returns 2^EXPONENT - 1.
+ */
+template<size_t SIZE_IN_BITS>
+constexpr bui<SIZE_IN_BITS> mersenne(size_t exponent) {
+	bui<SIZE_IN_BITS> result = 0;
+
+	for (size_t i = 0; i < exponent; i++) {
+		result.el[i / EL_SIZE_IN_BITS] |= ((el_t) 1) << (i % EL_SIZE_IN_BITS);
+	}
+
+	return result;
+}
+
+uint64_t mod_pow_reference(uint64_t base, uint64_t exp, uint64_t n) {
+	uint128_t result = 1 % n;
+	uint128_t b = base % n;
+
+	for (; exp != 0; exp >>= 1) {
+		if (exp & 1) {
+			result = result * b % n;
+		}
+
+		b = b * b % n;
+	}
+
+	return (uint64_t) result;
+}
+
+/*
+ * Checks Fermat's little theorem a^(p - 1) = 1 mod p for the prime p.
+ */
+template<size_t SIZE_IN_BITS>
+int test_montgomery_fermat(const bui<SIZE_IN_BITS> &p, size_t test_count) {
+	const bifsi::montgomery<SIZE_IN_BITS, el_t> mont(p);
+
+	bui<SIZE_IN_BITS> p_minus_1 = p;
+	p_minus_1 -= 1;
+
+	for (size_t i = 0; i < test_count; i++) {
+		bui<SIZE_IN_BITS> a = random_bui<SIZE_IN_BITS>();
+		a.el[bui<SIZE_IN_BITS>::SIZE_IN_ELS - 1] = 0; // a < p
+
+		bui<SIZE_IN_BITS> actual = mont.mod_pow(a, p_minus_1);
+
+		if (a.is_nonzero() && actual != 1) {
+			cout << "test failed: montgomery fermat:" << endl;
+			cout << "p     : " << p << endl;
+			cout << "a     : " << a << endl;
+			cout << "actual: " << actual << endl;
+
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+/*
+ * Checks mont_sqr against mont_mul of a value with itself, with a modulus
+ * close to R, so the final subtraction of n is needed often.
+ */
+template<size_t SIZE_IN_BITS, typename EL_T>
+int test_montgomery_sqr(size_t test_count) {
+	typedef bifsi::bui<SIZE_IN_BITS, EL_T> bui_t;
+
+	for (size_t i = 0; i < test_count; i++) {
+		bui_t n = bifsi::el_cast<EL_T>(random_bui<SIZE_IN_BITS>());
+		n.el[0] |= 1;
+		n.el[bui_t::SIZE_IN_ELS - 1] |= (EL_T) 1 << (bui_t::EL_SIZE_IN_BITS - 1);
+
+		const bifsi::montgomery<SIZE_IN_BITS, EL_T> mont(n);
+
+		const bui_t a = mont.to_mont(bifsi::el_cast<EL_T>(random_bui<SIZE_IN_BITS>()));
+
+		if (mont.mont_sqr(a).str() != mont.mont_mul(a, a).str()) {
+			cout << "test failed: mont_sqr of " << bifsi::type_name<bui_t>() << ":" << endl;
+			cout << "n: " << n << endl;
+			cout << "a: " << a << endl;
+
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+int test_montgomery() {
+	const size_t TEST_COUNT = 100000;
+
+	cout << "running montgomery tests" << endl;
+
+	for (size_t i = 0; i < TEST_COUNT; i++) {
+		bui<64> n = random_bui<64>();
+		n.el[0] |= 1;
+
+		const bifsi::montgomery<64, el_t> mont(n);
+
+		const uint64_t n64 = n.as<uint64_t>();
+		const uint64_t a64 = random_bui<64>().as<uint64_t>();
+		const uint64_t b64 = random_bui<64>().as<uint64_t>();
+		const uint64_t e64 = random_bui<64>().as<uint64_t>() >> (i % 64);
+
+		const uint64_t expected_mul = (uint64_t) (((uint128_t) a64) * b64 % n64);
+		const uint64_t expected_pow = mod_pow_reference(a64, e64, n64);
+
+		const bui<64> a = a64;
+		const bui<64> b = b64;
+		const bui<64> e = e64;
+
+		const bui<64> actual_mul = mont.from_mont(mont.mont_mul(mont.to_mont(a), mont.to_mont(b)));
+		const bui<64> actual_pow = mont.mod_pow(a, e);
+		const bui<64> actual_pow_w1 = mont.mod_pow<1>(a, e);
+		const bui<64> actual_pow_w8 = mont.mod_pow<8>(a, e);
+
+		if (actual_mul != expected_mul || actual_pow != expected_pow || actual_pow_w1 != expected_pow || actual_pow_w8 != expected_pow) {
+			cout << "test failed: montgomery:" << endl;
+			cout << "i           : " << i << endl;
+			cout << "n           : " << n << endl;
+			cout << "a           : " << a << endl;
+			cout << "b           : " << b << endl;
+			cout << "e           : " << e << endl;
+			cout << "expected_mul: " << expected_mul << endl;
+			cout << "actual_mul  : " << actual_mul << endl;
+			cout << "expected_pow: " << expected_pow << endl;
+			cout << "actual_pow  : " << actual_pow << endl;
+
+			return 1;
+		}
+	}
+
+	// Montgomery constants and a modular exponentiation in a constant
+	// expression, by Fermat's little theorem for the prime 2^127 - 1
+	constexpr bifsi::montgomery<128, el_t> M127(mersenne<128>(127));
+	static_assert(M127.mod_pow(bui<128>(3U), mersenne<128>(127) -= 1U) == 1U, "constexpr montgomery");
+	static_assert(M127.from_mont(M127.mont_mul(M127.to_mont(bui<128>(6U)), M127.to_mont(bui<128>(7U)))) == 42U, "constexpr montgomery");
+
+	int result = 0;
+
+	bui<256> p25519 = mersenne<256>(255);
+	p25519 -= 18;
+
+	result |= test_montgomery_fermat(mersenne<128>(127), 1000);
+	result |= test_montgomery_fermat(p25519, 100);
+	result |= test_montgomery_fermat(mersenne<544>(521), 20);
+	result |= test_montgomery_fermat(mersenne<608>(607), 20);
+	result |= test_montgomery_sqr<64, el_t>(10000);
+	result |= test_montgomery_sqr<384, el_t>(1000);
+	result |= test_montgomery_sqr<768, uint64_t>(200);
+	result |= test_montgomery_sqr<2048, el_t>(50);
+	result |= test_montgomery_sqr<256, uint8_t>(100);
+	result |= test_montgomery_sqr<2048, uint64_t>(50);
+
+	if (result == 0) {
+		cout << "montgomery tests completed successfully." << endl;
+	}
+
+	return result;
+}
+
+/*
+ * Checks fixed_base_table::mod_pow against montgomery::mod_pow for random
+ * odd moduli, bases and exponents, and the exponents 0 and 2^EXP_BITS - 1,
+ * which use the entries 0 and 2^TEETH - 1 only.
+ */
+template<size_t SIZE_IN_BITS, size_t EXP_BITS, size_t TEETH, typename EL_T>
+int test_fixed_base(size_t modulus_count, size_t test_count) {
+	typedef bifsi::bui<SIZE_IN_BITS, EL_T> bui_t;
+	typedef bifsi::bui<EXP_BITS, EL_T> exp_t;
+
+	for (size_t i = 0; i < modulus_count; i++) {
+		bui_t n = bifsi::el_cast<EL_T>(random_bui<SIZE_IN_BITS>());
+		n.el[0] |= 1;
+
+		const bifsi::montgomery<SIZE_IN_BITS, EL_T> mont(n);
+
+		// g not reduced modulo n
+		const bui_t g = bifsi::el_cast<EL_T>(random_bui<SIZE_IN_BITS>());
+		const bifsi::fixed_base_table<SIZE_IN_BITS, EXP_BITS, TEETH, EL_T> table(mont, g);
+
+		for (size_t j = 0; j < test_count + 2; j++) {
+			exp_t e = bifsi::el_cast<EL_T>(random_bui<EXP_BITS>());
+
+			if (j == test_count) {
+				e = 0U;
+			} else if (j == test_count + 1) {
+				e = 0U;
+				e -= 1U;
+			}
+
+			const bui_t expected = mont.mod_pow(g, e);
+			const bui_t actual = table.mod_pow(mont, e);
+
+			if (actual != expected) {
+				cout << "test failed: fixed_base_table<" << SIZE_IN_BITS << ", " << EXP_BITS << ", " << TEETH << ">::mod_pow of " << bifsi::type_name<bui_t>() << ":" << endl;
+				cout << "n       : " << n << endl;
+				cout << "g       : " << g << endl;
+				cout << "e       : " << e << endl;
+				cout << "expected: " << expected << endl;
+				cout << "actual  : " << actual << endl;
+
+				return 1;
+			}
+		}
+	}
+
+	return 0;
+}
+
+/*
+ * Checks multi_pow against the product of the powers computed with
+ * montgomery::mod_pow, for count terms with every Straus and Pippenger
+ * window size and the plan of get_multi_pow_plan. Some exponents are 0 or
+ * have only a few low bits, so digits and whole windows are zero.
+ */
+template<size_t SIZE_IN_BITS, size_t EXP_BITS, typename EL_T>
+int test_multi_pow(size_t count) {
+	typedef bifsi::bui<SIZE_IN_BITS, EL_T> bui_t;
+	typedef bifsi::bui<EXP_BITS, EL_T> exp_t;
+
+	bui_t n = bifsi::el_cast<EL_T>(random_bui<SIZE_IN_BITS>());
+	n.el[0] |= 1;
+
+	const bifsi::montgomery<SIZE_IN_BITS, EL_T> mont(n);
+
+	std::vector<bui_t> bases(count);
+	std::vector<exp_t> exps(count);
+
+	bui_t expected = mont.one;
+
+	for (size_t i = 0; i < count; i++) {
+		bases[i] = bifsi::el_cast<EL_T>(random_bui<SIZE_IN_BITS>());
+		exps[i] = bifsi::el_cast<EL_T>(random_bui<EXP_BITS>());
+
+		if (i % 5 == 1) {
+			exps[i] = 0U;
+		} else if (i % 5 == 2) {
+			exps[i] >>= EXP_BITS - 7;
+		}
+
+		expected = mont.mont_mul(expected, mont.to_mont(mont.mod_pow(bases[i], exps[i])));
+	}
+
+	expected = mont.from_mont(expected);
+
+	std::vector<bifsi::multi_pow_plan> plans;
+
+	for (size_t w = 1; w <= bifsi::MULTI_POW_MAX_STRAUS_WINDOW_BITS; w++) {
+		plans.push_back({ false, w, count * ((((size_t) 1) << w) - 1) });
+	}
+
+	for (size_t c = 1; c <= 8; c++) {
+		plans.push_back({ true, c, (((size_t) 1) << c) + count });
+	}
+
+	plans.push_back(bifsi::get_multi_pow_plan<EXP_BITS>(count));
+
+	for (const bifsi::multi_pow_plan &plan : plans) {
+		std::vector<bui_t> scratch(plan.scratch_size);
+
+		const bui_t actual = bifsi::multi_pow(mont, bases.data(), exps.data(), count, scratch.data(), plan);
+
+		if (actual != expected) {
+			cout << "test failed: multi_pow of " << count << " " << bifsi::type_name<bui_t>() << " with " << (plan.pippenger ? "Pippenger" : "Straus") << " and window size " << plan.window_bits << ":" << endl;
+			cout << "n       : " << n << endl;
+			cout << "expected: " << expected << endl;
+			cout << "actual  : " << actual << endl;
+
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+int test_pow() {
+	cout << "running pow tests" << endl;
+
+	// a table and an exponentiation in a constant expression, by Fermat's
+	// little theorem for the prime 2^127 - 1
+	constexpr bifsi::montgomery<128, el_t> M127(mersenne<128>(127));
+	constexpr bifsi::fixed_base_table<128, 128, 4, el_t> G3(M127, bui<128>(3U));
+	static_assert(G3.mod_pow(M127, mersenne<128>(127) -= 1U) == 1U, "constexpr fixed_base_table");
+	static_assert(G3.mod_pow(M127, bui<128>(5U)) == 243U, "constexpr fixed_base_table");
+
+	int result = 0;
+
+	result |= test_fixed_base<64, 64, 1, el_t>(100, 100);
+	result |= test_fixed_base<64, 64, 5, el_t>(100, 100);
+	result |= test_fixed_base<256, 256, 6, el_t>(20, 50);
+	result |= test_fixed_base<256, 192, 4, uint64_t>(20, 50);
+	result |= test_fixed_base<256, 64, 7, uint8_t>(10, 50);
+	result |= test_fixed_base<1024, 192, 8, uint64_t>(4, 20);
+	result |= test_fixed_base<2048, 2048, 6, el_t>(1, 5);
+
+	// Straus for few terms, Pippenger with wider windows for more terms
+	static_assert(!bifsi::get_multi_pow_plan<256>(4).pippenger, "multi_pow_plan");
+	static_assert(bifsi::get_multi_pow_plan<256>(1000).pippenger, "multi_pow_plan");
+	static_assert(bifsi::get_multi_pow_plan<256>(10000).window_bits > bifsi::get_multi_pow_plan<256>(1000).window_bits, "multi_pow_plan");
+
+	result |= test_multi_pow<64, 64, el_t>(0);
+	result |= test_multi_pow<64, 64, el_t>(1);
+	result |= test_multi_pow<64, 64, el_t>(37);
+	result |= test_multi_pow<256, 256, el_t>(3);
+	result |= test_multi_pow<256, 128, uint64_t>(100);
+	result |= test_multi_pow<256, 64, uint8_t>(20);
+	result |= test_multi_pow<1024, 256, uint64_t>(10);
+
+	if (result == 0) {
+		cout << "pow tests completed successfully." << endl;
+	}
+
+	return result;
+}
+
+/*
+ * Checks the operations of mod_bui<SIZE_IN_BITS, MODULUS_T> against the
+ * division of the unreduced results by the modulus. The first operands are
+ * n - 1, the biggest residue, for the biggest products.
+ */
+template<size_t SIZE_IN_BITS, typename MODULUS_T>
+int test_mod_bui(size_t test_count, bool expected_special_form) {
+	typedef bifsi::mod_bui<SIZE_IN_BITS, MODULUS_T> mod_t;
+	typedef typename mod_t::el_t mod_el_t;
+	typedef bifsi::bui<SIZE_IN_BITS, mod_el_t> bui_t;
+	typedef bifsi::bui<2 * SIZE_IN_BITS, mod_el_t> wide_t;
+
+	constexpr size_t N = bui_t::SIZE_IN_ELS;
+
+	const bui_t n = mod_t::MODULUS;
+
+	if (mod_t::IS_SPECIAL_FORM != expected_special_form) {
+		cout << "test failed: mod_bui of " << bifsi::type_name<MODULUS_T>() << ": IS_SPECIAL_FORM is " << mod_t::IS_SPECIAL_FORM << endl;
+
+		return 1;
+	}
+
+	bui_t n_minus_1 = n;
+	n_minus_1 -= 1;
+
+	for (size_t i = 0; i < test_count; i++) {
+		const bui_t a = (i < 2) ? n_minus_1 : bifsi::el_cast<mod_el_t>(random_bui<SIZE_IN_BITS>());
+		const bui_t b = (i < 1) ? n_minus_1 : bifsi::el_cast<mod_el_t>(random_bui<SIZE_IN_BITS>());
+
+		const bui_t ar = bifsi::divmod(a, n).r;
+		const bui_t br = bifsi::divmod(b, n).r;
+
+		wide_t sum = bifsi::mul_full(ar, bui_t(1U));
+		bifsi::els_add<2 * N, N>(sum.el, br.el);
+
+		wide_t diff = bifsi::mul_full(ar, bui_t(1U));
+		bifsi::els_add<2 * N, N>(diff.el, n.el);
+		bifsi::els_sub<2 * N, N>(diff.el, br.el);
+
+		wide_t neg = bifsi::mul_full(n, bui_t(1U));
+		bifsi::els_sub<2 * N, N>(neg.el, ar.el);
+
+		const mod_t x(a);
+		const mod_t y(b);
+
+		mod_t sq = x;
+		sq.square();
+
+		const bool ok = (x + y).value() == bifsi::divmod(sum, n).r //
+				&& (x - y).value() == bifsi::divmod(diff, n).r //
+				&& (x * y).value() == bifsi::divmod(bifsi::mul_full(ar, br), n).r //
+				&& sq.value() == bifsi::divmod(bifsi::mul_full(ar, ar), n).r //
+				&& (-x).value() == bifsi::divmod(neg, n).r //
+				&& (x * mod_t::one()) == x //
+				&& (x + mod_t::zero()) == x;
+
+		if (!ok) {
+			cout << "test failed: mod_bui of " << bifsi::type_name<MODULUS_T>() << ":" << endl;
+			cout << "a: " << a << endl;
+			cout << "b: " << b << endl;
+			cout << "x * y: " << (x * y).value() << endl;
+
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+template<typename EL_T>
+struct curve25519_modulus {
+	static constexpr bifsi::bui<256, EL_T> value = "57896044618658097711785492504343953926634992332820282019728792003956564819949";
+};
+
+/*
+ * Order of the group of P-256, with the highest bit set, but not sparse.
+ */
+template<typename EL_T>
+struct p256_order {
+	static constexpr bifsi::bui<256, EL_T> value = "115792089210356248762697446949407573529996955224135760342422259061068512044369";
+};
+
+/*
+ * 2^256 - 2, even, but of special form.
+ */
+template<typename EL_T>
+struct even_special_modulus {
+	static constexpr bifsi::bui<256, EL_T> value = "115792089237316195423570985008687907853269984665640564039457584007913129639934";
+};
+
+int test_mod() {
+	const size_t TEST_COUNT = 2000;
+
+	cout << "running mod tests" << endl;
+
+	constexpr bui<256> P256 = bifsi::p256_modulus<el_t>::value;
+	static_assert(P256.el[7] == 0xffffffff && P256.el[6] == 1 && P256.el[3] == 0 && P256.el[0] == 0xffffffff, "constexpr construction from a string");
+
+	typedef bifsi::mod_bui<256, bifsi::p256_modulus<el_t>> p256_t;
+	typedef bifsi::mod_bui<256, bifsi::secp256k1_modulus<el_t>> secp256k1_t;
+	static_assert(p256_t(bui<256>(6U)) * p256_t(bui<256>(7U)) - p256_t(bui<256>(42U)) == p256_t::zero(), "constexpr mod_bui");
+	static_assert((secp256k1_t(P256) * secp256k1_t::one() + secp256k1_t::one()).value() == (bui<256>(P256) += 1U), "constexpr mod_bui");
+
+	int result = 0;
+
+	result |= test_mod_bui<256, bifsi::p256_modulus<uint32_t>>(TEST_COUNT, true);
+	result |= test_mod_bui<256, bifsi::p256_modulus<uint64_t>>(TEST_COUNT, true);
+	result |= test_mod_bui<256, bifsi::p256_modulus<uint8_t>>(TEST_COUNT / 10, true);
+	result |= test_mod_bui<384, bifsi::p384_modulus<uint32_t>>(TEST_COUNT, true);
+	result |= test_mod_bui<384, bifsi::p384_modulus<uint64_t>>(TEST_COUNT, true);
+	result |= test_mod_bui<256, bifsi::secp256k1_modulus<uint32_t>>(TEST_COUNT, true);
+	result |= test_mod_bui<256, bifsi::secp256k1_modulus<uint64_t>>(TEST_COUNT, true);
+	result |= test_mod_bui<256, bifsi::secp256k1_modulus<uint16_t>>(TEST_COUNT / 10, true);
+	result |= test_mod_bui<256, even_special_modulus<uint32_t>>(TEST_COUNT, true);
+	result |= test_mod_bui<256, curve25519_modulus<uint32_t>>(TEST_COUNT, false);
+	result |= test_mod_bui<256, curve25519_modulus<uint64_t>>(TEST_COUNT, false);
+	result |= test_mod_bui<256, p256_order<uint32_t>>(TEST_COUNT, false);
+
+	if (result == 0) {
+		cout << "mod tests completed successfully." << endl;
+	}
+
+	return result;
+}
+
+/*
+ * Deterministic Miller-Rabin for 64 bit n with the bases 2 to 37, independent
+ * of bifsi.
+ */
+bool is_prime_reference(uint64_t n) {
+	const uint64_t BASES[] = { 2, 3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37 };
+
+	if (n < 2) {
+		return false;
+	}
+
+	for (uint64_t p : BASES) {
+		if (n % p == 0) {
+			return n == p;
+		}
+	}
+
+	uint64_t d = n - 1;
+	size_t s = 0;
+
+	while ((d & 1) == 0) {
+		d >>= 1;
+		s++;
+	}
+
+	for (uint64_t a : BASES) {
+		uint64_t x = mod_pow_reference(a, d, n);
+
+		if (x == 1 || x == n - 1) {
+			continue;
+		}
+
+		bool composite = true;
+
+		for (size_t j = 1; j < s && composite; j++) {
+			x = (uint64_t) ((uint128_t) x * x % n);
+			composite = (x != n - 1);
+		}
+
+		if (composite) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/*
+ * Checks that the candidates of the sieve are odd and consecutive, and that
+ * survives agrees with dividing the candidate by the primes of the table.
+ */
+template<size_t SIZE_IN_BITS, typename EL_T, size_t PRIME_COUNT>
+int test_sieve(size_t test_count) {
+	typedef bifsi::bui<SIZE_IN_BITS, EL_T> bui_t;
+
+	const bui_t start = bifsi::el_cast<EL_T>(random_bui<SIZE_IN_BITS>());
+
+	bifsi::prime::sieve<SIZE_IN_BITS, EL_T, PRIME_COUNT> s(start);
+
+	bui_t expected = start;
+	expected.el[0] |= 1;
+
+	for (size_t i = 0; i < test_count; i++) {
+		bool expected_survives = true;
+
+		for (size_t j = 0; j < PRIME_COUNT; j++) {
+			expected_survives &= (expected % (EL_T) bifsi::prime::SMALL_PRIMES<PRIME_COUNT>.p[j] != 0);
+		}
+
+		if (s.candidate().str() != expected.str() || s.survives() != expected_survives) {
+			cout << "test failed: sieve of " << bifsi::type_name<bui_t>() << ":" << endl;
+			cout << "i               : " << i << endl;
+			cout << "expected        : " << expected << endl;
+			cout << "actual          : " << s.candidate() << endl;
+			cout << "expected survive: " << expected_survives << endl;
+			cout << "actual survive  : " << s.survives() << endl;
+
+			return 1;
+		}
+
+		s.step();
+		expected += 2U;
+	}
+
+	return 0;
+}
+
+int test_prime() {
+	const size_t TEST_COUNT = 1000;
+	const size_t PRIME_COUNT = bifsi::prime::DEFAULT_SIEVE_PRIME_COUNT;
+	const uint32_t SMALL_LIMIT = 100000;
+
+	cout << "running prime tests" << endl;
+
+	// sieve of Eratosthenes as reference for the table and for small n
+	std::vector<bool> composite(SMALL_LIMIT, false);
+
+	for (uint32_t i = 2; i * i < SMALL_LIMIT; i++) {
+		for (uint32_t j = i * i; j < SMALL_LIMIT; j += i) {
+			composite[j] = true;
+		}
+	}
+
+	for (uint32_t c = 3, i = 0; i < PRIME_COUNT; c += 2) {
+		if (!composite[c]) {
+			if (bifsi::prime::SMALL_PRIMES<PRIME_COUNT>.p[i] != c) {
+				cout << "test failed: small primes table:" << endl;
+				cout << "i       : " << i << endl;
+				cout << "expected: " << c << endl;
+				cout << "actual  : " << bifsi::prime::SMALL_PRIMES<PRIME_COUNT>.p[i] << endl;
+
+				return 1;
+			}
+
+			i++;
+		}
+	}
+
+	static_assert(bifsi::prime::is_probable_prime(mersenne<64>(61)) && !bifsi::prime::is_probable_prime(mersenne<64>(59)), "constexpr primality test");
+
+	for (uint32_t n = 0; n < SMALL_LIMIT; n++) {
+		const bool expected = (n >= 2) && !composite[n];
+
+		if (bifsi::prime::is_probable_prime(bui<64>(n)) != expected) {
+			cout << "test failed: is_probable_prime of small n:" << endl;
+			cout << "n       : " << n << endl;
+			cout << "expected: " << expected << endl;
+
+			return 1;
+		}
+	}
+
+	// random 64 bit n, and the survivors of the sieve, which are prime more
+	// often
+	bifsi::prime::sieve<64, el_t> s(random_bui<64>());
+
+	for (size_t i = 0; i < 2 * TEST_COUNT; i++) {
+		const bui<64> n = (i % 2 == 0) ? random_bui<64>() : s.next();
+		const bool expected = is_prime_reference(n.as<uint64_t>());
+
+		if (bifsi::prime::is_probable_prime(n) != expected || (n > 1000U && (n.el[0] & 1) == 1 && bifsi::prime::miller_rabin(n) != expected)) {
+			cout << "test failed: is_probable_prime of 64 bit n:" << endl;
+			cout << "n       : " << n << endl;
+			cout << "expected: " << expected << endl;
+
+			return 1;
+		}
+	}
+
+	// 3215031751 = 151 * 751 * 28351 is a strong pseudoprime to the bases 2,
+	// 3, 5 and 7, but not to 11
+	if (!bifsi::prime::miller_rabin<4>(bui<64>(3215031751U)) || bifsi::prime::miller_rabin<5>(bui<64>(3215031751U)) || bifsi::prime::is_probable_prime(bui<64>(3215031751U))) {
+		cout << "test failed: strong pseudoprime 3215031751" << endl;
+
+		return 1;
+	}
+
+	// large primes and products of two of them
+	bui<256> m127_m61 = mersenne<256>(127);
+	m127_m61 *= mersenne<256>(61);
+
+	bui<128> m127_plus_2 = mersenne<128>(127);
+	m127_plus_2 += 2U;
+
+	if (!bifsi::prime::is_probable_prime(mersenne<128>(127)) || !bifsi::prime::is_probable_prime(mersenne<544>(521)) || !bifsi::prime::is_probable_prime(mersenne<608>(607))
+			|| bifsi::prime::is_probable_prime(m127_m61) || bifsi::prime::is_probable_prime(m127_plus_2)) {
+		cout << "test failed: is_probable_prime of large n" << endl;
+
+		return 1;
+	}
+
+	// rounds with more squarings than needed, like in the lockstep of a warp
+	for (size_t i = 0; i < TEST_COUNT; i++) {
+		const bui<64> n = s.next();
+
+		const bifsi::montgomery<64, el_t> mont(n);
+
+		bui<64> d = n;
+		d -= 1;
+		const size_t k = bifsi::trailing_0_bits(d);
+		d >>= k;
+
+		const bui<64> base = bifsi::prime::miller_rabin_base(i % bifsi::prime::MAX_MILLER_RABIN_ROUNDS);
+
+		if (bifsi::prime::miller_rabin_round(mont, d, k, k, base) != bifsi::prime::miller_rabin_round(mont, d, k, k + 1 + i % 8, base)) {
+			cout << "test failed: miller_rabin_round with extra squarings:" << endl;
+			cout << "n   : " << n << endl;
+			cout << "base: " << base << endl;
+
+			return 1;
+		}
+	}
+
+	for (size_t i = 0; i < TEST_COUNT / 10; i++) {
+		const uint64_t start = random_bui<64>().as<uint64_t>() >> 1;
+
+		uint64_t expected = start | 1;
+
+		do {
+			expected += 2;
+		} while (!is_prime_reference(expected));
+
+		const bui<64> start_bui = start;
+		bifsi::prime::sieve<64, el_t> t(start_bui);
+		const bui<64> actual = bifsi::prime::next_prime(t);
+
+		if (actual != expected || t.candidate() != expected) {
+			cout << "test failed: next_prime:" << endl;
+			cout << "start   : " << start << endl;
+			cout << "expected: " << expected << endl;
+			cout << "actual  : " << actual << endl;
+
+			return 1;
+		}
+	}
+
+	int result = 0;
+
+	result |= test_sieve<64, el_t, PRIME_COUNT>(TEST_COUNT);
+	result |= test_sieve<1024, el_t, 256>(TEST_COUNT);
+	result |= test_sieve<256, uint64_t, PRIME_COUNT>(TEST_COUNT);
+	result |= test_sieve<128, uint8_t, 53>(TEST_COUNT);
+
+	if (result == 0) {
+		cout << "prime tests completed successfully." << endl;
+	}
+
+	return result;
+}
+
+uint64_t gcd_reference(uint64_t a, uint64_t b) {
+	while (b != 0) {
+		const uint64_t t = a % b;
+		a = b;
+		b = t;
+	}
+
+	return a;
+}
+
+/*
+ * Returns x with the value of the smaller or bigger x, sign or zero extended.
+ */
+template<size_t TO_SIZE_IN_BITS, size_t SIZE_IN_BITS, typename EL_T>
+bifsi::bsi<TO_SIZE_IN_BITS, EL_T> widen(const bifsi::bsi<SIZE_IN_BITS, EL_T> &x) {
+	bifsi::bsi<TO_SIZE_IN_BITS, EL_T> result(0);
+
+	for (size_t i = 0; i < result.SIZE_IN_ELS; i++) {
+		result.bits.el[i] = (i < x.SIZE_IN_ELS) ? x.bits.el[i] : x.sign_mask();
+	}
+
+	return result;
+}
+
+template<size_t TO_SIZE_IN_BITS, size_t SIZE_IN_BITS, typename EL_T>
+bifsi::bsi<TO_SIZE_IN_BITS, EL_T> widen(const bifsi::bui<SIZE_IN_BITS, EL_T> &x) {
+	const bifsi::bsi<SIZE_IN_BITS + 8 * sizeof(EL_T), EL_T> t(bifsi::width_cast<SIZE_IN_BITS + 8 * sizeof(EL_T)>(x));
+
+	return widen<TO_SIZE_IN_BITS>(t);
+}
+
+/*
+ * Checks gcd, ext_gcd, mod_inverse and batch_mod_inverse of
+ * bui<SIZE_IN_BITS, EL_T>. The operands get a random common factor, so the
+ * gcd is not mostly 1, and the results are checked by the properties of the
+ * gcd and the inverse.
+ */
+template<size_t SIZE_IN_BITS, typename EL_T>
+int test_gcd_el_type(size_t test_count) {
+	typedef bifsi::bui<SIZE_IN_BITS, EL_T> bui_t;
+	typedef bifsi::bsi<2 * SIZE_IN_BITS + 16 * sizeof(EL_T), EL_T> wide_t;
+
+	const size_t BATCH_SIZE = 7;
+
+	bui_t batch[BATCH_SIZE];
+	bui_t batch_inverses[BATCH_SIZE];
+
+	for (size_t i = 0; i < test_count; i++) {
+		bui_t common = bifsi::el_cast<EL_T>(random_bui<SIZE_IN_BITS>());
+		common >>= SIZE_IN_BITS - 1 - std::rand() % (SIZE_IN_BITS / 2);
+
+		// a, b < 2^(SIZE_IN_BITS / 2) * 2^(SIZE_IN_BITS / 2)
+		bui_t a = bifsi::el_cast<EL_T>(random_bui<SIZE_IN_BITS>());
+		bui_t b = bifsi::el_cast<EL_T>(random_bui<SIZE_IN_BITS>());
+		a >>= SIZE_IN_BITS / 2;
+		b >>= SIZE_IN_BITS / 2 + std::rand() % (SIZE_IN_BITS / 2);
+		a *= common;
+		b *= common;
+
+		bui_t n = bifsi::el_cast<EL_T>(random_bui<SIZE_IN_BITS>());
+		n >>= std::rand() % (SIZE_IN_BITS - 1);
+		n.el[0] |= 1;
+
+		if (n == 1U) {
+			n = 3U;
+		}
+
+		bui_t x = bifsi::el_cast<EL_T>(random_bui<SIZE_IN_BITS>());
+
+		if (i == 0) {
+			a = 0;
+			b = 0;
+			x = 0;
+			x -= 1;
+			n = x;
+		} else if (i == 1) {
+			a = 0;
+			x = n;
+			x -= 1;
+		} else if (i == 2) {
+			b = 0;
+		}
+
+		// gcd
+		const bui_t g = bifsi::gcd(a, b);
+
+		bui_t a_over_g = a;
+		bui_t b_over_g = b;
+
+		bool ok = true;
+
+		if (g.is_zero()) {
+			ok = a.is_zero() && b.is_zero();
+		} else {
+			ok = bifsi::divmod(a, g).r.is_zero() && bifsi::divmod(b, g).r.is_zero();
+			a_over_g /= g;
+			b_over_g /= g;
+			ok = ok && bifsi::gcd(a_over_g, b_over_g) == 1U;
+		}
+
+		ok = ok && bifsi::gcd(a, b) == bifsi::gcd(b, a);
+
+		// ext_gcd with an odd first operand
+		bui_t a_odd = a;
+		a_odd.el[0] |= 1;
+
+		const bifsi::ext_gcd_result<SIZE_IN_BITS, EL_T> e = bifsi::ext_gcd(a_odd, b);
+
+		wide_t lhs = bifsi::mul_full(widen<SIZE_IN_BITS + 8 * sizeof(EL_T)>(a_odd), e.x);
+		lhs += bifsi::mul_full(widen<SIZE_IN_BITS + 8 * sizeof(EL_T)>(b), e.y);
+
+		ok = ok && e.g == bifsi::gcd(a_odd, b) && lhs == widen<2 * SIZE_IN_BITS + 16 * sizeof(EL_T)>(e.g);
+
+		// mod_inverse, which is 0 if there is none
+		const bui_t inverse = bifsi::mod_inverse(x, n);
+		const bool coprime = bifsi::gcd(x, n) == 1U;
+
+		bifsi::bui<2 * SIZE_IN_BITS, EL_T> product = bifsi::mul_full(x, inverse);
+		product %= n;
+
+		ok = ok && inverse < n && (coprime ? product == 1U : inverse.is_zero());
+
+		// batch inverse, of values which are coprime to n
+		if (ok && i % BATCH_SIZE == 0) {
+			for (size_t j = 0; j < BATCH_SIZE; j++) {
+				batch[j] = x;
+				batch[j] += j;
+				batch[j] = (bifsi::gcd(batch[j], n) == 1U) ? batch[j] : bui_t(1U);
+			}
+
+			bifsi::batch_mod_inverse(batch_inverses, batch, BATCH_SIZE, n);
+
+			for (size_t j = 0; j < BATCH_SIZE; j++) {
+				ok = ok && batch_inverses[j] == bifsi::mod_inverse(batch[j], n);
+			}
+		}
+
+		if (!ok) {
+			cout << "test failed: gcd of " << bifsi::type_name<bui_t>() << ":" << endl;
+			cout << "i: " << i << endl;
+			cout << "a: " << a << endl;
+			cout << "b: " << b << endl;
+			cout << "gcd(a, b): " << g << endl;
+			cout << "ext_gcd(a | 1, b): " << e.g << " " << e.x << " " << e.y << endl;
+			cout << "x: " << x << endl;
+			cout << "n: " << n << endl;
+			cout << "mod_inverse(x, n): " << inverse << endl;
+
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+int test_gcd() {
+	const size_t TEST_COUNT = 10000;
+
+	cout << "running gcd tests" << endl;
+
+	for (size_t i = 0; i < TEST_COUNT; i++) {
+		const uint64_t common = (uint64_t) std::rand() % 1000 + 1;
+		const uint64_t a = (((uint64_t) std::rand() << 31) ^ std::rand()) * common;
+		const uint64_t b = ((uint64_t) std::rand() >> (std::rand() % 31)) * common;
+
+		const uint64_t expected = gcd_reference(a, b);
+		const uint64_t actual = bifsi::gcd(bui<64>(a), bui<64>(b)).as<uint64_t>();
+
+		if (actual != expected) {
+			cout << "test failed: gcd of uint64_t:" << endl;
+			cout << "a       : " << a << endl;
+			cout << "b       : " << b << endl;
+			cout << "expected: " << expected << endl;
+			cout << "actual  : " << actual << endl;
+
+			return 1;
+		}
+	}
+
+	int result = 0;
+
+	result |= test_gcd_el_type<64, el_t>(TEST_COUNT);
+	result |= test_gcd_el_type<256, uint64_t>(TEST_COUNT / 10);
+	result |= test_gcd_el_type<256, uint32_t>(TEST_COUNT / 10);
+	result |= test_gcd_el_type<256, uint8_t>(TEST_COUNT / 100);
+	result |= test_gcd_el_type<96, uint16_t>(TEST_COUNT / 10);
+	result |= test_gcd_el_type<1024, uint64_t>(TEST_COUNT / 100);
+	result |= test_gcd_el_type<4096, uint64_t>(TEST_COUNT / 1000);
+
+	// batch_mod_inverse of a bui_batch
+	const bui<256> p = bifsi::p256_modulus<el_t>::value;
+
+	bifsi::bui_batch<256, 16, el_t> values;
+
+	for (size_t lane = 0; lane < values.LANE_COUNT; lane++) {
+		values.set(lane, random_bui<256>() >>= 1);
+	}
+
+	bifsi::bui_batch<256, 16, el_t> inverses = values;
+	bifsi::batch_mod_inverse(inverses, p);
+
+	for (size_t lane = 0; lane < values.LANE_COUNT && result == 0; lane++) {
+		if (inverses.get(lane) != bifsi::mod_inverse(values.get(lane), p)) {
+			cout << "test failed: batch_mod_inverse of bui_batch, lane " << lane << endl;
+
+			result = 1;
+		}
+	}
+
+	if (result == 0) {
+		cout << "gcd tests completed successfully." << endl;
+	}
+
+	return result;
+}
+
+/*
+ * Checks q * d + r = a and r < d, and that divmod and divmod_ct agree.
+ */
+template<size_t A_SIZE_IN_BITS, size_t D_SIZE_IN_BITS>
+int test_divmod_identity(size_t test_count) {
+	constexpr size_t D_ELS = bui<D_SIZE_IN_BITS>::SIZE_IN_ELS;
+
+	for (size_t i = 0; i < test_count; i++) {
+		const bui<A_SIZE_IN_BITS> a = random_bui<A_SIZE_IN_BITS>();
+		bui<D_SIZE_IN_BITS> d = random_bui<D_SIZE_IN_BITS>();
+
+		// vary the number of nonzero elements of d
+		d.template set_zero_starting_at_el<0>();
+		for (size_t j = 0; j < 1 + i % D_ELS; j++) {
+			d.el[j] = random_bui<D_SIZE_IN_BITS>().el[j];
+		}
+		d.el[0] |= 1;
+
+		const auto qr = bifsi::divmod(a, d);
+		const auto qr_ct = bifsi::divmod_ct(a, d);
+
+		bui<A_SIZE_IN_BITS> d_ext = 0;
+		for (size_t j = 0; j < D_ELS; j++) {
+			d_ext.el[j] = d.el[j];
+		}
+
+		bui<A_SIZE_IN_BITS> reconstructed = qr.q;
+		reconstructed *= d_ext;
+		bifsi::els_add<bui<A_SIZE_IN_BITS>::SIZE_IN_ELS, D_ELS>(reconstructed.el, qr.r.el);
+
+		bui<D_SIZE_IN_BITS> r_minus_d = qr.r;
+		const bool r_lt_d = bifsi::els_sub<D_ELS, D_ELS>(r_minus_d.el, d.el);
+
+		const bool ct_equal = equal_els(qr_ct.q, qr.q.el) && equal_els(qr_ct.r, qr.r.el);
+
+		if (!equal_els(reconstructed, a.el) || !r_lt_d || !ct_equal) {
+			cout << "test failed: divmod of " << bifsi::type_name<bui<A_SIZE_IN_BITS>>() << " by " << bifsi::type_name<bui<D_SIZE_IN_BITS>>() << ":" << endl;
+			cout << "i   : " << i << endl;
+			cout << "a   : " << a << endl;
+			cout << "d   : " << d << endl;
+			cout << "q   : " << qr.q << endl;
+			cout << "r   : " << qr.r << endl;
+			cout << "q_ct: " << qr_ct.q << endl;
+			cout << "r_ct: " << qr_ct.r << endl;
+
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+/*
+ * Checks division by a divisor with precomputed reciprocal against the
+ * scalar operator/= and operator%, for random divisors and the edge cases 1,
+ * the maximum of EL_T and powers of 2, which have no normalization shift or
+ * the maximum one.
+ */
+template<size_t SIZE_IN_BITS, typename EL_T>
+int test_divisor(size_t test_count) {
+	typedef bifsi::bui<SIZE_IN_BITS, EL_T> bui_t;
+
+	constexpr size_t W = sizeof(EL_T) * 8;
+
+	for (size_t i = 0; i < test_count; i++) {
+		const bui_t a = bifsi::el_cast<EL_T>(random_bui<SIZE_IN_BITS>());
+
+		EL_T d = (EL_T) (((uint64_t) std::rand() << 33) ^ ((uint64_t) std::rand() << 16) ^ std::rand());
+
+		if (i % 4 == 1) {
+			d = (EL_T) (d >> (std::rand() % W));
+		} else if (i % 4 == 2) {
+			d = (EL_T) ((EL_T) 1 << (std::rand() % W));
+		} else if (i % 4 == 3) {
+			d = (EL_T) ~(EL_T) (std::rand() % 3);
+		}
+
+		d = (EL_T) (d + (d == 0));
+
+		const bifsi::divisor<EL_T> dv(d);
+
+		bui_t expected_q = a;
+		const EL_T expected_r = (expected_q /= d);
+
+		bui_t actual_q = a;
+		const EL_T actual_r = (actual_q /= dv);
+		const auto qr = bifsi::divmod(a, dv);
+
+		if (actual_q.str() != expected_q.str() || actual_r != expected_r || (a % dv) != expected_r || qr.q.str() != expected_q.str() || qr.r != expected_r) {
+			cout << "test failed: divisor of " << bifsi::type_name<bui_t>() << ":" << endl;
+			cout << "a         : " << a << endl;
+			cout << "d         : " << (uint64_t) d << endl;
+			cout << "expected_q: " << expected_q << endl;
+			cout << "actual_q  : " << actual_q << endl;
+			cout << "expected_r: " << (uint64_t) expected_r << endl;
+			cout << "actual_r  : " << (uint64_t) actual_r << endl;
+
+			return 1;
+		}
+	}
+
+	constexpr bifsi::divisor<EL_T> d10 = bifsi::CONST_DIVISOR<EL_T, 10>;
+	static_assert(d10.d == 10 && d10.shift == W - 4, "CONST_DIVISOR is constexpr");
+
+	const bui_t a = bifsi::el_cast<EL_T>(random_bui<SIZE_IN_BITS>());
+
+	if ((a % d10) != (a % (EL_T) 10)) {
+		cout << "test failed: CONST_DIVISOR<" << bifsi::type_name<EL_T>() << ", 10>" << endl;
+
+		return 1;
+	}
+
+	return 0;
+}
+
+int test_divmod() {
+	const size_t TEST_COUNT = 200000;
+
+	cout << "running divmod tests" << endl;
+
+	constexpr auto QR = bifsi::divmod(bifsi::p256_modulus<el_t>::value, bui<256>("1000000000000000000000000000000"));
+	static_assert(QR.q == bui<256>("115792089210356248762697446949407573530086143415") && QR.r == bui<256>("290314195533631308867097853951"), "constexpr divmod");
+
+	for (size_t i = 0; i < TEST_COUNT; i++) {
+		const uint128_t a128 = to_uint128(random_bui<128>()) >> (std::rand() % 128);
+		uint128_t d128 = to_uint128(random_bui<128>()) >> (std::rand() % 128);
+		d128 += (d128 == 0);
+		const uint64_t d64 = (uint64_t) d128 | 1;
+
+		const bui<128> a = from_uint128(a128);
+		const bui<128> d = from_uint128(d128);
+		const bui<64> d_small = d64;
+
+		const auto qr = bifsi::divmod(a, d);
+		const auto qr_ct = bifsi::divmod_ct(a, d);
+		const auto qr_small = bifsi::divmod(a, d_small);
+
+		bui<128> q_op = a;
+		q_op /= d;
+		bui<128> r_op = a;
+		r_op %= d;
+
+		const bool ok = to_uint128(qr.q) == a128 / d128 //
+				&& to_uint128(qr.r) == a128 % d128 //
+				&& to_uint128(qr_ct.q) == a128 / d128 //
+				&& to_uint128(qr_ct.r) == a128 % d128 //
+				&& to_uint128(q_op) == a128 / d128 //
+				&& to_uint128(r_op) == a128 % d128 //
+				&& to_uint128(qr_small.q) == a128 / d64 //
+				&& qr_small.r.as<uint64_t>() == a128 % d64;
+
+		if (!ok) {
+			cout << "test failed: divmod:" << endl;
+			cout << "i   : " << i << endl;
+			cout << "a   : " << a << endl;
+			cout << "d   : " << d << endl;
+			cout << "q   : " << qr.q << endl;
+			cout << "r   : " << qr.r << endl;
+			cout << "q_ct: " << qr_ct.q << endl;
+			cout << "r_ct: " << qr_ct.r << endl;
+
+			return 1;
+		}
+	}
+
+	int result = 0;
+
+	result |= test_divmod_identity<2048, 1024>(200);
+	result |= test_divmod_identity<2048, 96>(200);
+	result |= test_divmod_identity<544, 544>(200);
+	result |= test_divisor<32, uint8_t>(TEST_COUNT / 10);
+	result |= test_divisor<64, uint16_t>(TEST_COUNT / 10);
+	result |= test_divisor<256, uint32_t>(TEST_COUNT / 10);
+	result |= test_divisor<256, uint64_t>(TEST_COUNT / 10);
+	result |= test_divisor<2048, uint64_t>(TEST_COUNT / 100);
+
+	if (result == 0) {
+		cout << "divmod tests completed successfully." << endl;
+	}
+
+	return result;
+}
+
+/*
+ * Checks str() against the digit by digit conversion of uint_to_string.
+ */
+template<size_t SIZE_IN_BITS>
+int test_str(size_t test_count) {
+	for (size_t i = 0; i < test_count; i++) {
+		bui<SIZE_IN_BITS> x = random_bui<SIZE_IN_BITS>();
+
+		if (i == 0) {
+			x = 0;
+		} else if (i == 1) {
+			x = 0;
+			x -= 1;
+		} else {
+			// vary the number of digits
+			x.template set_zero_starting_at_el<0>();
+			for (size_t j = 0; j < i % bui<SIZE_IN_BITS>::SIZE_IN_ELS + 1; j++) {
+				x.el[j] = random_bui<SIZE_IN_BITS>().el[j];
+			}
+		}
+
+		const string expected = bifsi::uint_to_string(x);
+		const string actual = x.str();
+
+		if (actual != expected) {
+			cout << "test failed: str of " << bifsi::type_name<bui<SIZE_IN_BITS>>() << ":" << endl;
+			cout << "i       : " << i << endl;
+			cout << "expected: " << expected << endl;
+			cout << "actual  : " << actual << endl;
+
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+int test_str() {
+	cout << "running str tests" << endl;
+
+	int result = 0;
+
+	result |= test_str<32>(1000);
+	result |= test_str<128>(1000);
+	result |= test_str<1024>(100);
+	result |= test_str<2048>(100);
+	result |= test_str<4128>(20);
+	result |= test_str<8192>(10);
+
+	if (result == 0) {
+		cout << "str tests completed successfully." << endl;
+	}
+
+	return result;
+}
+
+/*
+ * Returns the digits of x in base 2^digit_bits, with leading zeros.
+ */
+template<size_t SIZE_IN_BITS>
+string to_pow2_base_string(const bui<SIZE_IN_BITS> &x, size_t digit_bits) {
+	string result;
+
+	for (size_t bit_idx = 0; bit_idx < SIZE_IN_BITS; bit_idx += digit_bits) {
+		unsigned int digit = 0;
+
+		for (size_t i = 0; i < digit_bits && bit_idx + i < SIZE_IN_BITS; i++) {
+			const size_t b = bit_idx + i;
+			digit |= ((x.el[b / EL_SIZE_IN_BITS] >> (b % EL_SIZE_IN_BITS)) & 1) << i;
+		}
+
+		result.push_back("0123456789abcdef"[digit]);
+	}
+
+	std::reverse(result.begin(), result.end());
+
+	return result;
+}
+
+template<size_t SIZE_IN_BITS>
+bool parses_to(const string &str, int base, const bui<SIZE_IN_BITS> &expected) {
+	bui<SIZE_IN_BITS> actual = 0;
+	const bifsi::from_chars_result r = bifsi::from_chars(str.data(), str.data() + str.size(), actual, base);
+
+	return r.ec == std::errc() && r.ptr == str.data() + str.size() && equal_els(actual, expected.el);
+}
+
+template<size_t SIZE_IN_BITS>
+int test_from_chars(size_t test_count) {
+	for (size_t i = 0; i < test_count; i++) {
+		bui<SIZE_IN_BITS> x = random_bui<SIZE_IN_BITS>();
+
+		if (i == 0) {
+			x = 0;
+		} else if (i == 1) {
+			x = 0;
+			x -= 1;
+		}
+
+		string hex = to_pow2_base_string(x, 4);
+		std::transform(hex.begin(), hex.end(), hex.begin(), ::toupper);
+
+		const bool ok = parses_to(x.str(), 10, x) //
+				&& parses_to("000" + x.str(), 10, x) //
+				&& parses_to(hex, 16, x) //
+				&& parses_to(to_pow2_base_string(x, 1), 2, x) //
+				&& parses_to(to_pow2_base_string(x, 3), 8, x);
+
+		if (!ok) {
+			cout << "test failed: from_chars of " << bifsi::type_name<bui<SIZE_IN_BITS>>() << ":" << endl;
+			cout << "i: " << i << endl;
+			cout << "x: " << x << endl;
+
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+int test_from_chars() {
+	cout << "running from_chars tests" << endl;
+
+	int result = 0;
+
+	result |= test_from_chars<32>(1000);
+	result |= test_from_chars<128>(1000);
+	result |= test_from_chars<160>(1000);
+	result |= test_from_chars<2048>(100);
+
+	const string max_128 = "340282366920938463463374607431768211455";
+	const string max_128_plus_1 = "340282366920938463463374607431768211456";
+	const string hex_2_128 = "100000000000000000000000000000000";
+	const string trailing = "12345abc";
+	const string empty = "";
+
+	bui<128> x = 7;
+	bifsi::from_chars_result r;
+
+	r = bifsi::from_chars(max_128.data(), max_128.data() + max_128.size(), x);
+	result |= (r.ec != std::errc() || x.str() != max_128);
+
+	x = 7;
+	r = bifsi::from_chars(max_128_plus_1.data(), max_128_plus_1.data() + max_128_plus_1.size(), x);
+	result |= (r.ec != std::errc::result_out_of_range || r.ptr != max_128_plus_1.data() + max_128_plus_1.size() || x != 7);
+
+	r = bifsi::from_chars(hex_2_128.data(), hex_2_128.data() + hex_2_128.size(), x, 16);
+	result |= (r.ec != std::errc::result_out_of_range || x != 7);
+
+	r = bifsi::from_chars(trailing.data(), trailing.data() + trailing.size(), x);
+	result |= (r.ec != std::errc() || r.ptr != trailing.data() + 5 || x != 12345);
+
+	r = bifsi::from_chars(trailing.data(), trailing.data() + trailing.size(), x, 36);
+	result |= (r.ec != std::errc() || r.ptr != trailing.data() + trailing.size() || x.str() != "82906092408");
+
+	r = bifsi::from_chars(empty.data(), empty.data(), x);
+	result |= (r.ec != std::errc::invalid_argument || r.ptr != empty.data());
+
+	r = bifsi::from_chars(trailing.data() + 5, trailing.data() + trailing.size(), x);
+	result |= (r.ec != std::errc::invalid_argument || r.ptr != trailing.data() + 5);
+
+	const bui<128> from_ctor = "340282366920938463463374607431768211455";
+	result |= (from_ctor.str() != max_128);
+
+	if (result == 0) {
+		cout << "from_chars tests completed successfully." << endl;
+	} else {
+		cout << "test failed: from_chars" << endl;
+	}
+
+	return result;
+}
+
+/*
+ * Checks that to_bytes and from_bytes of bui<SIZE_IN_BITS, EL_T> round trip,
+ * and that the bytes are the same as for the bui<SIZE_IN_BITS> of the other
+ * tests, i.e. independent of the element type.
+ */
+template<size_t SIZE_IN_BITS, typename EL_T>
+int test_bytes(size_t test_count) {
+	typedef bifsi::bui<SIZE_IN_BITS, EL_T> bui_t;
+
+	constexpr size_t BYTES = bui_t::SIZE_IN_BYTES;
+
+	for (size_t t = 0; t < test_count; t++) {
+		const bui<SIZE_IN_BITS> x = random_bui<SIZE_IN_BITS>();
+		const bui_t xc = bifsi::el_cast<EL_T>(x);
+
+		uint8_t expected_le[BYTES];
+		uint8_t expected_be[BYTES];
+
+		x.to_bytes(expected_le, bifsi::byte_order::little);
+		x.to_bytes(expected_be, bifsi::byte_order::big);
+
+		uint8_t le[BYTES];
+		uint8_t be[BYTES];
+
+		xc.to_bytes(le, bifsi::byte_order::little);
+		xc.to_bytes(be, bifsi::byte_order::big);
+
+		bui_t from_le;
+		bui_t from_be;
+
+		from_le.from_bytes(le, bifsi::byte_order::little);
+		from_be.from_bytes(be, bifsi::byte_order::big);
+
+		bool reversed = true;
+
+		for (size_t i = 0; i < BYTES; i++) {
+			reversed &= (le[i] == be[BYTES - 1 - i]);
+		}
+
+		if (std::memcmp(le, expected_le, BYTES) != 0 || std::memcmp(be, expected_be, BYTES) != 0 || !reversed || from_le != xc || from_be != xc) {
+			cout << "test failed: to_bytes/from_bytes of bui<" << SIZE_IN_BITS << ", " << bifsi::type_name<EL_T>() << "> " << x << endl;
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+/*
+ * Writes count records of type T to an array file, maps it and compares the
+ * mapped records with the written ones.
+ */
+template<typename T>
+int test_array_file(const string &path, const std::vector<T> &records) {
+	bifsi::io::write_array_file(path, records.data(), records.size());
+
+	const bifsi::io::mapped_array_file<T> mapped(path);
+
+	if (mapped.size() != records.size() || ((uintptr_t) mapped.data()) % alignof(T) != 0 || (!records.empty() && std::memcmp(mapped.data(), records.data(), records.size() * sizeof(T)) != 0)) {
+		cout << "test failed: array file of " << records.size() << " " << bifsi::type_name<T>() << endl;
+		return 1;
+	}
+
+	return 0;
+}
+
+int test_io() {
+	cout << "running io tests" << endl;
+
+	int result = 0;
+
+	result |= test_bytes<64, uint8_t>(1000);
+	result |= test_bytes<128, uint16_t>(1000);
+	result |= test_bytes<256, uint64_t>(1000);
+	result |= test_bytes<1024, uint32_t>(100);
+
+	constexpr bifsi::bui<64, uint16_t> c = (uint64_t) 0x0102030405060708;
+	uint8_t be[8];
+	c.to_bytes(be, bifsi::byte_order::big);
+
+	for (size_t i = 0; i < 8; i++) {
+		result |= (be[i] != i + 1);
+	}
+
+	static_assert([]() {
+		uint8_t b[16] = { };
+		bifsi::bui<128, uint32_t>(12345678U).to_bytes(b, bifsi::byte_order::little);
+		bifsi::bui<128, uint32_t> y = 0U;
+		y.from_bytes(b, bifsi::byte_order::little);
+
+		return b[0] == 0x4e && b[1] == 0x61 && b[2] == 0xbc && y == 12345678U;
+	}());
+
+	const string path = string(std::getenv("TMPDIR") != nullptr ? std::getenv("TMPDIR") : "/tmp") + "/bifsi_test_" + std::to_string(std::rand()) + ".bin";
+
+	std::vector<bui<512>> values(1001);
+
+	for (bui<512> &v : values) {
+		v = random_bui<512>();
+	}
+
+	result |= test_array_file(path, values);
+	result |= test_array_file(path, std::vector<bui<512>>());
+
+	std::vector<bifsi::bui_batch<256, 16, el_t>> batches(7);
+
+	for (bifsi::bui_batch<256, 16, el_t> &b : batches) {
+		for (size_t lane = 0; lane < 16; lane++) {
+			b.set(lane, random_bui<256>());
+		}
+	}
+
+	result |= test_array_file(path, batches);
+
+	// a file of bui_batch<256, 16> is no file of bui<256> or other batches
+	try {
+		const bifsi::io::mapped_array_file<bui<256>> wrong(path);
+		cout << "test failed: mapped_array_file accepted a file of another record type" << endl;
+		result = 1;
+	} catch (const std::runtime_error&) {
+	}
+
+	try {
+		const bifsi::io::mapped_array_file<bifsi::bui_batch<256, 16, uint64_t>> wrong(path);
+		cout << "test failed: mapped_array_file accepted a file of another element type" << endl;
+		result = 1;
+	} catch (const std::runtime_error&) {
+	}
+
+	std::remove(path.c_str());
+
+	try {
+		const bifsi::io::mapped_array_file<bui<256>> missing(path);
+		cout << "test failed: mapped_array_file opened a missing file" << endl;
+		result = 1;
+	} catch (const std::runtime_error&) {
+	}
+
+	if (result == 0) {
+		cout << "io tests completed successfully." << endl;
+	} else {
+		cout << "test failed: io" << endl;
+	}
+
+	return result;
+}
+
+/*
+ * Checks each operation of bui_batch against the same operation on the
+ * individual bui values.
+ */
+template<size_t SIZE_IN_BITS, size_t LANES, typename EL_T = el_t>
+int test_batch(size_t test_count) {
+	typedef bifsi::bui_batch<SIZE_IN_BITS, LANES, EL_T> batch_t;
+	typedef bifsi::bui<SIZE_IN_BITS, EL_T> bui_t;
+	constexpr size_t N = bui_t::SIZE_IN_ELS;
+
+	batch_t *a = new batch_t;
+	batch_t *b = new batch_t;
+
+	int result = 0;
+
+	for (size_t t = 0; t < test_count && result == 0; t++) {
+		for (size_t lane = 0; lane < LANES; lane++) {
+			bui_t x = bifsi::el_cast<EL_T>(random_bui<SIZE_IN_BITS>());
+			bui_t y = bifsi::el_cast<EL_T>(random_bui<SIZE_IN_BITS>());
+
+			if (lane % 4 == 0) {
+				// equal values and carries through all elements
+				x = 0;
+				x -= lane % 8;
+				y = x;
+			}
+
+			a->set(lane, x);
+			b->set(lane, y);
+		}
+
+		// every other m uses all bits of EL_T
+		const EL_T m = (t % 2 == 0) ? (EL_T) std::rand() | 1 : bifsi::el_cast<EL_T>(random_bui<64>()).el[0] | 1;
+
+		batch_t sum = *a;
+		sum.add(*b);
+
+		batch_t diff = *a;
+		diff.sub(*b);
+
+		batch_t prod = *a;
+		prod.mul_scalar(m);
+
+		EL_T mods[LANES];
+		a->mod_scalar(m, mods);
+
+		int cmps[LANES];
+		a->compare(*b, cmps);
+
+		for (size_t lane = 0; lane < LANES; lane++) {
+			const bui_t x = a->get(lane);
+			const bui_t y = b->get(lane);
+
+			bui_t expected_sum = x;
+			bifsi::els_add<N, N>(expected_sum.el, y.el);
+
+			bui_t expected_diff = x;
+			const bool lt = bifsi::els_sub<N, N>(expected_diff.el, y.el);
+
+			bui_t expected_prod = x;
+			expected_prod *= m;
+
+			const int expected_cmp = lt ? -1 : expected_diff.is_zero() ? 0 : 1;
+
+			if (sum.get(lane) != expected_sum //
+					|| diff.get(lane) != expected_diff //
+					|| prod.get(lane) != expected_prod //
+					|| mods[lane] != x % m //
+					|| cmps[lane] != expected_cmp) {
+				cout << "test failed: " << bifsi::type_name<batch_t>() << ":" << endl;
+				cout << "lane: " << lane << endl;
+				cout << "x   : " << x << endl;
+				cout << "y   : " << y << endl;
+				cout << "m   : " << m << endl;
+
+				result = 1;
+				break;
+			}
+		}
+	}
+
+	delete a;
+	delete b;
+
+	return result;
+}
+
+int test_batch() {
+	cout << "running batch tests" << endl;
+
+	int result = 0;
+
+	result |= test_batch<256, 37>(100);
+	result |= test_batch<1024, 64>(20);
+	result |= test_batch<32, 17>(100);
+	result |= test_batch<256, 37, uint64_t>(100);
+	result |= test_batch<1024, 64, uint64_t>(20);
+
+	if (result == 0) {
+		cout << "batch tests completed successfully." << endl;
+	}
+
+	return result;
+}
+
+/*
+ * Checks the results of host::launcher with thread_count threads and a cache
+ * size of cache_size bytes against the same operations computed one element
+ * after the other. The small cache sizes give chunks of a few elements, so
+ * the workers steal from each other.
+ */
+template<size_t SIZE_IN_BITS, typename EL_T>
+int test_host(size_t count, size_t thread_count, size_t cache_size) {
+	typedef bifsi::bui<SIZE_IN_BITS, EL_T> bui_t;
+	typedef bifsi::bui<64, EL_T> exp_t;
+
+	bifsi::host::launcher launcher(thread_count, cache_size);
+
+	bui_t *a = launcher.allocate<bui_t>(count);
+	bui_t *b = launcher.allocate<bui_t>(count);
+	bui_t *r = launcher.allocate<bui_t>(count);
+	exp_t *e = launcher.allocate<exp_t>(count);
+	uint8_t *p = launcher.allocate<uint8_t>(count);
+	std::vector<string> s(count);
+
+	for (size_t i = 0; i < count; i++) {
+		if (a[i] != 0U || b[i] != 0U || r[i] != 0U || e[i] != 0U || p[i] != 0) {
+			cout << "test failed: allocate<bui<" << SIZE_IN_BITS << ">> didn't zero element " << i << endl;
+			return 1;
+		}
+
+		a[i] = bifsi::el_cast<EL_T>(random_bui<SIZE_IN_BITS>());
+		b[i] = bifsi::el_cast<EL_T>(random_bui<SIZE_IN_BITS>());
+		e[i] = bifsi::el_cast<EL_T>(random_bui<64>());
+
+		// small divisors for some elements, so divmod takes different paths
+		if (i % 3 == 0) {
+			b[i] >>= SIZE_IN_BITS - sizeof(EL_T) * 8;
+		}
+
+		// odd and greater than 2 plus the largest Miller-Rabin base
+		b[i].el[0] |= 0x83;
+	}
+
+	const bifsi::montgomery<SIZE_IN_BITS, EL_T> mont(b[0]);
+
+	int result = 0;
+
+	auto check = [&](const char *op, size_t i, const bui_t &expected, const bui_t &actual) {
+		if (expected != actual && result == 0) {
+			cout << "test failed: host::launcher(" << thread_count << ")." << op << "<" << SIZE_IN_BITS << "> at " << i << ": expected " << expected << " but got " << actual << endl;
+			result = 1;
+		}
+	};
+
+	launcher.add(r, a, b, count);
+
+	for (size_t i = 0; i < count; i++) {
+		bui_t expected = a[i];
+		bifsi::els_add<bui_t::SIZE_IN_ELS, bui_t::SIZE_IN_ELS>(expected.el, b[i].el);
+		check("add", i, expected, r[i]);
+	}
+
+	launcher.mul(r, a, b, count);
+
+	for (size_t i = 0; i < count; i++) {
+		bui_t expected = a[i];
+		expected *= b[i];
+		check("mul", i, expected, r[i]);
+	}
+
+	launcher.mod(r, a, b, count);
+
+	for (size_t i = 0; i < count; i++) {
+		check("mod", i, bifsi::divmod(a[i], b[i]).r, r[i]);
+	}
+
+	launcher.mod_pow(r, a, e, count, mont);
+
+	for (size_t i = 0; i < count; i++) {
+		check("mod_pow", i, mont.mod_pow(a[i], e[i]), r[i]);
+	}
+
+	const bifsi::fixed_base_table<SIZE_IN_BITS, 64, 4, EL_T> table(mont, a[0]);
+	launcher.fixed_base_mod_pow(r, e, count, mont, table);
+
+	for (size_t i = 0; i < count; i++) {
+		check("fixed_base_mod_pow", i, mont.mod_pow(a[0], e[i]), r[i]);
+	}
+
+	bui_t expected_multi_pow = mont.one;
+
+	for (size_t i = 0; i < count; i++) {
+		expected_multi_pow = mont.mont_mul(expected_multi_pow, mont.to_mont(mont.mod_pow(a[i], e[i])));
+	}
+
+	check("multi_pow", 0, mont.from_mont(expected_multi_pow), launcher.multi_pow(a, e, count, mont));
+
+	launcher.miller_rabin<4>(p, b, count);
+
+	for (size_t i = 0; i < count; i++) {
+		check("miller_rabin", i, bui_t((unsigned) bifsi::prime::miller_rabin<4>(b[i])), bui_t((unsigned) p[i]));
+	}
+
+	launcher.str(s.data(), a, count);
+
+	for (size_t i = 0; i < count; i++) {
+		if (s[i] != a[i].str() && result == 0) {
+			cout << "test failed: host::launcher(" << thread_count << ").str<" << SIZE_IN_BITS << "> at " << i << ": expected " << a[i] << " but got " << s[i] << endl;
+			result = 1;
+		}
+	}
+
+	// in place, r is a
+	bui_t *c = launcher.allocate<bui_t>(count);
+	std::copy(a, a + count, c);
+
+	launcher.add(c, c, b, count);
+	launcher.add(r, a, b, count);
+
+	for (size_t i = 0; i < count; i++) {
+		check("add in place", i, r[i], c[i]);
+	}
+
+	launcher.deallocate(a);
+	launcher.deallocate(b);
+	launcher.deallocate(r);
+	launcher.deallocate(e);
+	launcher.deallocate(p);
+	launcher.deallocate(c);
+
+	return result;
+}
+
+int test_host() {
+	cout << "running host tests" << endl;
+
+	int result = 0;
+
+	result |= test_host<256, uint64_t>(1000, 4, 1024);
+	result |= test_host<256, uint32_t>(1, 4, 1024);
+	result |= test_host<128, uint32_t>(777, 1, 1 << 20);
+	result |= test_host<512, uint32_t>(100, 7, 256);
+	result |= test_host<64, uint16_t>(4099, 3, bifsi::host::l2_cache_size());
+
+	// one call after the other on the same launcher
+	bifsi::host::launcher launcher(3, 64);
+
+	for (size_t t = 0; t < 200 && result == 0; t++) {
+		const size_t count = (size_t) std::rand() % 50;
+
+		std::vector<bui<128>> a(count);
+		std::vector<bui<128>> b(count);
+
+		for (size_t i = 0; i < count; i++) {
+			a[i] = random_bui<128>();
+			b[i] = random_bui<128>();
+		}
+
+		std::vector<bui<128>> r(count);
+		launcher.mul(r.data(), a.data(), b.data(), count);
+
+		for (size_t i = 0; i < count; i++) {
+			bui<128> expected = a[i];
+			expected *= b[i];
+
+			if (r[i] != expected) {
+				cout << "test failed: host::launcher.mul, call " << t << " at " << i << ": expected " << expected << " but got " << r[i] << endl;
+				result = 1;
+				break;
+			}
+		}
+	}
+
+	// exceptions of process, from the first chunk, which the calling thread
+	// processes, and from the last one, which a worker processes, and the
+	// launcher still works afterwards
+	for (size_t t = 0; t < 2 && result == 0; t++) {
+		const size_t count = 1000;
+
+		std::vector<uint32_t> x(count, 1U);
+		const uint32_t *thrower = (t == 0) ? x.data() : x.data() + count - 1;
+
+		try {
+			launcher.run(x.data(), x.data(), (const uint8_t*) nullptr, count, [&](uint32_t *cr, const uint32_t *ca, const uint8_t*, size_t n) {
+				for (size_t i = 0; i < n; i++) {
+					if (ca + i == thrower) {
+						throw std::runtime_error("process failed");
+					}
+
+					cr[i] = ca[i] + 1;
+				}
+			});
+
+			cout << "test failed: host::launcher.run, case " << t << ": no exception" << endl;
+			result = 1;
+		} catch (const std::runtime_error &e) {
+			if (string(e.what()) != "process failed") {
+				cout << "test failed: host::launcher.run, case " << t << ": unexpected exception " << e.what() << endl;
+				result = 1;
+			}
+		}
+
+		std::vector<bui<128>> a(count, bui<128>(3U));
+		std::vector<bui<128>> r(count);
+		launcher.mul(r.data(), a.data(), a.data(), count);
+
+		if (!std::all_of(r.begin(), r.end(), [](const bui<128> &v) { return v == 9U; })) {
+			cout << "test failed: host::launcher.mul after an exception, case " << t << endl;
+			result = 1;
+		}
+	}
+
+	if (result == 0) {
+		cout << "host tests completed successfully." << endl;
+	}
+
+	return result;
+}
+
+/*
+ * Checks the operations of bui<SIZE_IN_BITS, EL_T> against the same operations
+ * on the bui<SIZE_IN_BITS> of the other tests, with the values converted
+ * between the element types by el_cast.
+ */
+template<size_t SIZE_IN_BITS, typename EL_T>
+int test_el_type(size_t test_count) {
+	typedef bifsi::bui<SIZE_IN_BITS, EL_T> bui_t;
+
+	for (size_t t = 0; t < test_count; t++) {
+		const bui<SIZE_IN_BITS> x = random_bui<SIZE_IN_BITS>();
+		const bui<SIZE_IN_BITS> y = random_bui<SIZE_IN_BITS>();
+		bui<SIZE_IN_BITS> d = random_bui<SIZE_IN_BITS>();
+
+		for (size_t j = t % bui<SIZE_IN_BITS>::SIZE_IN_ELS + 1; j < bui<SIZE_IN_BITS>::SIZE_IN_ELS; j++) {
+			d.el[j] = 0;
+		}
+
+		// odd and greater than 1, so it's a valid Montgomery modulus as well
+		d.el[0] |= 3;
+
+		const bui<64> e = random_bui<64>();
+
+		const EL_T m = (EL_T) (std::rand() | 1);
+
+		const bui_t xc = bifsi::el_cast<EL_T>(x);
+		const bui_t yc = bifsi::el_cast<EL_T>(y);
+		const bui_t dc(d);
+
+		bui<SIZE_IN_BITS> expected_prod = x;
+		expected_prod *= y;
+
+		bui<SIZE_IN_BITS> expected_scalar = x;
+		expected_scalar *= (el_t) m;
+		expected_scalar += (el_t) m;
+
+		bui<SIZE_IN_BITS> expected_quot = x;
+		const el_t expected_rem = (expected_quot /= (el_t) m);
+
+		const auto expected_qr = bifsi::divmod(x, d);
+
+		const bui<SIZE_IN_BITS> expected_pow = bifsi::montgomery<SIZE_IN_BITS, el_t>(d).mod_pow(x, e);
+
+		bui_t actual_prod = xc;
+		actual_prod *= yc;
+
+		bui_t actual_scalar = xc;
+		actual_scalar *= m;
+		actual_scalar += m;
+
+		bui_t actual_quot = xc;
+		const EL_T actual_rem = (actual_quot /= m);
+
+		const auto actual_qr = bifsi::divmod(xc, dc);
+
+		const bui_t actual_pow = bifsi::montgomery<SIZE_IN_BITS, EL_T>(dc).mod_pow(xc, bifsi::el_cast<EL_T>(e));
+
+		const string str = x.str();
+
+		bui_t parsed = 0;
+		bifsi::from_chars(str.data(), str.data() + str.size(), parsed);
+
+		if (!equal_els(bifsi::el_cast<el_t>(xc), x.el) //
+				|| !equal_els(bifsi::el_cast<el_t>(actual_prod), expected_prod.el) //
+				|| !equal_els(bifsi::el_cast<el_t>(actual_scalar), expected_scalar.el) //
+				|| !equal_els(bifsi::el_cast<el_t>(actual_quot), expected_quot.el) //
+				|| actual_rem != expected_rem //
+				|| actual_rem != xc % m //
+				|| !equal_els(bifsi::el_cast<el_t>(actual_qr.q), expected_qr.q.el) //
+				|| !equal_els(bifsi::el_cast<el_t>(actual_qr.r), expected_qr.r.el) //
+				|| !equal_els(bifsi::el_cast<el_t>(actual_pow), expected_pow.el) //
+				|| xc.str() != str //
+				|| !equal_els(bifsi::el_cast<el_t>(parsed), x.el)) {
+			cout << "test failed: " << bifsi::type_name<bui_t>() << ":" << endl;
+			cout << "x: " << x << endl;
+			cout << "y: " << y << endl;
+			cout << "d: " << d << endl;
+			cout << "m: " << (uint64_t) m << endl;
+
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+int test_el_types() {
+	cout << "running element type tests" << endl;
+
+	int result = 0;
+
+	// the element order doesn't depend on the byte order of the platform
+	const bifsi::bui<64, uint64_t> x64 = (uint64_t) 0x0102030405060708;
+	const bifsi::bui<64, uint8_t> x8(x64);
+	const bifsi::bui<64, uint16_t> x16 = bifsi::el_cast<uint16_t>(x8);
+
+	if (x8.el[0] != 0x08 || x8.el[7] != 0x01 || x16.el[0] != 0x0708 || x16.el[3] != 0x0102 || bifsi::el_cast<uint64_t>(x16).el[0] != 0x0102030405060708) {
+		cout << "test failed: el_cast of " << x64 << endl;
+		result = 1;
+	}
+
+	result |= test_el_type<256, uint8_t>(200);
+	result |= test_el_type<256, uint16_t>(200);
+	result |= test_el_type<256, uint64_t>(200);
+	result |= test_el_type<2048, uint8_t>(10);
+	result |= test_el_type<2048, uint16_t>(20);
+	result |= test_el_type<4096, uint64_t>(20);
+	result |= test_el_type<1024, bifsi::el_t>(50);
+
+	if (result == 0) {
+		cout << "element type tests completed successfully." << endl;
+	}
+
+	return result;
+}
+
+template<typename EL_T>
+int test_primitives_el_type(size_t test_count) {
+	const EL_T MAX = (EL_T) -1;
+	const EL_T edges[] = { 0, 1, 2, (EL_T) (MAX >> 1), (EL_T) ((MAX >> 1) + 1), (EL_T) (MAX - 1), MAX };
+	const size_t EDGE_COUNT = sizeof(edges) / sizeof(edges[0]);
+
+	for (size_t t = 0; t < EDGE_COUNT * EDGE_COUNT * 2 + test_count; t++) {
+		EL_T a;
+		EL_T b;
+		const EL_T c = (EL_T) (t & 1);
+
+		if (t < EDGE_COUNT * EDGE_COUNT * 2) {
+			a = edges[t / 2 % EDGE_COUNT];
+			b = edges[t / 2 / EDGE_COUNT];
+		} else {
+			a = (EL_T) (((uint64_t) std::rand() << 33) ^ ((uint64_t) std::rand() << 16) ^ std::rand());
+			b = (EL_T) (((uint64_t) std::rand() << 33) ^ ((uint64_t) std::rand() << 16) ^ std::rand());
+		}
+
+		EL_T expected_carry = c;
+		EL_T actual_carry = c;
+		const EL_T expected_sum = bifsi::portable::addc(a, b, expected_carry);
+		const EL_T actual_sum = bifsi::addc(a, b, actual_carry);
+
+		EL_T expected_borrow = c;
+		EL_T actual_borrow = c;
+		const EL_T expected_diff = bifsi::portable::subb(a, b, expected_borrow);
+		const EL_T actual_diff = bifsi::subb(a, b, actual_borrow);
+
+		EL_T expected_hi;
+		EL_T actual_hi;
+		const EL_T expected_lo = bifsi::portable::mul_wide(a, b, expected_hi);
+		const EL_T actual_lo = bifsi::mul_wide(a, b, actual_hi);
+
+		// a * b + a + b doesn't overflow 2 elements
+		EL_T fused_hi;
+		const EL_T fused_lo = bifsi::mul_add_wide(a, b, a, b, fused_hi);
+		EL_T sum_carry = 0;
+		EL_T sum_lo = bifsi::portable::addc(expected_lo, a, sum_carry);
+		EL_T sum_hi = (EL_T) (expected_hi + sum_carry);
+		sum_carry = 0;
+		sum_lo = bifsi::portable::addc(sum_lo, b, sum_carry);
+		sum_hi = (EL_T) (sum_hi + sum_carry);
+
+		if (expected_sum != actual_sum || expected_carry != actual_carry //
+				|| expected_diff != actual_diff || expected_borrow != actual_borrow //
+				|| expected_lo != actual_lo || expected_hi != actual_hi //
+				|| fused_lo != sum_lo || fused_hi != sum_hi //
+				|| (EL_T) (a + b + c) != expected_sum || (EL_T) (a - b - c) != expected_diff //
+				|| (EL_T) (a * b) != expected_lo) {
+			cout << "test failed: primitives for " << bifsi::type_name<EL_T>() << ":" << endl;
+			cout << "a: " << (uint64_t) a << endl;
+			cout << "b: " << (uint64_t) b << endl;
+			cout << "c: " << (uint64_t) c << endl;
+
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+int test_primitives() {
+	cout << "running primitive tests" << endl;
+
+	int result = 0;
+
+	result |= test_primitives_el_type<uint8_t>(10000);
+	result |= test_primitives_el_type<uint16_t>(10000);
+	result |= test_primitives_el_type<uint32_t>(100000);
+	result |= test_primitives_el_type<uint64_t>(100000);
+
+	// multiplying with an unsigned int type wider than the elements
+	for (size_t t = 0; t < 100000; t++) {
+		const uint128_t x = to_uint128(random_bui<128>());
+		const uint64_t m = (uint64_t) to_uint128(random_bui<128>());
+
+		uint128_t expected = x;
+		expected *= m;
+
+		bui<128> actual = from_uint128(x);
+		actual *= m;
+
+		if (to_uint128(actual) != expected) {
+			cout << "test failed: " << bifsi::type_name<decltype(actual)>() << " *= uint64_t:" << endl;
+			cout << "x       : " << x << endl;
+			cout << "m       : " << m << endl;
+			cout << "expected: " << expected << endl;
+			cout << "actual  : " << actual << endl;
+
+			result = 1;
+			break;
+		}
+	}
+
+	if (result == 0) {
+		cout << "primitive tests completed successfully." << endl;
+	}
+
+	return result;
+}
+
+/*
+ * Compares decimal strings without leading zeros, as reference for compare.
+ */
+int compare_dec_str(const string &a, const string &b) {
+	if (a.size() != b.size()) {
+		return (a.size() < b.size()) ? -1 : 1;
+	}
+
+	const int c = a.compare(b);
+
+	return (c > 0) - (c < 0);
+}
+
+/*
+ * Checks compare and the comparison operators of a bui<A_SIZE_IN_BITS> and a
+ * bui<B_SIZE_IN_BITS> against compare_dec_str. b is mostly derived from a by
+ * changing one element, so that all positions decide some of the
+ * comparisons.
+ */
+template<size_t A_SIZE_IN_BITS, size_t B_SIZE_IN_BITS, typename EL_T>
+int test_compare(size_t test_count) {
+	typedef bifsi::bui<A_SIZE_IN_BITS, EL_T> a_t;
+	typedef bifsi::bui<B_SIZE_IN_BITS, EL_T> b_t;
+
+	for (size_t i = 0; i < test_count; i++) {
+		const a_t a = bifsi::el_cast<EL_T>(random_bui<A_SIZE_IN_BITS>());
+		b_t b = bifsi::el_cast<EL_T>(random_bui<B_SIZE_IN_BITS>());
+
+		if (i % 4 != 0) {
+			for (size_t j = 0; j < b_t::SIZE_IN_ELS; j++) {
+				b.el[j] = (j < a_t::SIZE_IN_ELS) ? a.el[j] : 0;
+			}
+
+			if (i % 4 != 1) {
+				const size_t j = std::rand() % b_t::SIZE_IN_ELS;
+				b.el[j] = (EL_T) (b.el[j] + ((i % 4 == 2) ? 1 : -1));
+			}
+		}
+
+		const int expected = compare_dec_str(a.str(), b.str());
+		const int actual = a.compare(b);
+
+		const bool ok = actual == expected //
+				&& b.compare(a) == -expected //
+				&& (a == b) == (expected == 0) //
+				&& (a != b) == (expected != 0) //
+				&& (a < b) == (expected < 0) //
+				&& (a > b) == (expected > 0) //
+				&& (a <= b) == (expected <= 0) //
+				&& (a >= b) == (expected >= 0) //
+				&& (b < a) == (expected > 0);
+
+		if (!ok) {
+			cout << "test failed: compare of " << bifsi::type_name<a_t>() << " and " << bifsi::type_name<b_t>() << ":" << endl;
+			cout << "a       : " << a << endl;
+			cout << "b       : " << b << endl;
+			cout << "expected: " << expected << endl;
+			cout << "actual  : " << actual << endl;
+
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+int test_compare() {
+	const size_t TEST_COUNT = 10000;
+
+	cout << "running compare tests" << endl;
+
+	int result = 0;
+
+	result |= test_compare<128, 128, el_t>(TEST_COUNT);
+	result |= test_compare<512, 512, el_t>(TEST_COUNT);
+	result |= test_compare<256, 96, el_t>(TEST_COUNT);
+	result |= test_compare<64, 512, el_t>(TEST_COUNT);
+	result |= test_compare<256, 256, uint8_t>(TEST_COUNT);
+	result |= test_compare<512, 128, uint64_t>(TEST_COUNT);
+
+	// bui as the key of a sorted container
+	std::vector<bui<256>> v;
+
+	for (size_t i = 0; i < 100; i++) {
+		v.push_back(random_bui<256>() >>= (std::rand() % 256));
+	}
+
+	std::sort(v.begin(), v.end());
+
+	for (size_t i = 1; i < v.size(); i++) {
+		if (compare_dec_str(v[i - 1].str(), v[i].str()) > 0) {
+			cout << "test failed: std::sort of bui<256>" << endl;
+
+			result = 1;
+			break;
+		}
+	}
+
+#if __cplusplus >= 202002L
+	if ((v[0] <=> v[0]) != 0 || (mersenne<128>(127) <=> mersenne<256>(128)) >= 0) {
+		cout << "test failed: operator<=>" << endl;
+
+		result = 1;
+	}
+#endif
+
+	if (result == 0) {
+		cout << "compare tests completed successfully." << endl;
+	}
+
+	return result;
+}
+
+typedef __int128 int128_t;
 
-	constexpr int32_t INT128_SIZE_IN_BITS = sizeof(uint128_t) * 8;
+inline std::string to_string(int128_t x) {
+	return (x < 0) ? "-" + to_string((uint128_t) -(uint128_t) x) : to_string((uint128_t) x);
+}
 
-	constexpr int32_t MAX_DIGITS = bifsi::ceil_constexpr(INT128_SIZE_IN_BITS * LOG_BASE10_2);
+template<typename EL_T>
+inline int128_t to_int128(const bifsi::bsi<128, EL_T> &x) {
+	return (int128_t) to_uint128(bifsi::el_cast<el_t>(x.bits));
+}
 
-	char result[MAX_DIGITS + 1];
+template<typename EL_T>
+inline bifsi::bsi<128, EL_T> from_int128(int128_t x) {
+	return bifsi::bsi<128, EL_T>(bifsi::el_cast<EL_T>(from_uint128((uint128_t) x)));
+}
 
-	uint32_t i = 0;
+/*
+ * Checks the operations of bsi<128, EL_T> against __int128, and the widening
+ * multiplication of bsi<64, EL_T>. The first operands are the extremes of the
+ * value range.
+ */
+template<typename EL_T>
+int test_bsi_against_int128(size_t test_count) {
+	typedef bifsi::bsi<128, EL_T> bsi_t;
 
-	while (x != 0) {
-		result[i] = '0' + (char) (x % 10);
-		x /= 10;
+	const int128_t MIN = (int128_t) ((uint128_t) 1 << 127);
+	const int128_t MAX = (int128_t) (((uint128_t) 1 << 127) - 1);
+	const int128_t EXTREMES[] = { MIN, MAX, -1, 0, 1, MIN + 1 };
+	const size_t EXTREME_COUNT = sizeof(EXTREMES) / sizeof(EXTREMES[0]);
 
-		i++;
+	for (size_t i = 0; i < test_count; i++) {
+		int128_t a = (int128_t) to_uint128(random_bui<128>()) >> (std::rand() % 128);
+		int128_t b = (int128_t) to_uint128(random_bui<128>()) >> (std::rand() % 128);
+		const size_t n = std::rand() % 128;
+		const int32_t m = (int32_t) std::rand() - RAND_MAX / 2;
+
+		if (i < EXTREME_COUNT * EXTREME_COUNT) {
+			a = EXTREMES[i / EXTREME_COUNT];
+			b = EXTREMES[i % EXTREME_COUNT];
+		}
+
+		const bsi_t x = from_int128<EL_T>(a);
+		const bsi_t y = from_int128<EL_T>(b);
+
+		// wrapping arithmetic of the reference, computed unsigned
+		const int128_t sum = (int128_t) ((uint128_t) a + (uint128_t) b);
+		const int128_t diff = (int128_t) ((uint128_t) a - (uint128_t) b);
+		const int128_t prod = (int128_t) ((uint128_t) a * (uint128_t) b);
+		const int128_t prod_m = (int128_t) ((uint128_t) a * (uint128_t) (int128_t) m);
+		const int128_t neg = (int128_t) -(uint128_t) a;
+		const int128_t shl = (int128_t) ((uint128_t) a << n);
+		const int128_t sar = a >> n;
+		const int expected_cmp = (a < b) ? -1 : (a > b) ? 1 : 0;
+
+		bsi_t actual_sum = x;
+		actual_sum += y;
+
+		bsi_t actual_diff = x;
+		actual_diff -= y;
+
+		bsi_t actual_prod = x;
+		actual_prod *= y;
+
+		bsi_t actual_prod_m = x;
+		actual_prod_m *= m;
+
+		bsi_t actual_shl = x;
+		actual_shl <<= n;
+
+		bsi_t actual_sar = x;
+		actual_sar >>= n;
+
+		const int64_t a64 = (int64_t) a;
+		const int64_t b64 = (int64_t) b;
+		const bifsi::bsi<128, EL_T> actual_full = bifsi::mul_full(bifsi::bsi<64, EL_T>(a64), bifsi::bsi<64, EL_T>(b64));
+
+		const bool ok = to_int128(actual_sum) == sum //
+				&& to_int128(actual_diff) == diff //
+				&& to_int128(actual_prod) == prod //
+				&& to_int128(actual_prod_m) == prod_m //
+				&& to_int128(-x) == neg //
+				&& to_int128(actual_shl) == shl //
+				&& to_int128(actual_sar) == sar //
+				&& to_int128(actual_full) == (int128_t) a64 * b64 //
+				&& x.compare(y) == expected_cmp //
+				&& (x < y) == (a < b) //
+				&& (x >= y) == (a >= b) //
+				&& (x == y) == (a == b) //
+				&& x.is_negative() == (a < 0) //
+				&& x.template as<int64_t>() == a64 //
+				&& bsi_t(a64) == from_int128<EL_T>(a64) //
+				&& x.str() == to_string(a) //
+				&& bsi_t(to_string(a).c_str()) == x //
+				&& x.abs() == bifsi::el_cast<EL_T>(from_uint128((a < 0) ? -(uint128_t) a : (uint128_t) a));
+
+		if (!ok) {
+			cout << "test failed: bsi<128, " << bifsi::type_name<EL_T>() << "> against int128:" << endl;
+			cout << "a: " << to_string(a) << endl;
+			cout << "b: " << to_string(b) << endl;
+			cout << "n: " << n << endl;
+			cout << "m: " << m << endl;
+			cout << "x * y: " << actual_prod << endl;
+			cout << "x >> n: " << actual_sar << endl;
+
+			return 1;
+		}
 	}
 
-	if (i == 0) {
-		return "0";
+	return 0;
+}
+
+/*
+ * Checks the widening multiplication and the arithmetic right shift of
+ * bsi<SIZE_IN_BITS, EL_T> against the same operations on the absolute
+ * values.
+ */
+template<size_t SIZE_IN_BITS, typename EL_T>
+int test_bsi(size_t test_count) {
+	typedef bifsi::bsi<SIZE_IN_BITS, EL_T> bsi_t;
+	typedef bifsi::bsi<2 * SIZE_IN_BITS, EL_T> wide_t;
+
+	for (size_t i = 0; i < test_count; i++) {
+		const bsi_t x(bifsi::el_cast<EL_T>(random_bui<SIZE_IN_BITS>()));
+		const bsi_t y(bifsi::el_cast<EL_T>(random_bui<SIZE_IN_BITS>()));
+		const size_t n = std::rand() % SIZE_IN_BITS;
+
+		const wide_t actual_full = bifsi::mul_full(x, y);
+
+		// the sign of the product, and its magnitude from the magnitudes of
+		// the factors
+		wide_t expected_full(bifsi::mul_full(x.abs(), y.abs()));
+		expected_full.conditional_negate((EL_T) -(EL_T) (x.is_negative() != y.is_negative()));
+
+		// floor(x / 2^n) = -(((|x| - 1) >> n) + 1) for negative x
+		bsi_t expected_sar;
+
+		if (x.is_negative()) {
+			typename bsi_t::bui_t t = x.abs();
+			t -= 1;
+			t >>= n;
+			expected_sar = bsi_t(t);
+			expected_sar += 1;
+			expected_sar.negate();
+
+		} else {
+			typename bsi_t::bui_t t = x.abs();
+			t >>= n;
+			expected_sar = bsi_t(t);
+		}
+
+		bsi_t actual_sar = x;
+		actual_sar >>= n;
+
+		if (actual_full != expected_full || actual_sar != expected_sar) {
+			cout << "test failed: bsi of " << bifsi::type_name<bsi_t>() << ":" << endl;
+			cout << "x: " << x << endl;
+			cout << "y: " << y << endl;
+			cout << "n: " << n << endl;
+			cout << "expected x * y: " << expected_full << endl;
+			cout << "actual x * y  : " << actual_full << endl;
+			cout << "expected x >> n: " << expected_sar << endl;
+			cout << "actual x >> n  : " << actual_sar << endl;
+
+			return 1;
+		}
 	}
 
-	result[i] = '\0';
+	return 0;
+}
 
-	std::reverse(result, result + i);
+int test_signed() {
+	const size_t TEST_COUNT = 100000;
 
-	return std::string(result);
+	cout << "running signed tests" << endl;
+
+	constexpr bifsi::bsi<256, el_t> C = "-123456789012345678901234567890";
+	static_assert(C.is_negative() && -C == bifsi::bsi<256, el_t>("123456789012345678901234567890") && C < 0 && C.abs() > 1U, "constexpr bsi");
+
+	int result = 0;
+
+	result |= test_bsi_against_int128<uint32_t>(TEST_COUNT);
+	result |= test_bsi_against_int128<uint64_t>(TEST_COUNT);
+	result |= test_bsi_against_int128<uint8_t>(TEST_COUNT / 10);
+	result |= test_bsi<256, el_t>(TEST_COUNT / 10);
+	result |= test_bsi<1024, uint64_t>(TEST_COUNT / 100);
+	result |= test_bsi<2048, uint32_t>(TEST_COUNT / 100);
+	result |= test_bsi<96, uint16_t>(TEST_COUNT / 10);
+
+	if (result == 0) {
+		cout << "signed tests completed successfully." << endl;
+	}
+
+	return result;
 }
 
-inline std::ostream& operator<<(std::ostream &os, const uint128_t &x) {
-	return os << to_string(x);
+/*
+ * Checks the conversions of bui<SIZE_IN_BITS, EL_T> from and to uint128_t and
+ * the arithmetic and comparisons with uint128_t operands against uint128_t
+ * arithmetic, modulo 2^SIZE_IN_BITS for the smaller sizes.
+ */
+template<size_t SIZE_IN_BITS, typename EL_T>
+int test_conversions(size_t test_count) {
+	typedef bifsi::bui<SIZE_IN_BITS, EL_T> bui_t;
+
+	const uint128_t mask = (SIZE_IN_BITS >= 128) ? ~(uint128_t) 0 : (((uint128_t) 1) << (SIZE_IN_BITS % 128)) - 1;
+
+	for (size_t t = 0; t < test_count; t++) {
+		const uint128_t v = to_uint128(random_bui<128>()) >> (std::rand() % 128);
+		const uint128_t w = to_uint128(random_bui<128>()) >> (std::rand() % 128);
+		const uint64_t v64 = (uint64_t) v;
+
+		const bui_t x = v;
+
+		bui_t sum = x;
+		sum += w;
+
+		bui_t diff = x;
+		diff -= w;
+
+		bui_t prod = x;
+		prod *= w;
+
+		bool ok = x.template as<uint128_t>() == (v & mask);
+		ok = ok && x.template as<uint64_t>() == (uint64_t) (v & mask);
+		ok = ok && bui_t(v64).template as<uint64_t>() == (uint64_t) (v64 & mask);
+		ok = ok && sum.template as<uint128_t>() == ((v + w) & mask);
+		ok = ok && diff.template as<uint128_t>() == ((v - w) & mask);
+		ok = ok && prod.template as<uint128_t>() == ((v * w) & mask);
+		ok = ok && (x == w) == ((v & mask) == w);
+		ok = ok && (x < w) == ((v & mask) < w);
+		ok = ok && (x >= w) == ((v & mask) >= w);
+
+		// widened and narrowed again, which cuts off the zeros of widening
+		const bifsi::bui<SIZE_IN_BITS + 256, EL_T> wide = bifsi::width_cast<SIZE_IN_BITS + 256>(x);
+		const bifsi::bui<SIZE_IN_BITS, EL_T> narrow = bifsi::width_cast<SIZE_IN_BITS>(wide);
+		const bifsi::bui<8 * sizeof(EL_T), EL_T> lowest = bifsi::width_cast<8 * sizeof(EL_T)>(x);
+
+		bifsi::bui<SIZE_IN_BITS + 256, EL_T> wide_hi = wide;
+		wide_hi >>= SIZE_IN_BITS;
+
+		ok = ok && wide.template as<uint128_t>() == (v & mask) && wide_hi == 0U && narrow == x && lowest == x.el[0];
+
+		if (!ok) {
+			cout << "test failed: conversions of bui<" << SIZE_IN_BITS << ", " << bifsi::type_name<EL_T>() << "> with " << v << " and " << w << endl;
+			return 1;
+		}
+	}
+
+	return 0;
 }
 
-int main() {
+int test_conversions() {
+	cout << "running conversion tests" << endl;
+
+	int result = 0;
+
+	result |= test_conversions<8, uint8_t>(10000);
+	result |= test_conversions<24, uint8_t>(10000);
+	result |= test_conversions<128, uint8_t>(10000);
+	result |= test_conversions<136, uint8_t>(10000);
+	result |= test_conversions<48, uint16_t>(10000);
+	result |= test_conversions<256, uint16_t>(10000);
+	result |= test_conversions<32, uint32_t>(10000);
+	result |= test_conversions<96, uint32_t>(10000);
+	result |= test_conversions<64, uint64_t>(10000);
+	result |= test_conversions<192, uint64_t>(10000);
+
+	constexpr uint128_t C = (((uint128_t) 0x0123456789abcdefULL) << 64) | 0xfedcba9876543210ULL;
+
+	static_assert(bifsi::bui<128, uint8_t>(C).as<uint128_t>() == C);
+	static_assert(bifsi::bui<128, uint8_t>(C) == C && bifsi::bui<128, uint8_t>(C) > (uint64_t) -1);
+	static_assert(bifsi::width_cast<64>(bifsi::bui<128, uint16_t>(C)) == (uint64_t) C);
+	static_assert(bifsi::width_cast<512>(bifsi::bui<128, uint32_t>(C)).as<uint128_t>() == C);
+
+	if (result == 0) {
+		cout << "conversion tests completed successfully." << endl;
+	}
+
+	return result;
+}
+
+int test_scalar_ops() {
 	uint128_t before = 0;
 	uint128_t expected = 0;
-	bifsi::bui<128> actual = 0;
+	bui<128> actual = 0;
 
 //	if (actual != 0) {
 //		cout << "actual != 0" << endl;
@@ -105,10 +2911,10 @@ int main() {
 
 	for (; i < TEST_COUNT; i++) {
 		int op_idx = std::rand() % 5;
-		bifsi::el_t op_val = std::rand();
+		el_t op_val = std::rand();
 
-		bifsi::el_t r_expected = 0;
-		bifsi::el_t r_actual = 0;
+		el_t r_expected = 0;
+		el_t r_actual = 0;
 
 		before = expected;
 
@@ -153,7 +2959,7 @@ int main() {
 			throw std::runtime_error("unknown op_idx");
 		}
 
-		if (to_string(actual) != to_string(expected)) {
+		if (to_uint128(actual) != expected) {
 			cout << "test failed: actual != expected:" << endl;
 			cout << "i       : " << i << endl;
 			cout << "before  : " << before << endl;
@@ -177,3 +2983,490 @@ int main() {
 
 	return 0;
 }
+
+/*
+ * Returns a random bui with a random number of leading zero bits, so that
+ * the used elements of the values vary over the whole size.
+ */
+template<size_t SIZE_IN_BITS, typename EL_T>
+bifsi::bui<SIZE_IN_BITS, EL_T> random_used_bui() {
+	bifsi::bui<SIZE_IN_BITS, EL_T> result = bifsi::el_cast<EL_T>(random_bui<SIZE_IN_BITS>());
+	result >>= std::rand() % (SIZE_IN_BITS + 1);
+
+	return result;
+}
+
+/*
+ * Checks the operations with the vartime policy against the same ones with
+ * the default policy ct, for operands with any number of used elements.
+ */
+template<size_t SIZE_IN_BITS, typename EL_T>
+int test_vartime(size_t test_count) {
+	typedef bifsi::bui<SIZE_IN_BITS, EL_T> bui_t;
+
+	using bifsi::vartime;
+
+	for (size_t i = 0; i < test_count; i++) {
+		const bui_t a = random_used_bui<SIZE_IN_BITS, EL_T>();
+		bui_t b = random_used_bui<SIZE_IN_BITS, EL_T>();
+
+		if (i % 4 == 0) {
+			b = a;
+		}
+
+		bui_t d = b;
+		d += (unsigned int) d.is_zero();
+
+		const EL_T m = (EL_T) (std::rand() | 1);
+
+		const bifsi::divmod_result<SIZE_IN_BITS, SIZE_IN_BITS, EL_T> qr = bifsi::divmod(a, d);
+		const bifsi::divmod_result<SIZE_IN_BITS, SIZE_IN_BITS, EL_T> qr_vt = bifsi::divmod<vartime>(a, d);
+
+		const bifsi::divmod_result<SIZE_IN_BITS, sizeof(EL_T) * 8, EL_T> qr_el = bifsi::divmod(a, bifsi::divisor<EL_T>(m));
+		const bifsi::divmod_result<SIZE_IN_BITS, sizeof(EL_T) * 8, EL_T> qr_el_vt = bifsi::divmod<vartime>(a, bifsi::divisor<EL_T>(m));
+
+		const string a_str = a.str();
+
+		bui_t parsed_dec = 1U;
+		bui_t parsed_36 = 1U;
+		bifsi::from_chars<vartime>(a_str.c_str(), a_str.c_str() + a_str.size(), parsed_dec);
+
+		string b_36 = "0";
+
+		for (size_t j = std::rand() % (SIZE_IN_BITS / 5 + 1); j > 0; j--) {
+			b_36 += "0123456789abcdefghijklmnopqrstuvwxyz"[std::rand() % 36];
+		}
+
+		bui_t expected_36 = 0U;
+		const bool fits_36 = bifsi::from_chars(b_36.c_str(), b_36.c_str() + b_36.size(), expected_36, 36).ec == std::errc();
+		const bool fits_36_vt = bifsi::from_chars<vartime>(b_36.c_str(), b_36.c_str() + b_36.size(), parsed_36, 36).ec == std::errc();
+
+		const bool ok = bifsi::mul<vartime>(a, b) == (bui_t(a) *= b) //
+				&& bifsi::mul(a, b) == (bui_t(a) *= b) //
+				&& bifsi::mul_full<vartime>(a, b) == bifsi::mul_full(a, b) //
+				&& bifsi::sqr<vartime>(a) == bifsi::sqr(a) //
+				&& qr_vt.q == qr.q && qr_vt.r == qr.r //
+				&& qr_el_vt.q == qr_el.q && qr_el_vt.r == qr_el.r //
+				&& a.template compare<vartime>(b) == a.compare(b) //
+				&& b.template compare<vartime>(a) == b.compare(a) //
+				&& a.template compare<vartime>(d) == a.compare(d) //
+				&& a.template str<vartime>() == a_str //
+				&& parsed_dec == a //
+				&& fits_36_vt == fits_36 && (!fits_36 || parsed_36 == expected_36);
+
+		if (!ok) {
+			cout << "test failed: vartime of " << bifsi::type_name<bui_t>() << ":" << endl;
+			cout << "a: " << a << endl;
+			cout << "b: " << b << endl;
+			cout << "m: " << (uint64_t) m << endl;
+
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+int test_vartime() {
+	cout << "running vartime tests" << endl;
+
+	static_assert(bifsi::mul<bifsi::vartime>(bui<256>(6U), bui<256>(7U)) == 42U, "constexpr vartime");
+	static_assert(bifsi::divmod<bifsi::vartime>(bui<256>(1000U), bui<256>(7U)).r == 6U, "constexpr vartime");
+	static_assert(bui<256>(1U).compare<bifsi::vartime>(bui<128>(2U)) == -1, "constexpr vartime");
+
+	int result = 0;
+
+	result |= test_vartime<64, el_t>(10000);
+	result |= test_vartime<256, el_t>(10000);
+	result |= test_vartime<96, uint16_t>(10000);
+	result |= test_vartime<160, uint8_t>(10000);
+	result |= test_vartime<1024, uint64_t>(2000);
+	result |= test_vartime<2048, el_t>(500);
+	result |= test_vartime<4096, uint64_t>(200);
+
+	if (result == 0) {
+		cout << "vartime tests completed successfully." << endl;
+	}
+
+	return result;
+}
+
+/*
+ * Runs a function on THREADS host threads, which stand in for the threads of
+ * a tile of a CUDA thread block, so the functions of bifsi_cg.h can be tested
+ * without a GPU. Each shuffle and ballot waits until all threads have arrived.
+ */
+template<size_t THREADS>
+class sim_tile_group {
+	std::mutex mutex;
+	std::condition_variable arrived_cv;
+	size_t arrived = 0;
+	size_t generation = 0;
+	uint64_t slots[THREADS];
+
+	void barrier(std::unique_lock<std::mutex> &lock) {
+		const size_t g = generation;
+
+		if (++arrived == THREADS) {
+			arrived = 0;
+			generation++;
+			arrived_cv.notify_all();
+		} else {
+			arrived_cv.wait(lock, [&]() {
+				return generation != g;
+			});
+		}
+	}
+
+public:
+	/*
+	 * Returns x of the thread with rank src_rank, for the thread with rank
+	 * rank.
+	 */
+	uint64_t exchange(const unsigned int &rank, const uint64_t &x, const unsigned int &src_rank) {
+		std::unique_lock<std::mutex> lock(mutex);
+
+		slots[rank] = x;
+		barrier(lock);
+		const uint64_t y = slots[src_rank];
+		barrier(lock);
+
+		return y;
+	}
+
+	unsigned int ballot(const unsigned int &rank, const bool &predicate) {
+		std::unique_lock<std::mutex> lock(mutex);
+
+		slots[rank] = predicate;
+		barrier(lock);
+
+		unsigned int result = 0;
+
+		for (size_t i = 0; i < THREADS; i++) {
+			result |= (unsigned int) slots[i] << i;
+		}
+
+		barrier(lock);
+
+		return result;
+	}
+
+	template<typename F>
+	void run(const F &f);
+};
+
+/*
+ * Tile of a sim_tile_group, with the functions of
+ * cooperative_groups::thread_block_tile, which bifsi_cg.h uses.
+ */
+template<size_t THREADS>
+class sim_tile {
+	sim_tile_group<THREADS> &group;
+	const unsigned int rank;
+
+public:
+	sim_tile(sim_tile_group<THREADS> &group, const unsigned int &rank) :
+			group(group), rank(rank) {
+	}
+
+	unsigned int thread_rank() const {
+		return rank;
+	}
+
+	template<typename T>
+	T shfl(const T &x, const unsigned int &src_rank) const {
+		return (T) group.exchange(rank, x, src_rank);
+	}
+
+	// like on CUDA, threads without a source get their own value
+	template<typename T>
+	T shfl_up(const T &x, const unsigned int &delta) const {
+		return (T) group.exchange(rank, x, (rank >= delta) ? rank - delta : rank);
+	}
+
+	template<typename T>
+	T shfl_down(const T &x, const unsigned int &delta) const {
+		return (T) group.exchange(rank, x, (rank + delta < THREADS) ? rank + delta : rank);
+	}
+
+	unsigned int ballot(const bool &predicate) const {
+		return group.ballot(rank, predicate);
+	}
+};
+
+template<size_t THREADS>
+template<typename F>
+void sim_tile_group<THREADS>::run(const F &f) {
+	std::vector<std::thread> threads;
+
+	for (unsigned int rank = 0; rank < THREADS; rank++) {
+		threads.emplace_back([this, &f, rank]() {
+			f(sim_tile<THREADS>(*this, rank));
+		});
+	}
+
+	for (std::thread &t : threads) {
+		t.join();
+	}
+}
+
+/*
+ * Checks the cooperative operations of cg_bui and cg_montgomery on values
+ * spread over THREADS simulated threads against bui and montgomery. Half of
+ * the moduli are close to R, so the final subtraction of n is needed often.
+ */
+template<size_t SIZE_IN_BITS, size_t THREADS, typename EL_T>
+int test_cg(size_t test_count, bool with_mod_pow) {
+	typedef bifsi::bui<SIZE_IN_BITS, EL_T> bui_t;
+	typedef bifsi::cg_bui<SIZE_IN_BITS, THREADS, EL_T> cg_bui_t;
+
+	for (size_t i = 0; i < test_count; i++) {
+		bui_t n = bifsi::el_cast<EL_T>(random_bui<SIZE_IN_BITS>());
+		n.el[0] |= 1;
+
+		if (i % 2 == 0) {
+			n.el[bui_t::SIZE_IN_ELS - 1] |= (EL_T) 1 << (bui_t::EL_SIZE_IN_BITS - 1);
+		}
+
+		const bifsi::montgomery<SIZE_IN_BITS, EL_T> mont(n);
+
+		bui_t a = bifsi::el_cast<EL_T>(random_bui<SIZE_IN_BITS>());
+		bui_t b = bifsi::el_cast<EL_T>(random_bui<SIZE_IN_BITS>());
+
+		// carries through whole slices
+		if (i % 4 == 1) {
+			b = 0U;
+			bifsi::els_sub<bui_t::SIZE_IN_ELS, bui_t::SIZE_IN_ELS>(b.el, a.el);
+			b -= (unsigned int) (i % 8 == 1);
+		} else if (i % 4 == 3) {
+			b = a;
+		}
+
+		const bifsi::bui<64, EL_T> e = bifsi::el_cast<EL_T>(random_bui<64>());
+
+		const bui_t a_mont = mont.to_mont(a);
+		const bui_t b_mont = mont.to_mont(b);
+
+		bui_t sum = a;
+		const EL_T carry = bifsi::els_add<bui_t::SIZE_IN_ELS, bui_t::SIZE_IN_ELS>(sum.el, b.el);
+		bui_t diff = a;
+		const EL_T borrow = bifsi::els_sub<bui_t::SIZE_IN_ELS, bui_t::SIZE_IN_ELS>(diff.el, b.el);
+		const bifsi::bui<2 * SIZE_IN_BITS, EL_T> full = bifsi::mul_full(a, b);
+
+		bui_t cg_sum, cg_diff, cg_lo, cg_hi, cg_prod, cg_mont_mul, cg_mod_pow;
+		EL_T cg_carry[THREADS], cg_borrow[THREADS];
+		int cg_cmp[THREADS];
+
+		sim_tile_group<THREADS> group;
+
+		group.run([&](const sim_tile<THREADS> &tile) {
+			const unsigned int rank = tile.thread_rank();
+
+			cg_bui_t x, y, lo, hi;
+			x.load(tile, a);
+			y.load(tile, b);
+
+			cg_bui_t s = x;
+			cg_carry[rank] = s.add(tile, y);
+			s.store(tile, cg_sum);
+
+			cg_bui_t d = x;
+			cg_borrow[rank] = d.sub(tile, y);
+			d.store(tile, cg_diff);
+
+			cg_cmp[rank] = x.compare(tile, y);
+
+			cg_bui_t::mul_full(tile, x, y, lo, hi);
+			lo.store(tile, cg_lo);
+			hi.store(tile, cg_hi);
+
+			cg_bui_t p = x;
+			p.mul(tile, y).store(tile, cg_prod);
+
+			const bifsi::cg_montgomery<SIZE_IN_BITS, THREADS, EL_T> cg_mont(tile, mont);
+
+			cg_mont.mont_mul(tile, cg_bui_t().load(tile, a_mont), cg_bui_t().load(tile, b_mont)).store(tile, cg_mont_mul);
+
+			if (with_mod_pow) {
+				cg_mont.mod_pow(tile, x, e).store(tile, cg_mod_pow);
+			}
+		});
+
+		bool ok = cg_sum == sum && cg_diff == diff //
+				&& cg_lo == bui_t(full) && cg_hi == bui_t(bifsi::bui<2 * SIZE_IN_BITS, EL_T>(full) >>= SIZE_IN_BITS) //
+				&& cg_prod == (bui_t(a) *= b) //
+				&& cg_mont_mul == mont.mont_mul(a_mont, b_mont) //
+				&& (!with_mod_pow || cg_mod_pow == mont.mod_pow(a, e));
+
+		for (size_t r = 0; r < THREADS; r++) {
+			ok &= cg_carry[r] == carry && cg_borrow[r] == borrow && cg_cmp[r] == a.compare(b);
+		}
+
+		if (!ok) {
+			cout << "test failed: cg of " << bifsi::type_name<cg_bui_t>() << ":" << endl;
+			cout << "n: " << n << endl;
+			cout << "a: " << a << endl;
+			cout << "b: " << b << endl;
+			cout << "e: " << e << endl;
+
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+int test_cg() {
+	cout << "running cg tests" << endl;
+
+	int result = 0;
+
+	// the simulated threads synchronize on each shuffle, so the counts are
+	// small
+	result |= test_cg<256, 4, el_t>(40, true);
+	result |= test_cg<256, 8, el_t>(20, false);
+	result |= test_cg<128, 2, uint64_t>(40, true);
+	result |= test_cg<128, 1, uint64_t>(40, true);
+	result |= test_cg<1024, 4, uint8_t>(4, false);
+	result |= test_cg<1024, 16, uint64_t>(2, true);
+	result |= test_cg<4096, 32, el_t>(1, false);
+
+	if (result == 0) {
+		cout << "cg tests completed successfully." << endl;
+	}
+
+	return result;
+}
+
+#ifdef BIFSI_INSTRUMENT
+/*
+ * Checks the counters of bifsi_instrument.h after known numbers of calls, on
+ * this thread and on another one, which has ended before the counters are
+ * collected. Multiplications in constant expressions aren't counted.
+ */
+int test_instrument() {
+	using bifsi::instrument::op;
+
+	typedef bui<256>::el_t el_256_t;
+
+	cout << "running instrument tests" << endl;
+
+	bifsi::instrument::reset();
+
+	constexpr bui<256> C = bui<256>(3U) *= bui<256>(5U);
+	static_assert(C == 15U, "constexpr with instrumentation");
+
+	bui<256> a = random_bui<256>();
+	const bui<256> b = random_bui<256>();
+
+	for (size_t i = 0; i < 10; i++) {
+		a *= b;
+	}
+
+	for (size_t i = 0; i < 3; i++) {
+		a.square();
+	}
+
+	const bui<256> q = bifsi::divmod(a, b).q;
+	a /= bui<64>(12345U);
+
+	// the overloads for scalars
+	a *= 7U;
+	a /= (el_256_t) 1000U;
+	const el_256_t m = a % (el_256_t) 1000U;
+	a /= bifsi::divisor<el_256_t>(1000U);
+	const el_256_t m_d = a % bifsi::divisor<el_256_t>(1000U);
+
+	std::thread t([&]() {
+		bui<256> x = a;
+
+		for (size_t i = 0; i < 5; i++) {
+			x *= b;
+		}
+
+		(void) x.str();
+	});
+
+	t.join();
+
+	const bifsi::instrument::counts c = bifsi::instrument::collect();
+
+	const size_t N = bui<256>::SIZE_IN_ELS;
+
+	// str divides by a divisor for each chunk of decimal digits
+	const size_t STR_DIVS = (bifsi::max_dec_digits<256>() + bifsi::dec_chunk_digits<el_256_t>() - 1) / bifsi::dec_chunk_digits<el_256_t>();
+
+	int result = 0;
+
+	auto check = [&](const char *name, uint64_t expected, uint64_t actual) {
+		if (expected != actual && result == 0) {
+			cout << "test failed: instrument " << name << ": expected " << expected << " but got " << actual << endl;
+			result = 1;
+		}
+	};
+
+	check("mul calls", 15 + 1, c[op::mul].calls);
+	check("mul limb_ops", 15 * N * (N + 1) / 2 + N, c[op::mul].limb_ops);
+	check("sqr calls", 3, c[op::sqr].calls);
+	check("div calls", 2 + 4 + STR_DIVS, c[op::div].calls);
+	check("div limb_ops", N * 1 + (N - 2 + 1) * 2 + 4 * N + STR_DIVS * N, c[op::div].limb_ops);
+	check("str calls", 1, c[op::str].calls);
+	check("mont_mul calls", 0, c[op::mont_mul].calls);
+
+#ifdef BIFSI_INSTRUMENT_CYCLES
+	check("mul samples", (15 + 1) >> BIFSI_INSTRUMENT_SAMPLE_BITS, c[op::mul].samples >> BIFSI_INSTRUMENT_SAMPLE_BITS);
+#endif
+
+	std::ostringstream os;
+	bifsi::instrument::dump(os, c);
+
+	if (os.str().find("mul") == string::npos || os.str().find("mont_mul") != string::npos) {
+		cout << "test failed: instrument dump:" << endl << os.str();
+		result = 1;
+	}
+
+	bifsi::instrument::reset();
+	check("calls after reset", 0, bifsi::instrument::collect()[op::mul].calls);
+
+	(void) q;
+	(void) m;
+	(void) m_d;
+
+	if (result == 0) {
+		cout << "instrument tests completed successfully." << endl;
+	}
+
+	return result;
+}
+#endif
+
+int main() {
+	int result = 0;
+
+	result |= test_primitives();
+	result |= test_scalar_ops();
+	result |= test_conversions();
+	result |= test_compare();
+	result |= test_signed();
+	result |= test_mul();
+	result |= test_shift();
+	result |= test_montgomery();
+	result |= test_pow();
+	result |= test_mod();
+	result |= test_prime();
+	result |= test_gcd();
+	result |= test_divmod();
+	result |= test_str();
+	result |= test_from_chars();
+	result |= test_vartime();
+	result |= test_cg();
+	result |= test_io();
+	result |= test_batch();
+	result |= test_host();
+	result |= test_el_types();
+#ifdef BIFSI_INSTRUMENT
+	result |= test_instrument();
+#endif
+
+	return result;
+}